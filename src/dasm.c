@@ -232,7 +232,131 @@ static const char *MNEMONICS[NUM_OPCODES] = {
     "ORFI",    "POP",    "POPB",   "POPH",   "POPF",    "PUSHB",   "PUSHH",
     "PUSHF",   "PUSHNB", "PUSHNH", "PUSHNF", "SETADR",  "SETADRB", "SUB",
     "SUBF",    "SUBBI",  "SUBHI",  "SUBFI",  "SYSCALL", "XOR",     "XORBI",
-    "XORHI",   "XORFI"};
+    "XORHI",   "XORFI",
+
+    // Superinstructions.
+    "ADDBI_JRBI", "CEQ_JRCONBI", "CLEQ_JRCONBI", "CLT_JRCONBI", "CMEQ_JRCONBI",
+    "CMT_JRCONBI", "GETBI_ADDBI", "GETBI_GETBI", "GETBI_GETBI_ADD",
+    "GETBI_SUBBI", "PUSHB_GETBI", "PUSHB_SYSCALL", "SYSCALL_POP"};
+
+/**
+ * \fn static void asm_immediates_dump(DIns opcode, char *ins)
+ * \brief Print the immediates of an instruction to stdout.
+ *
+ * \param opcode The opcode of the instruction.
+ * \param ins A pointer to the first byte of the instruction.
+ */
+static void asm_immediates_dump(DIns opcode, char *ins) {
+    bimmediate_t b2;
+
+    // We group together instructions with the same "format" to simplify.
+    switch (opcode) {
+        // Byte Immediate.
+        case OP_RETN:
+        case OP_ADDBI:
+        case OP_ANDBI:
+        case OP_CALL:
+        case OP_CALLC:
+        case OP_CALLR:
+        case OP_DIVBI:
+        case OP_GETBI:
+        case OP_JRBI:
+        case OP_JRCONBI:
+        case OP_MODBI:
+        case OP_MULBI:
+        case OP_ORBI:
+        case OP_POPB:
+        case OP_PUSHB:
+        case OP_PUSHNB:
+        case OP_SUBBI:
+        case OP_SYSCALL:
+        case OP_XORBI:;
+            bimmediate_t b = *(bimmediate_t *)(ins + 1);
+            printf("0x%" BIMMEDIATE_PRINTF "x (%" BIMMEDIATE_PRINTF "d)", b,
+                   b);
+            break;
+
+        // Half Immediate.
+        case OP_ADDHI:
+        case OP_ANDHI:
+        case OP_DIVHI:
+        case OP_GETHI:
+        case OP_JRHI:
+        case OP_JRCONHI:
+        case OP_MODHI:
+        case OP_MULHI:
+        case OP_ORHI:
+        case OP_POPH:
+        case OP_PUSHH:
+        case OP_PUSHNH:
+        case OP_SUBHI:
+        case OP_XORHI:;
+            himmediate_t h = *(himmediate_t *)(ins + 1);
+            printf("0x%" HIMMEDIATE_PRINTF "x (%" HIMMEDIATE_PRINTF "d)", h,
+                   h);
+            break;
+
+        // Full Immediate.
+        case OP_ADDFI:
+        case OP_ANDFI:
+        case OP_DEREFI:
+        case OP_DEREFBI:
+        case OP_DIVFI:
+        case OP_GETFI:
+        case OP_JCONI:
+        case OP_JI:
+        case OP_JRFI:
+        case OP_JRCONFI:
+        case OP_MODFI:
+        case OP_MULFI:
+        case OP_ORFI:
+        case OP_POPF:
+        case OP_PUSHF:
+        case OP_PUSHNF:
+        case OP_SUBFI:
+        case OP_XORFI:;
+            fimmediate_t f = *(fimmediate_t *)(ins + 1);
+            printf("0x%" FIMMEDIATE_PRINTF "x (%" FIMMEDIATE_PRINTF "d)", f,
+                   f);
+            break;
+
+        // Byte Immediate + Byte Immediate.
+        case OP_CALLRB:;
+            bimmediate_t b1 = *(bimmediate_t *)(ins + 1);
+            b2              = *(bimmediate_t *)(ins + 1 + BIMMEDIATE_SIZE);
+            printf("0x%" BIMMEDIATE_PRINTF "x (%" BIMMEDIATE_PRINTF
+                   "d), 0x%" BIMMEDIATE_PRINTF "x (%" BIMMEDIATE_PRINTF
+                   "d)",
+                   b1, b1, b2, b2);
+            break;
+
+        // Half Immediate + Byte Immediate.
+        case OP_CALLRH:;
+            himmediate_t h1 = *(himmediate_t *)(ins + 1);
+            b2              = *(bimmediate_t *)(ins + 1 + HIMMEDIATE_SIZE);
+            printf("0x%" HIMMEDIATE_PRINTF "x (%" HIMMEDIATE_PRINTF
+                   "d), 0x%" BIMMEDIATE_PRINTF "x (%" BIMMEDIATE_PRINTF
+                   "d)",
+                   h1, h1, b2, b2);
+            break;
+
+        // Full Immediate + Byte Immediate.
+        case OP_CALLCI:
+        case OP_CALLI:
+        case OP_CALLRF:;
+            fimmediate_t f1 = *(fimmediate_t *)(ins + 1);
+            b2              = *(bimmediate_t *)(ins + 1 + FIMMEDIATE_SIZE);
+            printf("0x%" FIMMEDIATE_PRINTF "x (%" FIMMEDIATE_PRINTF
+                   "d), 0x%" BIMMEDIATE_PRINTF "x (%" BIMMEDIATE_PRINTF
+                   "d)",
+                   f1, f1, b2, b2);
+            break;
+
+        // No immediates.
+        default:
+            break;
+    }
+}
 
 /**
  * \fn void d_asm_text_dump(char *code, size_t size)
@@ -272,114 +396,30 @@ DECISION_API void d_asm_text_dump(char *code, size_t size) {
 
         printf("\t%s ", mnemonic);
 
-        bimmediate_t b2;
-
-        // We group together instructions with the same "format" to simplify.
-        switch (opcode) {
-            // Byte Immediate.
-            case OP_RETN:
-            case OP_ADDBI:
-            case OP_ANDBI:
-            case OP_CALL:
-            case OP_CALLC:
-            case OP_CALLR:
-            case OP_DIVBI:
-            case OP_GETBI:
-            case OP_JRBI:
-            case OP_JRCONBI:
-            case OP_MODBI:
-            case OP_MULBI:
-            case OP_ORBI:
-            case OP_POPB:
-            case OP_PUSHB:
-            case OP_PUSHNB:
-            case OP_SUBBI:
-            case OP_SYSCALL:
-            case OP_XORBI:;
-                bimmediate_t b = *(bimmediate_t *)(ins + 1);
-                printf("0x%" BIMMEDIATE_PRINTF "x (%" BIMMEDIATE_PRINTF "d)", b,
-                       b);
-                break;
-
-            // Half Immediate.
-            case OP_ADDHI:
-            case OP_ANDHI:
-            case OP_DIVHI:
-            case OP_GETHI:
-            case OP_JRHI:
-            case OP_JRCONHI:
-            case OP_MODHI:
-            case OP_MULHI:
-            case OP_ORHI:
-            case OP_POPH:
-            case OP_PUSHH:
-            case OP_PUSHNH:
-            case OP_SUBHI:
-            case OP_XORHI:;
-                himmediate_t h = *(himmediate_t *)(ins + 1);
-                printf("0x%" HIMMEDIATE_PRINTF "x (%" HIMMEDIATE_PRINTF "d)", h,
-                       h);
-                break;
+        // Superinstructions have the immediates of each instruction they
+        // replace, in the same places.
+        const SuperIns *superIns = d_vm_superins(opcode);
 
-            // Full Immediate.
-            case OP_ADDFI:
-            case OP_ANDFI:
-            case OP_DEREFI:
-            case OP_DEREFBI:
-            case OP_DIVFI:
-            case OP_GETFI:
-            case OP_JCONI:
-            case OP_JI:
-            case OP_JRFI:
-            case OP_JRCONFI:
-            case OP_MODFI:
-            case OP_MULFI:
-            case OP_ORFI:
-            case OP_POPF:
-            case OP_PUSHF:
-            case OP_PUSHNF:
-            case OP_SUBFI:
-            case OP_XORFI:;
-                fimmediate_t f = *(fimmediate_t *)(ins + 1);
-                printf("0x%" FIMMEDIATE_PRINTF "x (%" FIMMEDIATE_PRINTF "d)", f,
-                       f);
-                break;
+        if (superIns != NULL) {
+            char *part  = ins;
+            bool spaced = false;
 
-            // Byte Immediate + Byte Immediate.
-            case OP_CALLRB:;
-                bimmediate_t b1 = *(bimmediate_t *)(ins + 1);
-                b2              = *(bimmediate_t *)(ins + 1 + BIMMEDIATE_SIZE);
-                printf("0x%" BIMMEDIATE_PRINTF "x (%" BIMMEDIATE_PRINTF
-                       "d), 0x%" BIMMEDIATE_PRINTF "x (%" BIMMEDIATE_PRINTF
-                       "d)",
-                       b1, b1, b2, b2);
-                break;
+            for (unsigned char j = 0; j < superIns->length; j++) {
+                const DIns partOpcode = superIns->sequence[j];
 
-            // Half Immediate + Byte Immediate.
-            case OP_CALLRH:;
-                himmediate_t h1 = *(himmediate_t *)(ins + 1);
-                b2              = *(bimmediate_t *)(ins + 1 + HIMMEDIATE_SIZE);
-                printf("0x%" HIMMEDIATE_PRINTF "x (%" HIMMEDIATE_PRINTF
-                       "d), 0x%" BIMMEDIATE_PRINTF "x (%" BIMMEDIATE_PRINTF
-                       "d)",
-                       h1, h1, b2, b2);
-                break;
+                if (d_vm_ins_size(partOpcode) > 1) {
+                    if (spaced) {
+                        printf(", ");
+                    }
 
-            // Full Immediate + Byte Immediate.
-            case OP_CALLCI:
-            case OP_CALLI:
-            case OP_CALLRF:;
-                fimmediate_t f1 = *(fimmediate_t *)(ins + 1);
-                b2              = *(bimmediate_t *)(ins + 1 + FIMMEDIATE_SIZE);
-                printf("0x%" FIMMEDIATE_PRINTF "x (%" FIMMEDIATE_PRINTF
-                       "d), 0x%" BIMMEDIATE_PRINTF "x (%" BIMMEDIATE_PRINTF
-                       "d)",
-                       f1, f1, b2, b2);
-                break;
+                    asm_immediates_dump(partOpcode, part);
+                    spaced = true;
+                }
 
-            // No immediates.
-            default:
-                break;
+                part += d_vm_ins_size(partOpcode);
+            }
+        } else {
+            asm_immediates_dump(opcode, ins);
         }
 
         printf("\n");
@@ -548,4 +588,206 @@ void d_asm_dump_all(Sheet *sheet) {
     d_asm_incl_dump(sheet->includes, sheet->numIncludes);
 
     printf("\n");
-}
\ No newline at end of file
+}
+/**
+ * \fn void d_asm_count_sequences(AsmSequenceStats *stats, char *code,
+ *                                size_t size)
+ * \brief Count how many times each sequence of 2 to `ASM_SEQUENCE_MAX_LEN`
+ * opcodes appears in some machine code, and add the counts to `stats`.
+ *
+ * Superinstructions are counted as the sequence of opcodes they replace, and
+ * sequences are not counted if execution could leave or enter them part of
+ * the way through, i.e. over jumps, calls and jump targets.
+ *
+ * \param stats The statistics to add to.
+ * \param code The machine code array to count.
+ * \param size The size of the machine code array.
+ */
+void d_asm_count_sequences(AsmSequenceStats *stats, char *code, size_t size) {
+    if (size == 0) {
+        return;
+    }
+
+    // Firstly, find out what the opcodes are, where they are, and which
+    // instructions can be jumped to. Since superinstructions are counted as
+    // the opcodes they replace, the opcodes of the rest of the sequence are
+    // where they would be without the superinstruction.
+    DIns *opcodes   = d_calloc(size, sizeof(DIns));
+    size_t *offsets = d_calloc(size, sizeof(size_t));
+    bool *isTarget  = d_calloc(size, sizeof(bool));
+    size_t numOps   = 0;
+
+    for (size_t i = 0; i < size;) {
+        const DIns opcode           = (unsigned char)code[i];
+        const unsigned char insSize = d_vm_ins_size(opcode);
+
+        // If the text section is borked, don't go into an infinite loop.
+        if (insSize == 0) {
+            break;
+        }
+
+        // Where is the last opcode of the instruction? This is only different
+        // to the start of the instruction for superinstructions.
+        size_t last = i;
+
+        const SuperIns *superIns = d_vm_superins(opcode);
+        if (superIns != NULL) {
+            for (unsigned char j = 0; j < superIns->length; j++) {
+                opcodes[numOps] = superIns->sequence[j];
+                offsets[numOps] = last;
+                numOps++;
+
+                if (j < superIns->length - 1) {
+                    last += d_vm_ins_size(superIns->sequence[j]);
+                }
+            }
+        } else {
+            opcodes[numOps] = opcode;
+            offsets[numOps] = i;
+            numOps++;
+        }
+
+        // Relative jumps and calls have the amount as the first immediate.
+        const char *immediate = code + last + 1;
+        dint jmpAmt           = 0;
+
+        switch (opcodes[numOps - 1]) {
+            case OP_CALLRB:
+            case OP_JRBI:
+            case OP_JRCONBI:
+                jmpAmt = *(bimmediate_t *)immediate;
+                break;
+            case OP_CALLRH:
+            case OP_JRHI:
+            case OP_JRCONHI:
+                jmpAmt = *(himmediate_t *)immediate;
+                break;
+            case OP_CALLRF:
+            case OP_JRFI:
+            case OP_JRCONFI:
+                jmpAmt = *(fimmediate_t *)immediate;
+                break;
+            default:
+                break;
+        }
+
+        if (jmpAmt != 0 && (dint)last + jmpAmt >= 0 &&
+            (size_t)((dint)last + jmpAmt) < size) {
+            isTarget[last + jmpAmt] = true;
+        }
+
+        i += insSize;
+    }
+
+    // Now count the sequences.
+    for (size_t start = 0; start < numOps; start++) {
+        for (unsigned char len = 2; len <= ASM_SEQUENCE_MAX_LEN; len++) {
+            if (start + len > numOps) {
+                break;
+            }
+
+            // Execution can't leave part of the way through the sequence, or
+            // jump into the middle of it.
+            const size_t end = start + len - 1;
+            if (d_vm_ins_changes_flow(opcodes[end - 1]) ||
+                isTarget[offsets[end]]) {
+                break;
+            }
+
+            // Find the sequence in the list, or add it if it's new.
+            AsmSequence *seq = NULL;
+            for (size_t s = 0; s < stats->numSequences; s++) {
+                AsmSequence *other = stats->sequences + s;
+                if (other->length == len &&
+                    memcmp(other->opcodes, opcodes + start,
+                           len * sizeof(DIns)) == 0) {
+                    seq = other;
+                    break;
+                }
+            }
+
+            if (seq == NULL) {
+                stats->numSequences++;
+                stats->sequences =
+                    d_realloc(stats->sequences,
+                              stats->numSequences * sizeof(AsmSequence));
+
+                seq         = stats->sequences + stats->numSequences - 1;
+                seq->length = len;
+                seq->count  = 0;
+                memcpy(seq->opcodes, opcodes + start, len * sizeof(DIns));
+            }
+
+            seq->count++;
+        }
+    }
+
+    stats->numIns += numOps;
+
+    free(opcodes);
+    free(offsets);
+    free(isTarget);
+}
+
+/* Used by qsort to put the most common sequences first. */
+static int compare_sequences(const void *a, const void *b) {
+    const AsmSequence *seqA = (const AsmSequence *)a;
+    const AsmSequence *seqB = (const AsmSequence *)b;
+
+    if (seqA->count != seqB->count) {
+        return (seqA->count < seqB->count) ? 1 : -1;
+    }
+
+    return (int)seqA->length - (int)seqB->length;
+}
+
+/**
+ * \fn void d_asm_sequences_dump(AsmSequenceStats stats, size_t max)
+ * \brief Print the most common opcode sequences to stdout.
+ *
+ * \param stats The statistics to print.
+ * \param max The maximum number of sequences to print for each length.
+ */
+void d_asm_sequences_dump(AsmSequenceStats stats, size_t max) {
+    printf("Counted %zu instructions.\n", stats.numIns);
+
+    if (stats.numSequences > 0) {
+        qsort(stats.sequences, stats.numSequences, sizeof(AsmSequence),
+              compare_sequences);
+    }
+
+    for (unsigned char len = 2; len <= ASM_SEQUENCE_MAX_LEN; len++) {
+        printf("\nMost common sequences of %u instructions:\n", len);
+
+        size_t numPrinted = 0;
+        for (size_t i = 0; i < stats.numSequences && numPrinted < max; i++) {
+            AsmSequence seq = stats.sequences[i];
+
+            if (seq.length == len) {
+                printf("%8zu\t", seq.count);
+
+                for (unsigned char j = 0; j < seq.length; j++) {
+                    printf("%s%s", (j > 0) ? "; " : "",
+                           MNEMONICS[seq.opcodes[j]]);
+                }
+
+                printf("\n");
+                numPrinted++;
+            }
+        }
+    }
+}
+
+/**
+ * \fn void d_asm_free_sequences(AsmSequenceStats *stats)
+ * \brief Free the malloc'd elements of sequence statistics.
+ *
+ * \param stats The statistics to free.
+ */
+void d_asm_free_sequences(AsmSequenceStats *stats) {
+    if (stats->sequences != NULL) {
+        free(stats->sequences);
+    }
+
+    *stats = NO_SEQUENCE_STATS;
+}
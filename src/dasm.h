@@ -58,6 +58,49 @@ typedef struct _bcode {
     size_t linkListSize;         ///< The size of the `linkList` array.
 } BCode;
 
+/**
+ * \def ASM_SEQUENCE_MAX_LEN
+ * \brief The length of the longest opcode sequence that
+ * `d_asm_count_sequences` counts.
+ */
+#define ASM_SEQUENCE_MAX_LEN 3
+
+/**
+ * \struct _asmSequence
+ * \brief A sequence of opcodes, and how many times it has been seen.
+ *
+ * \typedef struct _asmSequence AsmSequence
+ */
+typedef struct _asmSequence {
+    DIns opcodes[ASM_SEQUENCE_MAX_LEN]; ///< The opcodes in the sequence.
+    unsigned char length;               ///< The number of opcodes.
+    size_t count; ///< How many times the sequence has been seen.
+} AsmSequence;
+
+/**
+ * \struct _asmSequenceStats
+ * \brief How often sequences of opcodes appear in one or more text sections.
+ *
+ * This is used to decide which sequences are worth fusing into
+ * superinstructions.
+ *
+ * \typedef struct _asmSequenceStats AsmSequenceStats
+ */
+typedef struct _asmSequenceStats {
+    AsmSequence *sequences; ///< The sequences that have been seen.
+    size_t numSequences;    ///< The number of different sequences.
+    size_t numIns;          ///< The total number of instructions counted.
+} AsmSequenceStats;
+
+/**
+ * \def NO_SEQUENCE_STATS
+ * \brief An empty set of sequence statistics.
+ */
+#define NO_SEQUENCE_STATS \
+    (AsmSequenceStats) {  \
+        NULL, 0, 0        \
+    }
+
 /*
 === STRUCTURE FUNCTIONS ===================================
 */
@@ -186,4 +229,38 @@ DECISION_API void d_asm_incl_dump(struct _sheet **includes, size_t size);
  */
 DECISION_API void d_asm_dump_all(struct _sheet *sheet);
 
+/**
+ * \fn void d_asm_count_sequences(AsmSequenceStats *stats, char *code,
+ *                                size_t size)
+ * \brief Count how many times each sequence of 2 to `ASM_SEQUENCE_MAX_LEN`
+ * opcodes appears in some machine code, and add the counts to `stats`.
+ *
+ * Superinstructions are counted as the sequence of opcodes they replace, and
+ * sequences are not counted if execution could leave or enter them part of
+ * the way through, i.e. over jumps, calls and jump targets.
+ *
+ * \param stats The statistics to add to.
+ * \param code The machine code array to count.
+ * \param size The size of the machine code array.
+ */
+DECISION_API void d_asm_count_sequences(AsmSequenceStats *stats, char *code,
+                                        size_t size);
+
+/**
+ * \fn void d_asm_sequences_dump(AsmSequenceStats stats, size_t max)
+ * \brief Print the most common opcode sequences to stdout.
+ *
+ * \param stats The statistics to print.
+ * \param max The maximum number of sequences to print for each length.
+ */
+DECISION_API void d_asm_sequences_dump(AsmSequenceStats stats, size_t max);
+
+/**
+ * \fn void d_asm_free_sequences(AsmSequenceStats *stats)
+ * \brief Free the malloc'd elements of sequence statistics.
+ *
+ * \param stats The statistics to free.
+ */
+DECISION_API void d_asm_free_sequences(AsmSequenceStats *stats);
+
 #endif // DASM_H
@@ -0,0 +1,842 @@
+/*
+    Decision
+    Copyright (C) 2019-2020  Benjamin Beddows
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "dcache.h"
+
+#include "dcontext.h"
+#include "decision.h"
+#include "dmalloc.h"
+#include "dobj.h"
+#include "dsheet.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#if defined(_WIN32)
+#include <direct.h>
+#include <io.h>
+#include <process.h>
+#else
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+/* The first bytes of every file in the cache. The last byte is the version of
+   the layout of the file, which should change if the layout does. */
+static const char CACHE_MAGIC[4] = {'D', 'C', 'C', 1};
+
+/* The extension of files that are still being written. */
+#define CACHE_TEMP_EXTENSION ".tmp"
+
+/* The number of characters in a key written in hex. */
+#define CACHE_KEY_HEX_LEN (2 * sizeof(uint64_t))
+
+/* The constants of the 64-bit FNV-1a hash. */
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+/* A static global variable holding the directory of the cache, or NULL if
+   the cache is disabled. */
+static char *cacheDir = NULL;
+
+/* Static global variables holding the statistics of the cache. Threads
+   compiling at the same time share them, so they are only used while holding
+   LOCK_COMPILE_CACHE, along with numTempFiles. */
+static size_t cacheHits   = 0;
+static size_t cacheMisses = 0;
+static size_t cacheWrites = 0;
+
+/* A static global variable holding how many temporary files this process has
+   written, so they all get different names. */
+static unsigned long numTempFiles = 0;
+
+/**
+ * \struct _cacheDependency
+ * \brief A file that a cached object file was compiled with, and the hash of
+ * its contents at the time.
+ *
+ * \typedef struct _cacheDependency CacheDependency
+ */
+typedef struct _cacheDependency {
+    char *path;    ///< The absolute path of the file.
+    uint64_t hash; ///< The hash of the contents of the file.
+} CacheDependency;
+
+/**
+ * \fn static uint64_t hash_bytes(uint64_t hash, const void *bytes,
+ *                                size_t size)
+ * \brief Add some bytes to a 64-bit FNV-1a hash.
+ *
+ * \return The new hash.
+ *
+ * \param hash The hash so far. Start with `FNV_OFFSET_BASIS`.
+ * \param bytes The bytes to add to the hash.
+ * \param size The number of bytes to add.
+ */
+static uint64_t hash_bytes(uint64_t hash, const void *bytes, size_t size) {
+    const unsigned char *ptr = (const unsigned char *)bytes;
+
+    for (size_t i = 0; i < size; i++) {
+        hash ^= ptr[i];
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+
+/**
+ * \fn static char *copy_string(const char *str)
+ * \brief Make a malloc'd copy of a string.
+ *
+ * \return The copy of the string.
+ *
+ * \param str The string to copy.
+ */
+static char *copy_string(const char *str) {
+    const size_t len = strlen(str);
+    char *copy       = d_calloc(len + 1, sizeof(char));
+    memcpy(copy, str, len + 1);
+
+    return copy;
+}
+
+/**
+ * \fn static char *canonical_path(const char *filePath)
+ * \brief Get the absolute path of a file, so it is the same no matter which
+ * directory the process is running in.
+ *
+ * \return The malloc'd absolute path, or `NULL` if the file doesn't exist.
+ *
+ * \param filePath The path of the file.
+ */
+static char *canonical_path(const char *filePath) {
+#if defined(_WIN32)
+    return _fullpath(NULL, filePath, 0);
+#elif defined(__unix__) || defined(__APPLE__)
+    return realpath(filePath, NULL);
+#else
+    return copy_string(filePath);
+#endif
+}
+
+/**
+ * \fn static char *read_file(const char *filePath, size_t *size)
+ * \brief Read the whole of a file into memory.
+ *
+ * \return The malloc'd contents of the file, or `NULL` if it couldn't be
+ * read.
+ *
+ * \param filePath The path of the file to read.
+ * \param size Set to the size of the file in bytes.
+ */
+static char *read_file(const char *filePath, size_t *size) {
+    FILE *f = fopen(filePath, "rb");
+    if (f == NULL) {
+        return NULL;
+    }
+
+    fseek(f, 0, SEEK_END);
+    long fSize = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    if (fSize < 0) {
+        fclose(f);
+        return NULL;
+    }
+
+    // Always allocate at least one byte, even for empty files.
+    char *contents = d_malloc((size_t)fSize + 1);
+
+    if (fread(contents, 1, (size_t)fSize, f) != (size_t)fSize) {
+        free(contents);
+        fclose(f);
+        return NULL;
+    }
+
+    fclose(f);
+
+    *size = (size_t)fSize;
+    return contents;
+}
+
+/**
+ * \fn static bool hash_file(const char *filePath, uint64_t *hash)
+ * \brief Hash the contents of a file.
+ *
+ * \return If the file could be read.
+ *
+ * \param filePath The path of the file to hash.
+ * \param hash Set to the hash of the file.
+ */
+static bool hash_file(const char *filePath, uint64_t *hash) {
+    size_t size;
+    char *contents = read_file(filePath, &size);
+
+    if (contents == NULL) {
+        return false;
+    }
+
+    *hash = hash_bytes(FNV_OFFSET_BASIS, contents, size);
+    free(contents);
+
+    return true;
+}
+
+/**
+ * \fn static bool is_cacheable(CompileOptions *options)
+ * \brief Check if sheets compiled with some options can be cached.
+ *
+ * Object files don't have debugging information, and sheets given as initial
+ * includes can't be saved in the cache.
+ *
+ * \return If the sheets can be cached.
+ *
+ * \param options The compile options. Can be `NULL` for the default options.
+ */
+static bool is_cacheable(CompileOptions *options) {
+    if (cacheDir == NULL) {
+        return false;
+    }
+
+    return options == NULL || (!options->debug && options->includes == NULL);
+}
+
+/**
+ * \fn static uint64_t cache_key(const char *canonicalPath, const char *source,
+ *                               size_t sourceSize, CompileOptions *options)
+ * \brief Get the key of a source file in the cache.
+ *
+ * \return The key of the source file.
+ *
+ * \param canonicalPath The absolute path of the source file.
+ * \param source The contents of the source file.
+ * \param sourceSize The size of the source file in bytes.
+ * \param options The compile options. Can be `NULL` for the default options.
+ */
+static uint64_t cache_key(const char *canonicalPath, const char *source,
+                          size_t sourceSize, CompileOptions *options) {
+    CompileOptions opts = DEFAULT_COMPILE_OPTIONS;
+    if (options != NULL) {
+        opts = *options;
+    }
+
+    // Object files change between versions, and between 32 and 64-bit
+    // builds.
+    const char *version = "Decision " DECISION_VERSION;
+    const char dintSize = (char)sizeof(dint);
+
+    const char flags[2] = {opts.jit, opts.tiered};
+
+    uint64_t hash = FNV_OFFSET_BASIS;
+    hash          = hash_bytes(hash, version, strlen(version) + 1);
+    hash          = hash_bytes(hash, &dintSize, 1);
+    hash          = hash_bytes(hash, flags, sizeof(flags));
+
+    // Includes are found relative to the source file, so the same source
+    // code in a different directory could compile differently.
+    hash = hash_bytes(hash, canonicalPath, strlen(canonicalPath) + 1);
+    hash = hash_bytes(hash, source, sourceSize);
+
+    return hash;
+}
+
+/**
+ * \fn static char *entry_path(const char *dir, uint64_t key,
+ *                             const char *extension)
+ * \brief Get the path of a file in the cache.
+ *
+ * \return The malloc'd path of the file, or `NULL` if it couldn't be made.
+ *
+ * \param dir The directory of the cache.
+ * \param key The key of the source file.
+ * \param extension What to put at the end of the file name.
+ */
+static char *entry_path(const char *dir, uint64_t key, const char *extension) {
+    // The name of the file is the key in hex, then the extension.
+    const size_t dirLen   = strlen(dir);
+    const size_t nameSize = CACHE_KEY_HEX_LEN + strlen(extension) + 1;
+    char *path            = d_calloc(dirLen + 1 + nameSize, sizeof(char));
+
+    memcpy(path, dir, dirLen);
+    path[dirLen] = '/';
+
+    const int nameLen = snprintf(path + dirLen + 1, nameSize, "%016llx%s",
+                                 (unsigned long long)key, extension);
+
+    if (nameLen < 0 || (size_t)nameLen >= nameSize) {
+        free(path);
+        return NULL;
+    }
+
+    return path;
+}
+
+/**
+ * \fn static void free_dependencies(CacheDependency *deps, size_t numDeps)
+ * \brief Free a list of dependencies.
+ *
+ * \param deps The list of dependencies.
+ * \param numDeps The number of dependencies in the list.
+ */
+static void free_dependencies(CacheDependency *deps, size_t numDeps) {
+    for (size_t i = 0; i < numDeps; i++) {
+        free(deps[i].path);
+    }
+
+    free(deps);
+}
+
+/**
+ * \fn static bool collect_dependencies(struct _sheet *sheet,
+ *                                      CacheDependency **deps,
+ *                                      size_t *numDeps)
+ * \brief Recursively find every file a sheet included, and hash them.
+ *
+ * \return If every included file could be read.
+ *
+ * \param sheet The sheet to find the includes of.
+ * \param deps The list of dependencies to add to.
+ * \param numDeps The number of dependencies in the list.
+ */
+static bool collect_dependencies(Sheet *sheet, CacheDependency **deps,
+                                 size_t *numDeps) {
+    for (size_t i = 0; i < sheet->numIncludes; i++) {
+        Sheet *include = sheet->includes[i];
+
+        // Sheets that weren't included from a file don't have a file to
+        // depend on.
+        if (include->includePath == NULL) {
+            continue;
+        }
+
+        char *path = canonical_path(include->filePath);
+        if (path == NULL) {
+            return false;
+        }
+
+        // With diamond includes, we might have seen this file already.
+        bool seen = false;
+        for (size_t j = 0; j < *numDeps; j++) {
+            if (strcmp((*deps)[j].path, path) == 0) {
+                seen = true;
+                break;
+            }
+        }
+
+        if (seen) {
+            free(path);
+            continue;
+        }
+
+        CacheDependency dep;
+        dep.path = path;
+
+        if (!hash_file(path, &(dep.hash))) {
+            free(path);
+            return false;
+        }
+
+        *deps = d_realloc(*deps, (*numDeps + 1) * sizeof(CacheDependency));
+        (*deps)[(*numDeps)++] = dep;
+
+        if (!collect_dependencies(include, deps, numDeps)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * \fn static bool replace_file(const char *from, const char *to)
+ * \brief Move a file over another file.
+ *
+ * \return If the file was moved.
+ *
+ * \param from The file to move.
+ * \param to Where to move the file to.
+ */
+static bool replace_file(const char *from, const char *to) {
+#if defined(_WIN32)
+    // rename won't replace a file on Windows, so get rid of the old one
+    // first. Another process could sneak in between, in which case we just
+    // don't cache this file - the file we lost to is just as good.
+    remove(to);
+#endif
+
+    // On POSIX systems, rename replaces the file atomically, so other
+    // processes either see the old file or the new one, never a mix.
+    return rename(from, to) == 0;
+}
+
+/**
+ * \fn void d_compile_cache_set_dir(const char *dir)
+ * \brief Set the directory of the compilation cache, creating it if it
+ * doesn't exist. The cache is disabled by default.
+ *
+ * When the cache is enabled, `d_load_source_file` checks the cache for an
+ * object file compiled from the same source code, and loads that instead if
+ * it can. Otherwise, it compiles the source code as usual, and puts the object
+ * file in the cache.
+ *
+ * An object file is only loaded from the cache if it was compiled from the
+ * same file, with the same contents, by the same version of Decision with the
+ * same compile options, and none of the files it includes have changed since.
+ * Sheets that are compiled in debug mode, or with initial includes, are never
+ * cached.
+ *
+ * The directory is shared by every thread, so it should be set before any
+ * threads start compiling.
+ *
+ * \param dir The directory to keep the cache in. If `NULL`, the cache is
+ * disabled.
+ */
+void d_compile_cache_set_dir(const char *dir) {
+    if (cacheDir != NULL) {
+        free(cacheDir);
+        cacheDir = NULL;
+    }
+
+    if (dir != NULL) {
+        cacheDir = copy_string(dir);
+
+        // If the directory already exists, this fails, which is fine.
+#if defined(_WIN32)
+        _mkdir(cacheDir);
+#else
+        mkdir(cacheDir, 0777);
+#endif
+    }
+}
+
+/**
+ * \fn const char *d_compile_cache_get_dir()
+ * \brief Get the directory of the compilation cache.
+ *
+ * \return The directory of the cache, or `NULL` if the cache is disabled.
+ */
+const char *d_compile_cache_get_dir() {
+    return cacheDir;
+}
+
+/**
+ * \fn static bool is_cache_file(const char *name)
+ * \brief Check if a file in the cache directory belongs to the cache.
+ *
+ * \return If the file is a cached object file, or a temporary file.
+ *
+ * \param name The name of the file.
+ */
+static bool is_cache_file(const char *name) {
+    const size_t nameLen = strlen(name);
+    const char *exts[]   = {COMPILE_CACHE_EXTENSION, CACHE_TEMP_EXTENSION};
+
+    for (size_t i = 0; i < 2; i++) {
+        const size_t extLen = strlen(exts[i]);
+
+        if (nameLen > extLen &&
+            strcmp(name + nameLen - extLen, exts[i]) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * \fn static bool remove_cache_file(const char *dir, const char *name)
+ * \brief Delete a file in the cache directory, if it belongs to the cache.
+ *
+ * \return If the file didn't belong to the cache, or it was deleted.
+ *
+ * \param dir The directory of the cache.
+ * \param name The name of the file.
+ */
+static bool remove_cache_file(const char *dir, const char *name) {
+    if (!is_cache_file(name)) {
+        return true;
+    }
+
+    const size_t dirLen = strlen(dir);
+    char *path = d_calloc(dirLen + 1 + strlen(name) + 1, sizeof(char));
+
+    memcpy(path, dir, dirLen);
+    path[dirLen] = '/';
+    strcpy(path + dirLen + 1, name);
+
+    bool removed = remove(path) == 0;
+    free(path);
+
+    return removed;
+}
+
+/**
+ * \fn bool d_compile_cache_clear(const char *dir)
+ * \brief Delete every file in the compilation cache.
+ *
+ * \return If every cached file could be deleted.
+ *
+ * \param dir The directory of the cache to clear. If `NULL`, the directory
+ * set with `d_compile_cache_set_dir` is cleared.
+ */
+bool d_compile_cache_clear(const char *dir) {
+    if (dir == NULL) {
+        dir = cacheDir;
+    }
+
+    // No cache, nothing to clear.
+    if (dir == NULL) {
+        return true;
+    }
+
+    bool success = true;
+
+#if defined(_WIN32)
+    const size_t dirLen = strlen(dir);
+    char *pattern       = d_calloc(dirLen + 3, sizeof(char));
+    memcpy(pattern, dir, dirLen);
+    strcpy(pattern + dirLen, "/*");
+
+    struct _finddata_t fileInfo;
+    intptr_t handle = _findfirst(pattern, &fileInfo);
+
+    if (handle != -1) {
+        do {
+            if (!remove_cache_file(dir, fileInfo.name)) {
+                success = false;
+            }
+        } while (_findnext(handle, &fileInfo) == 0);
+
+        _findclose(handle);
+    }
+
+    free(pattern);
+#else
+    DIR *dirStream = opendir(dir);
+
+    if (dirStream != NULL) {
+        struct dirent *entry;
+
+        while ((entry = readdir(dirStream)) != NULL) {
+            if (!remove_cache_file(dir, entry->d_name)) {
+                success = false;
+            }
+        }
+
+        closedir(dirStream);
+    }
+#endif
+
+    return success;
+}
+
+/**
+ * \fn CompileCacheStats d_compile_cache_stats()
+ * \brief Get how well the compilation cache is doing in this process.
+ *
+ * \return The statistics of the compilation cache.
+ */
+CompileCacheStats d_compile_cache_stats() {
+    CompileCacheStats stats;
+
+    d_lock_shared(LOCK_COMPILE_CACHE);
+    stats.hits   = cacheHits;
+    stats.misses = cacheMisses;
+    stats.writes = cacheWrites;
+    d_unlock_shared(LOCK_COMPILE_CACHE);
+
+    return stats;
+}
+
+/* Read a value from a cache file, if there's enough of the file left. */
+#define READ_VALUE(ptr, end, value)                                            \
+    if ((size_t)((end) - (ptr)) < sizeof(value)) {                             \
+        return false;                                                          \
+    }                                                                          \
+    memcpy(&(value), ptr, sizeof(value));                                      \
+    ptr += sizeof(value);
+
+/**
+ * \fn static bool read_entry(const char *entry, size_t entrySize,
+ *                            uint64_t key, const char **obj,
+ *                            size_t *objSize)
+ * \brief Check that a file in the cache has the right key, and that none of
+ * the files it depends on have changed, and find the object file in it.
+ *
+ * \return If the object file in the cache can be used.
+ *
+ * \param entry The contents of the file in the cache.
+ * \param entrySize The size of the file in bytes.
+ * \param key The key the file should have.
+ * \param obj Set to where the object file starts in `entry`.
+ * \param objSize Set to the size of the object file in bytes.
+ */
+static bool read_entry(const char *entry, size_t entrySize, uint64_t key,
+                       const char **obj, size_t *objSize) {
+    const char *ptr = entry;
+    const char *end = entry + entrySize;
+
+    // Check this is the file we're after.
+    char magic[4];
+    READ_VALUE(ptr, end, magic)
+
+    if (memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0) {
+        return false;
+    }
+
+    uint64_t entryKey;
+    READ_VALUE(ptr, end, entryKey)
+
+    if (entryKey != key) {
+        return false;
+    }
+
+    // Check none of the included files have changed.
+    uint32_t numDeps;
+    READ_VALUE(ptr, end, numDeps)
+
+    for (uint32_t i = 0; i < numDeps; i++) {
+        uint32_t pathLen;
+        READ_VALUE(ptr, end, pathLen)
+
+        if ((size_t)(end - ptr) < (size_t)pathLen) {
+            return false;
+        }
+
+        char *depPath = d_calloc((size_t)pathLen + 1, sizeof(char));
+        memcpy(depPath, ptr, pathLen);
+        ptr += pathLen;
+
+        uint64_t currentHash;
+        bool depExists = hash_file(depPath, &currentHash);
+        free(depPath);
+
+        uint64_t depHash;
+        READ_VALUE(ptr, end, depHash)
+
+        if (!depExists || currentHash != depHash) {
+            return false;
+        }
+    }
+
+    uint64_t size;
+    READ_VALUE(ptr, end, size)
+
+    if ((uint64_t)(end - ptr) != size) {
+        return false;
+    }
+
+    *obj     = ptr;
+    *objSize = (size_t)size;
+
+    return true;
+}
+
+/**
+ * \fn const char *d_compile_cache_load(const char *filePath,
+ *                                      const char *source, size_t sourceSize,
+ *                                      struct _compileOptions *options,
+ *                                      size_t *objSize)
+ * \brief Find the object file of a source file in the compilation cache.
+ *
+ * \return The malloc'd contents of the object file, or `NULL` if it isn't in
+ * the cache, or it is out of date.
+ *
+ * \param filePath The path of the source file.
+ * \param source The contents of the source file.
+ * \param sourceSize The size of the source file in bytes.
+ * \param options The options the source file is being compiled with. Can be
+ * `NULL` for the default options.
+ * \param objSize Set to the size of the object file in bytes.
+ */
+const char *d_compile_cache_load(const char *filePath, const char *source,
+                                 size_t sourceSize, CompileOptions *options,
+                                 size_t *objSize) {
+    if (!is_cacheable(options)) {
+        return NULL;
+    }
+
+    char *path = canonical_path(filePath);
+    if (path == NULL) {
+        return NULL;
+    }
+
+    uint64_t key = cache_key(path, source, sourceSize, options);
+    free(path);
+
+    char *entryPath = entry_path(cacheDir, key, COMPILE_CACHE_EXTENSION);
+    if (entryPath == NULL) {
+        return NULL;
+    }
+
+    size_t entrySize;
+    char *entry = read_file(entryPath, &entrySize);
+    free(entryPath);
+
+    const char *obj = NULL;
+    size_t size     = 0;
+
+    if (entry == NULL || !read_entry(entry, entrySize, key, &obj, &size)) {
+        d_lock(LOCK_COMPILE_CACHE);
+        cacheMisses++;
+        d_unlock(LOCK_COMPILE_CACHE);
+
+        free(entry);
+        return NULL;
+    }
+
+    // Move the object file to the start of the allocation, so the caller can
+    // free it like normal.
+    memmove(entry, obj, size);
+
+    VERBOSE(1, "--- Loading %s from the compilation cache...\n", filePath)
+
+    d_lock(LOCK_COMPILE_CACHE);
+    cacheHits++;
+    d_unlock(LOCK_COMPILE_CACHE);
+
+    *objSize = size;
+    return entry;
+}
+
+/* Write a value to a cache file, and remember if it failed. */
+#define WRITE_VALUE(file, value, success)                \
+    if (fwrite(&(value), sizeof(value), 1, file) != 1) { \
+        success = false;                                 \
+    }
+
+/**
+ * \fn void d_compile_cache_store(const char *filePath, const char *source,
+ *                                size_t sourceSize,
+ *                                struct _compileOptions *options,
+ *                                struct _sheet *sheet)
+ * \brief Put the object file of a compiled sheet into the compilation cache.
+ *
+ * The object file is written to a temporary file first, which is then renamed
+ * to its place in the cache, so other processes never see a half-written
+ * file.
+ *
+ * \param filePath The path of the source file.
+ * \param source The contents of the source file.
+ * \param sourceSize The size of the source file in bytes.
+ * \param options The options the source file was compiled with. Can be
+ * `NULL` for the default options.
+ * \param sheet The sheet that was compiled from the source file. If it has
+ * errors, it isn't cached.
+ */
+void d_compile_cache_store(const char *filePath, const char *source,
+                           size_t sourceSize, CompileOptions *options,
+                           Sheet *sheet) {
+    if (!is_cacheable(options) || sheet == NULL || sheet->hasErrors ||
+        !sheet->_isCompiled) {
+        return;
+    }
+
+    char *path = canonical_path(filePath);
+    if (path == NULL) {
+        return;
+    }
+
+    uint64_t key = cache_key(path, source, sourceSize, options);
+    free(path);
+
+    // If we can't read one of the included files, we can't tell when it
+    // changes, so don't cache the sheet.
+    CacheDependency *deps = NULL;
+    size_t numDeps        = 0;
+
+    if (!collect_dependencies(sheet, &deps, &numDeps)) {
+        free_dependencies(deps, numDeps);
+        return;
+    }
+
+    size_t objSize;
+    const char *obj = d_obj_generate(sheet, &objSize);
+
+    // Give the temporary file a name no other process or thread will use.
+#if defined(_WIN32)
+    unsigned long pid = (unsigned long)_getpid();
+#else
+    unsigned long pid = (unsigned long)getpid();
+#endif
+
+    d_lock(LOCK_COMPILE_CACHE);
+    const unsigned long tempIndex = numTempFiles++;
+    d_unlock(LOCK_COMPILE_CACHE);
+
+    char tempExtension[64];
+    snprintf(tempExtension, sizeof(tempExtension),
+             ".%lu.%lu" CACHE_TEMP_EXTENSION, pid, tempIndex);
+
+    char *tempPath  = entry_path(cacheDir, key, tempExtension);
+    char *entryPath = entry_path(cacheDir, key, COMPILE_CACHE_EXTENSION);
+
+    FILE *f = (tempPath != NULL && entryPath != NULL) ? fopen(tempPath, "wb")
+                                                       : NULL;
+
+    if (f != NULL) {
+        bool success = true;
+
+        WRITE_VALUE(f, CACHE_MAGIC, success)
+        WRITE_VALUE(f, key, success)
+
+        uint32_t numDeps32 = (uint32_t)numDeps;
+        WRITE_VALUE(f, numDeps32, success)
+
+        for (size_t i = 0; i < numDeps; i++) {
+            uint32_t pathLen = (uint32_t)strlen(deps[i].path);
+            WRITE_VALUE(f, pathLen, success)
+
+            if (fwrite(deps[i].path, 1, pathLen, f) != pathLen) {
+                success = false;
+            }
+
+            WRITE_VALUE(f, deps[i].hash, success)
+        }
+
+        uint64_t size = (uint64_t)objSize;
+        WRITE_VALUE(f, size, success)
+
+        if (fwrite(obj, 1, objSize, f) != objSize) {
+            success = false;
+        }
+
+        if (fclose(f) != 0) {
+            success = false;
+        }
+
+        if (success && replace_file(tempPath, entryPath)) {
+            VERBOSE(5, "Saved %s to the compilation cache as %s\n", filePath,
+                    entryPath)
+
+            d_lock(LOCK_COMPILE_CACHE);
+            cacheWrites++;
+            d_unlock(LOCK_COMPILE_CACHE);
+        } else {
+            remove(tempPath);
+        }
+    }
+
+    free(entryPath);
+    free(tempPath);
+    free((char *)obj);
+    free_dependencies(deps, numDeps);
+}
@@ -0,0 +1,170 @@
+/*
+    Decision
+    Copyright (C) 2019-2020  Benjamin Beddows
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file dcache.h
+ * \brief This header deals with the compilation cache, which keeps the
+ * object files of compiled source files on disk, so other processes don't
+ * need to compile them again.
+ */
+
+#ifndef DCACHE_H
+#define DCACHE_H
+
+#include "dcfg.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+=== HEADER DEFINITIONS ====================================
+*/
+
+/* Forward declaration of the Sheet struct from dsheet.h */
+struct _sheet;
+
+/* Forward declaration of the CompileOptions struct from decision.h */
+struct _compileOptions;
+
+/**
+ * \def COMPILE_CACHE_DEFAULT_DIR
+ * \brief The directory the compilation cache uses if one isn't given.
+ */
+#define COMPILE_CACHE_DEFAULT_DIR ".decision_cache"
+
+/**
+ * \def COMPILE_CACHE_EXTENSION
+ * \brief The extension of the files in the compilation cache.
+ */
+#define COMPILE_CACHE_EXTENSION ".dcc"
+
+/**
+ * \struct _compileCacheStats
+ * \brief Statistics about the compilation cache.
+ *
+ * \typedef struct _compileCacheStats CompileCacheStats
+ */
+typedef struct _compileCacheStats {
+    size_t hits;   ///< How many source files were loaded from the cache.
+    size_t misses; ///< How many source files had to be compiled.
+    size_t writes; ///< How many compiled files were written to the cache.
+} CompileCacheStats;
+
+/*
+=== FUNCTIONS =============================================
+*/
+
+/**
+ * \fn void d_compile_cache_set_dir(const char *dir)
+ * \brief Set the directory of the compilation cache, creating it if it
+ * doesn't exist. The cache is disabled by default.
+ *
+ * When the cache is enabled, `d_load_source_file` checks the cache for an
+ * object file compiled from the same source code, and loads that instead if
+ * it can. Otherwise, it compiles the source code as usual, and puts the object
+ * file in the cache.
+ *
+ * An object file is only loaded from the cache if it was compiled from the
+ * same file, with the same contents, by the same version of Decision with the
+ * same compile options, and none of the files it includes have changed since.
+ * Sheets that are compiled in debug mode, or with initial includes, are never
+ * cached.
+ *
+ * The directory is shared by every thread, so it should be set before any
+ * threads start compiling.
+ *
+ * \param dir The directory to keep the cache in. If `NULL`, the cache is
+ * disabled.
+ */
+DECISION_API void d_compile_cache_set_dir(const char *dir);
+
+/**
+ * \fn const char *d_compile_cache_get_dir()
+ * \brief Get the directory of the compilation cache.
+ *
+ * \return The directory of the cache, or `NULL` if the cache is disabled.
+ */
+DECISION_API const char *d_compile_cache_get_dir();
+
+/**
+ * \fn bool d_compile_cache_clear(const char *dir)
+ * \brief Delete every file in the compilation cache.
+ *
+ * \return If every cached file could be deleted.
+ *
+ * \param dir The directory of the cache to clear. If `NULL`, the directory
+ * set with `d_compile_cache_set_dir` is cleared.
+ */
+DECISION_API bool d_compile_cache_clear(const char *dir);
+
+/**
+ * \fn CompileCacheStats d_compile_cache_stats()
+ * \brief Get how well the compilation cache is doing in this process.
+ *
+ * \return The statistics of the compilation cache.
+ */
+DECISION_API CompileCacheStats d_compile_cache_stats();
+
+/**
+ * \fn const char *d_compile_cache_load(const char *filePath,
+ *                                      const char *source, size_t sourceSize,
+ *                                      struct _compileOptions *options,
+ *                                      size_t *objSize)
+ * \brief Find the object file of a source file in the compilation cache.
+ *
+ * \return The malloc'd contents of the object file, or `NULL` if it isn't in
+ * the cache, or it is out of date.
+ *
+ * \param filePath The path of the source file.
+ * \param source The contents of the source file.
+ * \param sourceSize The size of the source file in bytes.
+ * \param options The options the source file is being compiled with. Can be
+ * `NULL` for the default options.
+ * \param objSize Set to the size of the object file in bytes.
+ */
+DECISION_API const char *d_compile_cache_load(const char *filePath,
+                                              const char *source,
+                                              size_t sourceSize,
+                                              struct _compileOptions *options,
+                                              size_t *objSize);
+
+/**
+ * \fn void d_compile_cache_store(const char *filePath, const char *source,
+ *                                size_t sourceSize,
+ *                                struct _compileOptions *options,
+ *                                struct _sheet *sheet)
+ * \brief Put the object file of a compiled sheet into the compilation cache.
+ *
+ * The object file is written to a temporary file first, which is then renamed
+ * to its place in the cache, so other processes never see a half-written
+ * file.
+ *
+ * \param filePath The path of the source file.
+ * \param source The contents of the source file.
+ * \param sourceSize The size of the source file in bytes.
+ * \param options The options the source file was compiled with. Can be
+ * `NULL` for the default options.
+ * \param sheet The sheet that was compiled from the source file. If it has
+ * errors, it isn't cached.
+ */
+DECISION_API void d_compile_cache_store(const char *filePath,
+                                        const char *source, size_t sourceSize,
+                                        struct _compileOptions *options,
+                                        struct _sheet *sheet);
+
+#endif // DCACHE_H
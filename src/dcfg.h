@@ -102,4 +102,17 @@
 #define DECISION_API extern
 #endif // DECISION_BUILD_DLL
 
+/**
+ * \def D_THREAD_LOCAL
+ * \brief Goes in front of static variables that each thread has its own copy
+ * of.
+ */
+#if defined(_MSC_VER)
+#define D_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__) || defined(__clang__)
+#define D_THREAD_LOCAL __thread
+#else
+#define D_THREAD_LOCAL _Thread_local
+#endif
+
 #endif // DCFG_H
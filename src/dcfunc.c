@@ -18,6 +18,7 @@
 
 #include "dcfunc.h"
 
+#include "dintern.h"
 #include "dmalloc.h"
 
 #include <stdlib.h>
@@ -31,7 +32,9 @@
  * after this call can use this new function.
  *
  * \param function The C function to call when this node is activated.
- * \param name The name of the function.
+ * \param name The name of the function. It is interned, as are the names of
+ * the sockets, so the caller keeps ownership of them. The names in the
+ * returned definition belong to the intern pool, and must not be freed.
  * \param description The description of the function.
  * \param sockets An array of socket metadata. This array should have at least
  * `numInputs + numOutputs` elements in.
@@ -43,15 +46,6 @@ CFunction d_create_c_function(DecisionCFunction function, const char *name,
                               size_t numInputs, size_t numOutputs) {
     // Create a node definition to define the function.
 
-    char *newName = NULL;
-
-    // Copy the name over.
-    if (name != NULL) {
-        size_t nameSize = strlen(name) + 1;
-        newName         = d_calloc(nameSize, sizeof(char));
-        strcpy(newName, name);
-    }
-
     char *newDescription = NULL;
 
     // Copy the description over.
@@ -64,7 +58,8 @@ CFunction d_create_c_function(DecisionCFunction function, const char *name,
     SocketMeta *newSockets = NULL;
     size_t numSockets      = 0;
 
-    // Copy the sockets array, and copy the names and descriptions over as well.
+    // Copy the sockets array, and copy the descriptions over as well. The
+    // names are interned instead.
     if (sockets != NULL) {
         numSockets = numInputs + numOutputs;
         newSockets = d_calloc(numSockets, sizeof(SocketMeta));
@@ -74,12 +69,7 @@ CFunction d_create_c_function(DecisionCFunction function, const char *name,
             const char *socketName = newSockets[i].name;
             const char *socketDesc = newSockets[i].description;
 
-            if (socketName != NULL) {
-                size_t nameSize     = strlen(socketName) + 1;
-                char *newSocketName = d_calloc(nameSize, sizeof(char));
-                strcpy(newSocketName, socketName);
-                newSockets[i].name = newSocketName;
-            }
+            newSockets[i].name = d_intern(socketName);
 
             if (socketDesc != NULL) {
                 size_t descSize     = strlen(socketDesc) + 1;
@@ -91,7 +81,7 @@ CFunction d_create_c_function(DecisionCFunction function, const char *name,
     }
 
     NodeDefinition definition             = {NULL, NULL, NULL, 0, 0, false};
-    definition.name                       = newName;
+    definition.name                       = d_intern(name);
     definition.description                = newDescription;
     *(SocketMeta **)&(definition.sockets) = newSockets;
     definition.numSockets                 = numSockets;
@@ -101,6 +91,10 @@ CFunction d_create_c_function(DecisionCFunction function, const char *name,
     newFunction.function                           = function;
     *(NodeDefinition *)(&(newFunction.definition)) = definition;
 
+    // The names stay in the pool until the sheet the function is added to is
+    // freed.
+    d_intern_retain();
+
     return newFunction;
 }
 
@@ -116,7 +110,9 @@ CFunction d_create_c_function(DecisionCFunction function, const char *name,
  * not account for any execution nodes either.
  *
  * \param function The C function to call when this node is activated.
- * \param name The name of the function.
+ * \param name The name of the function. It is interned, as are the names of
+ * the sockets, so the caller keeps ownership of them. The names in the
+ * returned definition belong to the intern pool, and must not be freed.
  * \param description The description of the function.
  * \param sockets An array of socket metadata. This array should have at least
  * `numInputs + numOutputs` elements in.
@@ -66,7 +66,9 @@ typedef struct _cFunction {
  * \brief Create a function that calls a C function.
  *
  * \param function The C function to call when this node is activated.
- * \param name The name of the function.
+ * \param name The name of the function. It is interned, as are the names of
+ * the sockets, so the caller keeps ownership of them. The names in the
+ * returned definition belong to the intern pool, and must not be freed.
  * \param description The description of the function.
  * \param sockets An array of socket metadata. This array should have at least
  * `numInputs + numOutputs` elements in.
@@ -92,7 +94,9 @@ DECISION_API CFunction d_create_c_function(DecisionCFunction function,
  * not account for any execution nodes either.
  *
  * \param function The C function to call when this node is activated.
- * \param name The name of the function.
+ * \param name The name of the function. It is interned, as are the names of
+ * the sockets, so the caller keeps ownership of them. The names in the
+ * returned definition belong to the intern pool, and must not be freed.
  * \param description The description of the function.
  * \param sockets An array of socket metadata. This array should have at least
  * `numInputs + numOutputs` elements in.
@@ -88,34 +88,21 @@ void d_add_link_to_ins(BuildContext *context, BCode *bcode, size_t insIndex,
 
     // Firstly, does the link already exist in the list? We don't want
     // duplicates - we want instructions to point to the same thing.
-    bool duplicateFound = false;
-    size_t linkIndex    = 0;
+    LinkMeta *existing = d_link_find_meta(&(context->linkMetaList),
+                                          linkMeta.type, linkMeta.name);
 
-    for (size_t i = 0; i < context->linkMetaList.size; i++) {
-        LinkMeta testAgainst = context->linkMetaList.list[i];
+    bool duplicateFound = existing != NULL;
+    size_t linkIndex    = 0;
 
-        if (linkMeta.type == testAgainst.type &&
-            strcmp(linkMeta.name, testAgainst.name) == 0) {
-            duplicateFound = true;
-            linkIndex      = i;
-            break;
-        }
+    if (duplicateFound) {
+        linkIndex = (size_t)(existing - context->linkMetaList.list);
     }
 
     *wasDuplicate = duplicateFound;
 
     if (!duplicateFound) {
-        // Before we store the LinkMeta object, we first need to copy the name.
-        // This prevents the name being free'd from 2 seperate places: once
-        // from a node name, and the other being in the LinkMetaList.
-        size_t nameLen = strlen(linkMeta.name);
-        char *cpyName  = d_calloc(nameLen + 1, sizeof(char));
-        memcpy(cpyName, linkMeta.name, nameLen);
-        cpyName[nameLen] = 0;
-        linkMeta.name    = (const char *)cpyName;
-
         // Store the link metadata into the build context if it's not already
-        // in.
+        // in. The name is interned, so the list can share it.
         d_link_meta_list_push(&(context->linkMetaList), linkMeta);
         linkIndex = context->linkMetaList.size - 1;
     }
@@ -953,9 +940,25 @@ BCode d_generate_call(BuildContext *context, size_t nodeIndex) {
         numRets--;
     }
 
+    BCode out = d_malloc_bytecode(0);
+
+    // If we are calling a Decision function, reserve two elements in the stack
+    // below the arguments. This is where the VM will save the frame pointer
+    // and the return address, so it doesn't need to move the arguments.
+    if (opcode == OP_CALLI) {
+        BCode reserve = d_bytecode_ins(OP_PUSHNB);
+        d_bytecode_set_byte(reserve, 1, 2);
+        d_concat_bytecode(&out, &reserve);
+        d_free_bytecode(&reserve);
+
+        context->stackTop += 2;
+    }
+
     // Push the arguments in order, such that the first argument gets pushed
     // first, then the second, etc.
-    BCode out = d_push_node_inputs(context, nodeIndex, true, false, false);
+    BCode args = d_push_node_inputs(context, nodeIndex, true, false, false);
+    d_concat_bytecode(&out, &args);
+    d_free_bytecode(&args);
 
     // Call the function/subroutine, and link to it later.
     BCode call = d_bytecode_ins(opcode);
@@ -994,6 +997,11 @@ BCode d_generate_call(BuildContext *context, size_t nodeIndex) {
     d_concat_bytecode(&out, &call);
     d_free_bytecode(&call);
 
+    // The return values are placed starting from the first reserved element.
+    if (opcode == OP_CALLI) {
+        context->stackTop -= 2;
+    }
+
     NodeSocket socket;
     socket.nodeIndex = nodeIndex;
 
@@ -1133,7 +1141,7 @@ BCode d_generate_nonexecution_node(BuildContext *context, size_t nodeIndex) {
 
     // Firstly, we need to check if the node is a particular function -
     // spoiler alert, one of them is not like the others...
-    const CoreFunction coreFunc = d_core_find_name(nodeDef->name);
+    const CoreFunction coreFunc = node.coreFunc;
 
     if (coreFunc == CORE_TERNARY) {
         // Hi. This is the story of why this if statement exists.
@@ -1477,7 +1485,7 @@ BCode d_generate_execution_node(BuildContext *context, size_t nodeIndex,
     VERBOSE(5, "- Generating bytecode for execution node %s...\n",
             nodeDef->name);
 
-    const CoreFunction coreFunc = d_core_find_name(nodeDef->name);
+    const CoreFunction coreFunc = node.coreFunc;
 
     NodeSocket socket;
     socket.nodeIndex   = nodeIndex;
@@ -2318,16 +2326,11 @@ void d_codegen_compile(Sheet *sheet, bool debug) {
         SheetVariable *var       = sheet->variables + i;
         const SocketMeta varMeta = var->variableMeta;
 
-        // Copy the name so d_link_free_list doesn't go balistic.
-        size_t nameLengthPlusNull = strlen(varMeta.name) + 1;
-        char *varName             = d_calloc(nameLengthPlusNull, sizeof(char));
-        memcpy(varName, varMeta.name, nameLengthPlusNull);
-
         // Create a LinkMeta entry so we know it exists.
         LinkMeta linkMeta = d_link_new_meta((varMeta.type == TYPE_STRING)
                                                 ? LINK_VARIABLE_POINTER
                                                 : LINK_VARIABLE,
-                                            varName, var);
+                                            varMeta.name, var);
 
         d_link_meta_list_push(&(context.linkMetaList), linkMeta);
 
@@ -2351,26 +2354,11 @@ void d_codegen_compile(Sheet *sheet, bool debug) {
         // Check that the metadata doesn't already exist.
         LinkMeta meta = d_link_new_meta(LINK_FUNCTION, funcDef.name, func);
 
-        LinkMeta *metaInList = NULL;
-
-        for (size_t j = 0; j < context.linkMetaList.size; j++) {
-            LinkMeta testAgainst = context.linkMetaList.list[j];
-
-            if (meta.type == testAgainst.type &&
-                strcmp(meta.name, testAgainst.name) == 0) {
-                metaInList = &(context.linkMetaList.list[j]);
-                break;
-            }
-        }
+        LinkMeta *metaInList =
+            d_link_find_meta(&(context.linkMetaList), meta.type, meta.name);
 
         // If it was not found in the list, add it.
         if (metaInList == NULL) {
-            // But first, copy the name.
-            size_t nameLen = strlen(meta.name) + 1;
-            char *newName  = d_calloc(nameLen, sizeof(char));
-            memcpy(newName, meta.name, nameLen);
-            meta.name = newName;
-
             d_link_meta_list_push(&context.linkMetaList, meta);
             metaInList =
                 &(context.linkMetaList.list[context.linkMetaList.size - 1]);
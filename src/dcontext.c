@@ -0,0 +1,257 @@
+/*
+    Decision
+    Copyright (C) 2019-2020  Benjamin Beddows
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "dcontext.h"
+
+#include "derror.h"
+#include "dintern.h"
+#include "dsheet.h"
+
+#include <stdlib.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+/* A context that hasn't been used yet. Every other field starts at zero,
+   including `_includeCacheEnabled`. */
+static const DCompileContext EMPTY_CONTEXT = {
+    ._nameGeneration = 1,
+};
+
+/* The context of compiles that don't give their own. */
+static DCompileContext defaultContext = {
+    ._nameGeneration = 1,
+};
+
+/* The context of the compile running on this thread, or NULL if there isn't
+   one. */
+static D_THREAD_LOCAL DCompileContext *currentContext = NULL;
+
+/* The locks of the state shared by every context. */
+#if defined(_WIN32)
+static SRWLOCK locks[NUM_LOCKS] = {SRWLOCK_INIT, SRWLOCK_INIT, SRWLOCK_INIT};
+#else
+static pthread_rwlock_t locks[NUM_LOCKS] = {PTHREAD_RWLOCK_INITIALIZER,
+                                            PTHREAD_RWLOCK_INITIALIZER,
+                                            PTHREAD_RWLOCK_INITIALIZER};
+#endif
+
+/**
+ * \fn DCompileContext *d_context_create()
+ * \brief Create an empty compile context, with a verbose level of 0, and the
+ * include cache disabled.
+ *
+ * \return The malloc'd context. Free it with `d_context_free`.
+ */
+DCompileContext *d_context_create() {
+    DCompileContext *context = d_malloc(sizeof(DCompileContext));
+    *context                 = EMPTY_CONTEXT;
+
+    // Names are kept for as long as the context is, so sheets compiled with
+    // it share them even if the sheets before them have been freed.
+    d_intern_retain();
+
+    return context;
+}
+
+/**
+ * \fn void d_context_free(DCompileContext *context)
+ * \brief Free a compile context, along with any errors it hasn't reported,
+ * and its references to the sheets in its include cache. The context also
+ * stops holding on to the intern pool, see `d_intern_release`.
+ *
+ * \param context The context to free. It can't be the default context, and it
+ * can't be in use by a compile.
+ */
+void d_context_free(DCompileContext *context) {
+    if (context == NULL || context == &defaultContext) {
+        return;
+    }
+
+    // The include cache and the errors are freed from the current context.
+    DCompileContext *previous = currentContext;
+    currentContext            = context;
+
+    d_include_cache_invalidate(NULL);
+    d_error_free();
+
+    currentContext = previous;
+
+    d_arena_free(context->_syntaxArena);
+    free(context);
+
+    d_intern_release();
+}
+
+/**
+ * \fn DCompileContext *d_context_default()
+ * \brief Get the default compile context, which is used by compiles that
+ * don't give their own context.
+ *
+ * Since every thread shares it, only one thread can use it at a time.
+ *
+ * \return The default context.
+ */
+DCompileContext *d_context_default() {
+    return &defaultContext;
+}
+
+/**
+ * \fn DCompileContext *d_context_current()
+ * \brief Get the compile context of the calling thread.
+ *
+ * \return The context that the compile running on this thread is using, or
+ * the default context if there isn't one.
+ */
+DCompileContext *d_context_current() {
+    return (currentContext != NULL) ? currentContext : &defaultContext;
+}
+
+/**
+ * \fn DCompileContext *d_context_begin(DCompileContext *context)
+ * \brief Start a compile in a context, by making it the context of the calling
+ * thread until `d_context_end` is called.
+ *
+ * If it is the outermost compile in the context, whether an earlier compile
+ * had errors is forgotten.
+ *
+ * \return The context that was current before, which should be given to
+ * `d_context_end`.
+ *
+ * \param context The context to compile in. If `NULL`, the current context is
+ * kept, which is how includes are compiled in the same context as the sheets
+ * including them.
+ */
+DCompileContext *d_context_begin(DCompileContext *context) {
+    DCompileContext *previous = currentContext;
+
+    if (context != NULL) {
+        currentContext = context;
+    }
+
+    DCompileContext *current = d_context_current();
+
+    if (current->_depth == 0) {
+        current->_hasErrors = false;
+    }
+
+    current->_depth++;
+
+    return previous;
+}
+
+/**
+ * \fn void d_context_end(DCompileContext *previous)
+ * \brief Finish a compile that was started with `d_context_begin`.
+ *
+ * If it was the outermost compile in the context, the context's syntax arena
+ * is reset, so the next compile can reuse its memory.
+ *
+ * \param previous The context that `d_context_begin` returned.
+ */
+void d_context_end(DCompileContext *previous) {
+    DCompileContext *context = d_context_current();
+
+    context->_depth--;
+
+    if (context->_depth == 0 && context->_syntaxArena != NULL) {
+        d_arena_reset(context->_syntaxArena);
+    }
+
+    currentContext = previous;
+}
+
+/**
+ * \fn DArena *d_context_syntax_arena(DCompileContext *context)
+ * \brief Get the arena that syntax trees are allocated from in a context.
+ *
+ * Anything allocated from it is freed when the outermost compile of the
+ * context ends.
+ *
+ * \return The syntax arena of the context.
+ *
+ * \param context The context to get the arena of.
+ */
+DArena *d_context_syntax_arena(DCompileContext *context) {
+    if (context->_syntaxArena == NULL) {
+        context->_syntaxArena = d_arena_create(0);
+    }
+
+    return context->_syntaxArena;
+}
+
+/**
+ * \fn void d_lock(DLock lock)
+ * \brief Wait until no other thread holds a lock, and then hold it
+ * exclusively.
+ *
+ * \param lock The lock to hold.
+ */
+void d_lock(DLock lock) {
+#if defined(_WIN32)
+    AcquireSRWLockExclusive(&locks[lock]);
+#else
+    pthread_rwlock_wrlock(&locks[lock]);
+#endif
+}
+
+/**
+ * \fn void d_unlock(DLock lock)
+ * \brief Release a lock that was held with `d_lock`.
+ *
+ * \param lock The lock to release.
+ */
+void d_unlock(DLock lock) {
+#if defined(_WIN32)
+    ReleaseSRWLockExclusive(&locks[lock]);
+#else
+    pthread_rwlock_unlock(&locks[lock]);
+#endif
+}
+
+/**
+ * \fn void d_lock_shared(DLock lock)
+ * \brief Wait until no other thread holds a lock exclusively, and then hold it
+ * along with any other threads that are only reading.
+ *
+ * \param lock The lock to hold.
+ */
+void d_lock_shared(DLock lock) {
+#if defined(_WIN32)
+    AcquireSRWLockShared(&locks[lock]);
+#else
+    pthread_rwlock_rdlock(&locks[lock]);
+#endif
+}
+
+/**
+ * \fn void d_unlock_shared(DLock lock)
+ * \brief Release a lock that was held with `d_lock_shared`.
+ *
+ * \param lock The lock to release.
+ */
+void d_unlock_shared(DLock lock) {
+#if defined(_WIN32)
+    ReleaseSRWLockShared(&locks[lock]);
+#else
+    pthread_rwlock_unlock(&locks[lock]);
+#endif
+}
@@ -0,0 +1,227 @@
+/*
+    Decision
+    Copyright (C) 2019-2020  Benjamin Beddows
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file dcontext.h
+ * \brief This header contains the compile context, which holds everything a
+ * compilation needs apart from the sheet itself, so that different threads can
+ * compile sheets at the same time.
+ */
+
+#ifndef DCONTEXT_H
+#define DCONTEXT_H
+
+#include "dcfg.h"
+#include "dmalloc.h"
+#include <stdbool.h>
+
+#include <stddef.h>
+
+/*
+=== HEADER DEFINITIONS ====================================
+*/
+
+/* A forward declaration of the IncludeCacheEntry struct from dsheet.c */
+struct _includeCacheEntry;
+
+/**
+ * \struct _dCompileContext
+ * \brief The diagnostics, settings, memory and caches of a set of
+ * compilations.
+ *
+ * Every thread has a current context, which is where compile-time errors are
+ * pushed to, where the verbose level comes from, and where included sheets
+ * are cached. It is the default context unless a compile says otherwise with
+ * `CompileOptions.context`, in which case that context is current until the
+ * compile finishes. Sheets that are included by a compile are compiled in the
+ * same context.
+ *
+ * A context can only be used by one thread at a time, but any number of
+ * threads can compile sheets at the same time as long as they each use their
+ * own context.
+ *
+ * \typedef struct _dCompileContext DCompileContext
+ */
+typedef struct _dCompileContext {
+    char verboseLevel; ///< The verbose level, between 0 and 5. See
+                       ///< `d_set_verbose_level`.
+
+    char *_errorMessages;     ///< The compile-time errors and warnings that
+                              ///< haven't been reported yet.
+    size_t _lenErrorMessages; ///< The size of `_errorMessages`, including the
+                              ///< NULL terminator.
+    bool _hasErrors;          ///< Has an error (not a warning) been pushed?
+
+    DArena *_syntaxArena; ///< The arena the syntax trees are allocated from.
+                          ///< It is reset once the outermost compile is done.
+    size_t _depth;        ///< How many compiles in this context are running,
+                          ///< including the compiles of includes.
+
+    size_t _nameGeneration; ///< The current generation of name tables, see
+                            ///< `d_name_invalidate_tables`.
+
+    struct _includeCacheEntry *_includeCache; ///< The sheets that have
+                                              ///< been included so far.
+
+    size_t _includeCacheSize;   ///< The number of sheets in `_includeCache`.
+    bool _includeCacheEnabled;  ///< Should `_includeCache` be used?
+    size_t _includeCacheHits;   ///< How many includes reused a sheet.
+    size_t _includeCacheMisses; ///< How many includes had to load the sheet.
+} DCompileContext;
+
+/**
+ * \enum _dLock
+ * \brief The locks protecting state that is shared by every context in the
+ * process.
+ *
+ * \typedef enum _dLock DLock
+ */
+typedef enum _dLock {
+    LOCK_INTERN,        ///< Protects the intern pool in `dintern.c`.
+    LOCK_COMPILE_CACHE, ///< Protects the statistics of the compilation cache
+                        ///< in `dcache.c`.
+    LOCK_DECODED_TEXTS, ///< Protects the list of decoded text sections in
+                        ///< `dvm.c`.
+} DLock;
+
+/**
+ * \def NUM_LOCKS
+ * \brief The number of locks in `DLock`.
+ */
+#define NUM_LOCKS 3
+
+/*
+=== FUNCTIONS =============================================
+*/
+
+/**
+ * \fn DCompileContext *d_context_create()
+ * \brief Create an empty compile context, with a verbose level of 0, and the
+ * include cache disabled.
+ *
+ * \return The malloc'd context. Free it with `d_context_free`.
+ */
+DECISION_API DCompileContext *d_context_create();
+
+/**
+ * \fn void d_context_free(DCompileContext *context)
+ * \brief Free a compile context, along with any errors it hasn't reported,
+ * and its references to the sheets in its include cache. The context also
+ * stops holding on to the intern pool, see `d_intern_release`.
+ *
+ * \param context The context to free. It can't be the default context, and it
+ * can't be in use by a compile.
+ */
+DECISION_API void d_context_free(DCompileContext *context);
+
+/**
+ * \fn DCompileContext *d_context_default()
+ * \brief Get the default compile context, which is used by compiles that
+ * don't give their own context.
+ *
+ * Since every thread shares it, only one thread can use it at a time.
+ *
+ * \return The default context.
+ */
+DECISION_API DCompileContext *d_context_default();
+
+/**
+ * \fn DCompileContext *d_context_current()
+ * \brief Get the compile context of the calling thread.
+ *
+ * \return The context that the compile running on this thread is using, or
+ * the default context if there isn't one.
+ */
+DECISION_API DCompileContext *d_context_current();
+
+/**
+ * \fn DCompileContext *d_context_begin(DCompileContext *context)
+ * \brief Start a compile in a context, by making it the context of the calling
+ * thread until `d_context_end` is called.
+ *
+ * If it is the outermost compile in the context, whether an earlier compile
+ * had errors is forgotten.
+ *
+ * \return The context that was current before, which should be given to
+ * `d_context_end`.
+ *
+ * \param context The context to compile in. If `NULL`, the current context is
+ * kept, which is how includes are compiled in the same context as the sheets
+ * including them.
+ */
+DECISION_API DCompileContext *d_context_begin(DCompileContext *context);
+
+/**
+ * \fn void d_context_end(DCompileContext *previous)
+ * \brief Finish a compile that was started with `d_context_begin`.
+ *
+ * If it was the outermost compile in the context, the context's syntax arena
+ * is reset, so the next compile can reuse its memory.
+ *
+ * \param previous The context that `d_context_begin` returned.
+ */
+DECISION_API void d_context_end(DCompileContext *previous);
+
+/**
+ * \fn DArena *d_context_syntax_arena(DCompileContext *context)
+ * \brief Get the arena that syntax trees are allocated from in a context.
+ *
+ * Anything allocated from it is freed when the outermost compile of the
+ * context ends.
+ *
+ * \return The syntax arena of the context.
+ *
+ * \param context The context to get the arena of.
+ */
+DECISION_API DArena *d_context_syntax_arena(DCompileContext *context);
+
+/**
+ * \fn void d_lock(DLock lock)
+ * \brief Wait until no other thread holds a lock, and then hold it
+ * exclusively.
+ *
+ * \param lock The lock to hold.
+ */
+DECISION_API void d_lock(DLock lock);
+
+/**
+ * \fn void d_unlock(DLock lock)
+ * \brief Release a lock that was held with `d_lock`.
+ *
+ * \param lock The lock to release.
+ */
+DECISION_API void d_unlock(DLock lock);
+
+/**
+ * \fn void d_lock_shared(DLock lock)
+ * \brief Wait until no other thread holds a lock exclusively, and then hold it
+ * along with any other threads that are only reading.
+ *
+ * \param lock The lock to hold.
+ */
+DECISION_API void d_lock_shared(DLock lock);
+
+/**
+ * \fn void d_unlock_shared(DLock lock)
+ * \brief Release a lock that was held with `d_lock_shared`.
+ *
+ * \param lock The lock to release.
+ */
+DECISION_API void d_unlock_shared(DLock lock);
+
+#endif // DCONTEXT_H
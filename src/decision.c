@@ -19,8 +19,11 @@
 #include "decision.h"
 
 #include "dasm.h"
+#include "dcache.h"
 #include "dcodegen.h"
+#include "dcontext.h"
 #include "derror.h"
+#include "dintern.h"
 #include "dlex.h"
 #include "dlink.h"
 #include "dmalloc.h"
@@ -34,22 +37,29 @@
 #include <stdlib.h>
 #include <string.h>
 
-/* Definition of the verbose level. */
-char verboseLevel = 0;
+/* Definition of the function handle struct from decision.h */
+struct _functionHandle {
+    Sheet *sheet;  ///< The sheet the handle was got from.
+    void *funcPtr; ///< The first instruction of the function/subroutine.
+
+    DecodedText *decoded; ///< The decoded text section `funcPtr` is in, or
+                          ///< `NULL` if it hasn't been decoded.
+    DecodedIns *ins;      ///< The decoded version of `funcPtr`.
+};
 
 /**
  * \fn char d_get_verbose_level()
- * \brief Get the current verbose level.
+ * \brief Get the verbose level of the current compile context.
  *
  * \return The verbose level. It will be a number between 0 and 5.
  */
 char d_get_verbose_level() {
-    return verboseLevel;
+    return d_context_current()->verboseLevel;
 }
 
 /**
  * \fn void d_set_verbose_level(char level)
- * \brief Set the current verbose level.
+ * \brief Set the verbose level of the current compile context.
  *
  * \param level The verbose level to set. If the number is bigger than 5,
  * then the verbose level is set to 5.
@@ -61,7 +71,7 @@ void d_set_verbose_level(char level) {
         level = 0;
     }
 
-    verboseLevel = level;
+    d_context_current()->verboseLevel = level;
 }
 
 /*
@@ -128,15 +138,37 @@ static void save_object_to_file(const char *filePath, const char *content,
                                 size_t len) {
     FILE *f;
 
-    f = fopen(filePath, "wb");
+    // Object files are loaded by mapping them into memory, so the file is
+    // written under a different name and then renamed. That way, anything
+    // that has the old file mapped keeps the old contents, rather than having
+    // the file truncated underneath it.
+    const size_t pathLen = strlen(filePath);
+    char *tempPath       = d_calloc(pathLen + 5, sizeof(char));
+    memcpy(tempPath, filePath, pathLen);
+    memcpy(tempPath + pathLen, ".tmp", 5);
+
+    f = fopen(tempPath, "wb");
     if (f == NULL) {
         printf("Can't open the file!\n");
+        free(tempPath);
         return;
     }
 
     fwrite(content, sizeof(char), len, f);
 
     fclose(f);
+
+#if defined(_WIN32)
+    // rename won't replace a file on Windows.
+    remove(filePath);
+#endif
+
+    if (rename(tempPath, filePath) != 0) {
+        printf("Can't open the file!\n");
+        remove(tempPath);
+    }
+
+    free(tempPath);
 }
 
 /**
@@ -153,9 +185,24 @@ bool d_run_sheet(Sheet *sheet) {
         if (sheet->_isLinked) {
             if (sheet->_main > 0) // A Start function exists.
             {
-                DVM vm       = d_vm_create();
-                bool success = d_vm_run(&vm, sheet->_text + sheet->_main);
+                DVM vm = d_vm_create();
+
+                // If the sheet has been decoded, Start can be found in its
+                // decoded text directly.
+                DecodedText *decoded = sheet->_decodedText;
+                DecodedIns *start =
+                    (decoded != NULL) ? decoded->insAt[sheet->_main] : NULL;
+
+                bool success =
+                    (start != NULL)
+                        ? d_vm_run_decoded(&vm, decoded, start)
+                        : d_vm_run(&vm, sheet->_text + sheet->_main);
                 d_vm_free(&vm);
+
+                if (sheet->_useTiers && d_get_verbose_level() >= 3) {
+                    d_sheet_dump_profiles(sheet);
+                }
+
                 return success;
             } else {
                 printf("Fatal: Sheet %s has no Start function defined",
@@ -172,84 +219,78 @@ bool d_run_sheet(Sheet *sheet) {
 }
 
 /**
- * \fn bool d_run_function(DVM *vm, Sheet *sheet, const char *funcName)
- * \brief Run the specified function/subroutine in a given sheet, given the
- * sheet has gone through `d_codegen_compile`.
+ * \fn static void *find_function(Sheet *sheet, const char *funcName)
+ * \brief Find where a function/subroutine starts in the text section of the
+ * sheet it lives in, so it can be run from a given sheet.
  *
- * \return If the function/subroutine ran without any errors.
+ * If it can't be found, an error is printed.
  *
- * \param vm The VM to run the function on. The reason it is a seperate
- * argument is because it allows you to push and pop arguments and return values
- * seperately.
- * \param sheet The sheet the function lives in.
- * \param funcName The name of the function/subroutine to run.
+ * \return A pointer to the first instruction of the function/subroutine, or
+ * `NULL` if it cannot be run.
+ *
+ * \param sheet The sheet the function lives in, or includes it.
+ * \param funcName The name of the function/subroutine to find.
  */
-bool d_run_function(DVM *vm, Sheet *sheet, const char *funcName) {
+static void *find_function(Sheet *sheet, const char *funcName) {
     if (sheet->_text != NULL && sheet->_textSize > 0 && sheet->_isCompiled) {
         if (sheet->_isLinked) {
-            void *funcPtr = NULL;
-
             // Firstly check that the name we've been given isn't that of a
             // core function/subroutine.
             CoreFunction isCoreFunc = d_core_find_name(funcName);
             if ((int)isCoreFunc != -1) {
                 printf("Fatal: %s is a core function", funcName);
-                return false;
+                return NULL;
             }
 
             // If the function is already in the meta list of the sheet, we
-            // might as well use that pointer.
-            for (size_t metaIndex = 0; metaIndex < sheet->_link.size;
-                 metaIndex++) {
-                LinkMeta meta = sheet->_link.list[metaIndex];
-
-                if (meta.type == LINK_FUNCTION) {
-                    if (strcmp(meta.name, funcName) == 0) {
-                        SheetFunction *func = (SheetFunction *)meta.meta;
-                        Sheet *extSheet     = func->sheet;
-
-                        if (sheet == extSheet) {
-                            // If the function lives inside this sheet, then
-                            // the pointer is actually an index.
-                            funcPtr = sheet->_text + (size_t)meta._ptr;
-                        } else {
-                            // Otherwise, the pointer should be accurate
-                            // already.
-                            funcPtr = meta._ptr;
-                        }
-
-                        break;
-                    }
+            // might as well use that pointer. The names in the list are
+            // interned, so if the name isn't, it can't be in there.
+            const char *name = d_intern_find(funcName);
+            LinkMeta *meta   = NULL;
+
+            if (name != NULL) {
+                meta = d_link_find_meta(&(sheet->_link), LINK_FUNCTION, name);
+            }
+
+            if (meta != NULL) {
+                SheetFunction *func = (SheetFunction *)meta->meta;
+                Sheet *extSheet     = func->sheet;
+
+                if (sheet == extSheet) {
+                    // If the function lives inside this sheet, then the
+                    // pointer is actually an index.
+                    return sheet->_text + (size_t)meta->_ptr;
+                } else {
+                    // Otherwise, the pointer should be accurate already.
+                    return meta->_ptr;
                 }
             }
 
             // If we couldn't find it in our link list, then this sheet didn't
             // use the function. So, we're going to have to find out manually
-            // where this sheet is and run it there.
-            if (funcPtr == NULL) {
-                AllNameDefinitions nameDefs =
-                    d_get_name_definitions(sheet, funcName);
-
-                if (nameDefs.numDefinitions == 1) {
-                    NameDefinition definition = nameDefs.definitions[0];
-                    if (definition.type == NAME_FUNCTION) {
-                        Sheet *extSheet = definition.sheet;
-                        return d_run_function(vm, extSheet, funcName);
-                    }
-                } else if (nameDefs.numDefinitions == 0) {
-                    printf("Fatal: Sheet %s has no function %s defined",
-                           sheet->filePath, funcName);
-                } else {
-                    printf("Fatal: Sheet %s has multiple definitions of the "
-                           "function %s defined",
-                           sheet->filePath, funcName);
-                }
+            // where this sheet is and find it there.
+            void *funcPtr = NULL;
+
+            AllNameDefinitions nameDefs =
+                d_get_name_definitions(sheet, funcName);
 
-                d_free_name_definitions(&nameDefs);
+            if (nameDefs.numDefinitions == 1) {
+                NameDefinition definition = nameDefs.definitions[0];
+                if (definition.type == NAME_FUNCTION) {
+                    funcPtr = find_function(definition.sheet, funcName);
+                }
+            } else if (nameDefs.numDefinitions == 0) {
+                printf("Fatal: Sheet %s has no function %s defined",
+                       sheet->filePath, funcName);
             } else {
-                // We know where it lives, so we can run it!
-                return d_vm_run(vm, funcPtr);
+                printf("Fatal: Sheet %s has multiple definitions of the "
+                       "function %s defined",
+                       sheet->filePath, funcName);
             }
+
+            d_free_name_definitions(&nameDefs);
+
+            return funcPtr;
         } else {
             printf("Fatal: Sheet %s has not been linked", sheet->filePath);
         }
@@ -257,7 +298,107 @@ bool d_run_function(DVM *vm, Sheet *sheet, const char *funcName) {
         printf("Fatal: Sheet %s has not been compiled", sheet->filePath);
     }
 
-    return false;
+    return NULL;
+}
+
+/**
+ * \fn bool d_run_function(DVM *vm, Sheet *sheet, const char *funcName)
+ * \brief Run the specified function/subroutine in a given sheet, given the
+ * sheet has gone through `d_codegen_compile`.
+ *
+ * If the same function is going to be run many times, it is quicker to get a
+ * handle to it with `d_get_function_handle`, and run that instead.
+ *
+ * \return If the function/subroutine ran without any errors.
+ *
+ * \param vm The VM to run the function on. The reason it is a seperate
+ * argument is because it allows you to push and pop arguments and return values
+ * seperately.
+ * \param sheet The sheet the function lives in.
+ * \param funcName The name of the function/subroutine to run.
+ */
+bool d_run_function(DVM *vm, Sheet *sheet, const char *funcName) {
+    void *funcPtr = find_function(sheet, funcName);
+
+    if (funcPtr == NULL) {
+        return false;
+    }
+
+    // We know where it lives, so we can run it!
+    return d_vm_run(vm, funcPtr);
+}
+
+/**
+ * \fn FunctionHandle *d_get_function_handle(Sheet *sheet,
+ *                                          const char *funcName)
+ * \brief Find a function/subroutine in a given sheet once, so it can be run
+ * any number of times with `d_run_function_handle` without looking up its
+ * name, or where its decoded instructions are, again.
+ *
+ * **NOTE:** The handle is only valid for as long as the sheet is.
+ *
+ * \return A malloc'd handle to the function/subroutine, or `NULL` if it
+ * cannot be run, in which case an error is printed. Free it with
+ * `d_free_function_handle`.
+ *
+ * \param sheet The sheet the function lives in. It must have been compiled
+ * and linked.
+ * \param funcName The name of the function/subroutine.
+ */
+FunctionHandle *d_get_function_handle(Sheet *sheet, const char *funcName) {
+    void *funcPtr = find_function(sheet, funcName);
+
+    if (funcPtr == NULL) {
+        return NULL;
+    }
+
+    FunctionHandle *handle = d_malloc(sizeof(FunctionHandle));
+    handle->sheet          = sheet;
+    handle->funcPtr        = funcPtr;
+    handle->decoded        = d_vm_find_decoded_text(funcPtr);
+    handle->ins            = NULL;
+
+    // Find the decoded instruction now, so running the handle doesn't have to.
+    if (handle->decoded != NULL) {
+        handle->ins = handle->decoded->insAt[(char *)funcPtr -
+                                             handle->decoded->text];
+    }
+
+    return handle;
+}
+
+/**
+ * \fn bool d_run_function_handle(DVM *vm, FunctionHandle *handle)
+ * \brief Run a function/subroutine from a handle given by
+ * `d_get_function_handle`.
+ *
+ * \return If the function/subroutine ran without any errors.
+ *
+ * \param vm The VM to run the function on. Like with `d_run_function`,
+ * arguments can be pushed onto it before, and return values popped off it
+ * after.
+ * \param handle The handle of the function/subroutine to run.
+ */
+bool d_run_function_handle(DVM *vm, FunctionHandle *handle) {
+    if (handle == NULL) {
+        return false;
+    }
+
+    if (handle->ins != NULL) {
+        return d_vm_run_decoded(vm, handle->decoded, handle->ins);
+    }
+
+    return d_vm_run(vm, handle->funcPtr);
+}
+
+/**
+ * \fn void d_free_function_handle(FunctionHandle *handle)
+ * \brief Free a handle given by `d_get_function_handle`.
+ *
+ * \param handle The handle to free.
+ */
+void d_free_function_handle(FunctionHandle *handle) {
+    free(handle);
 }
 
 /**
@@ -288,6 +429,10 @@ Sheet *d_load_string(const char *source, const char *name,
         opts = *options;
     }
 
+    // Errors are pushed to, and the syntax tree is allocated from, the
+    // context we're compiling in.
+    DCompileContext *previous = d_context_begin(opts.context);
+
     if (opts.includes != NULL) {
         Sheet **include = opts.includes;
 
@@ -305,7 +450,11 @@ Sheet *d_load_string(const char *source, const char *name,
     if (stream.numTokens > 0) {
 
         VERBOSE(1, "--- STAGE 2: Checking syntax...\n")
-        SyntaxResult result = d_syntax_parse(stream, name);
+
+        // All of the syntax nodes are put in the context's arena, so the
+        // whole tree is freed in one go once the outermost compile is done.
+        DArena *syntaxArena = d_context_syntax_arena(d_context_current());
+        SyntaxResult result = d_syntax_parse(stream, name, syntaxArena);
         SyntaxNode *root    = result.node;
 
         // Syntax analysis may have thrown errors, in which case semantic
@@ -339,6 +488,8 @@ Sheet *d_load_string(const char *source, const char *name,
                 }
 
                 VERBOSE(1, "--- STAGE 6: Linking...\n")
+                sheet->_useJit   = opts.jit && !opts.debug;
+                sheet->_useTiers = opts.tiered && !opts.debug;
                 d_link_sheet(sheet);
 
                 // Dump the compiled content.
@@ -351,10 +502,6 @@ Sheet *d_load_string(const char *source, const char *name,
                 }
             }
 
-            // Only free the tree if syntax analysis was successful, as
-            // dsyntax.c frees the root node if it failed.
-            d_syntax_free_tree(root);
-
         } else {
             sheet->hasErrors = d_error_report();
         }
@@ -367,6 +514,8 @@ Sheet *d_load_string(const char *source, const char *name,
     d_error_free();
     d_lex_free_stream(stream);
 
+    d_context_end(previous);
+
     return sheet;
 }
 
@@ -428,11 +577,67 @@ bool d_compile_string(const char *source, const char *filePath,
     return hadErrors;
 }
 
+/*
+    static Sheet *load_object(const char *obj, size_t size,
+                              const char *filePath, CompileOptions *options,
+                              bool mapped)
+    Load the contents of an object file into a sheet, and link it.
+
+    Returns: The malloc'd sheet.
+
+    const char* obj: The contents of the object file.
+    size_t size: The size of the object file in bytes.
+    const char* filePath: The file path the object file came from.
+    CompileOptions* options: A set of compile options. If NULL, the default
+    settings are used. The debug setting is ignored.
+    bool mapped: Was obj mapped with d_map_file? If so, the sheet takes
+    ownership of it.
+*/
+static Sheet *load_object(const char *obj, size_t size, const char *filePath,
+                          CompileOptions *options, bool mapped) {
+    CompileOptions opts = DEFAULT_COMPILE_OPTIONS;
+
+    if (options != NULL) {
+        opts = *options;
+    }
+
+    DCompileContext *previous = d_context_begin(opts.context);
+
+    Sheet *out;
+
+    if (mapped) {
+        out = d_obj_load_mapped((char *)obj, size, filePath, opts.includes,
+                                opts.priors);
+    } else {
+        out = d_obj_load(obj, size, filePath, opts.includes, opts.priors);
+    }
+
+    out->hasErrors = d_error_report();
+
+    if (!out->hasErrors) {
+        out->_useJit   = opts.jit;
+        out->_useTiers = opts.tiered;
+        d_link_sheet(out);
+    }
+
+    if (d_get_verbose_level() >= 3) {
+        d_asm_dump_all(out);
+    }
+
+    d_context_end(previous);
+
+    return out;
+}
+
 /**
  * \fn Sheet *d_load_source_file(const char *filePath, CompileOptions *options)
  * \brief Take Decision source code from a file and compile it into bytecode,
  * but do not run it.
  *
+ * If the compilation cache is enabled with `d_compile_cache_set_dir`, and the
+ * file has been compiled before, the object file is loaded from the cache
+ * instead.
+ *
  * \return A malloc'd sheet containing all of the compilation info.
  *
  * \param filePath The file path of the source file to compile.
@@ -440,12 +645,29 @@ bool d_compile_string(const char *source, const char *filePath,
  * used.
  */
 Sheet *d_load_source_file(const char *filePath, CompileOptions *options) {
-    size_t _size; // Not needed.
-    const char *source = load_string_from_file(filePath, &_size, false);
+    // Looking in the compilation cache is part of the compile as well.
+    DCompileContext *previous =
+        d_context_begin((options != NULL) ? options->context : NULL);
+
+    size_t size;
+    const char *source = load_string_from_file(filePath, &size, false);
     Sheet *sheet       = NULL;
 
     if (source != NULL) {
-        sheet = d_load_string(source, filePath, options);
+        // If the compilation cache is enabled, we might have already compiled
+        // this file before.
+        size_t objSize;
+        const char *obj =
+            d_compile_cache_load(filePath, source, size, options, &objSize);
+
+        if (obj != NULL) {
+            sheet = load_object(obj, objSize, filePath, options, false);
+            free((char *)obj);
+        } else {
+            sheet = d_load_string(source, filePath, options);
+            d_compile_cache_store(filePath, source, size, options, sheet);
+        }
+
         free((void *)source);
     } else {
         // We errored loading the file.
@@ -453,6 +675,8 @@ Sheet *d_load_source_file(const char *filePath, CompileOptions *options) {
         sheet->hasErrors = true;
     }
 
+    d_context_end(previous);
+
     return sheet;
 }
 
@@ -515,6 +739,10 @@ bool d_compile_file(const char *filePathIn, const char *filePathOut,
  * \fn Sheet *d_load_object_file(const char *filePath, CompileOptions *options)
  * \brief Take a Decision object file and load it into memory.
  *
+ * Where it can, the file is mapped into memory rather than read, so the text
+ * and data sections of the sheet are shared with the operating system's file
+ * cache until linking or running the sheet writes to them.
+ *
  * \return A malloc'd sheet object containing all of the compilation info.
  *
  * \param filePath The file path of the object file.
@@ -523,33 +751,21 @@ bool d_compile_file(const char *filePathIn, const char *filePathOut,
  */
 Sheet *d_load_object_file(const char *filePath, CompileOptions *options) {
     size_t size;
-    const char *obj = load_string_from_file(filePath, &size, true);
-    Sheet *out      = NULL;
+    Sheet *out = NULL;
 
-    // Ignore the debug option.
-    Sheet **includes = NULL;
-    if (options != NULL) {
-        includes = options->includes;
-    }
+    // Try and map the file into memory first, so the sheet can point into it
+    // rather than copying it.
+    const char *obj = d_map_file(filePath, &size);
 
-    Sheet **priors = NULL;
-    if (options != NULL) {
-        priors = options->priors;
+    if (obj != NULL) {
+        return load_object(obj, size, filePath, options, true);
     }
 
+    obj = load_string_from_file(filePath, &size, true);
+
     if (obj != NULL) {
-        out = d_obj_load(obj, size, filePath, includes, priors);
+        out = load_object(obj, size, filePath, options, false);
         free((char *)obj);
-
-        out->hasErrors = d_error_report();
-
-        if (!out->hasErrors) {
-            d_link_sheet(out);
-        }
-
-        if (d_get_verbose_level() >= 3) {
-            d_asm_dump_all(out);
-        }
     } else {
         // We errored loading the file.
         out            = d_sheet_create(filePath);
@@ -594,10 +810,14 @@ bool d_run_object_file(const char *filePath, CompileOptions *options) {
  * \param filePath The file path of the file to examine.
  */
 short d_is_object_file(const char *filePath) {
-    size_t size;
-    const char *str = load_string_from_file(filePath, &size, true);
+    // We only need the first few bytes of the file to tell.
+    FILE *f = fopen(filePath, "rb");
+
+    if (f != NULL) {
+        char str[4];
+        size_t size = fread(str, sizeof(char), 4, f);
+        fclose(f);
 
-    if (str != NULL) {
         bool isObjectFile = false;
 
         if (size > 3) {
@@ -609,11 +829,11 @@ short d_is_object_file(const char *filePath) {
             }
         }
 
-        free((char *)str);
-
         return isObjectFile;
-    } else
+    } else {
+        printf("Can't open the file!\n");
         return -1;
+    }
 }
 
 /**
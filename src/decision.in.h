@@ -75,12 +75,27 @@ struct _sheet;
 /* A forward declaration of the DVM struct from dvm.h */
 struct _DVM;
 
+/* A forward declaration of the DCompileContext struct from dcontext.h */
+struct _dCompileContext;
+
+/**
+ * \struct _functionHandle
+ * \brief A function/subroutine that has already been found in a linked sheet,
+ * so it can be run without looking up its name. See `d_get_function_handle`.
+ *
+ * The contents of the struct are private.
+ *
+ * \typedef struct _functionHandle FunctionHandle
+ */
+typedef struct _functionHandle FunctionHandle;
+
 /**
  * \struct _compileOptions
  * \brief A set of options for when a sheet is compiled.
  *
- * By default, there are no initial includes, and the sheet is not compiled in
- * debug mode.
+ * By default, there are no initial includes, the sheet is not compiled in
+ * debug mode, the sheet is run with stack instructions by the interpreter,
+ * and the sheet is compiled in the current compile context.
  *
  * \typedef struct _compileOptions CompileOptions
  */
@@ -95,15 +110,32 @@ typedef struct _compileOptions {
                               ///< but sheets are not longer optimised.
                               ///< Note that compiled sheets do not store debug
                               ///< information, and thus cannot be debugged.
+    bool jit;                 ///< Compiles what it can of the sheets to
+                              ///< native code, see `d_jit_compile`. This is
+                              ///< ignored in debug mode, or if the platform
+                              ///< isn't supported.
+    bool tiered;              ///< Runs sheets in the VM first, and only
+                              ///< compiles functions to native code once
+                              ///< they get hot, see `d_link_sheet`. This
+                              ///< overrides `jit`, and is ignored in debug
+                              ///< mode.
+
+    struct _dCompileContext *context; ///< The context to compile in, see
+                                      ///< `DCompileContext`. If NULL, the
+                                      ///< current context of the thread is
+                                      ///< used. Sheets compiled in different
+                                      ///< contexts can be compiled on
+                                      ///< different threads at the same
+                                      ///< time.
 } CompileOptions;
 
 /**
  * \def DEFAULT_COMPILE_OPTIONS
  * \brief The default compile options.
  */
-#define DEFAULT_COMPILE_OPTIONS \
-    (CompileOptions) {          \
-        NULL, NULL, false       \
+#define DEFAULT_COMPILE_OPTIONS               \
+    (CompileOptions) {                        \
+        NULL, NULL, false, false, false, NULL \
     }
 
 /*
@@ -112,7 +144,7 @@ typedef struct _compileOptions {
 
 /**
  * \fn char d_get_verbose_level()
- * \brief Get the current verbose level.
+ * \brief Get the verbose level of the current compile context.
  *
  * \return The verbose level. It will be a number between 0 and 5.
  */
@@ -120,7 +152,7 @@ DECISION_API char d_get_verbose_level();
 
 /**
  * \fn void d_set_verbose_level(char level)
- * \brief Set the current verbose level.
+ * \brief Set the verbose level of the current compile context.
  *
  * \param level The verbose level to set. If the number is bigger than 5,
  * then the verbose level is set to 5.
@@ -158,6 +190,9 @@ DECISION_API bool d_run_sheet(struct _sheet *sheet);
  * \brief Run the specified function/subroutine in a given sheet, given the
  * sheet has gone through `d_codegen_compile`.
  *
+ * If the same function is going to be run many times, it is quicker to get a
+ * handle to it with `d_get_function_handle`, and run that instead.
+ *
  * \return If the function/subroutine ran without any errors.
  *
  * \param vm The VM to run the function on. The reason it is a seperate
@@ -169,6 +204,49 @@ DECISION_API bool d_run_sheet(struct _sheet *sheet);
 DECISION_API bool d_run_function(struct _DVM *vm, struct _sheet *sheet,
                                  const char *funcName);
 
+/**
+ * \fn FunctionHandle *d_get_function_handle(Sheet *sheet,
+ *                                          const char *funcName)
+ * \brief Find a function/subroutine in a given sheet once, so it can be run
+ * any number of times with `d_run_function_handle` without looking up its
+ * name, or where its decoded instructions are, again.
+ *
+ * **NOTE:** The handle is only valid for as long as the sheet is.
+ *
+ * \return A malloc'd handle to the function/subroutine, or `NULL` if it
+ * cannot be run, in which case an error is printed. Free it with
+ * `d_free_function_handle`.
+ *
+ * \param sheet The sheet the function lives in. It must have been compiled
+ * and linked.
+ * \param funcName The name of the function/subroutine.
+ */
+DECISION_API FunctionHandle *d_get_function_handle(struct _sheet *sheet,
+                                                   const char *funcName);
+
+/**
+ * \fn bool d_run_function_handle(DVM *vm, FunctionHandle *handle)
+ * \brief Run a function/subroutine from a handle given by
+ * `d_get_function_handle`.
+ *
+ * \return If the function/subroutine ran without any errors.
+ *
+ * \param vm The VM to run the function on. Like with `d_run_function`,
+ * arguments can be pushed onto it before, and return values popped off it
+ * after.
+ * \param handle The handle of the function/subroutine to run.
+ */
+DECISION_API bool d_run_function_handle(struct _DVM *vm,
+                                        FunctionHandle *handle);
+
+/**
+ * \fn void d_free_function_handle(FunctionHandle *handle)
+ * \brief Free a handle given by `d_get_function_handle`.
+ *
+ * \param handle The handle to free.
+ */
+DECISION_API void d_free_function_handle(FunctionHandle *handle);
+
 /**
  * \fn Sheet *d_load_string(const char *source, const char *name,
  *                          CompileOptions *options)
@@ -222,6 +300,10 @@ DECISION_API bool d_compile_string(const char *source, const char *filePath,
  * \brief Take Decision source code from a file and compile it into bytecode,
  * but do not run it.
  *
+ * If the compilation cache is enabled with `d_compile_cache_set_dir`, and the
+ * file has been compiled before, the object file is loaded from the cache
+ * instead.
+ *
  * \return A malloc'd sheet containing all of the compilation info.
  *
  * \param filePath The file path of the source file to compile.
@@ -266,6 +348,10 @@ DECISION_API bool d_compile_file(const char *filePathIn,
  * \fn Sheet *d_load_object_file(const char *filePath, CompileOptions *options)
  * \brief Take a Decision object file and load it into memory.
  *
+ * Where it can, the file is mapped into memory rather than read, so the text
+ * and data sections of the sheet are shared with the operating system's file
+ * cache until linking or running the sheet writes to them.
+ *
  * \return A malloc'd sheet object containing all of the compilation info.
  *
  * \param filePath The file path of the object file.
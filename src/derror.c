@@ -18,73 +18,76 @@
 
 #include "derror.h"
 
+#include "dcontext.h"
 #include "dmalloc.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-/* A static global variable holding all of the run-time error messages. */
-static char *errorMessages = NULL;
-
-/* A static global variable holding the length of the errorMessages variable. */
-static size_t lenErrorMessages = 0;
-
-/* A static global variable saying if there's been an ERROR reported. */
-static bool programHasError = false;
+/*
+    The error messages, and whether there's been an ERROR reported, are kept
+    in the current compile context, so threads compiling in different contexts
+    don't mix up their errors.
+*/
 
 /*
-    size_t add_length_to_messages(size_t length)
-    Add a length of memory to the errorMessages variable. If there is no
+    size_t add_length_to_messages(DCompileContext *context, size_t length)
+    Add a length of memory to the error messages of a context. If there is no
     allocated memory, then malloc some.
 
     Returns: The index of the first char of available space. This is where the
     newline can be placed, followed by the new message.
 
+    DCompileContext *context: The context holding the error messages.
     size_t length: The length of memory to "add on". This does NOT include the
     \0 character at the end.
 */
-static size_t add_length_to_messages(size_t length) {
+static size_t add_length_to_messages(DCompileContext *context, size_t length) {
     size_t indexOfFirstFreeSpace = 0;
 
-    if (errorMessages == NULL) {
-        errorMessages = d_calloc((length + 1), sizeof(char));
+    if (context->_errorMessages == NULL) {
+        context->_errorMessages = d_calloc((length + 1), sizeof(char));
 
-        if (errorMessages != NULL)
-            lenErrorMessages = length + 1;
+        if (context->_errorMessages != NULL)
+            context->_lenErrorMessages = length + 1;
     } else {
         indexOfFirstFreeSpace =
-            lenErrorMessages - 1; // lenErrorMessages includes the \0.
-        size_t newLength = lenErrorMessages + length + 1;
-        errorMessages    = d_realloc(errorMessages, newLength * sizeof(char));
+            context->_lenErrorMessages - 1; // The length includes the \0.
+        size_t newLength = context->_lenErrorMessages + length + 1;
+        context->_errorMessages =
+            d_realloc(context->_errorMessages, newLength * sizeof(char));
 
-        if (errorMessages != NULL)
-            lenErrorMessages = newLength;
+        if (context->_errorMessages != NULL)
+            context->_lenErrorMessages = newLength;
     }
 
     return indexOfFirstFreeSpace;
 }
 
 /*
-    void add_message_to_error_list(const char* message, const char seperator)
-    Add a string to the error list.
+    void add_message_to_error_list(DCompileContext *context,
+                                   const char* message, const char seperator)
+    Add a string to the error list of a context.
 
+    DCompileContext *context: The context holding the error list.
     const char* message: The message itself. Ends in a \0 character.
     char seperator: The character to put inbetween the previous and new message.
 */
-static void add_message_to_error_list(const char *message,
+static void add_message_to_error_list(DCompileContext *context,
+                                      const char *message,
                                       const char seperator) {
     size_t lenMessage = strlen(message);
 
-    // Reallocate the amount of memory errorMessages has.
-    size_t indexToAdd = add_length_to_messages(lenMessage);
+    // Reallocate the amount of memory the error messages have.
+    size_t indexToAdd = add_length_to_messages(context, lenMessage);
 
     // Get the pointer to the index we want to add to.
-    char *ptr = errorMessages + indexToAdd;
+    char *ptr = context->_errorMessages + indexToAdd;
 
     // Place the seperator in if it's not the first message.
     if (indexToAdd > 0) {
-        errorMessages[indexToAdd] = seperator;
+        context->_errorMessages[indexToAdd] = seperator;
         ptr++;
     }
 
@@ -95,7 +98,8 @@ static void add_message_to_error_list(const char *message,
 /**
  * \fn void d_error_compiler_push(const char *message, const char *filePath,
  *                                size_t lineNum, bool isError)
- * \brief Push a compile-time error message to the error list.
+ * \brief Push a compile-time error message to the error list of the current
+ * compile context.
  *
  * \param message The error message itself.
  * \param filePath The file where the error occured.
@@ -104,9 +108,11 @@ static void add_message_to_error_list(const char *message,
  */
 void d_error_compiler_push(const char *message, const char *filePath,
                            size_t lineNum, bool isError) {
+    DCompileContext *context = d_context_current();
+
     // Does the program have an error?
     if (isError)
-        programHasError = true;
+        context->_hasErrors = true;
 
     char errorMessage[MAX_ERROR_SIZE];
 
@@ -115,34 +121,40 @@ void d_error_compiler_push(const char *message, const char *filePath,
             filePath, lineNum, message);
 
     // Add the error to the error list.
-    add_message_to_error_list(errorMessage, '\n');
+    add_message_to_error_list(context, errorMessage, '\n');
 }
 
 /**
  * \fn bool d_error_report()
- * \brief Report if there were any compile-time errors or warnings to `stdout`.
+ * \brief Report if there were any compile-time errors or warnings in the
+ * current compile context to `stdout`.
  *
  * \return `true` if there were errors (warnings do not count as errors),
  * `false` otherwise.
  */
 bool d_error_report() {
-    if (errorMessages != NULL) {
-        printf("%s\n", errorMessages);
+    DCompileContext *context = d_context_current();
+
+    if (context->_errorMessages != NULL) {
+        printf("%s\n", context->_errorMessages);
     }
 
-    return programHasError;
+    return context->_hasErrors;
 }
 
 /**
  * \fn void d_error_free()
- * \brief Free any compile-time error messages saved.
+ * \brief Free any compile-time error messages saved in the current compile
+ * context.
  *
  * Should be called at the end of compilation.
  */
 void d_error_free() {
-    if (errorMessages != NULL) {
-        free(errorMessages);
-        errorMessages    = NULL;
-        lenErrorMessages = 0;
+    DCompileContext *context = d_context_current();
+
+    if (context->_errorMessages != NULL) {
+        free(context->_errorMessages);
+        context->_errorMessages    = NULL;
+        context->_lenErrorMessages = 0;
     }
 }
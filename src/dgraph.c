@@ -334,7 +334,7 @@ short d_wire_cmp(Wire wire1, Wire wire2) {
         } else {
             if (wire1.socketTo.nodeIndex < wire2.socketTo.nodeIndex) {
                 return -1;
-            } else if (wire1.socketTo.nodeIndex < wire2.socketTo.nodeIndex) {
+            } else if (wire1.socketTo.nodeIndex > wire2.socketTo.nodeIndex) {
                 return 1;
             } else {
                 if (wire1.socketTo.socketIndex < wire2.socketTo.socketIndex) {
@@ -361,6 +361,21 @@ short d_wire_cmp(Wire wire1, Wire wire2) {
  * \param socket The "from" socket to search for.
  */
 int d_wire_find_first(Graph graph, NodeSocket socket) {
+    // If the graph is indexed, we can look the wires up directly.
+    if (graph.wireOffsets != NULL) {
+        if (!d_is_node_socket_valid(graph, socket)) {
+            return -1;
+        }
+
+        size_t s = graph.socketOffsets[socket.nodeIndex] + socket.socketIndex;
+
+        if (graph.wireOffsets[s] == graph.wireOffsets[s + 1]) {
+            return -1;
+        }
+
+        return (int)graph.wireOffsets[s];
+    }
+
     int left   = 0;
     int right  = graph.numWires - 1;
     int middle = (left + right) / 2;
@@ -427,6 +442,15 @@ int d_wire_find_first(Graph graph, NodeSocket socket) {
  * \param socket The socket to query.
  */
 size_t d_socket_num_connections(Graph graph, NodeSocket socket) {
+    if (graph.wireOffsets != NULL) {
+        if (!d_is_node_socket_valid(graph, socket)) {
+            return 0;
+        }
+
+        size_t s = graph.socketOffsets[socket.nodeIndex] + socket.socketIndex;
+        return graph.wireOffsets[s + 1] - graph.wireOffsets[s];
+    }
+
     int first = d_wire_find_first(graph, socket);
 
     if (first < 0) {
@@ -442,6 +466,180 @@ size_t d_socket_num_connections(Graph graph, NodeSocket socket) {
     return (size_t)(index - first);
 }
 
+/**
+ * \fn static void clear_index(Graph *graph)
+ * \brief Throw away the index of a graph, if it has one, since the nodes or
+ * wires are about to change.
+ *
+ * \param graph The graph whose index to free.
+ */
+static void clear_index(Graph *graph) {
+    if (graph->socketOffsets != NULL) {
+        free(graph->socketOffsets);
+        graph->socketOffsets = NULL;
+    }
+
+    if (graph->wireOffsets != NULL) {
+        free(graph->wireOffsets);
+        graph->wireOffsets = NULL;
+    }
+}
+
+/**
+ * \fn static void resize_wires(Graph *graph, size_t capacity)
+ * \brief Reallocate the `wires` array of a graph to have room for exactly a
+ * number of wires.
+ *
+ * \param graph The graph to resize.
+ * \param capacity How many wires the array should have room for.
+ */
+static void resize_wires(Graph *graph, size_t capacity) {
+    if (graph->wires == NULL) {
+        graph->wires = d_malloc(capacity * sizeof(Wire));
+    } else {
+        graph->wires = d_realloc(graph->wires, capacity * sizeof(Wire));
+    }
+
+    graph->wiresCapacity = capacity;
+}
+
+/**
+ * \fn static void reserve_wires(Graph *graph, size_t numWires)
+ * \brief Make sure the `wires` array of a graph has room for a number of
+ * wires, growing it geometrically if it doesn't.
+ *
+ * \param graph The graph to reserve room in.
+ * \param numWires How many wires the array should have room for.
+ */
+static void reserve_wires(Graph *graph, size_t numWires) {
+    if (numWires <= graph->wiresCapacity) {
+        return;
+    }
+
+    size_t newCapacity = 2 * graph->wiresCapacity;
+    if (newCapacity < numWires) {
+        newCapacity = numWires;
+    }
+
+    resize_wires(graph, newCapacity);
+}
+
+/**
+ * \fn static void resize_nodes(Graph *graph, size_t capacity)
+ * \brief Reallocate the `nodes` array of a graph to have room for exactly a
+ * number of nodes.
+ *
+ * \param graph The graph to resize.
+ * \param capacity How many nodes the array should have room for.
+ */
+static void resize_nodes(Graph *graph, size_t capacity) {
+    if (graph->nodes == NULL) {
+        graph->nodes = d_calloc(capacity, sizeof(Node));
+    } else {
+        graph->nodes = d_realloc(graph->nodes, capacity * sizeof(Node));
+    }
+
+    graph->nodesCapacity = capacity;
+}
+
+/**
+ * \fn static void reserve_nodes(Graph *graph, size_t numNodes)
+ * \brief Make sure the `nodes` array of a graph has room for a number of
+ * nodes, growing it geometrically if it doesn't.
+ *
+ * \param graph The graph to reserve room in.
+ * \param numNodes How many nodes the array should have room for.
+ */
+static void reserve_nodes(Graph *graph, size_t numNodes) {
+    if (numNodes <= graph->nodesCapacity) {
+        return;
+    }
+
+    size_t newCapacity = 2 * graph->nodesCapacity;
+    if (newCapacity < numNodes) {
+        newCapacity = numNodes;
+    }
+
+    resize_nodes(graph, newCapacity);
+}
+
+/**
+ * \fn static void check_connections(Graph *graph, NodeSocket socket,
+ *                                   size_t numChecked, const char *filePath)
+ * \brief Detect "too many connections" errors on a socket.
+ *
+ * An error is reported for every connection after the first that hasn't been
+ * checked yet, with the connections up to and including it.
+ *
+ * \param graph The graph the socket belongs to. The wires need to be sorted.
+ * \param socket The socket to check the connections of.
+ * \param numChecked The number of connections that have already been checked.
+ * \param filePath In case we error, say where we errored from.
+ */
+static void check_connections(Graph *graph, NodeSocket socket,
+                              size_t numChecked, const char *filePath) {
+    SocketMeta meta    = d_get_socket_meta(*graph, socket);
+    bool isInputSocket = d_is_input_socket(*graph, socket);
+    DType socketType   = meta.type;
+
+    // Only non-execution input sockets and execution output sockets are
+    // limited to one connection.
+    bool isLimited = (socketType != TYPE_EXECUTION && isInputSocket) ||
+                     (socketType == TYPE_EXECUTION && !isInputSocket);
+    if (!isLimited) {
+        return;
+    }
+
+    size_t lineNum = graph->nodes[socket.nodeIndex].lineNum;
+
+    // Build up a string of the connection's line numbers, in case we error.
+    char connLineNums[MAX_ERROR_SIZE] = {0};
+    size_t lineNumIndex               = 0;
+
+    size_t numConnections = 0;
+
+    int wireStart = d_wire_find_first(*graph, socket);
+    int wireIndex = wireStart;
+
+    while (IS_WIRE_FROM(*graph, wireIndex, socket)) {
+        size_t connNodeIndex = graph->wires[wireIndex].socketTo.nodeIndex;
+
+        if (d_is_node_index_valid(*graph, connNodeIndex) &&
+            lineNumIndex < MAX_ERROR_SIZE) {
+            size_t connLineNum = graph->nodes[connNodeIndex].lineNum;
+
+            int len = snprintf(connLineNums + lineNumIndex,
+                               MAX_ERROR_SIZE - lineNumIndex, "%s%zu",
+                               (wireIndex > wireStart) ? ", " : "",
+                               connLineNum);
+
+            if (len > 0) {
+                lineNumIndex += (size_t)len;
+            }
+        }
+
+        numConnections++;
+        wireIndex++;
+
+        if (numConnections <= 1 || numConnections <= numChecked) {
+            continue;
+        }
+
+        if (socketType != TYPE_EXECUTION) {
+            ERROR_COMPILER(filePath, lineNum, true,
+                           "Input non-execution socket (#%zu) has more than "
+                           "one connection (has %zu, on lines %s)",
+                           socket.socketIndex, numConnections, connLineNums);
+        } else {
+            ERROR_COMPILER(
+                filePath, lineNum, true,
+                "Output execution socket (#%zu) has more than one connection "
+                "(has %zu, on lines %s)",
+                socket.socketIndex, numConnections, connLineNums);
+        }
+    }
+}
+
 /**
  * \fn static void add_edge(Graph *graph, Wire wire, const char *filePath)
  * \brief Add an edge to a graph. Detect "too many connections" errors in the
@@ -456,12 +654,21 @@ static void add_edge(Graph *graph, Wire wire, const char *filePath) {
         return;
     }
 
+    clear_index(graph);
+    reserve_wires(graph, graph->numWires + 1);
+
+    // If we're in a batch, the wires are sorted and checked all at once at
+    // the end.
+    if (graph->inBatch) {
+        graph->wires[graph->numWires++] = wire;
+        return;
+    }
+
     // We can't just add the wire to the end of the list here. The list is
     // being stored in lexicographical order, so we need to insert it into the
     // correct position.
-    if (graph->wires == NULL) {
+    if (graph->numWires == 0) {
         graph->numWires = 1;
-        graph->wires    = d_malloc(sizeof(Wire));
         *(graph->wires) = wire;
     } else {
         // Use binary insertion, since the list should be sorted!
@@ -488,7 +695,6 @@ static void add_edge(Graph *graph, Wire wire, const char *filePath) {
         }
 
         graph->numWires++;
-        graph->wires = d_realloc(graph->wires, graph->numWires * sizeof(Wire));
 
         if (middle < (int)graph->numWires - 1) {
             memmove(graph->wires + middle + 1, graph->wires + middle,
@@ -498,71 +704,165 @@ static void add_edge(Graph *graph, Wire wire, const char *filePath) {
         graph->wires[middle] = wire;
     }
 
-    size_t fromNodeIndex = wire.socketFrom.nodeIndex;
-    size_t lineNum       = graph->nodes[fromNodeIndex].lineNum;
+    // Only the new connection needs to be checked.
+    check_connections(graph, wire.socketFrom,
+                      d_socket_num_connections(*graph, wire.socketFrom) - 1,
+                      filePath);
+}
 
-    // Build up a string of the connection's line numbers, in case we error.
-    char connLineNums[MAX_ERROR_SIZE];
-    size_t lineNumIndex = 0;
+/**
+ * \fn static int compare_wires(const void *a, const void *b)
+ * \brief Compare two wires for `qsort`.
+ *
+ * \return The result of `d_wire_cmp` on the wires.
+ *
+ * \param a The first wire.
+ * \param b The second wire.
+ */
+static int compare_wires(const void *a, const void *b) {
+    return d_wire_cmp(*(const Wire *)a, *(const Wire *)b);
+}
 
-    int wireStart = d_wire_find_first(*graph, wire.socketFrom);
-    int wireIndex = wireStart;
+/**
+ * \fn void d_graph_reserve(Graph *graph, size_t numNodes, size_t numWires)
+ * \brief Make sure a graph has room for a number of nodes and wires, so they
+ * can be added without reallocating.
+ *
+ * \param graph The graph to reserve room in.
+ * \param numNodes How many nodes the graph should have room for in total.
+ * \param numWires How many wires the graph should have room for in total.
+ * Note that `d_graph_add_wire` stores each wire in both directions.
+ */
+void d_graph_reserve(Graph *graph, size_t numNodes, size_t numWires) {
+    if (graph == NULL) {
+        return;
+    }
 
-    while (IS_WIRE_FROM(*graph, wireIndex, wire.socketFrom)) {
-        size_t connNodeIndex = graph->wires[wireIndex].socketTo.nodeIndex;
+    if (numNodes > graph->nodesCapacity && numNodes > graph->numNodes) {
+        resize_nodes(graph, numNodes);
+    }
 
-        if (d_is_node_index_valid(*graph, connNodeIndex)) {
-            size_t connLineNum = graph->nodes[connNodeIndex].lineNum;
+    if (numWires > graph->wiresCapacity && numWires > graph->numWires) {
+        resize_wires(graph, numWires);
+    }
+}
 
-            if (wireIndex > wireStart) {
-                sprintf(connLineNums + lineNumIndex, ", ");
-                lineNumIndex += 2;
+/**
+ * \fn void d_graph_begin_batch(Graph *graph)
+ * \brief Start adding wires to a graph in bulk.
+ *
+ * Until `d_graph_end_batch` is called, `d_graph_add_wire` appends wires to
+ * the end of the `wires` array instead of inserting them in order, so the
+ * graph shouldn't be queried until then.
+ *
+ * \param graph The graph to add wires to.
+ */
+void d_graph_begin_batch(Graph *graph) {
+    if (graph != NULL) {
+        clear_index(graph);
+        graph->inBatch = true;
+    }
+}
 
-                if (lineNumIndex >= MAX_ERROR_SIZE) {
-                    break;
-                }
-            }
+/**
+ * \fn void d_graph_end_batch(Graph *graph, const char *filePath)
+ * \brief Stop adding wires to a graph in bulk, sorting the wires that were
+ * added, and removing any duplicates.
+ *
+ * Sockets with too many connections are reported here rather than when the
+ * wires were added, with an error for each extra connection.
+ *
+ * \param graph The graph that wires were added to.
+ * \param filePath In case we error, say where we errored from.
+ */
+void d_graph_end_batch(Graph *graph, const char *filePath) {
+    if (graph == NULL || !graph->inBatch) {
+        return;
+    }
 
-            sprintf(connLineNums + lineNumIndex, "%zu", connLineNum);
+    graph->inBatch = false;
 
-            while (connLineNums[lineNumIndex] != 0 &&
-                   lineNumIndex < MAX_ERROR_SIZE) {
-                lineNumIndex++;
-            }
+    if (graph->numWires == 0) {
+        return;
+    }
 
-            if (lineNumIndex >= MAX_ERROR_SIZE) {
-                break;
-            }
+    qsort(graph->wires, graph->numWires, sizeof(Wire), compare_wires);
+
+    // Remove any duplicates, which are now next to each other.
+    size_t numUnique = 1;
+
+    for (size_t i = 1; i < graph->numWires; i++) {
+        if (d_wire_cmp(graph->wires[i], graph->wires[numUnique - 1]) != 0) {
+            graph->wires[numUnique++] = graph->wires[i];
         }
+    }
 
-        wireIndex++;
+    graph->numWires = numUnique;
+
+    // Check the connections of each socket with more than one.
+    for (size_t i = 0; i < graph->numWires;) {
+        NodeSocket socket = graph->wires[i].socketFrom;
+
+        size_t next = i + 1;
+        while (IS_WIRE_FROM(*graph, (int)next, socket)) {
+            next++;
+        }
+
+        if (next - i > 1) {
+            check_connections(graph, socket, 0, filePath);
+        }
+
+        i = next;
     }
+}
 
-    size_t numConnections = d_socket_num_connections(*graph, wire.socketFrom);
-    SocketMeta meta       = d_get_socket_meta(*graph, wire.socketFrom);
-    bool isInputSocket    = d_is_input_socket(*graph, wire.socketFrom);
-    DType socketType      = meta.type;
+/**
+ * \fn void d_graph_build_index(Graph *graph)
+ * \brief Index the wires of a graph by the socket they come from, so that
+ * `d_wire_find_first` and `d_socket_num_connections` take constant time.
+ *
+ * Since wires are stored in both directions, this indexes the wires going
+ * into a socket as well as the wires coming out of it. The index is thrown
+ * away whenever a node or wire is added to the graph. If the graph is already
+ * indexed, this does nothing.
+ *
+ * \param graph The graph to index. The wires need to be sorted, i.e. it can't
+ * be in a batch.
+ */
+void d_graph_build_index(Graph *graph) {
+    if (graph == NULL || graph->wireOffsets != NULL || graph->inBatch) {
+        return;
+    }
+
+    // Give each socket of each node a position in one big array.
+    size_t *socketOffsets = d_calloc(graph->numNodes + 1, sizeof(size_t));
+
+    for (size_t i = 0; i < graph->numNodes; i++) {
+        socketOffsets[i + 1] = socketOffsets[i] +
+                               d_node_num_inputs(*graph, i) +
+                               d_node_num_outputs(*graph, i);
+    }
+
+    const size_t numSockets = socketOffsets[graph->numNodes];
 
-    // If the socket is non-execution, an input socket, and we have more than
-    // one connection...
-    if (numConnections > 1 && socketType != TYPE_EXECUTION && isInputSocket) {
-        ERROR_COMPILER(filePath, lineNum, true,
-                       "Input non-execution socket (#%zu) has more than one "
-                       "connection (has %zu, on lines %s)",
-                       wire.socketFrom.socketIndex, numConnections,
-                       connLineNums);
+    // Count how many wires come from each socket. Since the wires are sorted,
+    // the running total of the counts is where each socket's wires start.
+    size_t *wireOffsets = d_calloc(numSockets + 1, sizeof(size_t));
+
+    for (size_t i = 0; i < graph->numWires; i++) {
+        NodeSocket from = graph->wires[i].socketFrom;
+
+        if (d_is_node_socket_valid(*graph, from)) {
+            wireOffsets[socketOffsets[from.nodeIndex] + from.socketIndex + 1]++;
+        }
     }
 
-    // If the socket is execution, an output socket, and we have more than one
-    // connection...
-    else if (numConnections > 1 && socketType == TYPE_EXECUTION &&
-             !isInputSocket) {
-        ERROR_COMPILER(
-            filePath, lineNum, true,
-            "Output execution socket (#%zu) has more than one connection "
-            "(has %zu, on lines %s)",
-            wire.socketFrom.socketIndex, numConnections, connLineNums);
+    for (size_t i = 0; i < numSockets; i++) {
+        wireOffsets[i + 1] += wireOffsets[i];
     }
+
+    graph->socketOffsets = socketOffsets;
+    graph->wireOffsets   = wireOffsets;
 }
 
 /**
@@ -632,13 +932,9 @@ size_t d_graph_add_node(Graph *graph, Node node) {
     node._stackPositions = NULL;
 
     const size_t newNumNodes = graph->numNodes + 1;
-    const size_t newAlloc    = newNumNodes * sizeof(Node);
 
-    if (graph->nodes == NULL) {
-        graph->nodes = d_calloc(newNumNodes, sizeof(Node));
-    } else {
-        graph->nodes = d_realloc(graph->nodes, newAlloc);
-    }
+    clear_index(graph);
+    reserve_nodes(graph, newNumNodes);
 
     graph->numNodes = newNumNodes;
 
@@ -742,29 +1038,32 @@ void d_graph_free(Graph *graph) {
     }
 
     free(graph->nodes);
-    graph->nodes    = NULL;
-    graph->numNodes = 0;
+    graph->nodes         = NULL;
+    graph->numNodes      = 0;
+    graph->nodesCapacity = 0;
 
     if (graph->wires != NULL) {
         free(graph->wires);
     }
 
-    graph->wires    = NULL;
-    graph->numWires = 0;
+    graph->wires         = NULL;
+    graph->numWires      = 0;
+    graph->wiresCapacity = 0;
+    graph->inBatch       = false;
+
+    clear_index(graph);
 }
 
 /**
  * \fn void d_definition_free(const NodeDefinition nodeDef, bool freeSocketStrs)
- * \brief Free the malloc'd elements of a NodeDefinition.
+ * \brief Free the malloc'd elements of a NodeDefinition. The names are
+ * interned, so they are not freed.
  *
  * \param nodeDef The definition whose elements free from memory.
- * \param freeSocketStrs If true, free the names and descriptions of sockets.
+ * \param freeSocketStrs If true, free the descriptions and default values of
+ * sockets.
  */
 void d_definition_free(const NodeDefinition nodeDef, bool freeSocketStrs) {
-    if (nodeDef.name != NULL) {
-        free((char *)nodeDef.name);
-    }
-
     if (nodeDef.description != NULL) {
         free((char *)nodeDef.description);
     }
@@ -774,7 +1073,6 @@ void d_definition_free(const NodeDefinition nodeDef, bool freeSocketStrs) {
             for (size_t i = 0; i < nodeDef.numSockets; i++) {
                 SocketMeta meta = nodeDef.sockets[i];
 
-                free((char *)meta.name);
                 free((char *)meta.description);
 
                 if (meta.type == TYPE_STRING) {
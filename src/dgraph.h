@@ -139,6 +139,9 @@ typedef struct _node {
                                    ///< Return node, this points to the
                                    ///< function. Otherwise, it points to the
                                    ///< name definition of the node.
+
+    CoreFunction coreFunc; ///< If the node is a core function, which one it
+                           ///< is. Otherwise, it is `-1`.
 } Node;
 
 /**
@@ -157,15 +160,33 @@ typedef struct _graph {
                  ///< so binary search can be performed on it.
 
     size_t numWires; ///< The number of wires in the `wires` array.
+
+    size_t nodesCapacity; ///< How many nodes the `nodes` array has room for.
+    size_t wiresCapacity; ///< How many wires the `wires` array has room for.
+
+    bool inBatch; ///< If true, wires are appended to the `wires` array
+                  ///< unsorted, and sorted by `d_graph_end_batch`.
+
+    size_t *socketOffsets; ///< If the graph has been indexed with
+                           ///< `d_graph_build_index`, for each node, the index
+                           ///< of its first socket in `wireOffsets`. It has
+                           ///< one more element than there are nodes.
+                           ///< Otherwise, `NULL`.
+    size_t *wireOffsets;   ///< If the graph has been indexed, for each socket
+                           ///< of each node, the index of the first wire in
+                           ///< `wires` coming from it. It has one more
+                           ///< element than there are sockets, so the wires
+                           ///< coming from socket `s` are in the range
+                           ///< `[wireOffsets[s], wireOffsets[s+1])`.
 } Graph;
 
 /**
  * \def EMPTY_GRAPH
  * \brief A graph wil no nodes or wires defined.
  */
-#define EMPTY_GRAPH      \
-    (Graph) {            \
-        NULL, 0, NULL, 0 \
+#define EMPTY_GRAPH                               \
+    (Graph) {                                     \
+        NULL, 0, NULL, 0, 0, 0, false, NULL, NULL \
     }
 
 /*
@@ -355,10 +376,66 @@ DECISION_API int d_wire_find_first(Graph graph, NodeSocket socket);
  */
 DECISION_API size_t d_socket_num_connections(Graph graph, NodeSocket socket);
 
+/**
+ * \fn void d_graph_reserve(Graph *graph, size_t numNodes, size_t numWires)
+ * \brief Make sure a graph has room for a number of nodes and wires, so they
+ * can be added without reallocating.
+ *
+ * \param graph The graph to reserve room in.
+ * \param numNodes How many nodes the graph should have room for in total.
+ * \param numWires How many wires the graph should have room for in total.
+ * Note that `d_graph_add_wire` stores each wire in both directions.
+ */
+DECISION_API void d_graph_reserve(Graph *graph, size_t numNodes,
+                                  size_t numWires);
+
+/**
+ * \fn void d_graph_begin_batch(Graph *graph)
+ * \brief Start adding wires to a graph in bulk.
+ *
+ * Until `d_graph_end_batch` is called, `d_graph_add_wire` appends wires to
+ * the end of the `wires` array instead of inserting them in order, so the
+ * graph shouldn't be queried until then.
+ *
+ * \param graph The graph to add wires to.
+ */
+DECISION_API void d_graph_begin_batch(Graph *graph);
+
+/**
+ * \fn void d_graph_end_batch(Graph *graph, const char *filePath)
+ * \brief Stop adding wires to a graph in bulk, sorting the wires that were
+ * added, and removing any duplicates.
+ *
+ * Sockets with too many connections are reported here rather than when the
+ * wires were added, with an error for each extra connection.
+ *
+ * \param graph The graph that wires were added to.
+ * \param filePath In case we error, say where we errored from.
+ */
+DECISION_API void d_graph_end_batch(Graph *graph, const char *filePath);
+
+/**
+ * \fn void d_graph_build_index(Graph *graph)
+ * \brief Index the wires of a graph by the socket they come from, so that
+ * `d_wire_find_first` and `d_socket_num_connections` take constant time.
+ *
+ * Since wires are stored in both directions, this indexes the wires going
+ * into a socket as well as the wires coming out of it. The index is thrown
+ * away whenever a node or wire is added to the graph. If the graph is already
+ * indexed, this does nothing.
+ *
+ * \param graph The graph to index. The wires need to be sorted, i.e. it can't
+ * be in a batch.
+ */
+DECISION_API void d_graph_build_index(Graph *graph);
+
 /**
  * \fn bool d_graph_add_wire(Graph *graph, Wire wire, const char *filePath)
  * \brief Add a wire to a sheet, connecting two sockets.
  *
+ * If the graph is in a batch, see `d_graph_begin_batch`, the wire is appended
+ * to the end of the `wires` array rather than inserted in order.
+ *
  * \return If the operation was successful.
  *
  * \param graph The graph to add the wire to. Both nodes have to belong to this
@@ -399,10 +476,12 @@ DECISION_API void d_graph_free(Graph *graph);
 
 /**
  * \fn void d_definition_free(const NodeDefinition nodeDef, bool freeSocketStrs)
- * \brief Free the malloc'd elements of a NodeDefinition.
+ * \brief Free the malloc'd elements of a NodeDefinition. The names are
+ * interned, so they are not freed.
  *
  * \param nodeDef The definition whose elements free from memory.
- * \param freeSocketStrs If true, free the names and descriptions of sockets.
+ * \param freeSocketStrs If true, free the descriptions and default values of
+ * sockets.
  */
 DECISION_API void d_definition_free(const NodeDefinition nodeDef,
                                     bool freeSocketStrs);
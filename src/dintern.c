@@ -0,0 +1,358 @@
+/*
+    Decision
+    Copyright (C) 2019-2020  Benjamin Beddows
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "dintern.h"
+
+#include "dcontext.h"
+#include "dmalloc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Strings are packed next to each other into chunks of this many bytes, since
+   arena allocations are padded out for alignment. */
+#define INTERN_CHUNK_SIZE ARENA_DEFAULT_BLOCK_SIZE
+
+/* How many buckets the pool starts with. */
+#define INTERN_INITIAL_BUCKETS 1024
+
+/**
+ * \struct _internEntry
+ * \brief A string in the intern pool.
+ *
+ * \typedef struct _internEntry InternEntry
+ */
+typedef struct _internEntry {
+    const char *str; ///< The interned string, or `NULL` if the bucket is
+                     ///< empty.
+    size_t len;      ///< The length of the string.
+    uint32_t hash;   ///< The hash of the string's characters.
+} InternEntry;
+
+/*
+    The pool is shared by every thread, so everything below is only used while
+    holding LOCK_INTERN.
+*/
+
+/* The arena the chunks of strings are allocated from. */
+static DArena *internArena = NULL;
+
+/* Where the next string goes in the current chunk, and how much room is left
+   in it. */
+static char *internChunk       = NULL;
+static size_t internChunkLeft = 0;
+
+/* The hash table of the strings in the pool. */
+static InternEntry *internBuckets = NULL;
+static size_t internNumBuckets    = 0;
+
+static InternStats internStats = {0, 0, 0, 0};
+
+/* How many things are holding on to the strings in the pool. See
+   d_intern_retain. */
+static size_t internNumHolders = 0;
+
+/**
+ * \fn static uint32_t hash_string(const char *str, size_t len)
+ * \brief Hash the characters of a string.
+ *
+ * \return The FNV-1a hash of the string.
+ *
+ * \param str The string to hash.
+ * \param len The number of characters in the string.
+ */
+static uint32_t hash_string(const char *str, size_t len) {
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)str[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+/**
+ * \fn static size_t find_bucket(const char *str, size_t len, uint32_t hash)
+ * \brief Find the bucket a string is in, or the empty bucket it would go in.
+ *
+ * \return The index of the bucket.
+ *
+ * \param str The string to find.
+ * \param len The number of characters in the string.
+ * \param hash The hash of the string.
+ */
+static size_t find_bucket(const char *str, size_t len, uint32_t hash) {
+    const size_t mask = internNumBuckets - 1;
+    size_t bucket     = hash & mask;
+
+    while (internBuckets[bucket].str != NULL) {
+        InternEntry entry = internBuckets[bucket];
+
+        if (entry.hash == hash && entry.len == len &&
+            memcmp(entry.str, str, len) == 0) {
+            break;
+        }
+
+        bucket = (bucket + 1) & mask;
+    }
+
+    return bucket;
+}
+
+/**
+ * \fn static void grow_buckets()
+ * \brief Double the number of buckets of the pool, or create them if there
+ * aren't any yet.
+ */
+static void grow_buckets() {
+    InternEntry *oldBuckets    = internBuckets;
+    const size_t oldNumBuckets = internNumBuckets;
+
+    internNumBuckets =
+        (oldNumBuckets > 0) ? 2 * oldNumBuckets : INTERN_INITIAL_BUCKETS;
+    internBuckets = d_calloc(internNumBuckets, sizeof(InternEntry));
+
+    for (size_t i = 0; i < oldNumBuckets; i++) {
+        InternEntry entry = oldBuckets[i];
+
+        if (entry.str != NULL) {
+            internBuckets[find_bucket(entry.str, entry.len, entry.hash)] =
+                entry;
+        }
+    }
+
+    if (oldBuckets != NULL) {
+        free(oldBuckets);
+    }
+}
+
+/**
+ * \fn static const char *store_string(const char *str, size_t len)
+ * \brief Copy a string into the chunks of the pool.
+ *
+ * \return The NULL-terminated copy of the string.
+ *
+ * \param str The string to copy.
+ * \param len The number of characters in the string.
+ */
+static const char *store_string(const char *str, size_t len) {
+    if (internArena == NULL) {
+        internArena = d_arena_create(INTERN_CHUNK_SIZE);
+    }
+
+    if (len + 1 > internChunkLeft) {
+        size_t chunkSize =
+            (len + 1 > INTERN_CHUNK_SIZE) ? len + 1 : INTERN_CHUNK_SIZE;
+
+        internChunk     = d_arena_push(internArena, chunkSize);
+        internChunkLeft = chunkSize;
+    }
+
+    char *out = internChunk;
+    memcpy(out, str, len);
+    out[len] = '\0';
+
+    internChunk += len + 1;
+    internChunkLeft -= len + 1;
+
+    return out;
+}
+
+/**
+ * \fn const char *d_intern_n(const char *str, size_t len)
+ * \brief Get the interned copy of the first `len` characters of a string,
+ * which doesn't need to be NULL-terminated.
+ *
+ * \return The interned copy of the string.
+ *
+ * \param str The start of the string to intern.
+ * \param len The number of characters in the string.
+ */
+const char *d_intern_n(const char *str, size_t len) {
+    // Hash the string before taking the lock, so other threads wait as little
+    // as possible.
+    const uint32_t hash = hash_string(str, len);
+
+    d_lock(LOCK_INTERN);
+
+    internStats.numRequests++;
+    internStats.requestedBytes += len + 1;
+
+    // Keep the table at most half full, so the probes stay short.
+    if (2 * (internStats.numStrings + 1) > internNumBuckets) {
+        grow_buckets();
+    }
+
+    const size_t bucket = find_bucket(str, len, hash);
+
+    if (internBuckets[bucket].str == NULL) {
+        internBuckets[bucket].str  = store_string(str, len);
+        internBuckets[bucket].len  = len;
+        internBuckets[bucket].hash = hash;
+
+        internStats.numStrings++;
+        internStats.numBytes += len + 1;
+    }
+
+    const char *interned = internBuckets[bucket].str;
+
+    d_unlock(LOCK_INTERN);
+
+    return interned;
+}
+
+/**
+ * \fn const char *d_intern(const char *str)
+ * \brief Get the interned copy of a string, adding it to the pool if it isn't
+ * already in it.
+ *
+ * Two interned strings are equal if and only if their pointers are equal.
+ * Interned strings belong to the pool, so they must not be freed. They last
+ * until nothing is holding on to the pool any more, see `d_intern_retain`.
+ *
+ * \return The interned copy of the string, or `NULL` if `str` is `NULL`.
+ *
+ * \param str The string to intern. The caller keeps ownership of it.
+ */
+const char *d_intern(const char *str) {
+    if (str == NULL) {
+        return NULL;
+    }
+
+    return d_intern_n(str, strlen(str));
+}
+
+/**
+ * \fn const char *d_intern_find(const char *str)
+ * \brief Get the interned copy of a string, without adding it to the pool.
+ *
+ * This is for looking up names: if a string isn't in the pool, nothing can
+ * have been defined with it.
+ *
+ * \return The interned copy of the string, or `NULL` if it has never been
+ * interned.
+ *
+ * \param str The string to look for.
+ */
+const char *d_intern_find(const char *str) {
+    if (str == NULL) {
+        return NULL;
+    }
+
+    const size_t len    = strlen(str);
+    const uint32_t hash = hash_string(str, len);
+    const char *found   = NULL;
+
+    d_lock_shared(LOCK_INTERN);
+
+    if (internNumBuckets > 0) {
+        found = internBuckets[find_bucket(str, len, hash)].str;
+    }
+
+    d_unlock_shared(LOCK_INTERN);
+
+    return found;
+}
+
+/**
+ * \fn uint32_t d_intern_hash(const char *interned)
+ * \brief Hash an interned string by its address, which is a lot quicker than
+ * hashing its characters.
+ *
+ * \return The hash of the string.
+ *
+ * \param interned The interned string to hash.
+ */
+uint32_t d_intern_hash(const char *interned) {
+    // Strings are packed together, so every bit of the address matters. Mix
+    // them all into the low bits, which are the ones used for buckets.
+    uint64_t x = (uint64_t)(uintptr_t)interned;
+
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+
+    return (uint32_t)x;
+}
+
+/**
+ * \fn InternStats d_intern_stats()
+ * \brief Get statistics about the intern pool.
+ *
+ * \return The statistics of the pool so far.
+ */
+InternStats d_intern_stats() {
+    d_lock_shared(LOCK_INTERN);
+    InternStats stats = internStats;
+    d_unlock_shared(LOCK_INTERN);
+
+    return stats;
+}
+
+/**
+ * \fn void d_intern_retain()
+ * \brief Hold on to the strings in the pool, so they aren't freed until
+ * `d_intern_release` is called.
+ *
+ * Sheets, compile contexts and C functions hold on to the pool for as long as
+ * they exist, since they use interned names.
+ */
+void d_intern_retain() {
+    d_lock(LOCK_INTERN);
+    internNumHolders++;
+    d_unlock(LOCK_INTERN);
+}
+
+/**
+ * \fn void d_intern_release()
+ * \brief Stop holding on to the strings in the pool. If nothing else is
+ * holding on to them, every string in the pool is freed, and the statistics
+ * of the pool start again from zero.
+ *
+ * This means a long-running program doesn't keep the names of sheets it has
+ * freed. Any interned strings that aren't in a sheet, context or C function
+ * need to be held on to with `d_intern_retain` to stay valid.
+ */
+void d_intern_release() {
+    d_lock(LOCK_INTERN);
+
+    if (internNumHolders > 0) {
+        internNumHolders--;
+    }
+
+    if (internNumHolders == 0) {
+        if (internArena != NULL) {
+            d_arena_free(internArena);
+            internArena = NULL;
+        }
+
+        if (internBuckets != NULL) {
+            free(internBuckets);
+            internBuckets = NULL;
+        }
+
+        internChunk      = NULL;
+        internChunkLeft  = 0;
+        internNumBuckets = 0;
+
+        memset(&internStats, 0, sizeof(InternStats));
+    }
+
+    d_unlock(LOCK_INTERN);
+}
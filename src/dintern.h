@@ -0,0 +1,144 @@
+/*
+    Decision
+    Copyright (C) 2019-2020  Benjamin Beddows
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file dintern.h
+ * \brief This header contains functions to intern strings, so that every
+ * distinct name in the program is only stored once.
+ *
+ * There is one pool for the whole process, which any thread can use. The
+ * strings in it are freed once nothing is holding on to the pool, see
+ * `d_intern_retain` and `d_intern_release`.
+ */
+
+#ifndef DINTERN_H
+#define DINTERN_H
+
+#include "dcfg.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+=== HEADER DEFINITIONS ====================================
+*/
+
+/**
+ * \struct _internStats
+ * \brief How much the intern pool has stored, and how much it has been asked
+ * to store.
+ *
+ * \typedef struct _internStats InternStats
+ */
+typedef struct _internStats {
+    size_t numStrings; ///< The number of distinct strings in the pool.
+    size_t numBytes;   ///< The bytes the strings take up, including their
+                       ///< NULL terminators.
+
+    size_t numRequests;    ///< The number of strings that have been interned.
+    size_t requestedBytes; ///< The bytes those strings would have taken up if
+                           ///< they were all stored separately.
+} InternStats;
+
+/*
+=== FUNCTIONS =============================================
+*/
+
+/**
+ * \fn const char *d_intern(const char *str)
+ * \brief Get the interned copy of a string, adding it to the pool if it isn't
+ * already in it.
+ *
+ * Two interned strings are equal if and only if their pointers are equal.
+ * Interned strings belong to the pool, so they must not be freed. They last
+ * until nothing is holding on to the pool any more, see `d_intern_retain`.
+ *
+ * \return The interned copy of the string, or `NULL` if `str` is `NULL`.
+ *
+ * \param str The string to intern. The caller keeps ownership of it.
+ */
+DECISION_API const char *d_intern(const char *str);
+
+/**
+ * \fn const char *d_intern_n(const char *str, size_t len)
+ * \brief Get the interned copy of the first `len` characters of a string,
+ * which doesn't need to be NULL-terminated.
+ *
+ * \return The interned copy of the string.
+ *
+ * \param str The start of the string to intern.
+ * \param len The number of characters in the string.
+ */
+DECISION_API const char *d_intern_n(const char *str, size_t len);
+
+/**
+ * \fn const char *d_intern_find(const char *str)
+ * \brief Get the interned copy of a string, without adding it to the pool.
+ *
+ * This is for looking up names: if a string isn't in the pool, nothing can
+ * have been defined with it.
+ *
+ * \return The interned copy of the string, or `NULL` if it has never been
+ * interned.
+ *
+ * \param str The string to look for.
+ */
+DECISION_API const char *d_intern_find(const char *str);
+
+/**
+ * \fn uint32_t d_intern_hash(const char *interned)
+ * \brief Hash an interned string by its address, which is a lot quicker than
+ * hashing its characters.
+ *
+ * \return The hash of the string.
+ *
+ * \param interned The interned string to hash.
+ */
+DECISION_API uint32_t d_intern_hash(const char *interned);
+
+/**
+ * \fn InternStats d_intern_stats()
+ * \brief Get statistics about the intern pool.
+ *
+ * \return The statistics of the pool so far.
+ */
+DECISION_API InternStats d_intern_stats();
+
+/**
+ * \fn void d_intern_retain()
+ * \brief Hold on to the strings in the pool, so they aren't freed until
+ * `d_intern_release` is called.
+ *
+ * Sheets, compile contexts and C functions hold on to the pool for as long as
+ * they exist, since they use interned names.
+ */
+DECISION_API void d_intern_retain();
+
+/**
+ * \fn void d_intern_release()
+ * \brief Stop holding on to the strings in the pool. If nothing else is
+ * holding on to them, every string in the pool is freed, and the statistics
+ * of the pool start again from zero.
+ *
+ * This means a long-running program doesn't keep the names of sheets it has
+ * freed. Any interned strings that aren't in a sheet, context or C function
+ * need to be held on to with `d_intern_retain` to stay valid.
+ */
+DECISION_API void d_intern_release();
+
+#endif // DINTERN_H
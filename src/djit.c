@@ -0,0 +1,1652 @@
+/*
+    Decision
+    Copyright (C) 2019-2020  Benjamin Beddows
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "djit.h"
+
+#include "dmalloc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+    If `DECISION_JIT` is defined (see the `COMPILER_JIT` CMake option), and
+    the platform is 64-bit x86 with POSIX memory mapping, decoded text sections
+    can be compiled to native code. Everywhere else, `d_jit_compile` doesn't
+    compile anything, and the VM interprets everything as usual.
+*/
+#if defined(DECISION_JIT) && !defined(DECISION_32) && \
+    (defined(__x86_64__) || defined(_M_X64)) &&        \
+    (defined(__unix__) || defined(__APPLE__))
+#define JIT_X86_64
+
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/*
+    This needs to be the same condition as the one in dvm.c. If the stack is
+    guarded, it grows by itself, so the native code doesn't need to check that
+    there is space on the stack before pushing.
+*/
+#if defined(DECISION_GUARDED_STACK) && (defined(__unix__) || defined(__APPLE__))
+#define JIT_GUARDED_STACK
+#endif
+
+#ifdef JIT_X86_64
+
+/*
+=== X86-64 ENCODING ======================================
+*/
+
+/*
+    The native code is a template JIT: each decoded instruction is turned into
+    a fixed sequence of x86-64 instructions that does the same thing to the
+    VM's stack in memory. While native code is running, these registers are
+    used:
+
+    * `rdi`: The VM.
+    * `rsi`: The stack pointer.
+    * `r10`: The frame pointer.
+    * `r8`: The end of the stack, i.e. `basePtr + stackSize`.
+    * `rax`, `rcx` and `rdx`: Scratch registers.
+
+    These are all caller-saved in the System V ABI, so the native code doesn't
+    need a stack frame of its own. The only thing it calls is
+    `d_vm_syscall`, around which it saves the registers it still needs on the
+    native stack. It returns to the VM by writing the stack and frame pointers
+    back and returning the decoded instruction the VM should carry on from in
+    `rax`.
+
+    Calls and returns between Decision functions are compiled too, and build
+    the same stack frames as the VM does. Since a return address is a decoded
+    instruction that is only known at runtime, returning (and calling a
+    function in another range) checks if that instruction has been replaced
+    with `VM_OP_NATIVE`, and if so, jumps straight to its native code instead
+    of going through the VM.
+*/
+
+/**
+ * \enum _jitReg
+ * \brief The x86-64 registers that the native code uses.
+ *
+ * \typedef enum _jitReg JitReg
+ */
+typedef enum _jitReg {
+    JIT_RAX = 0,
+    JIT_RCX = 1,
+    JIT_RDX = 2,
+    JIT_RSI = 6,
+    JIT_RDI = 7,
+    JIT_R8  = 8,
+    JIT_R10 = 10,
+} JitReg;
+
+#define JIT_VM    JIT_RDI
+#define JIT_SP    JIT_RSI
+#define JIT_FP    JIT_R10
+#define JIT_LIMIT JIT_R8
+
+/**
+ * \enum _jitCond
+ * \brief The x86-64 condition codes that the native code uses.
+ *
+ * \typedef enum _jitCond JitCond
+ */
+typedef enum _jitCond {
+    JIT_CC_B      = 0x2,
+    JIT_CC_AE     = 0x3,
+    JIT_CC_E      = 0x4,
+    JIT_CC_NE     = 0x5,
+    JIT_CC_L      = 0xC,
+    JIT_CC_GE     = 0xD,
+    JIT_CC_LE     = 0xE,
+    JIT_CC_G      = 0xF,
+    JIT_CC_ALWAYS = 0x10,
+} JitCond;
+
+/**
+ * \def JIT_CC_NOT(cc)
+ * \brief Get the opposite of a condition code.
+ */
+#define JIT_CC_NOT(cc) ((JitCond)((cc) ^ 1))
+
+/* Opcodes of the "op r/m64, r64" forms of instructions. */
+#define JIT_OP_ADD        0x01
+#define JIT_OP_OR         0x09
+#define JIT_OP_AND        0x21
+#define JIT_OP_SUB        0x29
+#define JIT_OP_XOR        0x31
+#define JIT_OP_CMP        0x39
+#define JIT_OP_TEST       0x85
+#define JIT_OP_STORE_BYTE 0x88
+#define JIT_OP_STORE      0x89
+#define JIT_OP_LOAD       0x8B
+#define JIT_OP_LEA        0x8D
+
+/* Opcode extensions of the "shift r/m64, imm8" instruction. */
+#define JIT_SHIFT_SHL 4
+#define JIT_SHIFT_SAR 7
+
+/**
+ * \struct _jitBuffer
+ * \brief A growing buffer of machine code.
+ *
+ * \typedef struct _jitBuffer JitBuffer
+ */
+typedef struct _jitBuffer {
+    unsigned char *bytes;
+    size_t size;
+    size_t capacity;
+} JitBuffer;
+
+/**
+ * \fn static void jit_byte(JitBuffer *buf, unsigned char byte)
+ * \brief Add a byte to the end of the buffer.
+ *
+ * \param buf The buffer to add to.
+ * \param byte The byte to add.
+ */
+static void jit_byte(JitBuffer *buf, unsigned char byte) {
+    if (buf->size >= buf->capacity) {
+        buf->capacity = (buf->capacity > 0) ? buf->capacity * 2 : 256;
+        buf->bytes    = d_realloc(buf->bytes, buf->capacity);
+    }
+
+    buf->bytes[buf->size++] = byte;
+}
+
+/**
+ * \fn static void jit_u32(JitBuffer *buf, uint32_t value)
+ * \brief Add a 32-bit little-endian value to the end of the buffer.
+ *
+ * \param buf The buffer to add to.
+ * \param value The value to add.
+ */
+static void jit_u32(JitBuffer *buf, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        jit_byte(buf, (unsigned char)(value >> (8 * i)));
+    }
+}
+
+/**
+ * \fn static void jit_u64(JitBuffer *buf, uint64_t value)
+ * \brief Add a 64-bit little-endian value to the end of the buffer.
+ *
+ * \param buf The buffer to add to.
+ * \param value The value to add.
+ */
+static void jit_u64(JitBuffer *buf, uint64_t value) {
+    jit_u32(buf, (uint32_t)value);
+    jit_u32(buf, (uint32_t)(value >> 32));
+}
+
+/**
+ * \fn static void jit_rex(JitBuffer *buf, int reg, int rm)
+ * \brief Add a 64-bit REX prefix for the given ModRM registers.
+ *
+ * \param buf The buffer to add to.
+ * \param reg The register in the `reg` field.
+ * \param rm The register in the `r/m` field.
+ */
+static void jit_rex(JitBuffer *buf, int reg, int rm) {
+    jit_byte(buf,
+             (unsigned char)(0x48 | ((reg & 8) >> 1) | ((rm & 8) >> 3)));
+}
+
+/**
+ * \fn static void jit_modrm(JitBuffer *buf, int mod, int reg, int rm)
+ * \brief Add a ModRM byte.
+ *
+ * \param buf The buffer to add to.
+ * \param mod The addressing mode.
+ * \param reg The register, or opcode extension, in the `reg` field.
+ * \param rm The register in the `r/m` field.
+ */
+static void jit_modrm(JitBuffer *buf, int mod, int reg, int rm) {
+    jit_byte(buf, (unsigned char)((mod << 6) | ((reg & 7) << 3) | (rm & 7)));
+}
+
+/**
+ * \fn static void jit_mem(JitBuffer *buf, unsigned char op, JitReg reg,
+ *                         JitReg base, dint index)
+ * \brief Add an instruction that uses `reg` and the element `index` elements
+ * away from `base`, e.g. `mov reg, [base + 8 * index]`.
+ *
+ * \param buf The buffer to add to.
+ * \param op The opcode, e.g. `JIT_OP_LOAD`.
+ * \param reg The register operand.
+ * \param base The register to address from. This can't be `rsp` or `r12`.
+ * \param index How many elements away from `base` the memory operand is.
+ */
+static void jit_mem(JitBuffer *buf, unsigned char op, JitReg reg, JitReg base,
+                    dint index) {
+    jit_rex(buf, reg, base);
+    jit_byte(buf, op);
+    jit_modrm(buf, 2, reg, base);
+    jit_u32(buf, (uint32_t)(int32_t)(index * (dint)sizeof(dint)));
+}
+
+/**
+ * \fn static void jit_field(JitBuffer *buf, unsigned char op, JitReg reg,
+ *                           size_t offset)
+ * \brief Add an instruction that uses `reg` and a field of the VM.
+ *
+ * \param buf The buffer to add to.
+ * \param op The opcode, e.g. `JIT_OP_LOAD`.
+ * \param reg The register operand.
+ * \param offset The offset of the field in `DVM`.
+ */
+static void jit_field(JitBuffer *buf, unsigned char op, JitReg reg,
+                      size_t offset) {
+    jit_rex(buf, reg, JIT_VM);
+    jit_byte(buf, op);
+    jit_modrm(buf, 2, reg, JIT_VM);
+    jit_u32(buf, (uint32_t)offset);
+}
+
+/**
+ * \fn static void jit_alu(JitBuffer *buf, unsigned char op, JitReg dst,
+ *                         JitReg src)
+ * \brief Add an instruction of the form `op dst, src`.
+ *
+ * \param buf The buffer to add to.
+ * \param op The opcode, e.g. `JIT_OP_ADD`.
+ * \param dst The destination register.
+ * \param src The source register.
+ */
+static void jit_alu(JitBuffer *buf, unsigned char op, JitReg dst, JitReg src) {
+    jit_rex(buf, src, dst);
+    jit_byte(buf, op);
+    jit_modrm(buf, 3, src, dst);
+}
+
+/**
+ * \fn static void jit_mov_imm(JitBuffer *buf, JitReg dst, int64_t value)
+ * \brief Add an instruction that sets a register to a constant.
+ *
+ * \param buf The buffer to add to.
+ * \param dst The register to set.
+ * \param value The value to set it to.
+ */
+static void jit_mov_imm(JitBuffer *buf, JitReg dst, int64_t value) {
+    if (value >= INT32_MIN && value <= INT32_MAX) {
+        // mov r/m64, imm32 (sign-extended)
+        jit_rex(buf, 0, dst);
+        jit_byte(buf, 0xC7);
+        jit_modrm(buf, 3, 0, dst);
+        jit_u32(buf, (uint32_t)(int32_t)value);
+    } else {
+        // mov r64, imm64
+        jit_rex(buf, 0, dst);
+        jit_byte(buf, (unsigned char)(0xB8 | (dst & 7)));
+        jit_u64(buf, (uint64_t)value);
+    }
+}
+
+/**
+ * \fn static void jit_add_elements(JitBuffer *buf, JitReg dst, dint n)
+ * \brief Add an instruction that moves a pointer to the stack by `n`
+ * elements.
+ *
+ * \param buf The buffer to add to.
+ * \param dst The register containing the pointer.
+ * \param n How many elements to move by.
+ */
+static void jit_add_elements(JitBuffer *buf, JitReg dst, dint n) {
+    if (n == 0) {
+        return;
+    }
+
+    // add r/m64, imm32
+    jit_rex(buf, 0, dst);
+    jit_byte(buf, 0x81);
+    jit_modrm(buf, 3, 0, dst);
+    jit_u32(buf, (uint32_t)(int32_t)(n * (dint)sizeof(dint)));
+}
+
+/**
+ * \fn static void jit_load_byte(JitBuffer *buf, JitReg dst, JitReg base)
+ * \brief Add an instruction that zero-extends the byte `base` points to into
+ * `dst`.
+ *
+ * \param buf The buffer to add to.
+ * \param dst The register to load into.
+ * \param base The register containing the pointer. This can't be `rsp` or
+ * `r12`.
+ */
+static void jit_load_byte(JitBuffer *buf, JitReg dst, JitReg base) {
+    // movzx r64, byte [base + 0]
+    jit_rex(buf, dst, base);
+    jit_byte(buf, 0x0F);
+    jit_byte(buf, 0xB6);
+    jit_modrm(buf, 2, dst, base);
+    jit_u32(buf, 0);
+}
+
+/**
+ * \fn static void jit_shift(JitBuffer *buf, int ext, JitReg dst,
+ *                           uint8_t amount)
+ * \brief Add an instruction that shifts a register by a constant.
+ *
+ * \param buf The buffer to add to.
+ * \param ext The kind of shift, e.g. `JIT_SHIFT_SHL`.
+ * \param dst The register to shift.
+ * \param amount How many bits to shift by.
+ */
+static void jit_shift(JitBuffer *buf, int ext, JitReg dst, uint8_t amount) {
+    jit_rex(buf, 0, dst);
+    jit_byte(buf, 0xC1);
+    jit_modrm(buf, 3, ext, dst);
+    jit_byte(buf, amount);
+}
+
+/**
+ * \fn static void jit_save(JitBuffer *buf, JitReg reg)
+ * \brief Add an instruction that pushes a register onto the native stack.
+ *
+ * \param buf The buffer to add to.
+ * \param reg The register to push.
+ */
+static void jit_save(JitBuffer *buf, JitReg reg) {
+    if (reg & 8) {
+        jit_byte(buf, 0x41);
+    }
+    jit_byte(buf, (unsigned char)(0x50 | (reg & 7)));
+}
+
+/**
+ * \fn static void jit_restore(JitBuffer *buf, JitReg reg)
+ * \brief Add an instruction that pops a register off the native stack.
+ *
+ * \param buf The buffer to add to.
+ * \param reg The register to pop into.
+ */
+static void jit_restore(JitBuffer *buf, JitReg reg) {
+    if (reg & 8) {
+        jit_byte(buf, 0x41);
+    }
+    jit_byte(buf, (unsigned char)(0x58 | (reg & 7)));
+}
+
+/**
+ * \fn static void jit_is_native(JitBuffer *buf, JitReg reg)
+ * \brief Add an instruction that compares the opcode of the decoded
+ * instruction `reg` points to with `VM_OP_NATIVE`.
+ *
+ * \param buf The buffer to add to.
+ * \param reg The register containing the decoded instruction.
+ */
+static void jit_is_native(JitBuffer *buf, JitReg reg) {
+    // cmp byte [reg + offset], imm8
+    jit_rex(buf, 0, reg);
+    jit_byte(buf, 0x80);
+    jit_modrm(buf, 2, 7, reg);
+    jit_u32(buf, (uint32_t)offsetof(DecodedIns, opcode));
+    jit_byte(buf, VM_OP_NATIVE);
+}
+
+/**
+ * \fn static size_t jit_jcc(JitBuffer *buf, JitCond cc)
+ * \brief Add a jump with a 32-bit relative offset, which needs to be set with
+ * `jit_patch`.
+ *
+ * \return The position of the offset in the buffer.
+ *
+ * \param buf The buffer to add to.
+ * \param cc When to jump. `JIT_CC_ALWAYS` for an unconditional jump.
+ */
+static size_t jit_jcc(JitBuffer *buf, JitCond cc) {
+    if (cc == JIT_CC_ALWAYS) {
+        jit_byte(buf, 0xE9);
+    } else {
+        jit_byte(buf, 0x0F);
+        jit_byte(buf, (unsigned char)(0x80 | cc));
+    }
+
+    const size_t at = buf->size;
+    jit_u32(buf, 0);
+    return at;
+}
+
+/**
+ * \fn static void jit_patch(JitBuffer *buf, size_t at, size_t to)
+ * \brief Set the offset of a jump added by `jit_jcc`.
+ *
+ * \param buf The buffer containing the jump.
+ * \param at The position of the offset in the buffer.
+ * \param to The position in the buffer to jump to.
+ */
+static void jit_patch(JitBuffer *buf, size_t at, size_t to) {
+    const uint32_t rel = (uint32_t)(int32_t)((int64_t)to - (int64_t)(at + 4));
+
+    for (int i = 0; i < 4; i++) {
+        buf->bytes[at + i] = (unsigned char)(rel >> (8 * i));
+    }
+}
+
+/*
+=== COMPILING =============================================
+*/
+
+/**
+ * \struct _jitPatch
+ * \brief A jump to a decoded instruction that hasn't been compiled yet.
+ *
+ * \typedef struct _jitPatch JitPatch
+ */
+typedef struct _jitPatch {
+    size_t at;    ///< Where the jump's offset is in the buffer.
+    size_t index; ///< The index of the decoded instruction to jump to in the
+                  ///< range being compiled.
+} JitPatch;
+
+/**
+ * \struct _jitCompiler
+ * \brief The state of the JIT while it compiles a range of decoded
+ * instructions.
+ *
+ * \typedef struct _jitCompiler JitCompiler
+ */
+typedef struct _jitCompiler {
+    JitBuffer buf;
+
+    DecodedIns *first; ///< The first decoded instruction in the range.
+    size_t numIns;     ///< The number of decoded instructions in the range.
+
+    bool *supported; ///< For each decoded instruction in the range, can it be
+                     ///< compiled?
+    size_t *label;   ///< For each decoded instruction in the range, where its
+                     ///< native code is in the buffer.
+
+    JitPatch *patches;
+    size_t numPatches;
+} JitCompiler;
+
+/**
+ * \fn static DIns jit_base_op(unsigned char opcode, bool *immediate)
+ * \brief Get the stack instruction that an arithmetic or comparison
+ * instruction is a form of, e.g. `OP_ADD` for `OP_ADDBI`.
+ *
+ * \return The stack instruction, or `OP_RET` if there isn't one.
+ *
+ * \param opcode The opcode of the instruction.
+ * \param immediate Set to true if the right operand is the instruction's
+ * `operand`.
+ */
+static DIns jit_base_op(unsigned char opcode, bool *immediate) {
+    *immediate = true;
+
+    switch (opcode) {
+        case OP_ADDBI:
+        case OP_ADDHI:
+        case OP_ADDFI:
+            return OP_ADD;
+        case OP_ANDBI:
+        case OP_ANDHI:
+        case OP_ANDFI:
+            return OP_AND;
+        case OP_DIVBI:
+        case OP_DIVHI:
+        case OP_DIVFI:
+            return OP_DIV;
+        case OP_MODBI:
+        case OP_MODHI:
+        case OP_MODFI:
+            return OP_MOD;
+        case OP_MULBI:
+        case OP_MULHI:
+        case OP_MULFI:
+            return OP_MUL;
+        case OP_ORBI:
+        case OP_ORHI:
+        case OP_ORFI:
+            return OP_OR;
+        case OP_SUBBI:
+        case OP_SUBHI:
+        case OP_SUBFI:
+            return OP_SUB;
+        case OP_XORBI:
+        case OP_XORHI:
+        case OP_XORFI:
+            return OP_XOR;
+
+        case OP_ADD:
+        case OP_AND:
+        case OP_CEQ:
+        case OP_CLEQ:
+        case OP_CLT:
+        case OP_CMEQ:
+        case OP_CMT:
+        case OP_DIV:
+        case OP_MOD:
+        case OP_MUL:
+        case OP_OR:
+        case OP_SUB:
+        case OP_XOR:
+            *immediate = false;
+            return (DIns)opcode;
+
+        case OP_CEQ_JRCONBI:
+            *immediate = false;
+            return OP_CEQ;
+        case OP_CLEQ_JRCONBI:
+            *immediate = false;
+            return OP_CLEQ;
+        case OP_CLT_JRCONBI:
+            *immediate = false;
+            return OP_CLT;
+        case OP_CMEQ_JRCONBI:
+            *immediate = false;
+            return OP_CMEQ;
+        case OP_CMT_JRCONBI:
+            *immediate = false;
+            return OP_CMT;
+
+        default:
+            break;
+    }
+
+    *immediate = false;
+    return OP_RET;
+}
+
+/**
+ * \fn static JitCond jit_compare_cond(DIns op)
+ * \brief Get the condition code for a comparison instruction.
+ *
+ * \return The condition code, or `JIT_CC_ALWAYS` if `op` isn't a comparison.
+ *
+ * \param op The comparison instruction.
+ */
+static JitCond jit_compare_cond(DIns op) {
+    switch (op) {
+        case OP_CEQ:
+            return JIT_CC_E;
+        case OP_CLEQ:
+            return JIT_CC_LE;
+        case OP_CLT:
+            return JIT_CC_L;
+        case OP_CMEQ:
+            return JIT_CC_GE;
+        case OP_CMT:
+            return JIT_CC_G;
+        default:
+            return JIT_CC_ALWAYS;
+    }
+}
+
+/**
+ * \fn static uint8_t jit_pushes(DecodedIns *ins)
+ * \brief Get how many elements an instruction needs space for on the stack.
+ *
+ * \return The number of elements, which is what the native code checks for.
+ *
+ * \param ins The decoded instruction.
+ */
+static uint8_t jit_pushes(DecodedIns *ins) {
+    switch (ins->opcode) {
+        case OP_GETBI:
+        case OP_GETHI:
+        case OP_GETFI:
+        case OP_PUSHB:
+        case OP_PUSHH:
+        case OP_PUSHF:
+        case OP_DEREFI:
+        case OP_DEREFBI:
+        case OP_GETBI_ADDBI:
+        case OP_GETBI_SUBBI:
+        case OP_PUSHB_SYSCALL:
+            return 1;
+
+        case OP_PUSHNB:
+        case OP_PUSHNH:
+        case OP_PUSHNF:
+            return (uint8_t)ins->operand;
+
+        case OP_GETBI_GETBI:
+        case OP_GETBI_GETBI_ADD:
+        case OP_PUSHB_GETBI:
+            return 2;
+
+        default:
+            return 0;
+    }
+}
+
+/**
+ * \fn static bool jit_in_range(JitCompiler *c, DecodedIns *ins)
+ * \brief Check if a decoded instruction is in the range being compiled.
+ *
+ * \return If the instruction is in the range.
+ *
+ * \param c The compiler.
+ * \param ins The decoded instruction.
+ */
+static bool jit_in_range(JitCompiler *c, DecodedIns *ins) {
+    return ins >= c->first && ins < c->first + c->numIns;
+}
+
+/**
+ * \fn static bool jit_is_call(DecodedIns *ins)
+ * \brief Check if a decoded instruction is a call to a Decision function at a
+ * fixed location.
+ *
+ * \return If the instruction is a fixed call.
+ *
+ * \param ins The decoded instruction.
+ */
+static bool jit_is_call(DecodedIns *ins) {
+    return ins->opcode == OP_CALLI || ins->opcode == OP_CALLRB ||
+           ins->opcode == OP_CALLRH || ins->opcode == OP_CALLRF;
+}
+
+/**
+ * \fn static bool jit_calls_in_range(JitCompiler *c, DecodedIns *ins)
+ * \brief Check if a fixed call goes to a compiled instruction in the range
+ * being compiled, so the native code can jump straight to it.
+ *
+ * \return If the call's target is compiled in the same range.
+ *
+ * \param c The compiler.
+ * \param ins The call.
+ */
+static bool jit_calls_in_range(JitCompiler *c, DecodedIns *ins) {
+    return jit_in_range(c, ins->target) && c->supported[ins->target - c->first];
+}
+
+/**
+ * \fn static bool jit_can_compile(DecodedIns *ins)
+ * \brief Check if the JIT can compile a decoded instruction.
+ *
+ * \return If the instruction can be compiled.
+ *
+ * \param ins The decoded instruction.
+ */
+static bool jit_can_compile(DecodedIns *ins) {
+    bool immediate;
+    const DIns op = jit_base_op(ins->opcode, &immediate);
+
+    // Dividing by a constant 0 is always an error, so leave it to the VM.
+    if ((op == OP_DIV || op == OP_MOD) && immediate && ins->operand == 0) {
+        return false;
+    }
+
+    switch (ins->opcode) {
+        case OP_ADDBI_JRBI:
+        case OP_CEQ_JRCONBI:
+        case OP_CLEQ_JRCONBI:
+        case OP_CLT_JRCONBI:
+        case OP_CMEQ_JRCONBI:
+        case OP_CMT_JRCONBI:
+        case OP_JCONI:
+        case OP_JI:
+        case OP_JRBI:
+        case OP_JRHI:
+        case OP_JRFI:
+        case OP_JRCONBI:
+        case OP_JRCONHI:
+        case OP_JRCONFI:
+        case OP_CALLI:
+        case OP_CALLRB:
+        case OP_CALLRH:
+        case OP_CALLRF:
+            return ins->target != NULL;
+
+        case OP_PUSHNB:
+        case OP_PUSHNH:
+        case OP_PUSHNF:
+            return ins->operand >= 0 && ins->operand <= UINT8_MAX;
+
+        case OP_DEREF:
+        case OP_DEREFI:
+        case OP_DEREFB:
+        case OP_DEREFBI:
+        case OP_RET:
+        case OP_RETN:
+        case OP_SETADR:
+        case OP_SETADRB:
+        case OP_SYSCALL:
+        case OP_PUSHB_SYSCALL:
+        case OP_SYSCALL_POP:
+        case OP_GETBI:
+        case OP_GETHI:
+        case OP_GETFI:
+        case OP_INV:
+        case OP_NOT:
+        case OP_POP:
+        case OP_PUSHB:
+        case OP_PUSHH:
+        case OP_PUSHF:
+        case OP_GETBI_ADDBI:
+        case OP_GETBI_GETBI:
+        case OP_GETBI_GETBI_ADD:
+        case OP_GETBI_SUBBI:
+        case OP_PUSHB_GETBI:
+            return true;
+
+        default:
+            break;
+    }
+
+    return op != OP_RET;
+}
+
+/**
+ * \fn static bool jit_can_enter(JitCompiler *c, DecodedIns *ins)
+ * \brief Check if the VM can enter native code at a decoded instruction.
+ *
+ * This is only the case if the only reason the native code would give the
+ * instruction back to the VM is that the stack needs to grow, which the VM
+ * does before entering the native code. Otherwise, the VM would keep entering
+ * and leaving the native code at the same instruction.
+ *
+ * \return If the VM can enter native code at the instruction.
+ *
+ * \param c The compiler.
+ * \param ins The decoded instruction.
+ */
+static bool jit_can_enter(JitCompiler *c, DecodedIns *ins) {
+    switch (ins->opcode) {
+        // Dividing by 0, and returning from the last frame, are left to the
+        // VM.
+        case OP_DIV:
+        case OP_MOD:
+        case OP_RET:
+        case OP_RETN:
+            return false;
+
+        default:
+            break;
+    }
+
+    // Calls out of the range are left to the VM if the function they call
+    // isn't running native code.
+    return !jit_is_call(ins) || jit_calls_in_range(c, ins);
+}
+
+/**
+ * \fn static void jit_exit(JitCompiler *c, DecodedIns *to)
+ * \brief Compile returning to the VM.
+ *
+ * \param c The compiler.
+ * \param to The decoded instruction the VM should carry on from.
+ */
+static void jit_exit(JitCompiler *c, DecodedIns *to) {
+    jit_field(&c->buf, JIT_OP_STORE, JIT_SP, offsetof(DVM, stackPtr));
+    jit_field(&c->buf, JIT_OP_STORE, JIT_FP, offsetof(DVM, framePtr));
+    jit_mov_imm(&c->buf, JIT_RAX, (int64_t)(intptr_t)to);
+    jit_byte(&c->buf, 0xC3); // ret
+}
+
+/**
+ * \fn static void jit_exit_if(JitCompiler *c, JitCond cc, DecodedIns *to)
+ * \brief Compile returning to the VM if a condition is true.
+ *
+ * \param c The compiler.
+ * \param cc The condition.
+ * \param to The decoded instruction the VM should carry on from.
+ */
+static void jit_exit_if(JitCompiler *c, JitCond cc, DecodedIns *to) {
+    if (cc == JIT_CC_ALWAYS) {
+        jit_exit(c, to);
+        return;
+    }
+
+    const size_t skip = jit_jcc(&c->buf, JIT_CC_NOT(cc));
+    jit_exit(c, to);
+    jit_patch(&c->buf, skip, c->buf.size);
+}
+
+/**
+ * \fn static void jit_continue(JitCompiler *c, JitReg to)
+ * \brief Compile carrying on from a decoded instruction that is only known at
+ * runtime, like a return address.
+ *
+ * If the instruction has been replaced with `VM_OP_NATIVE`, the native code
+ * jumps straight to its native code. Otherwise, it returns to the VM.
+ *
+ * \param c The compiler.
+ * \param to The register containing the decoded instruction to carry on
+ * from.
+ */
+static void jit_continue(JitCompiler *c, JitReg to) {
+    JitBuffer *buf = &c->buf;
+
+    jit_field(buf, JIT_OP_STORE, JIT_SP, offsetof(DVM, stackPtr));
+    jit_field(buf, JIT_OP_STORE, JIT_FP, offsetof(DVM, framePtr));
+
+    jit_is_native(buf, to);
+    const size_t toVM = jit_jcc(buf, JIT_CC_NE);
+
+    // jmp qword [to + offset], with the VM still in rdi.
+    jit_byte(buf, 0xFF);
+    jit_modrm(buf, 2, 4, to);
+    jit_u32(buf, (uint32_t)offsetof(DecodedIns, native));
+
+    jit_patch(buf, toVM, buf->size);
+    jit_alu(buf, JIT_OP_STORE, JIT_RAX, to);
+    jit_byte(buf, 0xC3); // ret
+}
+
+/**
+ * \fn static void jit_goto(JitCompiler *c, JitCond cc, DecodedIns *to)
+ * \brief Compile jumping to a decoded instruction if a condition is true.
+ *
+ * If the instruction is compiled in the same range, the native code jumps
+ * straight to it. Otherwise, the native code returns to the VM.
+ *
+ * \param c The compiler.
+ * \param cc The condition.
+ * \param to The decoded instruction to jump to.
+ */
+static void jit_goto(JitCompiler *c, JitCond cc, DecodedIns *to) {
+    if (jit_in_range(c, to) && c->supported[to - c->first]) {
+        JitPatch patch;
+        patch.at    = jit_jcc(&c->buf, cc);
+        patch.index = (size_t)(to - c->first);
+
+        c->numPatches++;
+        c->patches = d_realloc(c->patches, c->numPatches * sizeof(JitPatch));
+        c->patches[c->numPatches - 1] = patch;
+    } else {
+        jit_exit_if(c, cc, to);
+    }
+}
+
+/**
+ * \fn static void jit_reserve(JitCompiler *c, DecodedIns *ins)
+ * \brief Compile checking that there is enough space on the stack for an
+ * instruction, and giving the instruction to the VM if there isn't.
+ *
+ * \param c The compiler.
+ * \param ins The instruction that is about to push.
+ */
+static void jit_reserve(JitCompiler *c, DecodedIns *ins) {
+#ifdef JIT_GUARDED_STACK
+    (void)c;
+    (void)ins;
+#else
+    const uint8_t n = jit_pushes(ins);
+
+    if (n > 0) {
+        jit_mem(&c->buf, JIT_OP_LEA, JIT_RAX, JIT_SP, n);
+        jit_alu(&c->buf, JIT_OP_CMP, JIT_RAX, JIT_LIMIT);
+        jit_exit_if(c, JIT_CC_AE, ins);
+    }
+#endif // JIT_GUARDED_STACK
+}
+
+/**
+ * \fn static void jit_get(JitCompiler *c, JitReg dst, dint index)
+ * \brief Compile loading an element of the stack into a register, in the same
+ * way as `d_vm_get`.
+ *
+ * \param c The compiler.
+ * \param dst The register to load into.
+ * \param index The index of the element.
+ */
+static void jit_get(JitCompiler *c, JitReg dst, dint index) {
+    jit_mem(&c->buf, JIT_OP_LOAD, dst, (index > 0) ? JIT_FP : JIT_SP, index);
+}
+
+/**
+ * \fn static void jit_push(JitCompiler *c, JitReg src)
+ * \brief Compile pushing a register onto the stack.
+ *
+ * \param c The compiler.
+ * \param src The register to push.
+ */
+static void jit_push(JitCompiler *c, JitReg src) {
+    jit_add_elements(&c->buf, JIT_SP, 1);
+    jit_mem(&c->buf, JIT_OP_STORE, src, JIT_SP, 0);
+}
+
+/**
+ * \fn static void jit_op(JitCompiler *c, DIns op, DecodedIns *ins)
+ * \brief Compile `rax = rax op rcx`.
+ *
+ * \param c The compiler.
+ * \param op The arithmetic or comparison instruction.
+ * \param ins The instruction being compiled, which is given back to the VM if
+ * it divides by 0.
+ */
+static void jit_op(JitCompiler *c, DIns op, DecodedIns *ins) {
+    JitBuffer *buf = &c->buf;
+
+    switch (op) {
+        case OP_ADD:
+            jit_alu(buf, JIT_OP_ADD, JIT_RAX, JIT_RCX);
+            break;
+        case OP_AND:
+            jit_alu(buf, JIT_OP_AND, JIT_RAX, JIT_RCX);
+            break;
+        case OP_OR:
+            jit_alu(buf, JIT_OP_OR, JIT_RAX, JIT_RCX);
+            break;
+        case OP_SUB:
+            jit_alu(buf, JIT_OP_SUB, JIT_RAX, JIT_RCX);
+            break;
+        case OP_XOR:
+            jit_alu(buf, JIT_OP_XOR, JIT_RAX, JIT_RCX);
+            break;
+
+        case OP_MUL:
+            // imul rax, rcx
+            jit_rex(buf, JIT_RAX, JIT_RCX);
+            jit_byte(buf, 0x0F);
+            jit_byte(buf, 0xAF);
+            jit_modrm(buf, 3, JIT_RAX, JIT_RCX);
+            break;
+
+        case OP_DIV:
+        case OP_MOD:
+            // Let the VM raise the error if we are dividing by 0.
+            jit_alu(buf, JIT_OP_TEST, JIT_RCX, JIT_RCX);
+            jit_exit_if(c, JIT_CC_E, ins);
+
+            // cqo; idiv rcx
+            jit_byte(buf, 0x48);
+            jit_byte(buf, 0x99);
+            jit_rex(buf, 0, JIT_RCX);
+            jit_byte(buf, 0xF7);
+            jit_modrm(buf, 3, 7, JIT_RCX);
+
+            if (op == OP_MOD) {
+                // mov rax, rdx
+                jit_alu(buf, JIT_OP_STORE, JIT_RAX, JIT_RDX);
+            }
+            break;
+
+        default:
+            // Comparisons: cmp rax, rcx; setcc al; movzx eax, al
+            jit_alu(buf, JIT_OP_CMP, JIT_RAX, JIT_RCX);
+            jit_byte(buf, 0x0F);
+            jit_byte(buf, (unsigned char)(0x90 | jit_compare_cond(op)));
+            jit_modrm(buf, 3, 0, JIT_RAX);
+            jit_byte(buf, 0x0F);
+            jit_byte(buf, 0xB6);
+            jit_modrm(buf, 3, JIT_RAX, JIT_RAX);
+            break;
+    }
+}
+
+/**
+ * \fn static void jit_call(JitCompiler *c, DecodedIns *ins)
+ * \brief Compile a call to a Decision function at a fixed location, which
+ * saves the frame in the same way as `CALL_GENERIC` in the VM.
+ *
+ * If the function is compiled in the same range, the native code jumps
+ * straight to it. Otherwise, it only makes the call if the function is
+ * running native code at the time, and gives the call to the VM if it isn't,
+ * so the VM can count it towards promoting the function.
+ *
+ * \param c The compiler.
+ * \param ins The call to compile.
+ */
+static void jit_call(JitCompiler *c, DecodedIns *ins) {
+    JitBuffer *buf   = &c->buf;
+    const dint n     = ins->arity;
+    const bool local = jit_calls_in_range(c, ins);
+
+    if (!local) {
+        jit_mov_imm(buf, JIT_RCX, (int64_t)(intptr_t)ins->target);
+        jit_is_native(buf, JIT_RCX);
+        jit_exit_if(c, JIT_CC_NE, ins);
+    }
+
+    // The caller reserved two elements below the arguments for the frame
+    // pointer, relative to the base of the stack, and the return address.
+    jit_field(buf, JIT_OP_LOAD, JIT_RAX, offsetof(DVM, basePtr));
+    jit_alu(buf, JIT_OP_STORE, JIT_RDX, JIT_FP);
+    jit_alu(buf, JIT_OP_SUB, JIT_RDX, JIT_RAX);
+    jit_shift(buf, JIT_SHIFT_SAR, JIT_RDX, 3);
+    jit_mem(buf, JIT_OP_STORE, JIT_RDX, JIT_SP, -n - 1);
+
+    jit_mov_imm(buf, JIT_RAX, (int64_t)(intptr_t)(ins + 1));
+    jit_mem(buf, JIT_OP_STORE, JIT_RAX, JIT_SP, -n);
+    jit_mem(buf, JIT_OP_LEA, JIT_FP, JIT_SP, -n);
+
+    if (local) {
+        jit_goto(c, JIT_CC_ALWAYS, ins->target);
+    } else {
+        jit_continue(c, JIT_RCX);
+    }
+}
+
+/**
+ * \fn static void jit_ret(JitCompiler *c, DecodedIns *ins, uint8_t n)
+ * \brief Compile a return, which restores the frame in the same way as
+ * `RET_GENERIC` in the VM.
+ *
+ * \param c The compiler.
+ * \param ins The return to compile, which is given back to the VM if it
+ * returns from the last frame, so the VM can halt.
+ * \param n The number of return values.
+ */
+static void jit_ret(JitCompiler *c, DecodedIns *ins, uint8_t n) {
+    JitBuffer *buf = &c->buf;
+
+    jit_field(buf, JIT_OP_LOAD, JIT_RAX, offsetof(DVM, basePtr));
+    jit_alu(buf, JIT_OP_CMP, JIT_FP, JIT_RAX);
+    jit_exit_if(c, JIT_CC_B, ins);
+
+    // rcx = the return address, rdx = the frame pointer of the caller.
+    jit_mem(buf, JIT_OP_LOAD, JIT_RCX, JIT_FP, 0);
+    jit_mem(buf, JIT_OP_LOAD, JIT_RDX, JIT_FP, -1);
+    jit_shift(buf, JIT_SHIFT_SHL, JIT_RDX, 3);
+    jit_alu(buf, JIT_OP_ADD, JIT_RDX, JIT_RAX);
+
+    // The return values go where the frame was saved.
+    for (dint i = 0; i < n; i++) {
+        jit_mem(buf, JIT_OP_LOAD, JIT_RAX, JIT_SP, i - (n - 1));
+        jit_mem(buf, JIT_OP_STORE, JIT_RAX, JIT_FP, i - 1);
+    }
+
+    jit_mem(buf, JIT_OP_LEA, JIT_SP, JIT_FP, (dint)n - 2);
+    jit_alu(buf, JIT_OP_STORE, JIT_FP, JIT_RDX);
+
+    jit_continue(c, JIT_RCX);
+}
+
+/**
+ * \fn static void jit_syscall(JitCompiler *c, dint syscall)
+ * \brief Compile calling `d_vm_syscall`, which leaves the result in `rax`.
+ *
+ * \param c The compiler.
+ * \param syscall The syscall to run.
+ */
+static void jit_syscall(JitCompiler *c, dint syscall) {
+    JitBuffer *buf = &c->buf;
+
+    jit_field(buf, JIT_OP_STORE, JIT_SP, offsetof(DVM, stackPtr));
+
+    // The VM called the native code, so the native stack is 8 bytes off a
+    // 16-byte boundary. Saving three registers puts it back on one.
+    jit_save(buf, JIT_VM);
+    jit_save(buf, JIT_FP);
+    jit_save(buf, JIT_LIMIT);
+
+    // ISO C doesn't allow casting between object and function pointers, but
+    // POSIX does.
+    dint (*function)(DVM *, DSyscall) = d_vm_syscall;
+    int64_t address;
+    memcpy(&address, &function, sizeof(address));
+
+    jit_mov_imm(buf, JIT_RSI, syscall);
+    jit_mov_imm(buf, JIT_RAX, address);
+    jit_byte(buf, 0xFF); // call rax
+    jit_modrm(buf, 3, 2, JIT_RAX);
+
+    jit_restore(buf, JIT_LIMIT);
+    jit_restore(buf, JIT_FP);
+    jit_restore(buf, JIT_VM);
+
+    jit_field(buf, JIT_OP_LOAD, JIT_SP, offsetof(DVM, stackPtr));
+}
+
+/**
+ * \fn static void jit_compile_ins(JitCompiler *c, DecodedIns *ins)
+ * \brief Compile a decoded instruction that `jit_can_compile`.
+ *
+ * \param c The compiler.
+ * \param ins The decoded instruction to compile.
+ */
+static void jit_compile_ins(JitCompiler *c, DecodedIns *ins) {
+    JitBuffer *buf = &c->buf;
+
+    bool immediate;
+    const DIns op = jit_base_op(ins->opcode, &immediate);
+
+    jit_reserve(c, ins);
+
+    switch (ins->opcode) {
+        case OP_GETBI:
+        case OP_GETHI:
+        case OP_GETFI:
+            jit_get(c, JIT_RAX, ins->operand);
+            jit_push(c, JIT_RAX);
+            return;
+
+        case OP_PUSHB:
+        case OP_PUSHH:
+        case OP_PUSHF:
+            jit_mov_imm(buf, JIT_RAX, ins->operand);
+            jit_push(c, JIT_RAX);
+            return;
+
+        case OP_PUSHNB:
+        case OP_PUSHNH:
+        case OP_PUSHNF:
+            jit_mov_imm(buf, JIT_RAX, 0);
+            for (dint i = 1; i <= ins->operand; i++) {
+                jit_mem(buf, JIT_OP_STORE, JIT_RAX, JIT_SP, i);
+            }
+            jit_add_elements(buf, JIT_SP, ins->operand);
+            return;
+
+        case OP_POP:
+            jit_add_elements(buf, JIT_SP, -1);
+            return;
+
+        case OP_DEREF:
+            jit_get(c, JIT_RAX, 0);
+            jit_mem(buf, JIT_OP_LOAD, JIT_RAX, JIT_RAX, 0);
+            jit_mem(buf, JIT_OP_STORE, JIT_RAX, JIT_SP, 0);
+            return;
+
+        case OP_DEREFB:
+            jit_get(c, JIT_RAX, 0);
+            jit_load_byte(buf, JIT_RAX, JIT_RAX);
+            jit_mem(buf, JIT_OP_STORE, JIT_RAX, JIT_SP, 0);
+            return;
+
+        case OP_DEREFI:
+            jit_mov_imm(buf, JIT_RAX, ins->operand);
+            jit_mem(buf, JIT_OP_LOAD, JIT_RAX, JIT_RAX, 0);
+            jit_push(c, JIT_RAX);
+            return;
+
+        case OP_DEREFBI:
+            jit_mov_imm(buf, JIT_RAX, ins->operand);
+            jit_load_byte(buf, JIT_RAX, JIT_RAX);
+            jit_push(c, JIT_RAX);
+            return;
+
+        case OP_SETADR:
+        case OP_SETADRB:
+            jit_get(c, JIT_RAX, 0);
+            jit_get(c, JIT_RCX, -1);
+            jit_mem(buf,
+                    (ins->opcode == OP_SETADRB) ? JIT_OP_STORE_BYTE
+                                                : JIT_OP_STORE,
+                    JIT_RCX, JIT_RAX, 0);
+            jit_add_elements(buf, JIT_SP, -2);
+            return;
+
+        case OP_CALLI:
+        case OP_CALLRB:
+        case OP_CALLRH:
+        case OP_CALLRF:
+            jit_call(c, ins);
+            return;
+
+        case OP_RET:
+            jit_ret(c, ins, 0);
+            return;
+
+        case OP_RETN:
+            jit_ret(c, ins, ins->arity);
+            return;
+
+        case OP_SYSCALL:
+        case OP_PUSHB_SYSCALL:
+            if (ins->opcode == OP_PUSHB_SYSCALL) {
+                jit_mov_imm(buf, JIT_RAX, ins->operand);
+                jit_push(c, JIT_RAX);
+            }
+            jit_syscall(c, (ins->opcode == OP_SYSCALL) ? ins->operand
+                                                       : ins->operand2);
+            jit_add_elements(buf, JIT_SP, -2);
+            jit_mem(buf, JIT_OP_STORE, JIT_RAX, JIT_SP, 0);
+            return;
+
+        case OP_SYSCALL_POP:
+            jit_syscall(c, ins->operand);
+            jit_add_elements(buf, JIT_SP, -3);
+            return;
+
+        case OP_INV:
+            // not qword [rsi]
+            jit_mem(buf, 0xF7, 2, JIT_SP, 0);
+            return;
+
+        case OP_NOT:
+            jit_get(c, JIT_RAX, 0);
+            jit_mov_imm(buf, JIT_RCX, 0);
+            jit_op(c, OP_CEQ, ins);
+            jit_mem(buf, JIT_OP_STORE, JIT_RAX, JIT_SP, 0);
+            return;
+
+        case OP_JI:
+        case OP_JRBI:
+        case OP_JRHI:
+        case OP_JRFI:
+            jit_goto(c, JIT_CC_ALWAYS, ins->target);
+            return;
+
+        case OP_JCONI:
+        case OP_JRCONBI:
+        case OP_JRCONHI:
+        case OP_JRCONFI:
+            jit_get(c, JIT_RAX, 0);
+            jit_add_elements(buf, JIT_SP, -1);
+            jit_alu(buf, JIT_OP_TEST, JIT_RAX, JIT_RAX);
+            jit_goto(c, JIT_CC_NE, ins->target);
+            return;
+
+        case OP_ADDBI_JRBI:
+            jit_mov_imm(buf, JIT_RCX, ins->operand);
+            jit_mem(buf, JIT_OP_ADD, JIT_RCX, JIT_SP, 0); // add [rsi], rcx
+            jit_goto(c, JIT_CC_ALWAYS, ins->target);
+            return;
+
+        case OP_CEQ_JRCONBI:
+        case OP_CLEQ_JRCONBI:
+        case OP_CLT_JRCONBI:
+        case OP_CMEQ_JRCONBI:
+        case OP_CMT_JRCONBI:
+            jit_get(c, JIT_RAX, 0);
+            jit_get(c, JIT_RCX, -1);
+            jit_add_elements(buf, JIT_SP, -2);
+            jit_alu(buf, JIT_OP_CMP, JIT_RAX, JIT_RCX);
+            jit_goto(c, jit_compare_cond(op), ins->target);
+            return;
+
+        case OP_GETBI_ADDBI:
+        case OP_GETBI_SUBBI:
+            jit_get(c, JIT_RAX, ins->operand);
+            jit_mov_imm(buf, JIT_RCX, ins->operand2);
+            jit_alu(buf,
+                    (ins->opcode == OP_GETBI_ADDBI) ? JIT_OP_ADD : JIT_OP_SUB,
+                    JIT_RAX, JIT_RCX);
+            jit_push(c, JIT_RAX);
+            return;
+
+        case OP_GETBI_GETBI:
+            jit_get(c, JIT_RAX, ins->operand);
+            jit_push(c, JIT_RAX);
+            jit_get(c, JIT_RAX, ins->operand2);
+            jit_push(c, JIT_RAX);
+            return;
+
+        case OP_GETBI_GETBI_ADD:
+            jit_get(c, JIT_RAX, ins->operand);
+            jit_push(c, JIT_RAX);
+            jit_get(c, JIT_RCX, ins->operand2);
+            jit_alu(buf, JIT_OP_ADD, JIT_RAX, JIT_RCX);
+            jit_mem(buf, JIT_OP_STORE, JIT_RAX, JIT_SP, 0);
+            return;
+
+        case OP_PUSHB_GETBI:
+            jit_mov_imm(buf, JIT_RAX, ins->operand);
+            jit_push(c, JIT_RAX);
+            jit_get(c, JIT_RAX, ins->operand2);
+            jit_push(c, JIT_RAX);
+            return;
+
+        default:
+            break;
+    }
+
+    // Stack instructions with 2 inputs, or 1 input and an immediate.
+    jit_get(c, JIT_RAX, 0);
+    if (immediate) {
+        jit_mov_imm(buf, JIT_RCX, ins->operand);
+    } else {
+        jit_get(c, JIT_RCX, -1);
+    }
+
+    jit_op(c, op, ins);
+
+    if (!immediate) {
+        jit_add_elements(buf, JIT_SP, -1);
+    }
+    jit_mem(buf, JIT_OP_STORE, JIT_RAX, JIT_SP, 0);
+}
+
+/**
+ * \fn static bool jit_falls_through(DecodedIns *ins)
+ * \brief Check if a compiled instruction can carry on to the next instruction.
+ *
+ * \return If the next instruction can run after this one.
+ *
+ * \param ins The decoded instruction.
+ */
+static bool jit_falls_through(DecodedIns *ins) {
+    switch (ins->opcode) {
+        case OP_ADDBI_JRBI:
+        case OP_CALLI:
+        case OP_CALLRB:
+        case OP_CALLRH:
+        case OP_CALLRF:
+        case OP_RET:
+        case OP_RETN:
+        case OP_JI:
+        case OP_JRBI:
+        case OP_JRHI:
+        case OP_JRFI:
+            return false;
+
+        default:
+            return true;
+    }
+}
+
+/**
+ * \fn static void jit_prologue(JitCompiler *c, size_t index)
+ * \brief Compile the start of native code that the VM can enter, which loads
+ * the VM's state into registers, and jumps to a compiled instruction.
+ *
+ * \param c The compiler.
+ * \param index The index of the decoded instruction to jump to in the range.
+ */
+static void jit_prologue(JitCompiler *c, size_t index) {
+    JitBuffer *buf = &c->buf;
+
+    jit_field(buf, JIT_OP_LOAD, JIT_SP, offsetof(DVM, stackPtr));
+    jit_field(buf, JIT_OP_LOAD, JIT_FP, offsetof(DVM, framePtr));
+
+#ifndef JIT_GUARDED_STACK
+    // r8 = basePtr + stackSize * sizeof(dint)
+    jit_field(buf, JIT_OP_LOAD, JIT_LIMIT, offsetof(DVM, basePtr));
+    jit_field(buf, JIT_OP_LOAD, JIT_RAX, offsetof(DVM, stackSize));
+    jit_rex(buf, 0, JIT_RAX);
+    jit_byte(buf, 0xC1); // shl rax, 3
+    jit_modrm(buf, 3, 4, JIT_RAX);
+    jit_byte(buf, 3);
+    jit_alu(buf, JIT_OP_ADD, JIT_LIMIT, JIT_RAX);
+#endif // JIT_GUARDED_STACK
+
+    jit_patch(buf, jit_jcc(buf, JIT_CC_ALWAYS), c->label[index]);
+}
+
+#endif // JIT_X86_64
+
+/*
+=== FUNCTIONS =============================================
+*/
+
+/**
+ * \fn bool d_jit_available()
+ * \brief Check if decoded text sections can be compiled to native code on
+ * this platform.
+ *
+ * \return If `d_jit_compile` can compile anything.
+ */
+bool d_jit_available() {
+#ifdef JIT_X86_64
+    return true;
+#else
+    return false;
+#endif // JIT_X86_64
+}
+
+/**
+ * \fn JitCode *d_jit_compile(DecodedText *decoded)
+ * \brief Compile the integer instructions of a decoded text section to native
+ * machine code.
+ *
+ * This is the same as `d_jit_compile_range` over the whole text section.
+ *
+ * **NOTE:** The decoded text must be freed after the native code.
+ *
+ * \return The malloc'd native code, or `NULL` if the JIT isn't available, or
+ * there was nothing to compile. Free it with `d_jit_free`.
+ *
+ * \param decoded The decoded text section to compile.
+ */
+JitCode *d_jit_compile(DecodedText *decoded) {
+    if (decoded == NULL) {
+        return NULL;
+    }
+
+    return d_jit_compile_range(decoded, 0, decoded->numIns);
+}
+
+/**
+ * \fn JitCode *d_jit_compile_range(DecodedText *decoded, size_t start,
+ *                                  size_t end)
+ * \brief Compile the integer instructions in a range of a decoded text
+ * section, like a function, to native machine code.
+ *
+ * Instructions that the JIT doesn't support, like calls to C functions,
+ * calls through pointers and anything to do with floats, are left for the VM
+ * to run. Whenever the VM gets to a compiled instruction it can enter the
+ * native code from, that instruction is replaced using `d_vm_set_native`.
+ * The native code runs until it gets to an instruction it doesn't support, or
+ * jumps out of the range, and then hands it back to the VM. Calls and returns
+ * to compiled instructions in other ranges go straight to their native code.
+ *
+ * **NOTE:** The decoded text must be freed after the native code. A range
+ * should only be compiled once, and ranges shouldn't overlap.
+ *
+ * \return The malloc'd native code, or `NULL` if the JIT isn't available, or
+ * there was nothing to compile. Free it with `d_jit_free`.
+ *
+ * \param decoded The decoded text section to compile.
+ * \param start The index of the first decoded instruction to compile.
+ * \param end The index after the last decoded instruction to compile.
+ */
+JitCode *d_jit_compile_range(DecodedText *decoded, size_t start, size_t end) {
+#ifdef JIT_X86_64
+    if (decoded == NULL || end > decoded->numIns || start >= end) {
+        return NULL;
+    }
+
+    const size_t numIns = end - start;
+
+    JitCompiler c;
+    c.buf.bytes    = NULL;
+    c.buf.size     = 0;
+    c.buf.capacity = 0;
+    c.first        = decoded->ins + start;
+    c.numIns       = numIns;
+    c.supported    = d_calloc(numIns, sizeof(bool));
+    c.label        = d_calloc(numIns, sizeof(size_t));
+    c.patches      = NULL;
+    c.numPatches   = 0;
+
+    // Find out which instructions can be compiled, and which are jumped to,
+    // since the VM can enter native code there.
+    bool *isTarget     = d_calloc(numIns, sizeof(bool));
+    size_t numCompiled = 0;
+
+    for (size_t i = 0; i < numIns; i++) {
+        DecodedIns *ins = c.first + i;
+
+        c.supported[i] = jit_can_compile(ins);
+        if (c.supported[i]) {
+            numCompiled++;
+        }
+
+        if (ins->target != NULL && jit_in_range(&c, ins->target)) {
+            isTarget[ins->target - c.first] = true;
+        }
+    }
+
+    if (numCompiled == 0) {
+        free(c.supported);
+        free(c.label);
+        free(isTarget);
+        return NULL;
+    }
+
+    // Compile each run of instructions that can be compiled. If the run
+    // doesn't end with a jump, return to the VM at the instruction after it.
+    for (size_t i = 0; i < numIns; i++) {
+        if (!c.supported[i]) {
+            continue;
+        }
+
+        DecodedIns *ins = c.first + i;
+
+        c.label[i] = c.buf.size;
+        jit_compile_ins(&c, ins);
+
+        if (jit_falls_through(ins) &&
+            (i + 1 >= numIns || !c.supported[i + 1])) {
+            jit_exit(&c, ins + 1);
+        }
+    }
+
+    for (size_t i = 0; i < c.numPatches; i++) {
+        jit_patch(&c.buf, c.patches[i].at, c.label[c.patches[i].index]);
+    }
+
+    // The VM can enter at instructions that are jumped to, that calls return
+    // to, or that come after instructions the VM had to run itself, e.g. the
+    // start of functions.
+    size_t *entries   = d_calloc(numIns, sizeof(size_t));
+    size_t numEntries = 0;
+
+    for (size_t i = 0; i < numIns; i++) {
+        if (c.supported[i] && jit_can_enter(&c, c.first + i) &&
+            (i == 0 || isTarget[i] || !c.supported[i - 1] ||
+             jit_is_call(c.first + i - 1))) {
+            const size_t at = c.buf.size;
+            jit_prologue(&c, i);
+
+            // Remember where the prologue is in place of the label, since the
+            // label isn't needed anymore.
+            c.label[i]            = at;
+            entries[numEntries++] = i;
+        }
+    }
+
+    // Copy the code into executable memory.
+    const size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    const size_t size     = (c.buf.size + pageSize - 1) / pageSize * pageSize;
+
+    void *code = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    JitCode *jit = NULL;
+
+    if (code != MAP_FAILED) {
+        memcpy(code, c.buf.bytes, c.buf.size);
+
+        if (mprotect(code, size, PROT_READ | PROT_EXEC) == 0) {
+            jit              = d_malloc(sizeof(JitCode));
+            jit->code        = code;
+            jit->size        = size;
+            jit->numCompiled = numCompiled;
+            jit->numEntries  = numEntries;
+
+            for (size_t i = 0; i < numEntries; i++) {
+                DecodedIns *ins = c.first + entries[i];
+
+                // ISO C doesn't allow casting between object and function
+                // pointers, but POSIX does.
+                void *address = (char *)code + c.label[entries[i]];
+                DecodedIns *(*native)(DVM *);
+                memcpy(&native, &address, sizeof(native));
+
+                d_vm_set_native(ins, native, jit_pushes(ins));
+            }
+        } else {
+            munmap(code, size);
+        }
+    }
+
+    free(entries);
+    free(isTarget);
+    free(c.buf.bytes);
+    free(c.supported);
+    free(c.label);
+    free(c.patches);
+
+    return jit;
+#else
+    (void)decoded;
+    (void)start;
+    (void)end;
+    return NULL;
+#endif // JIT_X86_64
+}
+
+/**
+ * \fn bool d_jit_covers_range(DecodedText *decoded, size_t start, size_t end,
+ *                             bool loopsOnly)
+ * \brief Check if the JIT can compile the instructions of a range that get run
+ * the most, so that compiling it would actually make it faster.
+ *
+ * The native code hands every instruction it can't compile back to the VM,
+ * and going back and forth between the two is slower than staying in the VM.
+ *
+ * \return If every hot instruction in the range can be compiled. This is
+ * always false if the JIT isn't available.
+ *
+ * \param decoded The decoded text section the range is in.
+ * \param start The index of the first decoded instruction in the range.
+ * \param end The index after the last decoded instruction in the range.
+ * \param loopsOnly If true, only the instructions inside loops, i.e. between
+ * a backward jump and its target, are hot. Otherwise, every instruction in the
+ * range is hot, e.g. if it is a function that is called a lot.
+ */
+bool d_jit_covers_range(DecodedText *decoded, size_t start, size_t end,
+                        bool loopsOnly) {
+#ifdef JIT_X86_64
+    if (decoded == NULL || end > decoded->numIns || start >= end) {
+        return false;
+    }
+
+    DecodedIns *first = decoded->ins + start;
+    DecodedIns *last  = decoded->ins + end;
+
+    if (!loopsOnly) {
+        for (DecodedIns *ins = first; ins < last; ins++) {
+            if (!jit_can_compile(ins)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    for (DecodedIns *ins = first; ins < last; ins++) {
+        // A backward jump closes a loop that starts at its target.
+        if (ins->target == NULL || ins->target < first || ins->target > ins ||
+            jit_is_call(ins)) {
+            continue;
+        }
+
+        for (DecodedIns *body = ins->target; body <= ins; body++) {
+            if (!jit_can_compile(body)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+#else
+    (void)decoded;
+    (void)start;
+    (void)end;
+    (void)loopsOnly;
+    return false;
+#endif // JIT_X86_64
+}
+
+/**
+ * \fn void d_jit_free(JitCode *jit)
+ * \brief Free native code made by `d_jit_compile`.
+ *
+ * \param jit The native code to free.
+ */
+void d_jit_free(JitCode *jit) {
+    if (jit == NULL) {
+        return;
+    }
+
+#ifdef JIT_X86_64
+    munmap(jit->code, jit->size);
+#endif // JIT_X86_64
+
+    free(jit);
+}
@@ -0,0 +1,139 @@
+/*
+    Decision
+    Copyright (C) 2019-2020  Benjamin Beddows
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * \file djit.h
+ * \brief This header contains functionality for compiling decoded text
+ * sections to native machine code.
+ */
+
+#ifndef DJIT_H
+#define DJIT_H
+
+#include "dcfg.h"
+#include "dvm.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+=== HEADER DEFINITIONS ====================================
+*/
+
+/**
+ * \struct _jitCode
+ * \brief The native code that a decoded text section was compiled to.
+ *
+ * \typedef struct _jitCode JitCode
+ */
+typedef struct _jitCode {
+    void *code;  ///< The executable memory containing the native code.
+    size_t size; ///< The size of `code` in bytes.
+
+    size_t numCompiled; ///< How many decoded instructions were compiled.
+    size_t numEntries;  ///< How many decoded instructions the VM can enter the
+                        ///< native code from.
+} JitCode;
+
+/*
+=== FUNCTIONS =============================================
+*/
+
+/**
+ * \fn bool d_jit_available()
+ * \brief Check if decoded text sections can be compiled to native code on
+ * this platform.
+ *
+ * \return If `d_jit_compile` can compile anything.
+ */
+DECISION_API bool d_jit_available();
+
+/**
+ * \fn JitCode *d_jit_compile(DecodedText *decoded)
+ * \brief Compile the integer instructions of a decoded text section to native
+ * machine code.
+ *
+ * This is the same as `d_jit_compile_range` over the whole text section.
+ *
+ * **NOTE:** The decoded text must be freed after the native code.
+ *
+ * \return The malloc'd native code, or `NULL` if the JIT isn't available, or
+ * there was nothing to compile. Free it with `d_jit_free`.
+ *
+ * \param decoded The decoded text section to compile.
+ */
+DECISION_API JitCode *d_jit_compile(DecodedText *decoded);
+
+/**
+ * \fn JitCode *d_jit_compile_range(DecodedText *decoded, size_t start,
+ *                                  size_t end)
+ * \brief Compile the integer instructions in a range of a decoded text
+ * section, like a function, to native machine code.
+ *
+ * Instructions that the JIT doesn't support, like calls to C functions,
+ * calls through pointers and anything to do with floats, are left for the VM
+ * to run. Whenever the VM gets to a compiled instruction it can enter the
+ * native code from, that instruction is replaced using `d_vm_set_native`.
+ * The native code runs until it gets to an instruction it doesn't support, or
+ * jumps out of the range, and then hands it back to the VM. Calls and returns
+ * to compiled instructions in other ranges go straight to their native code.
+ *
+ * **NOTE:** The decoded text must be freed after the native code. A range
+ * should only be compiled once, and ranges shouldn't overlap.
+ *
+ * \return The malloc'd native code, or `NULL` if the JIT isn't available, or
+ * there was nothing to compile. Free it with `d_jit_free`.
+ *
+ * \param decoded The decoded text section to compile.
+ * \param start The index of the first decoded instruction to compile.
+ * \param end The index after the last decoded instruction to compile.
+ */
+DECISION_API JitCode *d_jit_compile_range(DecodedText *decoded, size_t start,
+                                          size_t end);
+
+/**
+ * \fn bool d_jit_covers_range(DecodedText *decoded, size_t start, size_t end,
+ *                             bool loopsOnly)
+ * \brief Check if the JIT can compile the instructions of a range that get run
+ * the most, so that compiling it would actually make it faster.
+ *
+ * The native code hands every instruction it can't compile back to the VM,
+ * and going back and forth between the two is slower than staying in the VM.
+ *
+ * \return If every hot instruction in the range can be compiled. This is
+ * always false if the JIT isn't available.
+ *
+ * \param decoded The decoded text section the range is in.
+ * \param start The index of the first decoded instruction in the range.
+ * \param end The index after the last decoded instruction in the range.
+ * \param loopsOnly If true, only the instructions inside loops, i.e. between
+ * a backward jump and its target, are hot. Otherwise, every instruction in the
+ * range is hot, e.g. if it is a function that is called a lot.
+ */
+DECISION_API bool d_jit_covers_range(DecodedText *decoded, size_t start,
+                                     size_t end, bool loopsOnly);
+
+/**
+ * \fn void d_jit_free(JitCode *jit)
+ * \brief Free native code made by `d_jit_compile`.
+ *
+ * \param jit The native code to free.
+ */
+DECISION_API void d_jit_free(JitCode *jit);
+
+#endif // DJIT_H
@@ -20,6 +20,7 @@
 
 #include "decision.h"
 #include "derror.h"
+#include "dintern.h"
 #include "dmalloc.h"
 
 #include <stdlib.h>
@@ -114,18 +115,21 @@ const char *d_lex_get_string_literal(const char *source, size_t *i,
         return NULL;
     }
 
-    const size_t len = strlen(source);
-
     char *out;
 
     bool endFound = false;
     size_t lenStr = 0;
     size_t oldi   = *i;
 
-    // Finding the length of the string.
-    for (size_t j = *i + 1; j < len; j++) {
+    // Finding the length of the string. We don't use strlen here, since we
+    // would be going through the whole source every time we found a string.
+    for (size_t j = *i + 1; source[j] != '\0'; j++) {
         // We need to deal with escape characters!
         if (source[j] == '\\') {
+            if (source[j + 1] == '\0') {
+                break;
+            }
+
             lenStr++;
             j++;
         }
@@ -218,7 +222,10 @@ const char *d_lex_get_string_literal(const char *source, size_t *i,
  *
  * It must follow the syntax rules for names.
  *
- * \return A malloc'd string representing the name. NULL if the name is
+ * **NOTE:** The name used to be malloc'd and owned by the caller. It is now
+ * interned, so it belongs to the intern pool and must not be freed.
+ *
+ * \return The interned string representing the name. NULL if the name is
  * errorneous.
  *
  * \param source The source text.
@@ -237,16 +244,12 @@ const char *d_lex_get_name(const char *source, size_t *i, const char *filePath,
         return NULL;
     }
 
-    size_t len = strlen(source);
-
-    char *out;
-
     bool endFound = false;
     long lenStr   = 1;
     size_t oldi   = *i;
 
     // Finding the length of the string.
-    for (size_t j = *i + 1; j < len; j++) {
+    for (size_t j = *i + 1; source[j] != '\0'; j++) {
         if (d_lex_is_name_char(source[j])) {
             lenStr++;
         }
@@ -264,23 +267,30 @@ const char *d_lex_get_name(const char *source, size_t *i, const char *filePath,
         return NULL;
     }
 
-    // Now we are building the string.
-    out = d_calloc(((size_t)lenStr + 1), sizeof(char));
-
-    memcpy(out, source + oldi, lenStr);
-    out[lenStr] = '\0';
-
-    return out;
+    // Every occurrence of a name shares the same string.
+    return d_intern_n(source + oldi, (size_t)lenStr);
 }
 
 /*
     Macro used to add currentToken to the stream.
-    It sets the data, and if the token type is defined, adds it to the array.
+    It sets the data, and if the token type is defined, adds it to the array,
+    doubling the size of the array if it is full.
 */
-#define ADD_TOKEN()                  \
-    currentToken.data = currentData; \
-    if ((int)currentToken.type > -1) \
-        lexArray[n++] = currentToken;
+#define ADD_TOKEN()                                                      \
+    currentToken.data = currentData;                                     \
+    if ((int)currentToken.type > -1) {                                   \
+        if (n >= capacity) {                                             \
+            capacity *= 2;                                               \
+            lexArray = d_realloc(lexArray, capacity * sizeof(LexToken)); \
+        }                                                                \
+        lexArray[n++] = currentToken;                                    \
+    }
+
+/*
+    How many bytes of source code we guess there are for each token, when
+    deciding how big the token array should start.
+*/
+#define LEX_BYTES_PER_TOKEN 2
 
 /**
  * \fn LexStream d_lex_create_stream(const char *source, const char *filePath)
@@ -300,11 +310,14 @@ LexStream d_lex_create_stream(const char *source, const char *filePath) {
     size_t sourceLength = strlen(source);
 
     LexStream out;
-    out.numTokens = sourceLength;
+    out.tokenArray = NULL;
+    out.numTokens  = 0;
 
-    // We set the size now to the length of the source code,
-    // but we will later resize it to the actual amount of tokens.
-    LexToken *lexArray = d_calloc(sourceLength, sizeof(LexToken));
+    // We start with a guess of how many tokens there will be, grow the array
+    // geometrically if we guessed too few, and then resize it to the actual
+    // amount of tokens at the end.
+    size_t capacity    = sourceLength / LEX_BYTES_PER_TOKEN + 16;
+    LexToken *lexArray = d_malloc(capacity * sizeof(LexToken));
 
     if (lexArray != NULL) {
         size_t i       = 0; // The character we're on in the source.
@@ -512,13 +525,6 @@ LexStream d_lex_create_stream(const char *source, const char *filePath) {
                                 currentData.stringValue = name;
                             else
                                 currentData.booleanValue = isBool;
-
-                            // If it's not a keyword (i.e. we need to keep the
-                            // name for something), we can just free the
-                            // malloc'd string, since we know what it
-                            // represents.
-                            if (currentToken.type != TK_NAME)
-                                free(name);
                         } else {
                             d_error_compiler_push("Unidentified character",
                                                   filePath, lineNum, true);
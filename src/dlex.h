@@ -239,7 +239,10 @@ DECISION_API const char *d_lex_get_string_literal(const char *source, size_t *i,
  *
  * It must follow the syntax rules for names.
  *
- * \return A malloc'd string representing the name. NULL if the name is
+ * **NOTE:** The name used to be malloc'd and owned by the caller. It is now
+ * interned, so it belongs to the intern pool and must not be freed.
+ *
+ * \return The interned string representing the name. NULL if the name is
  * errorneous.
  *
  * \param source The source text.
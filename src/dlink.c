@@ -19,10 +19,14 @@
 #include "dlink.h"
 
 #include "dcfunc.h"
+#include "decision.h"
+#include "dintern.h"
 #include "dmalloc.h"
 #include "dsheet.h"
 #include "dvm.h"
 
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -33,13 +37,14 @@
  * \return A new `LinkMeta` with the given parameters.
  *
  * \param type The type of object this link will point to.
- * \param name The name of the object this link will point to.
+ * \param name The name of the object this link will point to. It is interned,
+ * so the caller keeps ownership of it.
  * \param meta A pointer to the metadata of the object the link points to.
  */
 LinkMeta d_link_new_meta(LinkType type, const char *name, void *meta) {
     LinkMeta out;
     out.type = type;
-    out.name = name;
+    out.name = d_intern(name);
     out.meta = meta;
     out._ptr = (char *)-1;
 
@@ -53,7 +58,77 @@ LinkMeta d_link_new_meta(LinkType type, const char *name, void *meta) {
  * \return An empty LinkMetaList.
  */
 LinkMetaList d_link_new_meta_list() {
-    return (LinkMetaList){NULL, 0};
+    return (LinkMetaList){NULL, 0, NULL, 0};
+}
+
+/**
+ * \fn static size_t hash_meta(LinkType type, const char *name)
+ * \brief Hash the type and name of a LinkMeta item.
+ *
+ * \return The hash of the interned name, mixed with the type.
+ *
+ * \param type The type of the item.
+ * \param name The interned name of the item.
+ */
+static size_t hash_meta(LinkType type, const char *name) {
+    return d_intern_hash(name) ^ ((uint32_t)type * 16777619u);
+}
+
+/**
+ * \fn static void add_to_buckets(size_t *buckets, size_t numBuckets,
+ *                                 LinkMeta *items, size_t index)
+ * \brief Add an item of a LinkMetaList to its hash table.
+ *
+ * \param buckets The buckets of the hash table. There must be an empty one.
+ * \param numBuckets The number of buckets. Must be a power of 2.
+ * \param items The items of the list.
+ * \param index The index of the item to add.
+ */
+static void add_to_buckets(size_t *buckets, size_t numBuckets, LinkMeta *items,
+                           size_t index) {
+    LinkMeta meta = items[index];
+    size_t bucket = hash_meta(meta.type, meta.name) & (numBuckets - 1);
+
+    // If there are items with the same type and name, only the first one can
+    // be found.
+    while (buckets[bucket] != SIZE_MAX) {
+        LinkMeta other = items[buckets[bucket]];
+
+        if (other.type == meta.type && other.name == meta.name) {
+            return;
+        }
+
+        bucket = (bucket + 1) & (numBuckets - 1);
+    }
+
+    buckets[bucket] = index;
+}
+
+/**
+ * \fn static void build_buckets(LinkMetaList *list)
+ * \brief Build the hash table of a LinkMetaList.
+ *
+ * \param list The list to build the hash table of.
+ */
+static void build_buckets(LinkMetaList *list) {
+    // Keep the table at most half full, so the probes stay short. Leave room
+    // to grow, so items pushed afterwards can be added to it as they come.
+    size_t numBuckets = 16;
+    while (numBuckets < 4 * list->size) {
+        numBuckets *= 2;
+    }
+
+    size_t *buckets = d_malloc(numBuckets * sizeof(size_t));
+    for (size_t i = 0; i < numBuckets; i++) {
+        buckets[i] = SIZE_MAX;
+    }
+
+    for (size_t i = 0; i < list->size; i++) {
+        add_to_buckets(buckets, numBuckets, list->list, i);
+    }
+
+    list->_buckets    = buckets;
+    list->_numBuckets = numBuckets;
 }
 
 /**
@@ -74,6 +149,19 @@ void d_link_meta_list_push(LinkMetaList *list, LinkMeta item) {
 
     list->list[newSize - 1] = item;
     list->size              = newSize;
+
+    if (list->_buckets != NULL) {
+        // If the hash table still has room, the item can go straight in.
+        // Otherwise, it will be rebuilt bigger the next time it's needed.
+        if (2 * newSize <= list->_numBuckets) {
+            add_to_buckets(list->_buckets, list->_numBuckets, list->list,
+                           newSize - 1);
+        } else {
+            free(list->_buckets);
+            list->_buckets    = NULL;
+            list->_numBuckets = 0;
+        }
+    }
 }
 
 /**
@@ -83,16 +171,62 @@ void d_link_meta_list_push(LinkMetaList *list, LinkMeta item) {
  * \param list The list to free.
  */
 void d_link_free_list(LinkMetaList *list) {
+    // The names are interned, so only the list itself needs freeing.
     if (list->list != NULL) {
-        // Free the names of the metadata items.
-        for (size_t i = 0; i < list->size; i++) {
-            free((char *)list->list[i].name);
+        free(list->list);
+    }
+
+    if (list->_buckets != NULL) {
+        free(list->_buckets);
+    }
+
+    list->list        = NULL;
+    list->size        = 0;
+    list->_buckets    = NULL;
+    list->_numBuckets = 0;
+}
+
+/**
+ * \fn LinkMeta *d_link_find_meta(LinkMetaList *list, LinkType type,
+ *                                const char *name)
+ * \brief Find the item in a list with a given type and name.
+ *
+ * The first time this is called on a list, a hash table of the items is
+ * built, so every lookup after that doesn't need to go through the list.
+ *
+ * \return A pointer to the first item in the list with the given type and
+ * name, or `NULL` if there is no such item. The pointer is only valid until
+ * the next item is pushed onto the list.
+ *
+ * \param list The list to search.
+ * \param type The type of the item to find.
+ * \param name The name of the item to find. It must be interned, e.g. the
+ * name of another `LinkMeta`.
+ */
+LinkMeta *d_link_find_meta(LinkMetaList *list, LinkType type,
+                           const char *name) {
+    if (list->list == NULL || list->size == 0) {
+        return NULL;
+    }
+
+    if (list->_buckets == NULL) {
+        build_buckets(list);
+    }
+
+    const size_t mask = list->_numBuckets - 1;
+    size_t bucket     = hash_meta(type, name) & mask;
+
+    while (list->_buckets[bucket] != SIZE_MAX) {
+        LinkMeta *meta = list->list + list->_buckets[bucket];
+
+        if (meta->type == type && meta->name == name) {
+            return meta;
         }
 
-        free(list->list);
+        bucket = (bucket + 1) & mask;
     }
 
-    list->size = 0;
+    return NULL;
 }
 
 /**
@@ -132,34 +266,28 @@ void d_link_precalculate_ptr(struct _sheet *sheet) {
                     Sheet *extSheet    = var->sheet;
 
                     // Find the pointer in this sheet's link list.
-                    for (size_t i = 0; i < extSheet->_link.size; i++) {
-                        LinkMeta externalMeta = extSheet->_link.list[i];
-                        if (meta->type == externalMeta.type &&
-                            strcmp(meta->name, externalMeta.name) == 0) {
-
-                            // Great! We can add on this pointer to the sheet's
-                            // pointer to the data section, and we're done!
-                            meta->_ptr =
-                                extSheet->_data + (size_t)externalMeta._ptr;
-                            break;
-                        }
+                    LinkMeta *externalMeta = d_link_find_meta(
+                        &(extSheet->_link), meta->type, meta->name);
+
+                    if (externalMeta != NULL) {
+                        // Great! We can add on this pointer to the sheet's
+                        // pointer to the data section, and we're done!
+                        meta->_ptr =
+                            extSheet->_data + (size_t)externalMeta->_ptr;
                     }
                 } else if (meta->type == LINK_FUNCTION) {
                     SheetFunction *func = (SheetFunction *)meta->meta;
                     Sheet *extSheet     = func->sheet;
 
                     // Find the pointer in this sheet's link list.
-                    for (size_t i = 0; i < extSheet->_link.size; i++) {
-                        LinkMeta externalMeta = extSheet->_link.list[i];
-                        if (meta->type == externalMeta.type &&
-                            strcmp(meta->name, externalMeta.name) == 0) {
-
-                            // Great! We can add on this pointer to the sheet's
-                            // pointer to the text section, and we're done!
-                            meta->_ptr =
-                                extSheet->_text + (size_t)externalMeta._ptr;
-                            break;
-                        }
+                    LinkMeta *externalMeta = d_link_find_meta(
+                        &(extSheet->_link), meta->type, meta->name);
+
+                    if (externalMeta != NULL) {
+                        // Great! We can add on this pointer to the sheet's
+                        // pointer to the text section, and we're done!
+                        meta->_ptr =
+                            extSheet->_text + (size_t)externalMeta->_ptr;
                     }
                 } else if (meta->type == LINK_CFUNCTION) {
                     CFunction *cFunc = (CFunction *)meta->meta;
@@ -247,21 +375,12 @@ void d_link_self(Sheet *sheet) {
 
                 // Firstly, we need to find where the variable pointer is
                 // stored in data.
-                LinkMeta varMeta = (LinkMeta){NULL, NULL, NULL, 0};
-                bool varFound    = false;
-                for (size_t i = 0; i < sheet->_link.size; i++) {
-                    varMeta = sheet->_link.list[i];
-
-                    if (varMeta.type == LINK_VARIABLE_POINTER &&
-                        strcmp(varName, varMeta.name) == 0) {
-                        varFound = true;
-                        break;
-                    }
-                }
+                LinkMeta *varMeta = d_link_find_meta(
+                    &(sheet->_link), LINK_VARIABLE_POINTER, varName);
 
-                if (varFound) {
+                if (varMeta != NULL) {
                     // We've found the variable! Now where is it stored?
-                    char *strVarPtr = sheet->_data + (size_t)varMeta._ptr;
+                    char *strVarPtr = sheet->_data + (size_t)varMeta->_ptr;
                     char *strVarDefaultValue = sheet->_data + (size_t)meta._ptr;
                     
                     // Now we store the default value's pointer into the variable.
@@ -306,40 +425,31 @@ static void *recursive_find_link_meta(Sheet *sheet, LinkMeta *linkMeta) {
          includeIndex++) {
         Sheet *include = sheet->includes[includeIndex];
 
-        for (size_t linkIndex = 0; linkIndex < include->_link.size;
-             linkIndex++) {
-            LinkMeta includeLinkMeta = include->_link.list[linkIndex];
-
-            // Is this the thing we're looking for?
-            if (linkMeta->type == includeLinkMeta.type &&
-                strcmp(linkMeta->name, includeLinkMeta.name) == 0) {
-                // Is this the sheet where it is defined?
-                if (includeLinkMeta._ptr != (char *)-1) {
-                    // Bingo! Now we just need to find where the metadata is
-                    // defined and we're good to go!
-                    if (includeLinkMeta.type == LINK_VARIABLE ||
-                        includeLinkMeta.type == LINK_VARIABLE_POINTER) {
-                        // Find the SheetVariable entry.
-                        // TODO: Error if not found.
-                        for (size_t var = 0; var < include->numVariables;
-                             var++) {
-                            if (strcmp(includeLinkMeta.name,
-                                       include->variables[var]
-                                           .variableMeta.name) == 0) {
-                                return &(include->variables[var]);
-                            }
-                        }
-                    } else if (includeLinkMeta.type == LINK_FUNCTION) {
-                        // Find the SheetFunction entry.
-                        // TODO: Error if not found.
-                        for (size_t func = 0; func < include->numFunctions;
-                             func++) {
-                            if (strcmp(includeLinkMeta.name,
-                                       include->functions[func]
-                                           .functionDefinition.name) == 0) {
-                                return &(include->functions[func]);
-                            }
-                        }
+        // Is this the thing we're looking for?
+        LinkMeta *includeLinkMeta =
+            d_link_find_meta(&(include->_link), linkMeta->type, linkMeta->name);
+
+        // Is this the sheet where it is defined?
+        if (includeLinkMeta != NULL && includeLinkMeta->_ptr != (char *)-1) {
+            // Bingo! Now we just need to find where the metadata is
+            // defined and we're good to go!
+            if (includeLinkMeta->type == LINK_VARIABLE ||
+                includeLinkMeta->type == LINK_VARIABLE_POINTER) {
+                // Find the SheetVariable entry.
+                // TODO: Error if not found.
+                for (size_t var = 0; var < include->numVariables; var++) {
+                    if (includeLinkMeta->name ==
+                        include->variables[var].variableMeta.name) {
+                        return &(include->variables[var]);
+                    }
+                }
+            } else if (includeLinkMeta->type == LINK_FUNCTION) {
+                // Find the SheetFunction entry.
+                // TODO: Error if not found.
+                for (size_t func = 0; func < include->numFunctions; func++) {
+                    if (includeLinkMeta->name ==
+                        include->functions[func].functionDefinition.name) {
+                        return &(include->functions[func]);
                     }
                 }
             }
@@ -381,10 +491,226 @@ void d_link_find_included(Sheet *sheet) {
     }
 }
 
+/**
+ * \fn static void compile_native(Sheet *sheet)
+ * \brief Compile the decoded text section of a sheet to native code.
+ *
+ * \param sheet The sheet to compile.
+ */
+static void compile_native(Sheet *sheet) {
+    sheet->_jitCode = d_jit_compile(sheet->_decodedText);
+
+    if (d_get_verbose_level() >= 3) {
+        if (sheet->_jitCode != NULL) {
+            printf("Compiled %zu of %zu decoded instructions of %s into %zu "
+                   "bytes of executable memory, with %zu entry points.\n",
+                   sheet->_jitCode->numCompiled, sheet->_decodedText->numIns,
+                   sheet->filePath, sheet->_jitCode->size,
+                   sheet->_jitCode->numEntries);
+        } else if (!d_jit_available()) {
+            printf("Not compiling %s to native code, since the JIT isn't "
+                   "available on this platform.\n",
+                   sheet->filePath);
+        }
+    }
+}
+
+/**
+ * \fn static void promote_function(VMProfile *vmProfile)
+ * \brief Compile a function that has got hot to native code.
+ *
+ * This is called by the VM while it is running the function, so the function
+ * carries on in native code the next time the VM gets to one of its entry
+ * points.
+ *
+ * The function is only compiled if the JIT covers the instructions that made
+ * it hot: its loops if it got hot by looping, or all of it if it got hot by
+ * being called. Otherwise, the native code would keep handing those
+ * instructions back to the VM, which is slower than not compiling it at all.
+ *
+ * \param vmProfile The profile of the function, which is the first member of
+ * a `FunctionProfile`.
+ */
+static void promote_function(VMProfile *vmProfile) {
+    FunctionProfile *profile = (FunctionProfile *)vmProfile;
+    Sheet *sheet             = profile->sheet;
+
+    const bool loopsOnly = vmProfile->backEdges > vmProfile->calls;
+
+    if (!d_jit_covers_range(sheet->_decodedText, profile->start, profile->end,
+                            loopsOnly)) {
+        if (d_get_verbose_level() >= 3) {
+            printf("Not promoting %s in %s to native code, since some of the "
+                   "instructions in its %s can't be compiled.\n",
+                   profile->name, sheet->filePath,
+                   loopsOnly ? "loops" : "body");
+        }
+
+        return;
+    }
+
+    profile->jitCode = d_jit_compile_range(sheet->_decodedText, profile->start,
+                                           profile->end);
+
+    if (d_get_verbose_level() >= 3) {
+        printf("Promoted %s in %s to native code after %zu calls and %zu "
+               "backward jumps.\n",
+               profile->name, sheet->filePath, (size_t)vmProfile->calls,
+               (size_t)vmProfile->backEdges);
+    }
+}
+
+/**
+ * \fn static int compare_profiles(const void *a, const void *b)
+ * \brief Order function profiles by where they start in the decoded text.
+ *
+ * \return A negative number if `a` starts first, a positive number if `b`
+ * starts first, or 0 if they start at the same place.
+ *
+ * \param a The first function profile.
+ * \param b The second function profile.
+ */
+static int compare_profiles(const void *a, const void *b) {
+    const size_t startA = ((const FunctionProfile *)a)->start;
+    const size_t startB = ((const FunctionProfile *)b)->start;
+
+    return (startA > startB) - (startA < startB);
+}
+
+/**
+ * \fn static void profile_function(Sheet *sheet, const char *name,
+ *                                  size_t offset)
+ * \brief Add a profile for a function starting at an offset of the text
+ * section of a sheet.
+ *
+ * \param sheet The sheet the function belongs to.
+ * \param name The name of the function.
+ * \param offset The offset of the first instruction of the function in the
+ * text section.
+ */
+static void profile_function(Sheet *sheet, const char *name, size_t offset) {
+    DecodedIns *ins = d_vm_find_decoded_ins(sheet->_text + offset);
+    if (ins == NULL) {
+        return;
+    }
+
+    FunctionProfile *profile = sheet->_profiles + sheet->_numProfiles++;
+
+    // If the JIT isn't available, the functions are still counted, but they
+    // are never promoted.
+    profile->profile.calls     = 0;
+    profile->profile.backEdges = 0;
+    profile->profile.threshold = LINK_PROMOTE_THRESHOLD;
+    profile->profile.promote   = d_jit_available() ? promote_function : NULL;
+    profile->profile.data      = NULL;
+    profile->sheet             = sheet;
+    profile->name              = name;
+    profile->start             = ins - sheet->_decodedText->ins;
+    profile->end               = sheet->_decodedText->numIns;
+    profile->jitCode           = NULL;
+}
+
+/**
+ * \fn static void profile_functions(Sheet *sheet)
+ * \brief Give each function in the decoded text section of a sheet a profile,
+ * so the VM can count how often it is run.
+ *
+ * \param sheet The sheet to profile.
+ */
+static void profile_functions(Sheet *sheet) {
+    sheet->_profiles =
+        d_calloc(sheet->_link.size + 1, sizeof(FunctionProfile));
+    sheet->_numProfiles = 0;
+
+    if (sheet->_main > 0) {
+        profile_function(sheet, "Start", sheet->_main);
+    }
+
+    for (size_t i = 0; i < sheet->_link.size; i++) {
+        LinkMeta meta = sheet->_link.list[i];
+
+        if (meta.type == LINK_FUNCTION) {
+            SheetFunction *func = (SheetFunction *)meta.meta;
+
+            if (func->sheet == sheet) {
+                profile_function(sheet, meta.name, (size_t)meta._ptr);
+            }
+        }
+    }
+
+    qsort(sheet->_profiles, sheet->_numProfiles, sizeof(FunctionProfile),
+          compare_profiles);
+
+    // Each function runs up to the start of the next one.
+    DecodedText *decoded = sheet->_decodedText;
+
+    for (size_t i = 0; i < sheet->_numProfiles; i++) {
+        FunctionProfile *profile = sheet->_profiles + i;
+
+        if (i + 1 < sheet->_numProfiles) {
+            profile->end = sheet->_profiles[i + 1].start;
+        }
+
+        for (size_t j = profile->start; j < profile->end; j++) {
+            decoded->ins[j].profile = &(profile->profile);
+        }
+    }
+
+    if (d_get_verbose_level() >= 3) {
+        printf("Profiling %zu functions of %s, promoting them to native code "
+               "after %d calls and backward jumps.\n",
+               sheet->_numProfiles, sheet->filePath, LINK_PROMOTE_THRESHOLD);
+    }
+}
+
+/**
+ * \fn static void decode_recursive(Sheet *sheet, bool jit, bool tiered)
+ * \brief Decode the text sections of a linked sheet and its includes for the
+ * VM, if they haven't been decoded already.
+ *
+ * The includes are decoded first, so that calls to them can be resolved.
+ *
+ * \param sheet The sheet to decode.
+ * \param jit Should the decoded text sections be compiled to native code?
+ * \param tiered Should the functions in the decoded text sections only be
+ * compiled to native code once they get hot? This overrides `jit`.
+ */
+static void decode_recursive(Sheet *sheet, bool jit, bool tiered) {
+    for (size_t i = 0; i < sheet->numIncludes; i++) {
+        Sheet *include = sheet->includes[i];
+
+        if (include != NULL) {
+            decode_recursive(include, jit, tiered);
+        }
+    }
+
+    if (sheet->_isLinked && sheet->_decodedText == NULL &&
+        sheet->_text != NULL) {
+        sheet->_decodedText =
+            d_vm_decode_text(sheet->_text, sheet->_textSize);
+
+        d_vm_set_call_convention(sheet->_decodedText, sheet->_callConvention);
+
+        if (tiered) {
+            profile_functions(sheet);
+        } else if (jit) {
+            compile_native(sheet);
+        }
+    }
+}
+
 /**
  * \fn void d_link_sheet(Sheet *sheet)
  * \brief Call `d_link_find_included`, `d_link_precalculate_ptr`, `d_link_self`,
- * and `d_link_includes_recursive` on a sheet.
+ * and `d_link_includes_recursive` on a sheet, and then decode the linked text
+ * sections for the VM.
+ *
+ * If `sheet->_useJit` is true, the text sections of the sheet and any
+ * includes that haven't been decoded yet are then compiled to native code.
+ *
+ * If `sheet->_useTiers` is true, the functions in the decoded text sections
+ * are profiled instead, and each function is only compiled to native code
+ * once it has been called or looped `LINK_PROMOTE_THRESHOLD` times.
  *
  * \param sheet The sheet to link.
  */
@@ -393,4 +719,5 @@ void d_link_sheet(Sheet *sheet) {
     d_link_precalculate_ptr(sheet);
     d_link_self(sheet);
     d_link_includes_recursive(sheet);
+    decode_recursive(sheet, sheet->_useJit, sheet->_useTiers);
 }
@@ -35,6 +35,13 @@
 /* Forward declaration of the Sheet struct from dsheet.h */
 struct _sheet;
 
+/**
+ * \def LINK_PROMOTE_THRESHOLD
+ * \brief How many calls and backward jumps a function needs before it is
+ * compiled to native code, if the sheet is using tiered execution.
+ */
+#define LINK_PROMOTE_THRESHOLD 1000
+
 /**
  * \enum _linkType
  * \brief Describes what type of object we want to link.
@@ -60,7 +67,7 @@ typedef enum _linkType {
  * \typedef struct _linkMeta LinkMeta
  */
 typedef struct _linkMeta {
-    const char *name; ///< The name of the object we are linking.
+    const char *name; ///< The interned name of the object we are linking.
 
     void *meta; ///< A generic pointer to the metadata of the thing we are
                 ///< linking to, e.g. it can be a poiner to a `SheetVariable`
@@ -87,6 +94,14 @@ typedef struct _linkMeta {
 typedef struct _linkMetaList {
     LinkMeta *list;
     size_t size;
+
+    size_t *_buckets;   ///< A hash table of indexes into `list`, keyed by the
+                        ///< type and name of each item. It is built the first
+                        ///< time `d_link_find_meta` is called, and thrown
+                        ///< away whenever an item is pushed. Empty buckets are
+                        ///< `SIZE_MAX`.
+    size_t _numBuckets; ///< The number of buckets, which is a power of 2, or
+                        ///< 0 if the hash table hasn't been built.
 } LinkMetaList;
 
 /*
@@ -100,7 +115,8 @@ typedef struct _linkMetaList {
  * \return A new `LinkMeta` with the given parameters.
  *
  * \param type The type of object this link will point to.
- * \param name The name of the object this link will point to.
+ * \param name The name of the object this link will point to. It is interned,
+ * so the caller keeps ownership of it.
  * \param meta A pointer to the metadata of the object the link points to.
  */
 DECISION_API LinkMeta d_link_new_meta(LinkType type, const char *name,
@@ -131,6 +147,26 @@ DECISION_API void d_link_meta_list_push(LinkMetaList *list, LinkMeta item);
  */
 DECISION_API void d_link_free_list(LinkMetaList *list);
 
+/**
+ * \fn LinkMeta *d_link_find_meta(LinkMetaList *list, LinkType type,
+ *                                const char *name)
+ * \brief Find the item in a list with a given type and name.
+ *
+ * The first time this is called on a list, a hash table of the items is
+ * built, so every lookup after that doesn't need to go through the list.
+ *
+ * \return A pointer to the first item in the list with the given type and
+ * name, or `NULL` if there is no such item. The pointer is only valid until
+ * the next item is pushed onto the list.
+ *
+ * \param list The list to search.
+ * \param type The type of the item to find.
+ * \param name The name of the item to find. It must be interned, e.g. the
+ * name of another `LinkMeta`.
+ */
+DECISION_API LinkMeta *d_link_find_meta(LinkMetaList *list, LinkType type,
+                                        const char *name);
+
 /**
  * \fn void d_link_replace_fimmediate(char *ins, char *ptr)
  * \brief Change an instruction's full immediate to point somewhere.
@@ -182,7 +218,15 @@ DECISION_API void d_link_find_included(struct _sheet *sheet);
 /**
  * \fn void d_link_sheet(Sheet *sheet)
  * \brief Call `d_link_find_included`, `d_link_precalculate_ptr`, `d_link_self`,
- * and `d_link_includes_recursive` on a sheet.
+ * and `d_link_includes_recursive` on a sheet, and then decode the linked text
+ * sections for the VM.
+ *
+ * If `sheet->_useJit` is true, the text sections of the sheet and any
+ * includes that haven't been decoded yet are then compiled to native code.
+ *
+ * If `sheet->_useTiers` is true, the functions in the decoded text sections
+ * are profiled instead, and each function is only compiled to native code
+ * once it has been called or looped `LINK_PROMOTE_THRESHOLD` times.
  *
  * \param sheet The sheet to link.
  */
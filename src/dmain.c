@@ -17,6 +17,7 @@
 */
 
 #include "dasm.h"
+#include "dcache.h"
 #include "dcfg.h"
 #include "dcore.h"
 #include "ddebug.h"
@@ -45,10 +46,26 @@ static const char *HELP =
     "OPTIONS:\n"
     "  -c, --compile:                    Compile all source file(s) into .dco\n"
     "                                      object files.\n"
+    "  --cache[=DIR]:                    Keep compiled source files in the\n"
+    "                                      directory DIR, so they don't need\n"
+    "                                      to be compiled again next time.\n"
+    "                                      DIR defaults to .decision_cache.\n"
+    "  --clear-cache:                    Delete everything in the cache\n"
+    "                                      directory, set with --cache or the\n"
+    "                                      default.\n"
     "  -D, --disassemble:                Disassemble a given object file.\n"
     "  --export-core:                    Output the core reference in JSON\n"
     "                                      format.\n"
     "  -h, -?, --help:                   Display this screen and exit.\n"
+    "  -J, --jit:                        Compile what can be compiled of the\n"
+    "                                      file to native code before running\n"
+    "                                      it, if the platform supports it.\n"
+    "  -S, --sequence-stats:             Count the most common sequences of\n"
+    "                                      instructions in all given file(s).\n"
+    "  -T, --tiered:                     Run the file in the VM, and compile\n"
+    "                                      functions to native code once they\n"
+    "                                      get hot, if the platform supports\n"
+    "                                      it.\n"
     "  -V[=LEVEL], --verbose[=LEVEL]:    Output verbose debugging information "
     "as\n"
     "                                      source code is being compiled. See\n"
@@ -91,9 +108,15 @@ static void print_help() {
 
 int main(int argc, char *argv[]) {
 
-    char *filePath   = NULL;
-    bool compile     = false;
-    bool disassemble = false;
+    char *filePath     = NULL;
+    bool compile       = false;
+    bool disassemble   = false;
+    bool sequenceStats = false;
+    bool clearedCache  = false;
+
+    AsmSequenceStats stats = NO_SEQUENCE_STATS;
+
+    CompileOptions options = DEFAULT_COMPILE_OPTIONS;
 
     for (int i = 1; i < argc; i++) {
         char *arg = argv[i];
@@ -106,6 +129,41 @@ int main(int argc, char *argv[]) {
         else if (ARG("-D") || ARG("--disassemble")) {
             disassemble = true;
         }
+        // -S, --sequence-stats
+        else if (ARG("-S") || ARG("--sequence-stats")) {
+            sequenceStats = true;
+        }
+        // -J, --jit
+        else if (ARG("-J") || ARG("--jit")) {
+            options.jit = true;
+        }
+        // -T, --tiered
+        else if (ARG("-T") || ARG("--tiered")) {
+            options.tiered = true;
+        }
+        // --cache[=DIR]
+        else if (strncmp(arg, "--cache", 7) == 0 &&
+                 (arg[7] == 0 || arg[7] == '=')) {
+            const char *cacheDir =
+                (arg[7] == '=' && arg[8] != 0) ? arg + 8
+                                               : COMPILE_CACHE_DEFAULT_DIR;
+            d_compile_cache_set_dir(cacheDir);
+        }
+        // --clear-cache
+        else if (ARG("--clear-cache")) {
+            const char *cacheDir = d_compile_cache_get_dir();
+            if (cacheDir == NULL) {
+                cacheDir = COMPILE_CACHE_DEFAULT_DIR;
+            }
+
+            if (!d_compile_cache_clear(cacheDir)) {
+                printf("Could not delete everything in the cache directory "
+                       "%s\n",
+                       cacheDir);
+            }
+
+            clearedCache = true;
+        }
         // --export-core
         else if (ARG("--export-core")) {
             d_core_dump_json();
@@ -163,7 +221,7 @@ int main(int argc, char *argv[]) {
         } else {
             // If it's something we don't recognise, assume it's the source
             // file.
-            if (filePath != NULL && !compile) {
+            if (filePath != NULL && !compile && !sequenceStats) {
                 // A "file" has already been given.
                 printf("More than one file has been given!\n");
                 return 1;
@@ -171,7 +229,16 @@ int main(int argc, char *argv[]) {
 
             filePath = argv[i];
 
-            if (compile) {
+            if (sequenceStats) {
+                // Add the instructions of this file to the statistics.
+                Sheet *sheet = d_load_file((const char *)filePath, NULL);
+
+                if (sheet != NULL) {
+                    d_asm_count_sequences(&stats, sheet->_text,
+                                          sheet->_textSize);
+                    d_sheet_free(sheet);
+                }
+            } else if (compile) {
                 // We want to change the file path so it has an extension of
                 // .dco, instead of .dc
                 // If it's a different extension, just add it on.
@@ -211,7 +278,10 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    if (filePath != NULL) {
+    if (sequenceStats) {
+        d_asm_sequences_dump(stats, 20);
+        d_asm_free_sequences(&stats);
+    } else if (filePath != NULL) {
         if (!compile) {
             // If the file path ends in .dco, it's an object file.
             bool isObjectFile = false;
@@ -230,7 +300,8 @@ int main(int argc, char *argv[]) {
 
                     return 0;
                 } else
-                    return d_run_object_file((const char *)filePath, NULL);
+                    return d_run_object_file((const char *)filePath,
+                                             &options);
             } else {
                 // Check that we are not disassembling a source file.
                 if (disassemble) {
@@ -238,9 +309,13 @@ int main(int argc, char *argv[]) {
                            "object file!\n");
                     return 1;
                 } else
-                    return d_run_source_file((const char *)filePath, NULL);
+                    return d_run_source_file((const char *)filePath,
+                                             &options);
             }
         }
+    } else if (clearedCache) {
+        // Clearing the cache is a perfectly good thing to do on its own.
+        return 0;
     } else {
         print_help();
         return 1;
@@ -20,6 +20,28 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define HAS_MMAP
+#endif
+
+/* Allocations from arenas are aligned to this many bytes, which is enough for
+   any of the types the compiler puts in them. */
+#define ARENA_ALIGNMENT 16
+
+/* Round a size up to a multiple of ARENA_ALIGNMENT. */
+#define ARENA_ALIGN(size)                                                      \
+    (((size) + (ARENA_ALIGNMENT - 1)) & ~((size_t)ARENA_ALIGNMENT - 1))
+
+/* The size of a block header, so that the memory after it is aligned. */
+#define ARENA_HEADER_SIZE ARENA_ALIGN(sizeof(DArenaBlock))
 
 /**
  * \fn void *d_malloc(size_t size)
@@ -78,4 +100,252 @@ void *d_calloc(size_t num, size_t size) {
     }
 
     return newptr;
-}
\ No newline at end of file
+}
+
+/**
+ * \fn DArena *d_arena_create(size_t blockSize)
+ * \brief Create an empty arena.
+ *
+ * \return A malloc'd arena. Free it with `d_arena_free`.
+ *
+ * \param blockSize The minimum size of each block of the arena in bytes. If
+ * 0, `ARENA_DEFAULT_BLOCK_SIZE` is used.
+ */
+DArena *d_arena_create(size_t blockSize) {
+    DArena *arena = d_malloc(sizeof(DArena));
+
+    arena->first     = NULL;
+    arena->current   = NULL;
+    arena->blockSize = (blockSize > 0) ? blockSize : ARENA_DEFAULT_BLOCK_SIZE;
+
+    return arena;
+}
+
+/**
+ * \fn static DArenaBlock *arena_new_block(DArena *arena, size_t size)
+ * \brief Add a block to the end of an arena that can fit an allocation.
+ *
+ * \return The new block.
+ *
+ * \param arena The arena to add the block to.
+ * \param size The aligned size of the allocation that needs to fit.
+ */
+static DArenaBlock *arena_new_block(DArena *arena, size_t size) {
+    size_t capacity = (size > arena->blockSize) ? size : arena->blockSize;
+
+    DArenaBlock *block = d_malloc(ARENA_HEADER_SIZE + capacity);
+    block->next        = NULL;
+    block->capacity    = capacity;
+    block->used        = 0;
+
+    if (arena->current != NULL) {
+        // Any blocks after the current one were kept from a reset, so put
+        // the new block after them.
+        DArenaBlock *last = arena->current;
+        while (last->next != NULL) {
+            last = last->next;
+        }
+
+        last->next = block;
+    } else {
+        arena->first = block;
+    }
+
+    return block;
+}
+
+/**
+ * \fn void *d_arena_push(DArena *arena, size_t size)
+ * \brief Allocate memory from an arena. The memory is aligned for any type.
+ *
+ * The memory cannot be freed or reallocated by itself, it is freed with the
+ * rest of the arena.
+ *
+ * \return A pointer to the allocated memory.
+ *
+ * \param arena The arena to allocate from.
+ * \param size The size of the allocation.
+ */
+void *d_arena_push(DArena *arena, size_t size) {
+    size = ARENA_ALIGN(size);
+
+    DArenaBlock *block = arena->current;
+
+    // Find the next block with enough space, which after a reset may be one
+    // that is already there.
+    while (block == NULL || block->capacity - block->used < size) {
+        if (block != NULL && block->next != NULL) {
+            block = block->next;
+        } else {
+            block = arena_new_block(arena, size);
+        }
+    }
+
+    arena->current = block;
+
+    void *ptr = (char *)block + ARENA_HEADER_SIZE + block->used;
+    block->used += size;
+
+    return ptr;
+}
+
+/**
+ * \fn void *d_arena_push_zero(DArena *arena, size_t num, size_t size)
+ * \brief Allocate zeroed memory for an array from an arena, like `calloc`.
+ *
+ * \return A pointer to the allocated memory.
+ *
+ * \param arena The arena to allocate from.
+ * \param num The number of elements to allocate.
+ * \param size The size of each element.
+ */
+void *d_arena_push_zero(DArena *arena, size_t num, size_t size) {
+    if (size > 0 && num > (size_t)-1 / size) {
+        printf("Fatal: arena allocation is too big\n");
+        exit(1);
+    }
+
+    void *ptr = d_arena_push(arena, num * size);
+    memset(ptr, 0, num * size);
+
+    return ptr;
+}
+
+/**
+ * \fn void d_arena_reset(DArena *arena)
+ * \brief Free every allocation made from an arena, but keep the blocks so
+ * they can be used again.
+ *
+ * \param arena The arena to reset.
+ */
+void d_arena_reset(DArena *arena) {
+    DArenaBlock *block = arena->first;
+
+    while (block != NULL) {
+        block->used = 0;
+        block       = block->next;
+    }
+
+    arena->current = arena->first;
+}
+
+/**
+ * \fn void d_arena_free(DArena *arena)
+ * \brief Free an arena, and every allocation made from it.
+ *
+ * \param arena The arena to free.
+ */
+void d_arena_free(DArena *arena) {
+    if (arena == NULL) {
+        return;
+    }
+
+    DArenaBlock *block = arena->first;
+
+    while (block != NULL) {
+        DArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+
+    free(arena);
+}
+
+/**
+ * \fn char *d_map_file(const char *filePath, size_t *size)
+ * \brief Map the contents of a file into memory.
+ *
+ * The mapping is private and copy-on-write: the pages are shared with the
+ * operating system's file cache until they are written to, at which point
+ * only the written pages are copied. Writes never go back to the file.
+ *
+ * \return A pointer to the mapped contents of the file, or `NULL` if the file
+ * couldn't be mapped, e.g. if it doesn't exist, it is empty, or the platform
+ * doesn't support mapping files. Unmap it with `d_unmap_file`.
+ *
+ * \param filePath The file to map.
+ * \param size Overwritten with the size of the file in bytes.
+ */
+char *d_map_file(const char *filePath, size_t *size) {
+    *size = 0;
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return NULL;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return NULL;
+    }
+
+    // PAGE_WRITECOPY and FILE_MAP_COPY make the view copy-on-write.
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    CloseHandle(file);
+
+    if (mapping == NULL) {
+        return NULL;
+    }
+
+    // The view keeps the mapping alive after the handle is closed.
+    char *out = (char *)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    CloseHandle(mapping);
+
+    if (out != NULL) {
+        *size = (size_t)fileSize.QuadPart;
+    }
+
+    return out;
+#elif defined(HAS_MMAP)
+    int fd = open(filePath, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+
+    // MAP_PRIVATE with write access makes the mapping copy-on-write.
+    void *out = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (out == MAP_FAILED) {
+        return NULL;
+    }
+
+    *size = (size_t)st.st_size;
+    return (char *)out;
+#else
+    (void)filePath;
+    return NULL;
+#endif
+}
+
+/**
+ * \fn void d_unmap_file(char *mapping, size_t size)
+ * \brief Unmap a file mapped by `d_map_file`.
+ *
+ * \param mapping The mapped contents of the file.
+ * \param size The size of the file in bytes.
+ */
+void d_unmap_file(char *mapping, size_t size) {
+    if (mapping == NULL) {
+        return;
+    }
+
+#if defined(_WIN32)
+    (void)size;
+    UnmapViewOfFile(mapping);
+#elif defined(HAS_MMAP)
+    munmap(mapping, size);
+#else
+    (void)size;
+#endif
+}
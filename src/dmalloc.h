@@ -29,6 +29,42 @@
 
 #include <stddef.h>
 
+/*
+=== HEADER DEFINITIONS ====================================
+*/
+
+/**
+ * \def ARENA_DEFAULT_BLOCK_SIZE
+ * \brief The default size of a block of an arena in bytes, if one isn't given.
+ */
+#define ARENA_DEFAULT_BLOCK_SIZE 65536
+
+/**
+ * \struct _dArenaBlock
+ * \brief A block of memory that allocations are bumped from. The memory for
+ * the allocations is directly after the block in memory.
+ *
+ * \typedef struct _dArenaBlock DArenaBlock
+ */
+typedef struct _dArenaBlock {
+    struct _dArenaBlock *next; ///< The next block in the arena, if any.
+    size_t capacity;           ///< How many bytes can be allocated.
+    size_t used;               ///< How many bytes have been allocated.
+} DArenaBlock;
+
+/**
+ * \struct _dArena
+ * \brief A region of memory where lots of small allocations can be made
+ * quickly, and then all freed at once.
+ *
+ * \typedef struct _dArena DArena
+ */
+typedef struct _dArena {
+    DArenaBlock *first;   ///< The first block, or `NULL` if there isn't one.
+    DArenaBlock *current; ///< The block allocations are made from.
+    size_t blockSize;     ///< The minimum size of new blocks in bytes.
+} DArena;
+
 /*
 === FUNCTIONS =============================================
 */
@@ -65,4 +101,84 @@ DECISION_API void *d_realloc(void *ptr, size_t size);
  */
 DECISION_API void *d_calloc(size_t num, size_t size);
 
+/**
+ * \fn DArena *d_arena_create(size_t blockSize)
+ * \brief Create an empty arena.
+ *
+ * \return A malloc'd arena. Free it with `d_arena_free`.
+ *
+ * \param blockSize The minimum size of each block of the arena in bytes. If
+ * 0, `ARENA_DEFAULT_BLOCK_SIZE` is used.
+ */
+DECISION_API DArena *d_arena_create(size_t blockSize);
+
+/**
+ * \fn void *d_arena_push(DArena *arena, size_t size)
+ * \brief Allocate memory from an arena. The memory is aligned for any type.
+ *
+ * The memory cannot be freed or reallocated by itself, it is freed with the
+ * rest of the arena.
+ *
+ * \return A pointer to the allocated memory.
+ *
+ * \param arena The arena to allocate from.
+ * \param size The size of the allocation.
+ */
+DECISION_API void *d_arena_push(DArena *arena, size_t size);
+
+/**
+ * \fn void *d_arena_push_zero(DArena *arena, size_t num, size_t size)
+ * \brief Allocate zeroed memory for an array from an arena, like `calloc`.
+ *
+ * \return A pointer to the allocated memory.
+ *
+ * \param arena The arena to allocate from.
+ * \param num The number of elements to allocate.
+ * \param size The size of each element.
+ */
+DECISION_API void *d_arena_push_zero(DArena *arena, size_t num, size_t size);
+
+/**
+ * \fn void d_arena_reset(DArena *arena)
+ * \brief Free every allocation made from an arena, but keep the blocks so
+ * they can be used again.
+ *
+ * \param arena The arena to reset.
+ */
+DECISION_API void d_arena_reset(DArena *arena);
+
+/**
+ * \fn void d_arena_free(DArena *arena)
+ * \brief Free an arena, and every allocation made from it.
+ *
+ * \param arena The arena to free.
+ */
+DECISION_API void d_arena_free(DArena *arena);
+
+/**
+ * \fn char *d_map_file(const char *filePath, size_t *size)
+ * \brief Map the contents of a file into memory.
+ *
+ * The mapping is private and copy-on-write: the pages are shared with the
+ * operating system's file cache until they are written to, at which point
+ * only the written pages are copied. Writes never go back to the file.
+ *
+ * \return A pointer to the mapped contents of the file, or `NULL` if the file
+ * couldn't be mapped, e.g. if it doesn't exist, it is empty, or the platform
+ * doesn't support mapping files. Unmap it with `d_unmap_file`.
+ *
+ * \param filePath The file to map.
+ * \param size Overwritten with the size of the file in bytes.
+ */
+DECISION_API char *d_map_file(const char *filePath, size_t *size);
+
+/**
+ * \fn void d_unmap_file(char *mapping, size_t size)
+ * \brief Unmap a file mapped by `d_map_file`.
+ *
+ * \param mapping The mapped contents of the file.
+ * \param size The size of the file in bytes.
+ */
+DECISION_API void d_unmap_file(char *mapping, size_t size);
+
 #endif // DMALLOC_H
\ No newline at end of file
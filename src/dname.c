@@ -19,139 +19,252 @@
 #include "dname.h"
 
 #include "dcfunc.h"
+#include "dcontext.h"
 #include "dcore.h"
 #include "decision.h"
 #include "derror.h"
+#include "dintern.h"
 #include "dmalloc.h"
 #include "dsheet.h"
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
-/*
-    void add_name_definition(AllNameDefinitions* all, NameDefinition definition)
-    Add a name definition to the array of all name definitions.
-    Similar to the LIST_PUSH macro in dsheet.c
+/**
+ * \struct _nameEntry
+ * \brief A definition of a name in a name table.
+ *
+ * \typedef struct _nameEntry NameEntry
+ */
+typedef struct _nameEntry {
+    const char *name;          ///< The interned name that is defined.
+    uint32_t hash;             ///< The hash of the name.
+    bool isCoreName;           ///< Is the name also that of a core function?
+    NameDefinition definition; ///< Where the name is defined.
+    size_t next; ///< The index of the next entry with the same name, or
+                 ///< `SIZE_MAX` if this is the last one.
+} NameEntry;
 
-    AllNameDefinitions* all: The list of name definitions to add onto.
-    NameDefinition definition: The name definition to add on.
-*/
-static void add_name_definition(AllNameDefinitions *all,
-                                NameDefinition definition) {
-    size_t newNumDefinitions = all->numDefinitions + 1;
-    if (newNumDefinitions == 1)
-        all->definitions = d_malloc(sizeof(NameDefinition));
-    else
-        all->definitions = d_realloc(
-            all->definitions, newNumDefinitions * sizeof(NameDefinition));
-    all->definitions[all->numDefinitions++] = definition;
+/**
+ * \fn static bool is_up_to_date(const NameTable *table)
+ * \brief Check if a name table was built from the current generation of names
+ * of the current compile context.
+ *
+ * \return If the table can be used.
+ *
+ * \param table The table to check.
+ */
+static bool is_up_to_date(const NameTable *table) {
+    DCompileContext *context = d_context_current();
+
+    return table->_context == context &&
+           table->_generation == context->_nameGeneration;
 }
 
-/*
-    void get_name_definitions_recursive(struct _sheet* sheet, const char* name,
-   AllNameDefinitions* state) Recursively find a definition of a name.
+/**
+ * \fn static void add_entry(NameTable *table, size_t *tails, NameEntry entry)
+ * \brief Add an entry onto the end of a name table that is being built.
+ *
+ * \param table The table to add the entry to. It must have room for it.
+ * \param tails The index of the last entry of each bucket's name.
+ * \param entry The entry to add.
+ */
+static void add_entry(NameTable *table, size_t *tails, NameEntry entry) {
+    const size_t mask  = table->_numBuckets - 1;
+    const size_t index = table->_numEntries++;
 
-    Sheet* sheet: The sheet to start looking from.
-    const char* name: The name to query.
-    AllNameDefinitions* state: The state of the recursion. This is added onto
-   when we find a name definition.
-*/
-static void get_name_definitions_recursive(Sheet *sheet, const char *name,
-                                           AllNameDefinitions *state) {
-    VERBOSE(5, "Checking sheet %s for name %s...\n", sheet->filePath, name)
+    entry.next              = SIZE_MAX;
+    table->_entries[index] = entry;
 
-    // First, check to see if it is a core function.
-    CoreFunction coreFunc = d_core_find_name(name);
+    size_t bucket = entry.hash & mask;
 
-    if ((int)coreFunc > -1) {
-        NameDefinition definition;
-        definition.sheet               = sheet;
-        definition.type                = NAME_CORE;
-        definition.definition.coreFunc = coreFunc;
+    while (table->_buckets[bucket] != SIZE_MAX) {
+        NameEntry *first = table->_entries + table->_buckets[bucket];
 
-        add_name_definition(state, definition);
+        // If the name already has entries, this one goes after them.
+        if (first->name == entry.name) {
+            table->_entries[tails[bucket]].next = index;
+            tails[bucket]                       = index;
+            return;
+        }
 
-        VERBOSE(5, "Core function: YES\n")
-    } else {
-        VERBOSE(5, "Core function: NO\n")
+        bucket = (bucket + 1) & mask;
     }
 
-    // Maybe it's a variable name?
-    if (sheet->variables != NULL && sheet->numVariables > 0) {
-        size_t hits = 0;
-        for (size_t i = 0; i < sheet->numVariables; i++) {
-            if (strcmp(name, sheet->variables[i].variableMeta.name) == 0) {
-                hits++;
+    table->_buckets[bucket] = index;
+    tails[bucket]           = index;
+}
 
-                NameDefinition definition;
-                definition.sheet               = sheet;
-                definition.type                = NAME_VARIABLE;
-                definition.definition.variable = &(sheet->variables[i]);
+/**
+ * \fn static void add_own_entry(NameTable *table, size_t *tails,
+ *                               const char *name, NameDefinition definition)
+ * \brief Add the definition of a name in the table's own sheet.
+ *
+ * \param table The table to add the entry to. It must have room for it.
+ * \param tails The index of the last entry of each bucket's name.
+ * \param name The interned name that is defined.
+ * \param definition Where the name is defined.
+ */
+static void add_own_entry(NameTable *table, size_t *tails, const char *name,
+                          NameDefinition definition) {
+    NameEntry entry;
+    entry.name       = name;
+    entry.hash       = d_intern_hash(name);
+    entry.isCoreName = (int)d_core_find_name(name) > -1;
+    entry.definition = definition;
+
+    add_entry(table, tails, entry);
+}
 
-                add_name_definition(state, definition);
-            }
+/**
+ * \fn static void build_table(Sheet *sheet)
+ * \brief Build the name table of a sheet, and of the sheets it includes if
+ * they are out of date.
+ *
+ * The definitions of each name are in the same order they used to be found in
+ * by searching the sheets one by one: the core function, then the variables,
+ * functions and C functions of the sheet, then the definitions from each
+ * include in turn. If the name is a core function, the includes aren't
+ * searched.
+ *
+ * \param sheet The sheet to build the name table of.
+ */
+static void build_table(Sheet *sheet) {
+    VERBOSE(5, "Building the name table of sheet %s...\n", sheet->filePath)
+
+    NameTable *table = &(sheet->_names);
+    d_name_free_table(table);
+
+    size_t capacity = NUM_CORE_FUNCTIONS + sheet->numVariables +
+                      sheet->numFunctions + sheet->numCFunctions;
+
+    for (size_t i = 0; i < sheet->numIncludes; i++) {
+        Sheet *include = sheet->includes[i];
+
+        if (!is_up_to_date(&(include->_names))) {
+            build_table(include);
         }
 
-        VERBOSE(5, "Variable: %zu\n", hits)
-    } else {
-        VERBOSE(
-            5,
-            "Not checking if a variable, no variables defined in this sheet.\n")
+        capacity += include->_names._numEntries;
     }
 
-    // Maybe, just maybe... it's a function name?
-    if (sheet->functions != NULL && sheet->numFunctions > 0) {
-        size_t hits = 0;
-        for (size_t i = 0; i < sheet->numFunctions; i++) {
-            if (strcmp(name, sheet->functions[i].functionDefinition.name) ==
-                0) {
-                hits++;
+    // Keep the table at most half full, so the probes stay short.
+    size_t numBuckets = 8;
+    while (numBuckets < 2 * capacity) {
+        numBuckets *= 2;
+    }
 
-                NameDefinition definition;
-                definition.sheet               = sheet;
-                definition.type                = NAME_FUNCTION;
-                definition.definition.function = &(sheet->functions[i]);
+    table->_entries    = d_malloc(capacity * sizeof(NameEntry));
+    table->_buckets    = d_malloc(numBuckets * sizeof(size_t));
+    table->_numBuckets = numBuckets;
 
-                add_name_definition(state, definition);
-            }
-        }
+    for (size_t i = 0; i < numBuckets; i++) {
+        table->_buckets[i] = SIZE_MAX;
+    }
 
-        VERBOSE(5, "Function: %zu\n", hits)
-    } else {
-        VERBOSE(
-            5,
-            "Not checking if a function, no functions defined in this sheet.\n")
+    size_t *tails = d_malloc(numBuckets * sizeof(size_t));
+
+    NameDefinition definition;
+    definition.sheet = sheet;
+
+    definition.type = NAME_CORE;
+    for (size_t i = 0; i < NUM_CORE_FUNCTIONS; i++) {
+        definition.definition.coreFunc = (CoreFunction)i;
+
+        const char *name = d_core_get_definition((CoreFunction)i)->name;
+
+        NameEntry entry;
+        entry.name       = d_intern(name);
+        entry.hash       = d_intern_hash(entry.name);
+        entry.isCoreName = true;
+        entry.definition = definition;
+
+        add_entry(table, tails, entry);
     }
 
-    // It could also be a C function.
-    if (sheet->cFunctions != NULL && sheet->numCFunctions > 0) {
-        size_t hits = 0;
-        for (size_t i = 0; i < sheet->numCFunctions; i++) {
-            if (strcmp(name, sheet->cFunctions[i].definition.name) == 0) {
-                hits++;
+    definition.type = NAME_VARIABLE;
+    for (size_t i = 0; i < sheet->numVariables; i++) {
+        definition.definition.variable = sheet->variables + i;
+        add_own_entry(table, tails, sheet->variables[i].variableMeta.name,
+                      definition);
+    }
 
-                NameDefinition definition;
-                definition.sheet                = sheet;
-                definition.type                 = NAME_CFUNCTION;
-                definition.definition.cFunction = &(sheet->cFunctions[i]);
+    definition.type = NAME_FUNCTION;
+    for (size_t i = 0; i < sheet->numFunctions; i++) {
+        definition.definition.function = sheet->functions + i;
+        add_own_entry(table, tails,
+                      sheet->functions[i].functionDefinition.name, definition);
+    }
+
+    definition.type = NAME_CFUNCTION;
+    for (size_t i = 0; i < sheet->numCFunctions; i++) {
+        definition.definition.cFunction = sheet->cFunctions + i;
+        add_own_entry(table, tails, sheet->cFunctions[i].definition.name,
+                      definition);
+    }
 
-                add_name_definition(state, definition);
+    // Names of core functions never get looked up in the includes.
+    for (size_t i = 0; i < sheet->numIncludes; i++) {
+        NameTable *includeTable = &(sheet->includes[i]->_names);
+
+        for (size_t j = 0; j < includeTable->_numEntries; j++) {
+            if (!includeTable->_entries[j].isCoreName) {
+                add_entry(table, tails, includeTable->_entries[j]);
             }
         }
+    }
 
-        VERBOSE(5, "C Function: %zu\n", hits);
-    } else {
-        VERBOSE(5, "Not checking if a C function, no C functions defined in "
-                   "this sheet.\n")
+    free(tails);
+
+    table->_context    = d_context_current();
+    table->_generation = table->_context->_nameGeneration;
+
+    VERBOSE(5, "Sheet %s has %zu name definitions.\n", sheet->filePath,
+            table->_numEntries)
+}
+
+/**
+ * \fn NameTable d_name_new_table()
+ * \brief Create an empty name table. It is built the first time a name is
+ * looked up with `d_get_name_definitions`.
+ *
+ * \return An empty name table.
+ */
+NameTable d_name_new_table() {
+    return (NameTable){NULL, 0, NULL, 0, NULL, 0};
+}
+
+/**
+ * \fn void d_name_free_table(NameTable *table)
+ * \brief Free the contents of a name table.
+ *
+ * \param table The table to free.
+ */
+void d_name_free_table(NameTable *table) {
+    if (table->_entries != NULL) {
+        free(table->_entries);
     }
 
-    // Please sir... may I have some more names? (If it isn't a core function)
-    if (sheet->includes != NULL && sheet->numIncludes > 0 &&
-        (int)coreFunc == -1) {
-        for (size_t i = 0; i < sheet->numIncludes; i++) {
-            get_name_definitions_recursive(sheet->includes[i], name, state);
-        }
+    if (table->_buckets != NULL) {
+        free(table->_buckets);
     }
+
+    *table = d_name_new_table();
+}
+
+/**
+ * \fn void d_name_invalidate_tables()
+ * \brief Mark the name tables built in the current compile context as out of
+ * date, so they are built again the next time they are used.
+ *
+ * This needs to be called whenever a sheet gets a new variable, function, C
+ * function or include, since any sheet that includes it could see the new
+ * name. Tables built in other contexts aren't affected, so a sheet should
+ * only be changed in the context it is used in.
+ */
+void d_name_invalidate_tables() {
+    d_context_current()->_nameGeneration++;
 }
 
 /**
@@ -159,7 +272,9 @@ static void get_name_definitions_recursive(Sheet *sheet, const char *name,
  * \brief Get all of the places where a name is defined, and what the name's
  * type is.
  *
- * We will also check recursively up the includes of sheets.
+ * We will also check recursively up the includes of sheets. The first time a
+ * name is looked up in a sheet, a table of all of the names the sheet can
+ * use is built, so every lookup after that is a hash table lookup.
  *
  * \return An array of NameDefinition.
  *
@@ -170,7 +285,47 @@ AllNameDefinitions d_get_name_definitions(Sheet *sheet, const char *name) {
     VERBOSE(5, "Finding definitions for name %s...\n", name)
 
     AllNameDefinitions allDefinitions = (AllNameDefinitions){NULL, 0};
-    get_name_definitions_recursive(sheet, name, &allDefinitions);
+
+    NameTable *table = &(sheet->_names);
+
+    if (!is_up_to_date(table)) {
+        build_table(sheet);
+    }
+
+    // Every name that is defined is interned, so if this name isn't, it isn't
+    // defined anywhere. Otherwise, names can be compared by their pointers.
+    const char *interned = d_intern_find(name);
+    size_t first         = SIZE_MAX;
+
+    if (interned != NULL) {
+        const size_t mask = table->_numBuckets - 1;
+        size_t bucket     = d_intern_hash(interned) & mask;
+
+        while (table->_buckets[bucket] != SIZE_MAX) {
+            NameEntry *entry = table->_entries + table->_buckets[bucket];
+
+            if (entry->name == interned) {
+                first = table->_buckets[bucket];
+                break;
+            }
+
+            bucket = (bucket + 1) & mask;
+        }
+    }
+
+    for (size_t i = first; i != SIZE_MAX; i = table->_entries[i].next) {
+        allDefinitions.numDefinitions++;
+    }
+
+    if (allDefinitions.numDefinitions > 0) {
+        allDefinitions.definitions =
+            d_malloc(allDefinitions.numDefinitions * sizeof(NameDefinition));
+
+        size_t j = 0;
+        for (size_t i = first; i != SIZE_MAX; i = table->_entries[i].next) {
+            allDefinitions.definitions[j++] = table->_entries[i].definition;
+        }
+    }
 
     VERBOSE(5, "Found %zu results for name %s.\n",
             allDefinitions.numDefinitions, name)
@@ -92,6 +92,37 @@ typedef struct _allNameDefinitions {
     size_t numDefinitions;
 } AllNameDefinitions;
 
+/* Forward declaration of the NameEntry struct from dname.c */
+struct _nameEntry;
+
+/* A forward declaration of the DCompileContext struct from dcontext.h */
+struct _dCompileContext;
+
+/**
+ * \struct _nameTable
+ * \brief A hash table of every name a sheet can use, including the names of
+ * the core functions, and the names defined in the sheets it includes.
+ *
+ * \typedef struct _nameTable NameTable
+ */
+typedef struct _nameTable {
+    struct _nameEntry *_entries; ///< The definitions in the table, in the
+                                 ///< order `d_get_name_definitions` returns
+                                 ///< them in.
+    size_t _numEntries;          ///< The number of entries.
+
+    size_t *_buckets;   ///< The index of the first entry of each name, or
+                        ///< `SIZE_MAX` if the bucket is empty.
+    size_t _numBuckets; ///< The number of buckets. Always a power of 2.
+
+    struct _dCompileContext *_context; ///< The compile context the table was
+                                       ///< built in.
+    size_t _generation; ///< Which generation of names of the context the
+                        ///< table was built from. If it isn't the context's
+                        ///< current one, or the table was built in a
+                        ///< different context, the table is out of date.
+} NameTable;
+
 /*
 === FUNCTIONS =============================================
 */
@@ -101,7 +132,9 @@ typedef struct _allNameDefinitions {
  * \brief Get all of the places where a name is defined, and what the name's
  * type is.
  *
- * We will also check recursively up the includes of sheets.
+ * We will also check recursively up the includes of sheets. The first time a
+ * name is looked up in a sheet, a table of all of the names the sheet can
+ * use is built, so every lookup after that is a hash table lookup.
  *
  * \return An array of NameDefinition.
  *
@@ -120,6 +153,35 @@ DECISION_API AllNameDefinitions d_get_name_definitions(struct _sheet *sheet,
  */
 DECISION_API void d_free_name_definitions(AllNameDefinitions *definitions);
 
+/**
+ * \fn NameTable d_name_new_table()
+ * \brief Create an empty name table. It is built the first time a name is
+ * looked up with `d_get_name_definitions`.
+ *
+ * \return An empty name table.
+ */
+DECISION_API NameTable d_name_new_table();
+
+/**
+ * \fn void d_name_free_table(NameTable *table)
+ * \brief Free the contents of a name table.
+ *
+ * \param table The table to free.
+ */
+DECISION_API void d_name_free_table(NameTable *table);
+
+/**
+ * \fn void d_name_invalidate_tables()
+ * \brief Mark the name tables built in the current compile context as out of
+ * date, so they are built again the next time they are used.
+ *
+ * This needs to be called whenever a sheet gets a new variable, function, C
+ * function or include, since any sheet that includes it could see the new
+ * name. Tables built in other contexts aren't affected, so a sheet should
+ * only be changed in the context it is used in.
+ */
+DECISION_API void d_name_invalidate_tables();
+
 /**
  * \fn const NodeDefinition *d_get_definition(Sheet *sheet, const char *name,
  *                                            size_t lineNum,
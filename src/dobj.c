@@ -21,9 +21,11 @@
 #include "dcfunc.h"
 #include "decision.h"
 #include "derror.h"
+#include "dintern.h"
 #include "dmalloc.h"
 #include "dsheet.h"
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -48,8 +50,9 @@ typedef struct _objReader {
  * \typedef struct _objWriter ObjectWriter
  */
 typedef struct _objWriter {
-    char *obj;  ///< The object file contents.
-    size_t len; ///< The length of the object string in bytes.
+    char *obj;       ///< The object file contents.
+    size_t len;      ///< The length of the object string in bytes.
+    size_t capacity; ///< The number of bytes allocated for `obj`.
 } ObjectWriter;
 
 /**
@@ -63,6 +66,215 @@ typedef struct _indexList {
     size_t length;
 } IndexList;
 
+/*
+=== OBJECT FORMAT =========================================
+*/
+
+/* Older object files have the major version of Decision directly after the
+   "D32" or "D64" at the start, whereas newer object files have this marker
+   followed by an ObjHeader. */
+#define OBJ_FORMAT_MARKER ((char)0xff)
+
+/* The version of the object format that d_obj_generate writes. */
+#define OBJ_FORMAT_VERSION 3
+
+/* The first version of the object format whose header has the calling
+   convention of the text section. Object files with a section table from
+   before then always use calling convention 1. */
+#define OBJ_FORMAT_CALL_CONVENTION 3
+
+/* Every section is aligned to this many bytes in the object file, so that the
+   text and data sections can be used in place when the file is mapped. */
+#define OBJ_SECTION_ALIGNMENT 8
+
+/* The biggest alignment a section can ask for. */
+#define OBJ_MAX_ALIGNMENT 4096
+
+/* The number of bytes for the name of a section, including the \0. */
+#define OBJ_SECTION_NAME_SIZE 8
+
+/* Used in place of an index when there is no entry. */
+#define OBJ_NO_ENTRY 0xffffffff
+
+/* Used in place of an offset when the item is in another sheet. */
+#define OBJ_EXTERNAL_PTR UINT64_MAX
+
+/**
+ * \enum _objSectionType
+ * \brief The sections an object file can have.
+ *
+ * \typedef enum _objSectionType ObjSectionType
+ */
+typedef enum _objSectionType {
+    OBJ_SECTION_TEXT,   ///< The bytecode.
+    OBJ_SECTION_DATA,   ///< The data section.
+    OBJ_SECTION_STRTAB, ///< Every name, description and path, each ending in
+                        ///< a `\0`. Starts with an empty string.
+    OBJ_SECTION_LMETA,  ///< A list of `ObjLinkMeta`.
+    OBJ_SECTION_LINK,   ///< A list of `ObjInsLink`.
+    OBJ_SECTION_FUNC,   ///< A list of `ObjFunction`.
+    OBJ_SECTION_SOCKET, ///< A list of `ObjSocket`, used by the functions.
+    OBJ_SECTION_VAR,    ///< A list of `ObjVariable`.
+    OBJ_SECTION_INCL,   ///< A list of `uint32_t` offsets into `.strtab`.
+    OBJ_SECTION_SYMTAB, ///< A hash table of the symbols defined in the
+                        ///< sheet. See `ObjSymbolTable`.
+    OBJ_NUM_SECTIONS
+} ObjSectionType;
+
+/* The names of the sections in the section table. */
+static const char *OBJ_SECTION_NAMES[OBJ_NUM_SECTIONS] = {
+    ".text", ".data",   ".strtab", ".lmeta", ".link",
+    ".func", ".socket", ".var",    ".incl",  ".symtab"};
+
+/**
+ * \struct _objHeader
+ * \brief The header at the start of an object file.
+ *
+ * \typedef struct _objHeader ObjHeader
+ */
+typedef struct _objHeader {
+    char magic[4];          ///< "D32" or "D64", then `OBJ_FORMAT_MARKER`.
+    uint16_t format;        ///< The version of the object format.
+    uint8_t versionMajor;   ///< The major version of Decision.
+    uint8_t versionMinor;   ///< The minor version of Decision.
+    uint8_t versionPatch;   ///< The patch version of Decision.
+    uint8_t callConvention; ///< The calling convention of the text section.
+                            ///< See `VM_CALL_CONVENTION`.
+    uint8_t reserved[2];
+    uint32_t numSections;   ///< The number of entries in the section table,
+                            ///< which is directly after the header.
+    uint64_t main;          ///< The index of the first instruction of Start.
+} ObjHeader;
+
+/**
+ * \struct _objSectionEntry
+ * \brief An entry in the section table of an object file.
+ *
+ * \typedef struct _objSectionEntry ObjSectionEntry
+ */
+typedef struct _objSectionEntry {
+    char name[OBJ_SECTION_NAME_SIZE]; ///< The name of the section.
+    uint64_t offset;                  ///< Where the section starts in the
+                                      ///< object file.
+    uint64_t size;                    ///< The size of the section in bytes.
+    uint64_t alignment;               ///< What `offset` is a multiple of.
+} ObjSectionEntry;
+
+/**
+ * \struct _objLinkMeta
+ * \brief A `LinkMeta` in the `.lmeta` section.
+ *
+ * \typedef struct _objLinkMeta ObjLinkMeta
+ */
+typedef struct _objLinkMeta {
+    uint32_t name; ///< The offset of the name in `.strtab`.
+    uint8_t type;  ///< The `LinkType`.
+    uint8_t reserved[3];
+    uint64_t ptr; ///< The index of the item in `.text` or `.data`, or
+                  ///< `OBJ_EXTERNAL_PTR` if it is in another sheet.
+} ObjLinkMeta;
+
+/**
+ * \struct _objInsLink
+ * \brief An `InstructionToLink` in the `.link` section.
+ *
+ * \typedef struct _objInsLink ObjInsLink
+ */
+typedef struct _objInsLink {
+    uint64_t ins;  ///< The index of the instruction in `.text`.
+    uint64_t link; ///< The index of the item in `.lmeta`.
+} ObjInsLink;
+
+/**
+ * \struct _objFunction
+ * \brief A function in the `.func` section.
+ *
+ * \typedef struct _objFunction ObjFunction
+ */
+typedef struct _objFunction {
+    uint32_t link;             ///< The index of the function in `.lmeta`.
+    uint32_t description;      ///< The offset of the description in
+                               ///< `.strtab`.
+    uint32_t numSockets;       ///< The number of sockets.
+    uint32_t startOutputIndex; ///< The index of the first output socket.
+    uint32_t firstSocket;      ///< The index of the first socket in
+                               ///< `.socket`.
+    uint32_t reserved;
+} ObjFunction;
+
+/**
+ * \struct _objSocket
+ * \brief A socket of a function in the `.socket` section.
+ *
+ * \typedef struct _objSocket ObjSocket
+ */
+typedef struct _objSocket {
+    uint32_t name;        ///< The offset of the name in `.strtab`.
+    uint32_t description; ///< The offset of the description in `.strtab`.
+    uint8_t type;         ///< The `DType` of the socket.
+    uint8_t reserved[7];
+    uint64_t defaultValue; ///< The default value, or if the socket is a
+                           ///< string, the offset of it in `.strtab`.
+} ObjSocket;
+
+/**
+ * \struct _objVariable
+ * \brief A variable in the `.var` section.
+ *
+ * \typedef struct _objVariable ObjVariable
+ */
+typedef struct _objVariable {
+    uint32_t link;        ///< The index of the variable in `.lmeta`.
+    uint32_t description; ///< The offset of the description in `.strtab`.
+    uint8_t type;         ///< The `DType` of the variable.
+    uint8_t reserved[7];
+} ObjVariable;
+
+/**
+ * \struct _objSymbolTable
+ * \brief The start of the `.symtab` section. It is followed by
+ * `numBuckets` `uint32_t` indexes of the first symbol in each bucket, and then
+ * `numSymbols` `ObjSymbol`.
+ *
+ * \typedef struct _objSymbolTable ObjSymbolTable
+ */
+typedef struct _objSymbolTable {
+    uint32_t numBuckets; ///< The number of buckets. Always a power of 2.
+    uint32_t numSymbols; ///< The number of symbols.
+} ObjSymbolTable;
+
+/**
+ * \struct _objSymbol
+ * \brief A symbol in the `.symtab` section.
+ *
+ * \typedef struct _objSymbol ObjSymbol
+ */
+typedef struct _objSymbol {
+    uint32_t hash; ///< The hash of the symbol's name.
+    uint32_t link; ///< The index of the symbol in `.lmeta`.
+    uint32_t next; ///< The index of the next symbol in the same bucket, or
+                   ///< `OBJ_NO_ENTRY`.
+} ObjSymbol;
+
+/**
+ * \fn static uint32_t hash_name(const char *name)
+ * \brief Hash the name of a symbol for the symbol table, using FNV-1a.
+ *
+ * \return The hash of the name.
+ *
+ * \param name The name to hash.
+ */
+static uint32_t hash_name(const char *name) {
+    uint32_t hash = 2166136261u;
+
+    for (const char *c = name; *c != '\0'; c++) {
+        hash ^= (unsigned char)*c;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
 /*
 === READER FUNCTIONS ======================================
 */
@@ -104,7 +316,9 @@ static bool reader_test_string_n(ObjectReader *reader, const char *str,
         return false;
     }
 
-    if (!test_ahead(reader, n)) {
+    // The string not being there isn't an error, even if it would go past the
+    // end, since this is used to test for sections that are optional.
+    if (reader->ptr + n > reader->len) {
         return false;
     }
 
@@ -154,6 +368,39 @@ static char *read_string_n(ObjectReader *reader, size_t n) {
     return out;
 }
 
+/**
+ * \fn static char *read_section(ObjectReader *reader, size_t n, char *mapping,
+ *                               bool aligned)
+ * \brief Read a length-n section from an object reader. If the object is a
+ * mapped file, the section points into the mapping rather than being copied.
+ *
+ * \return The section at the reader's current position. It is only malloc'd
+ * if it is not in the mapping.
+ *
+ * \param reader The reader to read from.
+ * \param n The number of bytes in the section.
+ * \param mapping The mapped object file the reader is reading, or `NULL` if
+ * the object isn't mapped.
+ * \param aligned If true, the section is only pointed to if it is aligned
+ * enough for the integers and pointers in it, otherwise it is copied.
+ */
+static char *read_section(ObjectReader *reader, size_t n, char *mapping,
+                          bool aligned) {
+    if (mapping == NULL || !test_ahead(reader, n)) {
+        return read_string_n(reader, n);
+    }
+
+    char *out = mapping + reader->ptr;
+
+    if (aligned && ((uintptr_t)out % sizeof(dint) != 0 ||
+                    (uintptr_t)out % sizeof(char *) != 0)) {
+        return read_string_n(reader, n);
+    }
+
+    reader->ptr += n;
+    return out;
+}
+
 /**
  * \fn static char *read_string(ObjectReader *reader)
  * \brief Read a malloc'd string from an object reader. The end of the string
@@ -173,6 +420,27 @@ static char *read_string(ObjectReader *reader) {
     return read_string_n(reader, nameLen + 1);
 }
 
+/**
+ * \fn static const char *read_name(ObjectReader *reader)
+ * \brief Read an interned name from an object reader. The end of the name is
+ * determined by where the next \0 character is.
+ *
+ * \return The interned name at the reader's current position.
+ *
+ * \param reader The reader to read from.
+ */
+static const char *read_name(ObjectReader *reader) {
+    size_t nameLen = strlen(reader->obj + reader->ptr);
+
+    if (!test_ahead(reader, nameLen)) {
+        return NULL;
+    }
+
+    const char *out = d_intern_n(reader->obj + reader->ptr, nameLen);
+    reader->ptr += nameLen + 1;
+    return out;
+}
+
 /**
  * \fn static duint read_uinteger(ObjectReader *reader)
  * \brief Read an unsigned integer from an object reader.
@@ -207,7 +475,7 @@ static SocketMeta read_socket_meta(ObjectReader *reader, bool hasName,
     SocketMeta out = {NULL, NULL, TYPE_NONE, {0}};
 
     if (hasName) {
-        out.name = read_string(reader);
+        out.name = read_name(reader);
     }
 
     out.description = read_string(reader);
@@ -237,7 +505,7 @@ static NodeDefinition read_definition(ObjectReader *reader, bool hasName) {
     NodeDefinition def = {NULL, NULL, NULL, 0, 0, false};
 
     if (hasName) {
-        def.name = read_string(reader);
+        def.name = read_name(reader);
     }
 
     def.description = read_string(reader);
@@ -259,6 +527,224 @@ static NodeDefinition read_definition(ObjectReader *reader, bool hasName) {
     return def;
 }
 
+/**
+ * \fn static bool read_record(ObjectReader *reader,
+ *                             const ObjSectionEntry *section, size_t index,
+ *                             void *record, size_t recordSize)
+ * \brief Read a fixed-size record from a section of an object reader.
+ *
+ * \return If the record exists. If it doesn't, the record is zeroed and the
+ * reader is marked as having an error.
+ *
+ * \param reader The reader to read from.
+ * \param section The section the record is in.
+ * \param index The index of the record in the section.
+ * \param record Overwritten with the record.
+ * \param recordSize The size of each record in the section.
+ */
+static bool read_record(ObjectReader *reader, const ObjSectionEntry *section,
+                        size_t index, void *record, size_t recordSize) {
+    if (index >= section->size / recordSize) {
+        memset(record, 0, recordSize);
+        reader->error = true;
+        return false;
+    }
+
+    memcpy(record, reader->obj + section->offset + index * recordSize,
+           recordSize);
+    return true;
+}
+
+/**
+ * \fn static const char *strtab_get(ObjectReader *reader,
+ *                                   const ObjSectionEntry *strtab,
+ *                                   uint32_t offset)
+ * \brief Get a string from the string table of an object reader.
+ *
+ * \return A pointer to the string in the object. If the offset isn't valid,
+ * an empty string is returned and the reader is marked as having an error.
+ *
+ * \param reader The reader to read from.
+ * \param strtab The `.strtab` section.
+ * \param offset The offset of the string in the section.
+ */
+static const char *strtab_get(ObjectReader *reader,
+                              const ObjSectionEntry *strtab, uint32_t offset) {
+    const char *start = reader->obj + strtab->offset;
+
+    if (offset >= strtab->size ||
+        memchr(start + offset, '\0', strtab->size - offset) == NULL) {
+        reader->error = true;
+        return "";
+    }
+
+    return start + offset;
+}
+
+/**
+ * \fn static char *strtab_copy(ObjectReader *reader,
+ *                              const ObjSectionEntry *strtab, uint32_t offset)
+ * \brief Get a malloc'd copy of a string from the string table of an object
+ * reader.
+ *
+ * \return The malloc'd string.
+ *
+ * \param reader The reader to read from.
+ * \param strtab The `.strtab` section.
+ * \param offset The offset of the string in the section.
+ */
+static char *strtab_copy(ObjectReader *reader, const ObjSectionEntry *strtab,
+                         uint32_t offset) {
+    const char *str = strtab_get(reader, strtab, offset);
+    size_t len      = strlen(str) + 1;
+
+    char *out = d_malloc(len);
+    memcpy(out, str, len);
+    return out;
+}
+
+/**
+ * \fn static bool read_section_table(ObjectReader *reader, ObjHeader *header,
+ *                                    ObjSectionEntry *sections)
+ * \brief Read the header and section table of an object file.
+ *
+ * \return If the header and section table are valid.
+ *
+ * \param reader The reader to read from, at the start of the object.
+ * \param header Overwritten with the header.
+ * \param sections An array of `OBJ_NUM_SECTIONS` entries, indexed by
+ * `ObjSectionType`, which is overwritten with the section table. Sections
+ * that aren't in the object file have a size of 0.
+ */
+static bool read_section_table(ObjectReader *reader, ObjHeader *header,
+                               ObjSectionEntry *sections) {
+    memset(sections, 0, OBJ_NUM_SECTIONS * sizeof(ObjSectionEntry));
+
+    if (!test_ahead(reader, sizeof(ObjHeader))) {
+        return false;
+    }
+
+    memcpy(header, reader->obj + reader->ptr, sizeof(ObjHeader));
+    reader->ptr += sizeof(ObjHeader);
+
+    if (header->magic[3] != OBJ_FORMAT_MARKER) {
+        reader->error = true;
+        return false;
+    }
+
+    for (uint32_t i = 0; i < header->numSections; i++) {
+        if (!test_ahead(reader, sizeof(ObjSectionEntry))) {
+            return false;
+        }
+
+        ObjSectionEntry entry;
+        memcpy(&entry, reader->obj + reader->ptr, sizeof(ObjSectionEntry));
+        reader->ptr += sizeof(ObjSectionEntry);
+
+        // Make sure the section is inside the object, and that it is aligned
+        // like it says it is.
+        bool validAlignment = entry.alignment > 0 &&
+                              entry.alignment <= OBJ_MAX_ALIGNMENT &&
+                              (entry.alignment & (entry.alignment - 1)) == 0 &&
+                              entry.offset % entry.alignment == 0;
+
+        if (!validAlignment || entry.offset > reader->len ||
+            entry.size > reader->len - entry.offset) {
+            reader->error = true;
+            return false;
+        }
+
+        // Sections we don't know about are skipped, so object files from
+        // newer versions with extra sections can still be loaded.
+        for (size_t j = 0; j < OBJ_NUM_SECTIONS; j++) {
+            if (strncmp(entry.name, OBJ_SECTION_NAMES[j],
+                        OBJ_SECTION_NAME_SIZE) == 0) {
+                sections[j] = entry;
+                break;
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * \fn static uint32_t symtab_find(ObjectReader *reader,
+ *                                 const ObjSectionEntry *sections,
+ *                                 const char *name, LinkType type)
+ * \brief Find a symbol defined in an object file using its symbol table.
+ *
+ * \return The index of the symbol in `.lmeta`, or `OBJ_NO_ENTRY` if the
+ * object file doesn't define the symbol.
+ *
+ * \param reader The reader to read from.
+ * \param sections The section table of the object file.
+ * \param name The name of the symbol.
+ * \param type The type of the symbol.
+ */
+static uint32_t symtab_find(ObjectReader *reader,
+                            const ObjSectionEntry *sections, const char *name,
+                            LinkType type) {
+    const ObjSectionEntry *symtab = sections + OBJ_SECTION_SYMTAB;
+
+    if (symtab->size < sizeof(ObjSymbolTable)) {
+        return OBJ_NO_ENTRY;
+    }
+
+    ObjSymbolTable table;
+    memcpy(&table, reader->obj + symtab->offset, sizeof(ObjSymbolTable));
+
+    const size_t maxEntries = symtab->size / sizeof(uint32_t);
+
+    if (table.numBuckets == 0 || table.numBuckets > maxEntries ||
+        (table.numBuckets & (table.numBuckets - 1)) != 0 ||
+        table.numSymbols > maxEntries ||
+        sizeof(ObjSymbolTable) + table.numBuckets * sizeof(uint32_t) +
+                table.numSymbols * sizeof(ObjSymbol) >
+            symtab->size) {
+        reader->error = true;
+        return OBJ_NO_ENTRY;
+    }
+
+    const char *buckets = reader->obj + symtab->offset + sizeof(ObjSymbolTable);
+    const char *symbols = buckets + table.numBuckets * sizeof(uint32_t);
+
+    const uint32_t hash   = hash_name(name);
+    const uint32_t bucket = hash & (table.numBuckets - 1);
+
+    uint32_t index;
+    memcpy(&index, buckets + bucket * sizeof(uint32_t), sizeof(uint32_t));
+
+    // A bucket can't have more symbols than the table, unless the object file
+    // is corrupted.
+    for (uint32_t i = 0; i < table.numSymbols && index != OBJ_NO_ENTRY; i++) {
+        if (index >= table.numSymbols) {
+            reader->error = true;
+            return OBJ_NO_ENTRY;
+        }
+
+        ObjSymbol symbol;
+        memcpy(&symbol, symbols + index * sizeof(ObjSymbol), sizeof(ObjSymbol));
+
+        if (symbol.hash == hash) {
+            ObjLinkMeta meta;
+
+            if (read_record(reader, sections + OBJ_SECTION_LMETA, symbol.link,
+                            &meta, sizeof(ObjLinkMeta)) &&
+                meta.type == type &&
+                strcmp(strtab_get(reader, sections + OBJ_SECTION_STRTAB,
+                                  meta.name),
+                       name) == 0) {
+                return symbol.link;
+            }
+        }
+
+        index = symbol.next;
+    }
+
+    return OBJ_NO_ENTRY;
+}
+
 /*
 === WRITER FUNCTIONS ======================================
 */
@@ -273,10 +759,22 @@ static NodeDefinition read_definition(ObjectReader *reader, bool hasName) {
 static void writer_alloc_end(ObjectWriter *writer, size_t numBytes) {
     size_t newLen = writer->len + numBytes;
 
-    if (writer->obj == NULL) {
-        writer->obj = d_calloc(newLen, sizeof(char));
-    } else {
-        writer->obj = d_realloc(writer->obj, newLen);
+    // Grow the allocation geometrically, so writing lots of small items
+    // doesn't realloc every time.
+    if (newLen > writer->capacity) {
+        size_t newCapacity = (writer->capacity > 0) ? writer->capacity : 64;
+
+        while (newCapacity < newLen) {
+            newCapacity *= 2;
+        }
+
+        if (writer->obj == NULL) {
+            writer->obj = d_malloc(newCapacity);
+        } else {
+            writer->obj = d_realloc(writer->obj, newCapacity);
+        }
+
+        writer->capacity = newCapacity;
     }
 
     writer->len = newLen;
@@ -335,69 +833,38 @@ static void write_string(ObjectWriter *writer, const char *str) {
 }
 
 /**
- * \fn static void write_uinteger(ObjectWriter *writer, duint uinteger)
- * \brief Write an unsigned integer onto the end of an object writer.
+ * \fn static void write_padding(ObjectWriter *writer, size_t alignment)
+ * \brief Write zeros onto the end of an object writer until its length is a
+ * multiple of an alignment.
  *
- * \param writer The writer to write the integer to.
- * \param uinteger The integer to write.
- */
-static void write_uinteger(ObjectWriter *writer, duint uinteger) {
-    size_t start = writer->len;
-    writer_alloc_end(writer, sizeof(duint));
-    *(duint *)(writer->obj + start) = uinteger;
-}
-
-/**
- * \fn static void write_socket_meta(ObjectWriter *writer,
- *                                   const SocketMeta meta, bool writeName,
- *                                   bool writeDefault)
- * \brief Write socket metadata onto the end of an object writer.
- *
- * \param writer The writer to write the socket to.
- * \param meta The socket metadata to write.
- * \param writeName Do we write the name onto the writer?
- * \param writeDefault Do we write the default value onto the writer?
+ * \param writer The writer to write the padding to.
+ * \param alignment The alignment in bytes.
  */
-static void write_socket_meta(ObjectWriter *writer, const SocketMeta meta,
-                              bool writeName, bool writeDefault) {
-    if (writeName) {
-        write_string(writer, meta.name);
-    }
-    write_string(writer, meta.description);
-    write_byte(writer, meta.type);
-
-    if (writeDefault) {
-        if (meta.type == TYPE_STRING) {
-            write_string(writer, meta.defaultValue.stringValue);
-        } else {
-            write_uinteger(writer, meta.defaultValue.integerValue);
-        }
+static void write_padding(ObjectWriter *writer, size_t alignment) {
+    while (writer->len % alignment != 0) {
+        write_byte(writer, 0);
     }
 }
 
 /**
- * \fn static void write_definition(ObjectWriter *writer,
- *                                  const NodeDefinition def, bool writeName)
- * \brief Write a node definition onto the end of an object writer.
+ * \fn static uint32_t write_strtab(ObjectWriter *strtab, const char *str)
+ * \brief Write a string onto the end of a string table.
+ *
+ * \return The offset of the string in the string table.
  *
- * \param writer The writer to wrire the definition to.
- * \param def The definition to write.
- * \param writeName Do we write the name onto the writer?
+ * \param strtab The writer of the string table.
+ * \param str The string to write. If it is NULL, it is treated as an empty
+ * string.
  */
-static void write_definition(ObjectWriter *writer, const NodeDefinition def,
-                             bool writeName) {
-    if (writeName) {
-        write_string(writer, def.name);
+static uint32_t write_strtab(ObjectWriter *strtab, const char *str) {
+    // Every empty string uses the one at the start of the table.
+    if (str == NULL || *str == '\0') {
+        return 0;
     }
-    write_string(writer, def.description);
-
-    write_uinteger(writer, def.numSockets);
-    write_uinteger(writer, def.startOutputIndex);
 
-    for (size_t i = 0; i < def.numSockets; i++) {
-        const SocketMeta meta = def.sockets[i];
-        write_socket_meta(writer, meta, true, true);
-    }
+    uint32_t offset = (uint32_t)strtab->len;
+    write_string(strtab, str);
+    return offset;
 }
 
 /*
@@ -405,7 +872,8 @@ static void write_definition(ObjectWriter *writer, const NodeDefinition def,
 */
 
 /**
- * \fn static int find_link(LinkMetaList list, const char *name, LinkType type)
+ * \fn static int find_link(LinkMetaList *list, const char *name,
+ *                           LinkType type)
  * \brief Find the index of the link metadata with a given name and type.
  *
  * \return The index of the corresponding link metadata in the list. `-1` if
@@ -415,20 +883,14 @@ static void write_definition(ObjectWriter *writer, const NodeDefinition def,
  * \param name The name to query.
  * \param type The type to query.
  */
-static int find_link(LinkMetaList list, const char *name, LinkType type) {
-    if (list.list == NULL || list.size == 0) {
-        return -1;
-    }
+static int find_link(LinkMetaList *list, const char *name, LinkType type) {
+    LinkMeta *meta = d_link_find_meta(list, type, name);
 
-    for (int i = 0; i < (int)list.size; i++) {
-        LinkMeta meta = list.list[i];
-
-        if (strcmp(name, meta.name) == 0 && type == meta.type) {
-            return i;
-        }
+    if (meta == NULL) {
+        return -1;
     }
 
-    return -1;
+    return (int)(meta - list->list);
 }
 
 /**
@@ -467,6 +929,119 @@ static void free_index_list(IndexList *list) {
     list->length    = 0;
 }
 
+/**
+ * \fn static char *link_meta_ptr(Sheet *sheet, LinkMeta meta)
+ * \brief Get the pointer of some link metadata as it should be saved in an
+ * object file.
+ *
+ * \return The index of the item in the text or data section, or `-1` if the
+ * item is in another sheet.
+ *
+ * \param sheet The sheet the link metadata is in.
+ * \param meta The link metadata.
+ */
+static char *link_meta_ptr(Sheet *sheet, LinkMeta meta) {
+    // If the object is in another sheet, we can't store the pointer as it is
+    // now! We will need to re-calculate it when we run the object after it is
+    // built.
+    if (meta.type == LINK_VARIABLE || meta.type == LINK_VARIABLE_POINTER) {
+        SheetVariable *extVar = (SheetVariable *)meta.meta;
+
+        if (sheet != extVar->sheet) {
+            return (char *)-1;
+        }
+    } else if (meta.type == LINK_FUNCTION) {
+        SheetFunction *extFunc = (SheetFunction *)meta.meta;
+
+        if (sheet != extFunc->sheet) {
+            return (char *)-1;
+        }
+    }
+
+    return meta._ptr;
+}
+
+/**
+ * \fn static bool is_symbol(LinkMeta meta, char *ptr)
+ * \brief Decide if some link metadata should go in the symbol table of an
+ * object file, i.e. it is a function or variable defined in the sheet.
+ *
+ * \return If the link metadata is a symbol.
+ *
+ * \param meta The link metadata.
+ * \param ptr The pointer of the link metadata from `link_meta_ptr`.
+ */
+static bool is_symbol(LinkMeta meta, char *ptr) {
+    if (ptr == (char *)-1) {
+        return false;
+    }
+
+    return meta.type == LINK_VARIABLE || meta.type == LINK_VARIABLE_POINTER ||
+           meta.type == LINK_VARIABLE_STRING_DEFAULT_VALUE ||
+           meta.type == LINK_FUNCTION;
+}
+
+/**
+ * \fn static void write_symtab(ObjectWriter *writer, Sheet *sheet)
+ * \brief Write the symbol table of a sheet, so that loaders can find the
+ * functions and variables it defines without reading everything else.
+ *
+ * \param writer The writer of the `.symtab` section.
+ * \param sheet The sheet to write the symbol table of.
+ */
+static void write_symtab(ObjectWriter *writer, Sheet *sheet) {
+    ObjSymbolTable table = {1, 0};
+
+    for (size_t i = 0; i < sheet->_link.size; i++) {
+        LinkMeta meta = sheet->_link.list[i];
+
+        if (is_symbol(meta, link_meta_ptr(sheet, meta))) {
+            table.numSymbols++;
+        }
+    }
+
+    if (table.numSymbols == 0) {
+        return;
+    }
+
+    // Keep the table at most fully loaded.
+    while (table.numBuckets < table.numSymbols) {
+        table.numBuckets *= 2;
+    }
+
+    uint32_t *buckets  = d_malloc(table.numBuckets * sizeof(uint32_t));
+    ObjSymbol *symbols = d_calloc(table.numSymbols, sizeof(ObjSymbol));
+
+    for (uint32_t i = 0; i < table.numBuckets; i++) {
+        buckets[i] = OBJ_NO_ENTRY;
+    }
+
+    uint32_t numSymbols = 0;
+
+    for (size_t i = 0; i < sheet->_link.size; i++) {
+        LinkMeta meta = sheet->_link.list[i];
+
+        if (is_symbol(meta, link_meta_ptr(sheet, meta))) {
+            ObjSymbol *symbol = symbols + numSymbols;
+            symbol->hash      = hash_name(meta.name);
+            symbol->link      = (uint32_t)i;
+
+            const uint32_t bucket = symbol->hash & (table.numBuckets - 1);
+            symbol->next          = buckets[bucket];
+            buckets[bucket]       = numSymbols++;
+        }
+    }
+
+    write_string_n(writer, (const char *)&table, sizeof(ObjSymbolTable));
+    write_string_n(writer, (const char *)buckets,
+                   table.numBuckets * sizeof(uint32_t));
+    write_string_n(writer, (const char *)symbols,
+                   table.numSymbols * sizeof(ObjSymbol));
+
+    free(buckets);
+    free(symbols);
+}
+
 /**
  * \fn const char *d_obj_generate(Sheet *sheet, size_t *size)
  * \brief Given a sheet has been compiled, create the contents of the sheet's
@@ -474,6 +1049,11 @@ static void free_index_list(IndexList *list) {
  *
  * This function is essentially the reverse of `d_obj_load`.
  *
+ * The object file starts with a header and a table of where each section is.
+ * Every section is aligned to 8 bytes, so the text and data sections can be
+ * used in place, and names are kept in a string table. There is also a hash
+ * table of the symbols the sheet defines, see `d_obj_find_symbol`.
+ *
  * **NOTE:** You cannot compile the sheet if it has any C functions defined in
  * it!
  *
@@ -493,159 +1073,206 @@ const char *d_obj_generate(Sheet *sheet, size_t *size) {
         return NULL;
     }
 
-    // Create the ObjectWriter struct.
-    ObjectWriter writer = {NULL, 0};
-
-#ifdef DECISION_32
-    write_string_n(&writer, "D32", 3);
-#else
-    write_string_n(&writer, "D64", 3);
-#endif // DECISION_32
+    // Each section is written separately, and then put together at the end
+    // once we know how big they all are.
+    ObjectWriter sections[OBJ_NUM_SECTIONS];
+    memset(sections, 0, sizeof(sections));
 
-    // Add the current version of Decision.
-    write_byte(&writer, DECISION_VERSION_MAJOR);
-    write_byte(&writer, DECISION_VERSION_MINOR);
-    write_byte(&writer, DECISION_VERSION_PATCH);
+    ObjectWriter *strtab = sections + OBJ_SECTION_STRTAB;
+    write_byte(strtab, '\0');
 
     // .text
-    // If no bytecode has been compiled, don't bother putting anything here.
-    if (sheet->_textSize > 0) {
-        write_string_n(&writer, ".text", 5);
-        write_uinteger(&writer, sheet->_textSize);
-        write_string_n(&writer, sheet->_text, sheet->_textSize);
-    }
-
-    // .main
-    // If there is no Start function, don't bother putting anything here.
-    if (sheet->_main > 0) {
-        write_string_n(&writer, ".main", 5);
-        write_uinteger(&writer, sheet->_main);
-    }
+    write_string_n(sections + OBJ_SECTION_TEXT, sheet->_text,
+                   sheet->_textSize);
 
     // .data
-    // If there is nothing in the data section, don't bother putting anything
-    // here.
-    if (sheet->_dataSize > 0) {
-        write_string_n(&writer, ".data", 5);
-        write_uinteger(&writer, sheet->_dataSize);
-        write_string_n(&writer, sheet->_data, sheet->_dataSize);
-    }
+    write_string_n(sections + OBJ_SECTION_DATA, sheet->_data,
+                   sheet->_dataSize);
 
     // .lmeta
-    // If there is nothing linkable, don't bother putting anything here.
-    if (sheet->_link.size > 0) {
-        write_string_n(&writer, ".lmeta", 6);
-        write_uinteger(&writer, sheet->_link.size);
+    for (size_t i = 0; i < sheet->_link.size; i++) {
+        LinkMeta lm = sheet->_link.list[i];
 
-        for (size_t i = 0; i < sheet->_link.size; i++) {
-            LinkMeta lm = sheet->_link.list[i];
+        ObjLinkMeta record;
+        memset(&record, 0, sizeof(ObjLinkMeta));
 
-            write_byte(&writer, lm.type);
-            write_string(&writer, lm.name);
+        char *ptr   = link_meta_ptr(sheet, lm);
+        record.name = write_strtab(strtab, lm.name);
+        record.type = (uint8_t)lm.type;
+        record.ptr  = (ptr == (char *)-1) ? OBJ_EXTERNAL_PTR : (size_t)ptr;
 
-            // If the object is in another sheet, we can't store the pointer as
-            // it is now! We will need to re-calculate it when we run the object
-            // after it is built.
-            char *newPtr = lm._ptr;
+        write_string_n(sections + OBJ_SECTION_LMETA, (const char *)&record,
+                       sizeof(ObjLinkMeta));
+    }
 
-            if (lm.type == LINK_VARIABLE || lm.type == LINK_VARIABLE_POINTER) {
-                SheetVariable *extVar = (SheetVariable *)lm.meta;
-                Sheet *extSheet       = extVar->sheet;
+    // .link
+    for (size_t i = 0; i < sheet->_insLinkListSize; i++) {
+        InstructionToLink itl = sheet->_insLinkList[i];
+        ObjInsLink record     = {itl.ins, itl.link};
 
-                if (sheet != extSheet) {
-                    newPtr = (char *)-1;
-                }
-            } else if (lm.type == LINK_FUNCTION) {
-                SheetFunction *extFunc = (SheetFunction *)lm.meta;
-                Sheet *extSheet        = extFunc->sheet;
+        write_string_n(sections + OBJ_SECTION_LINK, (const char *)&record,
+                       sizeof(ObjInsLink));
+    }
 
-                if (sheet != extSheet) {
-                    newPtr = (char *)-1;
-                }
+    // .func and .socket
+    for (size_t i = 0; i < sheet->numFunctions; i++) {
+        const NodeDefinition funcDef = sheet->functions[i].functionDefinition;
+
+        int linkIndex = find_link(&(sheet->_link), funcDef.name, LINK_FUNCTION);
+
+        // TODO: Error if the index is invalid.
+        if (linkIndex < 0) {
+            continue;
+        }
+
+        ObjectWriter *sockets = sections + OBJ_SECTION_SOCKET;
+
+        ObjFunction record;
+        memset(&record, 0, sizeof(ObjFunction));
+
+        record.link             = (uint32_t)linkIndex;
+        record.description      = write_strtab(strtab, funcDef.description);
+        record.numSockets       = (uint32_t)funcDef.numSockets;
+        record.startOutputIndex = (uint32_t)funcDef.startOutputIndex;
+        record.firstSocket      = (uint32_t)(sockets->len / sizeof(ObjSocket));
+
+        for (size_t j = 0; j < funcDef.numSockets; j++) {
+            const SocketMeta meta = funcDef.sockets[j];
+
+            ObjSocket socket;
+            memset(&socket, 0, sizeof(ObjSocket));
+
+            socket.name        = write_strtab(strtab, meta.name);
+            socket.description = write_strtab(strtab, meta.description);
+            socket.type        = (uint8_t)meta.type;
+
+            if (meta.type == TYPE_STRING) {
+                socket.defaultValue =
+                    write_strtab(strtab, meta.defaultValue.stringValue);
+            } else {
+                socket.defaultValue = (duint)meta.defaultValue.integerValue;
             }
 
-            write_uinteger(&writer, (duint)newPtr);
+            write_string_n(sockets, (const char *)&socket, sizeof(ObjSocket));
         }
+
+        write_string_n(sections + OBJ_SECTION_FUNC, (const char *)&record,
+                       sizeof(ObjFunction));
     }
 
-    // .link
-    // If there are no instructions that need to be linked, don't bother putting
-    // anything here.
-    if (sheet->_insLinkListSize > 0) {
-        write_string_n(&writer, ".link", 5);
-        write_uinteger(&writer, sheet->_insLinkListSize);
+    // .var
+    for (size_t i = 0; i < sheet->numVariables; i++) {
+        const SocketMeta varMeta = sheet->variables[i].variableMeta;
+
+        LinkType linkType = LINK_VARIABLE;
+
+        if (varMeta.type == TYPE_STRING) {
+            linkType = LINK_VARIABLE_POINTER;
+        }
 
-        for (size_t i = 0; i < sheet->_insLinkListSize; i++) {
-            InstructionToLink itl = sheet->_insLinkList[i];
+        int linkIndex = find_link(&(sheet->_link), varMeta.name, linkType);
 
-            write_uinteger(&writer, itl.ins);
-            write_uinteger(&writer, itl.link);
+        // TODO: Error if the index is invalid.
+        if (linkIndex < 0) {
+            continue;
         }
+
+        ObjVariable record;
+        memset(&record, 0, sizeof(ObjVariable));
+
+        record.link        = (uint32_t)linkIndex;
+        record.description = write_strtab(strtab, varMeta.description);
+        record.type        = (uint8_t)varMeta.type;
+
+        write_string_n(sections + OBJ_SECTION_VAR, (const char *)&record,
+                       sizeof(ObjVariable));
     }
 
-    // .func
-    // If there are no functions, don't bother putting anything here.
-    if (sheet->numFunctions > 0) {
-        write_string_n(&writer, ".func", 5);
-        write_uinteger(&writer, sheet->numFunctions);
+    // .incl
+    for (size_t i = 0; i < sheet->numIncludes; i++) {
+        Sheet *include   = sheet->includes[i];
+        const char *path = include->filePath;
+
+        if (include->includePath != NULL) {
+            path = include->includePath;
+        }
 
-        for (size_t i = 0; i < sheet->numFunctions; i++) {
-            const NodeDefinition funcDef =
-                sheet->functions[i].functionDefinition;
+        uint32_t offset = write_strtab(strtab, path);
+        write_string_n(sections + OBJ_SECTION_INCL, (const char *)&offset,
+                       sizeof(uint32_t));
+    }
 
-            int linkIndex =
-                find_link(sheet->_link, funcDef.name, LINK_FUNCTION);
+    // .symtab
+    write_symtab(sections + OBJ_SECTION_SYMTAB, sheet);
 
-            // TODO: Error if the index is invalid.
+    // Now put it all together. If a section is empty, don't bother putting
+    // it in.
+    ObjHeader header;
+    memset(&header, 0, sizeof(ObjHeader));
 
-            if (linkIndex >= 0) {
-                write_uinteger(&writer, linkIndex);
-                write_definition(&writer, funcDef, false);
-            }
+#ifdef DECISION_32
+    memcpy(header.magic, "D32", 3);
+#else
+    memcpy(header.magic, "D64", 3);
+#endif // DECISION_32
+
+    header.magic[3]     = OBJ_FORMAT_MARKER;
+    header.format       = OBJ_FORMAT_VERSION;
+    header.versionMajor = DECISION_VERSION_MAJOR;
+    header.versionMinor = DECISION_VERSION_MINOR;
+    header.versionPatch = DECISION_VERSION_PATCH;
+    header.main         = sheet->_main;
+
+    header.callConvention = sheet->_callConvention;
+
+    for (size_t i = 0; i < OBJ_NUM_SECTIONS; i++) {
+        if (sections[i].len > 0) {
+            header.numSections++;
         }
     }
 
-    // .var
-    // If there are no variables, don't bother putting anything here.
-    if (sheet->numVariables > 0) {
-        write_string_n(&writer, ".var", 4);
-        write_uinteger(&writer, sheet->numVariables);
+    ObjectWriter writer = {NULL, 0, 0};
+    write_string_n(&writer, (const char *)&header, sizeof(ObjHeader));
 
-        for (size_t i = 0; i < sheet->numVariables; i++) {
-            const SocketMeta varMeta = sheet->variables[i].variableMeta;
+    // Leave space for the section table, and fill it in as we go.
+    const size_t tableStart = writer.len;
+    writer_alloc_end(&writer, header.numSections * sizeof(ObjSectionEntry));
 
-            LinkType linkType = LINK_VARIABLE;
+    size_t entryIndex = 0;
 
-            if (varMeta.type == TYPE_STRING) {
-                linkType = LINK_VARIABLE_POINTER;
-            }
+    for (size_t i = 0; i < OBJ_NUM_SECTIONS; i++) {
+        if (sections[i].len == 0) {
+            continue;
+        }
 
-            int linkIndex = find_link(sheet->_link, varMeta.name, linkType);
+        write_padding(&writer, OBJ_SECTION_ALIGNMENT);
 
-            // TODO: Error if the index is invalid.
+        ObjSectionEntry entry;
+        memset(&entry, 0, sizeof(ObjSectionEntry));
 
-            if (linkIndex >= 0) {
-                write_uinteger(&writer, linkIndex);
-                write_socket_meta(&writer, varMeta, false, false);
-            }
+        // Leave room for the terminator, so the name can be compared as a
+        // string when the object file is loaded.
+        size_t nameLen = strlen(OBJ_SECTION_NAMES[i]);
+        if (nameLen >= OBJ_SECTION_NAME_SIZE) {
+            nameLen = OBJ_SECTION_NAME_SIZE - 1;
         }
-    }
+        memcpy(entry.name, OBJ_SECTION_NAMES[i], nameLen);
+        entry.name[nameLen] = '\0';
 
-    // .incl
-    // If there are no included sheets, don't bother putting anything here.
-    if (sheet->numIncludes > 0) {
-        write_string_n(&writer, ".incl", 5);
-        write_uinteger(&writer, sheet->numIncludes);
+        entry.offset    = writer.len;
+        entry.size      = sections[i].len;
+        entry.alignment = OBJ_SECTION_ALIGNMENT;
 
-        for (size_t i = 0; i < sheet->numIncludes; i++) {
-            Sheet *include   = sheet->includes[i];
-            const char *path = include->filePath;
+        write_string_n(&writer, sections[i].obj, sections[i].len);
 
-            if (include->includePath != NULL) {
-                path = include->includePath;
-            }
+        memcpy(writer.obj + tableStart + entryIndex * sizeof(ObjSectionEntry),
+               &entry, sizeof(ObjSectionEntry));
+        entryIndex++;
+    }
 
-            write_string(&writer, path);
+    for (size_t i = 0; i < OBJ_NUM_SECTIONS; i++) {
+        if (sections[i].obj != NULL) {
+            free(sections[i].obj);
         }
     }
 
@@ -654,104 +1281,184 @@ const char *d_obj_generate(Sheet *sheet, size_t *size) {
 }
 
 /**
- * \fn Sheet *d_obj_load(const char *obj, size_t size, const char *filePath,
- *                       Sheet **includes, Sheet **priors)
- * \brief Given a binary object string, create a malloc'd Sheet structure from
- * it.
+ * \fn static void add_loaded_function(Sheet *out, size_t metaLinkIndex,
+ *                                     NodeDefinition funcDef,
+ *                                     IndexList *funcMetaIndexList)
+ * \brief Add a function that was loaded from an object file to a sheet.
  *
- * This function is essentially the reverse of `d_obj_generate`.
- *
- * \return The malloc'd sheet generated from the object string.
- *
- * \param obj The object string.
- * \param size The size of the object string.
- * \param filePath Where the object file the object string came from is located.
- * \param includes A NULL-terminated list of initially included sheets.
- * Can be NULL.
- * \param priors A NULL-terminates list of sheets that, if included, will throw
- * an error. Can be NULL.
+ * \param out The sheet to add the function to.
+ * \param metaLinkIndex The index of the function's link metadata.
+ * \param funcDef The definition of the function, without a name.
+ * \param funcMetaIndexList The list of the link metadata indexes of the
+ * functions loaded so far, which the index is added to.
  */
-Sheet *d_obj_load(const char *obj, size_t size, const char *filePath,
-                  Sheet **includes, Sheet **priors) {
-    Sheet *out       = d_sheet_create(filePath);
-    out->_isCompiled = true;
+static void add_loaded_function(Sheet *out, size_t metaLinkIndex,
+                                NodeDefinition funcDef,
+                                IndexList *funcMetaIndexList) {
+    // The function shares its name with its link metadata.
+    funcDef.name = out->_link.list[metaLinkIndex].name;
 
-    if (includes != NULL) {
-        Sheet **include = includes;
+    // Add the function to the sheet.
+    d_sheet_add_function(out, funcDef);
 
-        while (*include) {
-            d_sheet_add_include(out, *include);
-            include++;
+    // Add the LinkMetaList index to the dynamic array we are creating.
+    push_index(funcMetaIndexList, metaLinkIndex);
+}
+
+/**
+ * \fn static void add_loaded_variable(Sheet *out, size_t metaLinkIndex,
+ *                                     SocketMeta varMeta,
+ *                                     const char *defaultString,
+ *                                     IndexList *varMetaIndexList)
+ * \brief Add a variable that was loaded from an object file to a sheet.
+ *
+ * \param out The sheet to add the variable to.
+ * \param metaLinkIndex The index of the variable's link metadata.
+ * \param varMeta The metadata of the variable, without a name or default
+ * value.
+ * \param defaultString If the variable is a string, its default value in the
+ * data section, which is copied. Can be NULL.
+ * \param varMetaIndexList The list of the link metadata indexes of the
+ * variables loaded so far, which the index is added to.
+ */
+static void add_loaded_variable(Sheet *out, size_t metaLinkIndex,
+                                SocketMeta varMeta, const char *defaultString,
+                                IndexList *varMetaIndexList) {
+    LinkMeta varLinkMeta = out->_link.list[metaLinkIndex];
+
+    // The variable shares its name with its link metadata.
+    varMeta.name = varLinkMeta.name;
+
+    // Reference the default value from the data section.
+    char *ptr = out->_data + (size_t)varLinkMeta._ptr;
+
+    if (varMeta.type == TYPE_BOOL) {
+        varMeta.defaultValue.integerValue = *ptr;
+    } else if (varMeta.type == TYPE_STRING) {
+        if (defaultString != NULL) {
+            size_t valLen = strlen(defaultString) + 1;
+            char *val     = d_calloc(valLen, sizeof(char));
+            strcpy(val, defaultString);
+
+            varMeta.defaultValue.stringValue = val;
+        } else {
+            varMeta.defaultValue.stringValue = NULL;
         }
+    } else {
+        varMeta.defaultValue.integerValue = *(dint *)ptr;
     }
 
-    // TODO: Account for edianness in the instructions, and also for variables
-    // in the data section.
+    // Add the variable to the sheet.
+    d_sheet_add_variable(out, varMeta);
 
-    ObjectReader reader        = {NULL, 0, 0, false};
-    reader.obj                 = obj;
-    *(size_t *)(&(reader.len)) = size;
+    // Add the LinkMetaList index to the dynamic array we are creating.
+    push_index(varMetaIndexList, metaLinkIndex);
+}
 
-    if (!reader_test_string_n(&reader, "D", 1)) {
-        printf("%s cannot be loaded: object file is not a valid object file.\n",
-               filePath);
-        out->hasErrors = true;
-        return out;
-    }
+/**
+ * \fn static void point_to_functions(Sheet *out, IndexList *funcMetaIndexList)
+ * \brief Once all of the functions of a sheet have been loaded, point their
+ * link metadata to them.
+ *
+ * We can only do this once the array of functions has been fully created, as
+ * reallocing *may* move the address of the array.
+ *
+ * \param out The sheet the functions were loaded into.
+ * \param funcMetaIndexList The link metadata indexes of the functions, in the
+ * order they were loaded. It is freed.
+ */
+static void point_to_functions(Sheet *out, IndexList *funcMetaIndexList) {
+    for (size_t i = 0; i < funcMetaIndexList->length; i++) {
+        size_t funcMetaIndex = funcMetaIndexList->indexList[i];
 
-// We need to check if sizeof(dint) is the same as it is in the object.
-#ifdef DECISION_32
-    if (!reader_test_string_n(&reader, "32", 2)) {
-        printf("%s cannot be loaded: object file is not 32-bit.\n", filePath);
-        out->hasErrors = true;
-        return out;
+        // NOTE: This assumes there were no functions in the sheet
+        // beforehand.
+        out->_link.list[funcMetaIndex].meta = (void *)(out->functions + i);
     }
-#else
-    if (!reader_test_string_n(&reader, "64", 2)) {
-        printf("%s cannot be loaded: object file is not 64-bit.\n", filePath);
-        out->hasErrors = true;
-        return out;
-    }
-#endif // DECISION_32
 
-    // Load this object file's Decision version.
-    short major = read_byte(&reader);
-    short minor = read_byte(&reader);
-    short patch = read_byte(&reader);
+    free_index_list(funcMetaIndexList);
+}
 
-    // Is this version in the past or in the future?
-    short cmp = 0;
+/**
+ * \fn static void point_to_variables(Sheet *out, IndexList *varMetaIndexList)
+ * \brief Once all of the variables of a sheet have been loaded, point their
+ * link metadata to them.
+ *
+ * We can only do this once the array of variables has been fully created, as
+ * reallocing *may* move the address of the array.
+ *
+ * \param out The sheet the variables were loaded into.
+ * \param varMetaIndexList The link metadata indexes of the variables, in the
+ * order they were loaded. It is freed.
+ */
+static void point_to_variables(Sheet *out, IndexList *varMetaIndexList) {
+    for (size_t i = 0; i < varMetaIndexList->length; i++) {
+        size_t varMetaIndex = varMetaIndexList->indexList[i];
 
-    if (major > DECISION_VERSION_MAJOR) {
-        cmp = 1;
-    } else if (major < DECISION_VERSION_MAJOR) {
-        cmp = -1;
-    } else {
-        if (minor > DECISION_VERSION_MINOR) {
-            cmp = 1;
-        } else if (minor < DECISION_VERSION_MINOR) {
-            cmp = -1;
-        } else {
-            if (patch > DECISION_VERSION_PATCH) {
-                cmp = 1;
-            } else if (patch < DECISION_VERSION_PATCH) {
-                cmp = -1;
+        // NOTE: This assumes there were no variables in the sheet
+        // beforehand.
+        out->_link.list[varMetaIndex].meta = (void *)(out->variables + i);
+    }
+
+    free_index_list(varMetaIndexList);
+}
+
+/**
+ * \fn static void add_loaded_include(Sheet *out, const char *path,
+ *                                    Sheet **includes, Sheet **priors)
+ * \brief Include a sheet that an object file says it includes, unless it was
+ * already in the list of initial includes.
+ *
+ * \param out The sheet to include the sheet in.
+ * \param path The include path of the sheet.
+ * \param includes A NULL-terminated list of initially included sheets.
+ * Can be NULL.
+ * \param priors A NULL-terminates list of sheets that, if included, will throw
+ * an error. Can be NULL.
+ */
+static void add_loaded_include(Sheet *out, const char *path, Sheet **includes,
+                               Sheet **priors) {
+    // Check that it wasn't in the includes list!
+    if (includes != NULL) {
+        for (Sheet **test = includes; *test; test++) {
+            if (strcmp(path, (*test)->filePath) == 0) {
+                return;
             }
         }
     }
 
-    // If the object file was written in the future, warn the user that things
-    // are very likely going to break.
-    if (cmp > 0) {
-        printf("Warning: %s was compiled with a future version of Decision "
-               "(%hhi.%hhi.%hhi)\n",
-               filePath, major, minor, patch);
+    Sheet *include = d_sheet_add_include_from_path(out, path, priors, false);
+
+    if (include->hasErrors) {
+        ERROR_COMPILER(out->filePath, 0, true,
+                       "Included sheet %s produced errors", include->filePath);
     }
+}
 
+/**
+ * \fn static void load_stream(ObjectReader *reader, Sheet *out,
+ *                             Sheet **includes, Sheet **priors,
+ *                             char *mapping)
+ * \brief Load the sections of an object file written in the original format,
+ * where the sections are one after another, and have to be read in order.
+ *
+ * \param reader The reader to read from, after the version of Decision.
+ * \param out The sheet to load the sections into.
+ * \param includes A NULL-terminated list of initially included sheets.
+ * Can be NULL.
+ * \param priors A NULL-terminates list of sheets that, if included, will throw
+ * an error. Can be NULL.
+ * \param mapping The mapped object file, or `NULL` if it isn't mapped.
+ */
+static void load_stream(ObjectReader *reader, Sheet *out, Sheet **includes,
+                        Sheet **priors, char *mapping) {
     // .text
-    if (reader_test_string_n(&reader, ".text", 5)) {
-        size_t textSize = read_uinteger(&reader);
-        char *text      = read_string_n(&reader, textSize);
+    if (reader_test_string_n(reader, ".text", 5)) {
+        size_t textSize = read_uinteger(reader);
+
+        // Instructions are read byte by byte, or unaligned, so the text
+        // section doesn't need to be aligned.
+        char *text = read_section(reader, textSize, mapping, false);
 
         out->_text     = text;
         out->_textSize = textSize;
@@ -761,16 +1468,16 @@ Sheet *d_obj_load(const char *obj, size_t size, const char *filePath,
     }
 
     // .main
-    if (reader_test_string_n(&reader, ".main", 5)) {
-        out->_main = read_uinteger(&reader);
+    if (reader_test_string_n(reader, ".main", 5)) {
+        out->_main = read_uinteger(reader);
     } else {
         out->_main = 0;
     }
 
     // .data
-    if (reader_test_string_n(&reader, ".data", 5)) {
-        size_t dataSize = read_uinteger(&reader);
-        char *data      = read_string_n(&reader, dataSize);
+    if (reader_test_string_n(reader, ".data", 5)) {
+        size_t dataSize = read_uinteger(reader);
+        char *data      = read_section(reader, dataSize, mapping, true);
 
         out->_data     = data;
         out->_dataSize = dataSize;
@@ -780,15 +1487,15 @@ Sheet *d_obj_load(const char *obj, size_t size, const char *filePath,
     }
 
     // .lmeta
-    if (reader_test_string_n(&reader, ".lmeta", 6)) {
-        size_t numMeta = read_uinteger(&reader);
+    if (reader_test_string_n(reader, ".lmeta", 6)) {
+        size_t numMeta = read_uinteger(reader);
 
         for (size_t i = 0; i < numMeta; i++) {
             LinkMeta meta;
 
-            meta.type = read_byte(&reader);
-            meta.name = read_string(&reader);
-            meta._ptr = (char *)read_uinteger(&reader);
+            meta.type = read_byte(reader);
+            meta.name = read_name(reader);
+            meta._ptr = (char *)read_uinteger(reader);
 
             // If the metadata isn't in our sheet, then we don't know where it
             // is at all. This will need to be found out at link time.
@@ -804,8 +1511,8 @@ Sheet *d_obj_load(const char *obj, size_t size, const char *filePath,
     }
 
     // .link
-    if (reader_test_string_n(&reader, ".link", 5)) {
-        size_t numLinks = read_uinteger(&reader);
+    if (reader_test_string_n(reader, ".link", 5)) {
+        size_t numLinks = read_uinteger(reader);
 
         out->_insLinkList     = d_calloc(numLinks, sizeof(InstructionToLink));
         out->_insLinkListSize = numLinks;
@@ -813,8 +1520,8 @@ Sheet *d_obj_load(const char *obj, size_t size, const char *filePath,
         for (size_t i = 0; i < numLinks; i++) {
             InstructionToLink itl;
 
-            itl.ins  = read_uinteger(&reader);
-            itl.link = read_uinteger(&reader);
+            itl.ins  = read_uinteger(reader);
+            itl.link = read_uinteger(reader);
 
             out->_insLinkList[i] = itl;
         }
@@ -824,175 +1531,473 @@ Sheet *d_obj_load(const char *obj, size_t size, const char *filePath,
     }
 
     // .func
-    if (reader_test_string_n(&reader, ".func", 5)) {
-        size_t numFunctions = read_uinteger(&reader);
+    if (reader_test_string_n(reader, ".func", 5)) {
+        size_t numFunctions = read_uinteger(reader);
 
-        // We need to make sure that the entries in the LinkMetaList of the
-        // sheet point to these SheetFunctions we are about to make. But we can
-        // only link them once we've created the array of functions fully, as
-        // reallocing *may* move the address of the array.
         IndexList funcMetaIndexList = {NULL, 0};
 
         for (size_t i = 0; i < numFunctions; i++) {
             // TODO: Error if the index is out of bounds.
-            size_t metaLinkIndex = read_uinteger(&reader);
+            size_t metaLinkIndex = read_uinteger(reader);
 
-            // Copy the name of the function from the link meta list.
-            const char *name = out->_link.list[metaLinkIndex].name;
-            size_t nameSize  = strlen(name) + 1;
-            char *newName    = d_calloc(nameSize, sizeof(char));
-            strcpy(newName, name);
-
-            NodeDefinition funcDef = read_definition(&reader, false);
-            funcDef.name           = newName;
-
-            // Add the function to the sheet.
-            d_sheet_add_function(out, funcDef);
-
-            // Add the LinkMetaList index to the dynamic array we are creating.
-            push_index(&funcMetaIndexList, metaLinkIndex);
+            NodeDefinition funcDef = read_definition(reader, false);
+            add_loaded_function(out, metaLinkIndex, funcDef,
+                                &funcMetaIndexList);
         }
 
-        // Now the function array has been fully created, we can now safely
-        // point to the functions.
-        for (size_t i = 0; i < funcMetaIndexList.length; i++) {
-            size_t funcMetaIndex = funcMetaIndexList.indexList[i];
-
-            // NOTE: This assumes there were no functions in the sheet
-            // beforehand.
-            out->_link.list[funcMetaIndex].meta = (void *)(out->functions + i);
-        }
-
-        free_index_list(&funcMetaIndexList);
+        point_to_functions(out, &funcMetaIndexList);
     } else {
         out->functions    = NULL;
         out->numFunctions = 0;
     }
 
     // .var
-    if (reader_test_string_n(&reader, ".var", 4)) {
-        size_t numVars = read_uinteger(&reader);
+    if (reader_test_string_n(reader, ".var", 4)) {
+        size_t numVars = read_uinteger(reader);
 
-        // We need to make sure that the entries in the LinkMetaList of the
-        // sheet point to these SheetVariables we are about to make. But we can
-        // only link them once we've created the array of variables fully, as
-        // reallocing *may* move the address of the array.
         IndexList varMetaIndexList = {NULL, 0};
 
         for (size_t i = 0; i < numVars; i++) {
             // TODO: Error if the index is out of bounds.
-            size_t metaLinkIndex = read_uinteger(&reader);
-
-            SocketMeta varMeta = read_socket_meta(&reader, false, false);
+            size_t metaLinkIndex = read_uinteger(reader);
 
-            LinkMeta varLinkMeta = out->_link.list[metaLinkIndex];
+            SocketMeta varMeta = read_socket_meta(reader, false, false);
 
-            // Copy the name of the function from the link meta list.
-            size_t nameSize = strlen(varLinkMeta.name) + 1;
-            char *name      = d_calloc(nameSize, sizeof(char));
-            strcpy(name, varLinkMeta.name);
-            varMeta.name = name;
+            // If it's a string, the default value will be somewhere else in
+            // the data section. We just need to find out where.
+            const char *defaultString = NULL;
 
-            // Reference the default value from the data section.
-            char *ptr = out->_data + (size_t)varLinkMeta._ptr;
-
-            if (varMeta.type == TYPE_BOOL) {
-                varMeta.defaultValue.integerValue = *ptr;
-            } else if (varMeta.type == TYPE_STRING) {
-                // If it's a string, the default value will be somewhere else
-                // in the data section. We just need to find out where.
-                // Once we find it, we will need to copy it.
-                LinkMeta valMeta  = (LinkMeta){NULL, NULL, NULL, 0};
-                bool valMetaFound = false;
+            if (varMeta.type == TYPE_STRING) {
+                const char *name = out->_link.list[metaLinkIndex].name;
 
                 for (size_t j = 0; j < out->_link.size; j++) {
                     LinkMeta testMeta = out->_link.list[j];
 
-                    if (testMeta.type == LINK_VARIABLE_STRING_DEFAULT_VALUE && strcmp(testMeta.name, varMeta.name) == 0) {
-                        valMeta = testMeta;
-                        valMetaFound = true;
+                    if (testMeta.type == LINK_VARIABLE_STRING_DEFAULT_VALUE &&
+                        testMeta.name == name) {
+                        defaultString = out->_data + (size_t)testMeta._ptr;
                         break;
                     }
                 }
-
-                if (valMetaFound) {
-                    ptr = out->_data + (size_t)valMeta._ptr;
-                    size_t valLen = strlen(ptr) + 1;
-                    char *val = d_calloc(valLen, sizeof(char));
-                    strcpy(val, ptr);
-
-                    varMeta.defaultValue.stringValue = val;
-                } else {
-                    varMeta.defaultValue.stringValue = NULL;   
-                }
-            } else {
-                varMeta.defaultValue.integerValue = *(dint *)ptr;
             }
 
-            // Add the variable to the sheet.
-            d_sheet_add_variable(out, varMeta);
-
-            // Add the LinkMetaList index to the dynamic array we are creating.
-            push_index(&varMetaIndexList, metaLinkIndex);
+            add_loaded_variable(out, metaLinkIndex, varMeta, defaultString,
+                                &varMetaIndexList);
         }
 
-        // Now the variable array has been fully created, we can now safely
-        // point to the variables.
-        for (size_t i = 0; i < varMetaIndexList.length; i++) {
-            size_t funcMetaIndex = varMetaIndexList.indexList[i];
-
-            // NOTE: This assumes there were no variables in the sheet
-            // beforehand.
-            out->_link.list[funcMetaIndex].meta = (void *)(out->variables + i);
-        }
-
-        free_index_list(&varMetaIndexList);
+        point_to_variables(out, &varMetaIndexList);
     } else {
         out->variables    = NULL;
         out->numVariables = 0;
     }
 
     // .incl
-    if (reader_test_string_n(&reader, ".incl", 5)) {
-        size_t numIncludes = read_uinteger(&reader);
+    if (reader_test_string_n(reader, ".incl", 5)) {
+        size_t numIncludes = read_uinteger(reader);
 
         for (size_t i = 0; i < numIncludes; i++) {
-            const char *path = read_string(&reader);
+            const char *path = read_string(reader);
 
-            // Check that it wasn't in the includes list!
-            Sheet **test    = includes;
-            bool inIncludes = false;
+            add_loaded_include(out, path, includes, priors);
 
-            if (includes != NULL) {
-                while (*test) {
-                    Sheet *testInclude = *test;
-                    if (strcmp(path, testInclude->filePath) == 0) {
-                        inIncludes = true;
-                        break;
-                    }
+            // When the file path enters the sheet, it is copied, so we can
+            // safely free our copy here.
+            free((char *)path);
+        }
+    } else {
+        out->includes    = NULL;
+        out->numIncludes = 0;
+    }
+}
 
-                    test++;
-                }
+/**
+ * \fn static void load_sections(ObjectReader *reader, Sheet *out,
+ *                               const ObjSectionEntry *sections,
+ *                               Sheet **includes, Sheet **priors,
+ *                               char *mapping)
+ * \brief Load the sections of an object file written in the versioned
+ * format, using its section table.
+ *
+ * \param reader The reader to read from.
+ * \param out The sheet to load the sections into.
+ * \param sections The section table of the object file.
+ * \param includes A NULL-terminated list of initially included sheets.
+ * Can be NULL.
+ * \param priors A NULL-terminates list of sheets that, if included, will throw
+ * an error. Can be NULL.
+ * \param mapping The mapped object file, or `NULL` if it isn't mapped.
+ */
+static void load_sections(ObjectReader *reader, Sheet *out,
+                          const ObjSectionEntry *sections, Sheet **includes,
+                          Sheet **priors, char *mapping) {
+    const ObjSectionEntry *strtab = sections + OBJ_SECTION_STRTAB;
+
+    // .text and .data
+    // Since the sections are aligned, if the object file is mapped, they can
+    // both be used in place.
+    if (sections[OBJ_SECTION_TEXT].size > 0) {
+        reader->ptr    = sections[OBJ_SECTION_TEXT].offset;
+        out->_textSize = sections[OBJ_SECTION_TEXT].size;
+        out->_text     = read_section(reader, out->_textSize, mapping, false);
+    }
+
+    if (sections[OBJ_SECTION_DATA].size > 0) {
+        reader->ptr    = sections[OBJ_SECTION_DATA].offset;
+        out->_dataSize = sections[OBJ_SECTION_DATA].size;
+        out->_data     = read_section(reader, out->_dataSize, mapping, true);
+    }
+
+    // .lmeta
+    const size_t numMeta = sections[OBJ_SECTION_LMETA].size / sizeof(ObjLinkMeta);
+
+    for (size_t i = 0; i < numMeta; i++) {
+        ObjLinkMeta record;
+        read_record(reader, sections + OBJ_SECTION_LMETA, i, &record,
+                    sizeof(ObjLinkMeta));
+
+        const char *name = strtab_get(reader, strtab, record.name);
+        LinkMeta meta    = d_link_new_meta((LinkType)record.type, name, NULL);
+
+        // If the metadata isn't in our sheet, then we don't know where it is
+        // at all. This will need to be found out at link time.
+        if (record.ptr == OBJ_EXTERNAL_PTR) {
+            meta.meta = (void *)-1;
+        } else {
+            meta._ptr = (char *)(size_t)record.ptr;
+
+            // Make sure it doesn't point outside of the sheet.
+            size_t sectionSize = (record.type == LINK_FUNCTION)
+                                     ? out->_textSize
+                                     : out->_dataSize;
+
+            if (record.type != LINK_CFUNCTION && record.ptr >= sectionSize) {
+                reader->error = true;
             }
+        }
+
+        if (record.type > LINK_CFUNCTION) {
+            reader->error = true;
+        }
 
-            if (!inIncludes) {
-                Sheet *include =
-                    d_sheet_add_include_from_path(out, path, priors, false);
+        d_link_meta_list_push(&(out->_link), meta);
+    }
+
+    // .link
+    const size_t numLinks = sections[OBJ_SECTION_LINK].size / sizeof(ObjInsLink);
+
+    if (numLinks > 0) {
+        out->_insLinkList     = d_calloc(numLinks, sizeof(InstructionToLink));
+        out->_insLinkListSize = numLinks;
+
+        for (size_t i = 0; i < numLinks; i++) {
+            ObjInsLink record;
+            read_record(reader, sections + OBJ_SECTION_LINK, i, &record,
+                        sizeof(ObjInsLink));
+
+            if (record.ins >= out->_textSize || record.link >= numMeta) {
+                reader->error = true;
+            }
+
+            out->_insLinkList[i].ins  = (size_t)record.ins;
+            out->_insLinkList[i].link = (size_t)record.link;
+        }
+    }
+
+    // If anything so far was out of bounds, the rest of the object can't be
+    // trusted.
+    if (reader->error) {
+        return;
+    }
 
-                if (include->hasErrors) {
-                    ERROR_COMPILER(out->filePath, 0, true,
-                                   "Included sheet %s produced errors",
-                                   include->filePath);
+    // .func
+    const size_t numFunctions =
+        sections[OBJ_SECTION_FUNC].size / sizeof(ObjFunction);
+
+    IndexList funcMetaIndexList = {NULL, 0};
+
+    for (size_t i = 0; i < numFunctions; i++) {
+        ObjFunction record;
+        read_record(reader, sections + OBJ_SECTION_FUNC, i, &record,
+                    sizeof(ObjFunction));
+
+        const size_t numSockets =
+            sections[OBJ_SECTION_SOCKET].size / sizeof(ObjSocket);
+
+        if (record.link >= numMeta || record.firstSocket > numSockets ||
+            record.numSockets > numSockets - record.firstSocket ||
+            record.startOutputIndex > record.numSockets) {
+            reader->error = true;
+            break;
+        }
+
+        NodeDefinition funcDef = {NULL, NULL, NULL, 0, 0, false};
+
+        funcDef.description      = strtab_copy(reader, strtab, record.description);
+        funcDef.numSockets       = record.numSockets;
+        funcDef.startOutputIndex = record.startOutputIndex;
+
+        SocketMeta *sockets = d_calloc(funcDef.numSockets, sizeof(SocketMeta));
+
+        for (size_t j = 0; j < funcDef.numSockets; j++) {
+            ObjSocket socket;
+            read_record(reader, sections + OBJ_SECTION_SOCKET,
+                        (size_t)record.firstSocket + j, &socket,
+                        sizeof(ObjSocket));
+
+            const char *name = strtab_get(reader, strtab, socket.name);
+
+            SocketMeta meta  = {NULL, NULL, TYPE_NONE, {0}};
+            meta.name        = d_intern(name);
+            meta.description = strtab_copy(reader, strtab, socket.description);
+            meta.type        = (DType)socket.type;
+
+            if (meta.type == TYPE_STRING) {
+                meta.defaultValue.stringValue = strtab_copy(
+                    reader, strtab, (uint32_t)socket.defaultValue);
+            } else {
+                meta.defaultValue.integerValue = (dint)socket.defaultValue;
+            }
+
+            sockets[j] = meta;
+        }
+
+        *(SocketMeta **)(&(funcDef.sockets)) = sockets;
+
+        add_loaded_function(out, record.link, funcDef, &funcMetaIndexList);
+    }
+
+    point_to_functions(out, &funcMetaIndexList);
+
+    // .var
+    const size_t numVars = sections[OBJ_SECTION_VAR].size / sizeof(ObjVariable);
+
+    IndexList varMetaIndexList = {NULL, 0};
+
+    for (size_t i = 0; i < numVars; i++) {
+        ObjVariable record;
+        read_record(reader, sections + OBJ_SECTION_VAR, i, &record,
+                    sizeof(ObjVariable));
+
+        // The value of the variable needs to be inside the data section.
+        size_t varSize = (record.type == TYPE_BOOL) ? 1 : sizeof(dint);
+
+        if (record.link >= numMeta ||
+            out->_link.list[record.link]._ptr == (char *)-1 ||
+            (size_t)out->_link.list[record.link]._ptr + varSize >
+                out->_dataSize) {
+            reader->error = true;
+            break;
+        }
+
+        SocketMeta varMeta  = {NULL, NULL, TYPE_NONE, {0}};
+        varMeta.description = strtab_copy(reader, strtab, record.description);
+        varMeta.type        = (DType)record.type;
+
+        // If it's a string, the default value will be somewhere else in the
+        // data section. The link metadata has already been loaded with
+        // interned names, so it can be found without going back to the
+        // symbol table and comparing strings.
+        const char *defaultString = NULL;
+
+        if (varMeta.type == TYPE_STRING) {
+            const char *name = out->_link.list[record.link].name;
+
+            LinkMeta *valMeta = d_link_find_meta(
+                &(out->_link), LINK_VARIABLE_STRING_DEFAULT_VALUE, name);
+
+            if (valMeta != NULL && valMeta->_ptr != (char *)-1) {
+                size_t valPtr = (size_t)valMeta->_ptr;
+
+                if (memchr(out->_data + valPtr, '\0',
+                           out->_dataSize - valPtr) != NULL) {
+                    defaultString = out->_data + valPtr;
+                } else {
+                    reader->error = true;
                 }
             }
+        }
 
-            // When the file path enters the sheet, it is copied, so we can
-            // safely free our copy here.
-            free((char *)path);
+        add_loaded_variable(out, record.link, varMeta, defaultString,
+                            &varMetaIndexList);
+    }
+
+    point_to_variables(out, &varMetaIndexList);
+
+    // .incl
+    const size_t numIncludes = sections[OBJ_SECTION_INCL].size / sizeof(uint32_t);
+
+    for (size_t i = 0; i < numIncludes && !reader->error; i++) {
+        uint32_t offset;
+        read_record(reader, sections + OBJ_SECTION_INCL, i, &offset,
+                    sizeof(uint32_t));
+
+        add_loaded_include(out, strtab_get(reader, strtab, offset), includes,
+                           priors);
+    }
+}
+
+/**
+ * \fn static Sheet *load_sheet(const char *obj, size_t size,
+ *                              const char *filePath, Sheet **includes,
+ *                              Sheet **priors, char *mapping)
+ * \brief Given a binary object string, create a malloc'd Sheet structure from
+ * it.
+ *
+ * \return The malloc'd sheet generated from the object string.
+ *
+ * \param obj The object string.
+ * \param size The size of the object string.
+ * \param filePath Where the object file the object string came from is located.
+ * \param includes A NULL-terminated list of initially included sheets.
+ * Can be NULL.
+ * \param priors A NULL-terminates list of sheets that, if included, will throw
+ * an error. Can be NULL.
+ * \param mapping If not `NULL`, `obj` is a file mapped by `d_map_file`, which
+ * the sheet takes ownership of. The text and data sections then point into the
+ * mapping where they can.
+ */
+static Sheet *load_sheet(const char *obj, size_t size, const char *filePath,
+                         Sheet **includes, Sheet **priors, char *mapping) {
+    Sheet *out       = d_sheet_create(filePath);
+    out->_isCompiled = true;
+
+    if (mapping != NULL) {
+        out->_mapping     = mapping;
+        out->_mappingSize = size;
+    }
+
+    if (includes != NULL) {
+        Sheet **include = includes;
+
+        while (*include) {
+            d_sheet_add_include(out, *include);
+            include++;
+        }
+    }
+
+    // TODO: Account for edianness in the instructions, and also for variables
+    // in the data section.
+
+    ObjectReader reader        = {NULL, 0, 0, false};
+    reader.obj                 = obj;
+    *(size_t *)(&(reader.len)) = size;
+
+    if (!reader_test_string_n(&reader, "D", 1)) {
+        printf("%s cannot be loaded: object file is not a valid object file.\n",
+               filePath);
+        out->hasErrors = true;
+        return out;
+    }
+
+// We need to check if sizeof(dint) is the same as it is in the object.
+#ifdef DECISION_32
+    if (!reader_test_string_n(&reader, "32", 2)) {
+        printf("%s cannot be loaded: object file is not 32-bit.\n", filePath);
+        out->hasErrors = true;
+        return out;
+    }
+#else
+    if (!reader_test_string_n(&reader, "64", 2)) {
+        printf("%s cannot be loaded: object file is not 64-bit.\n", filePath);
+        out->hasErrors = true;
+        return out;
+    }
+#endif // DECISION_32
+
+    // Newer object files have a header with a section table, whereas older
+    // ones go straight into the version of Decision.
+    const char marker = OBJ_FORMAT_MARKER;
+    const bool hasSectionTable = reader_test_string_n(&reader, &marker, 1);
+
+    ObjHeader header;
+    ObjSectionEntry sections[OBJ_NUM_SECTIONS];
+
+    short major, minor, patch;
+
+    if (hasSectionTable) {
+        reader.ptr = 0;
+
+        if (!read_section_table(&reader, &header, sections)) {
+            printf("%s cannot be loaded: object file is not a valid object "
+                   "file.\n",
+                   filePath);
+            out->hasErrors = true;
+            return out;
+        }
+
+        if (header.format > OBJ_FORMAT_VERSION) {
+            printf("%s cannot be loaded: object file format %hu is newer than "
+                   "this version of Decision supports.\n",
+                   filePath, header.format);
+            out->hasErrors = true;
+            return out;
         }
+
+        major = header.versionMajor;
+        minor = header.versionMinor;
+        patch = header.versionPatch;
+
+        out->_callConvention = (header.format >= OBJ_FORMAT_CALL_CONVENTION)
+                                   ? header.callConvention
+                                   : 1;
     } else {
-        out->includes    = NULL;
-        out->numIncludes = 0;
+        // Load this object file's Decision version.
+        major = read_byte(&reader);
+        minor = read_byte(&reader);
+        patch = read_byte(&reader);
+
+        // These were written before callers reserved space for the frame.
+        out->_callConvention = 0;
+    }
+
+    if (out->_callConvention > VM_CALL_CONVENTION) {
+        printf("%s cannot be loaded: object file uses calling convention %hhu, "
+               "which is newer than this version of Decision supports.\n",
+               filePath, out->_callConvention);
+        out->hasErrors = true;
+        return out;
+    }
+
+    // Is this version in the past or in the future?
+    short cmp = 0;
+
+    if (major > DECISION_VERSION_MAJOR) {
+        cmp = 1;
+    } else if (major < DECISION_VERSION_MAJOR) {
+        cmp = -1;
+    } else {
+        if (minor > DECISION_VERSION_MINOR) {
+            cmp = 1;
+        } else if (minor < DECISION_VERSION_MINOR) {
+            cmp = -1;
+        } else {
+            if (patch > DECISION_VERSION_PATCH) {
+                cmp = 1;
+            } else if (patch < DECISION_VERSION_PATCH) {
+                cmp = -1;
+            }
+        }
+    }
+
+    // If the object file was written in the future, warn the user that things
+    // are very likely going to break.
+    if (cmp > 0) {
+        printf("Warning: %s was compiled with a future version of Decision "
+               "(%hhi.%hhi.%hhi)\n",
+               filePath, major, minor, patch);
+    }
+
+    if (hasSectionTable) {
+        out->_main = (size_t)header.main;
+        load_sections(&reader, out, sections, includes, priors, mapping);
+    } else {
+        load_stream(&reader, out, includes, priors, mapping);
+    }
+
+    if (reader.error) {
+        printf("%s cannot be loaded: object file is corrupted.\n", filePath);
+        out->hasErrors = true;
+        return out;
     }
 
     // There isn't a C function section, but we may still need to find the
@@ -1020,9 +2025,114 @@ Sheet *d_obj_load(const char *obj, size_t size, const char *filePath,
         }
     }
 
-    if (reader.error) {
-        out->hasErrors = true;
+    return out;
+}
+
+/**
+ * \fn Sheet *d_obj_load(const char *obj, size_t size, const char *filePath,
+ *                       Sheet **includes, Sheet **priors)
+ * \brief Given a binary object string, create a malloc'd Sheet structure from
+ * it.
+ *
+ * This function is essentially the reverse of `d_obj_generate`. It can also
+ * load object files written in the format before the section table was
+ * added.
+ *
+ * \return The malloc'd sheet generated from the object string.
+ *
+ * \param obj The object string.
+ * \param size The size of the object string.
+ * \param filePath Where the object file the object string came from is located.
+ * \param includes A NULL-terminated list of initially included sheets.
+ * Can be NULL.
+ * \param priors A NULL-terminates list of sheets that, if included, will throw
+ * an error. Can be NULL.
+ */
+Sheet *d_obj_load(const char *obj, size_t size, const char *filePath,
+                  Sheet **includes, Sheet **priors) {
+    return load_sheet(obj, size, filePath, includes, priors, NULL);
+}
+
+/**
+ * \fn Sheet *d_obj_load_mapped(char *mapping, size_t size,
+ *                              const char *filePath, Sheet **includes,
+ *                              Sheet **priors)
+ * \brief Create a malloc'd Sheet structure from an object file that was mapped
+ * into memory with `d_map_file`.
+ *
+ * Unlike `d_obj_load`, the text and data sections of the sheet point into the
+ * mapping instead of being copied, so only the pages that linking or running
+ * the sheet write to are copied.
+ *
+ * **NOTE:** The sheet takes ownership of the mapping, and unmaps it when the
+ * sheet is freed.
+ *
+ * \return The malloc'd sheet generated from the mapped object file.
+ *
+ * \param mapping The mapped object file.
+ * \param size The size of the mapped object file.
+ * \param filePath Where the mapped object file is located.
+ * \param includes A NULL-terminated list of initially included sheets.
+ * Can be NULL.
+ * \param priors A NULL-terminates list of sheets that, if included, will throw
+ * an error. Can be NULL.
+ */
+Sheet *d_obj_load_mapped(char *mapping, size_t size, const char *filePath,
+                         Sheet **includes, Sheet **priors) {
+    return load_sheet(mapping, size, filePath, includes, priors, mapping);
+}
+
+/**
+ * \fn bool d_obj_find_symbol(const char *obj, size_t size, const char *name,
+ *                            LinkType type, size_t *offset)
+ * \brief Find a function or variable defined in an object file using its
+ * symbol table, without loading the rest of the object file.
+ *
+ * \return If the object file defines the symbol. Object files written before
+ * symbol tables were added never define any symbols.
+ *
+ * \param obj The object string.
+ * \param size The size of the object string.
+ * \param name The name of the symbol.
+ * \param type The type of the symbol, e.g. `LINK_FUNCTION`.
+ * \param offset If the symbol was found, this is overwritten with the index
+ * of the symbol in the text section if it is a function, or in the data
+ * section otherwise. Can be NULL.
+ */
+bool d_obj_find_symbol(const char *obj, size_t size, const char *name,
+                       LinkType type, size_t *offset) {
+    ObjectReader reader        = {NULL, 0, 0, false};
+    reader.obj                 = obj;
+    *(size_t *)(&(reader.len)) = size;
+
+#ifdef DECISION_32
+    const char *magic = "D32";
+#else
+    const char *magic = "D64";
+#endif // DECISION_32
+
+    ObjHeader header;
+    ObjSectionEntry sections[OBJ_NUM_SECTIONS];
+
+    if (size < sizeof(ObjHeader) || strncmp(obj, magic, 3) != 0 ||
+        !read_section_table(&reader, &header, sections) ||
+        header.format > OBJ_FORMAT_VERSION) {
+        return false;
     }
 
-    return out;
+    uint32_t index = symtab_find(&reader, sections, name, type);
+
+    if (index == OBJ_NO_ENTRY) {
+        return false;
+    }
+
+    ObjLinkMeta record;
+    read_record(&reader, sections + OBJ_SECTION_LMETA, index, &record,
+                sizeof(ObjLinkMeta));
+
+    if (offset != NULL) {
+        *offset = (size_t)record.ptr;
+    }
+
+    return true;
 }
@@ -25,7 +25,9 @@
 #define DOBJ_H
 
 #include "dcfg.h"
+#include "dlink.h"
 
+#include <stdbool.h>
 #include <stddef.h>
 
 /*
@@ -80,4 +82,54 @@ DECISION_API struct _sheet *d_obj_load(const char *obj, size_t size,
                                        struct _sheet **includes,
                                        struct _sheet **priors);
 
+/**
+ * \fn Sheet *d_obj_load_mapped(char *mapping, size_t size,
+ *                              const char *filePath, Sheet **includes,
+ *                              Sheet **priors)
+ * \brief Create a malloc'd Sheet structure from an object file that was mapped
+ * into memory with `d_map_file`.
+ *
+ * Unlike `d_obj_load`, the text and data sections of the sheet point into the
+ * mapping instead of being copied, so only the pages that linking or running
+ * the sheet write to are copied.
+ *
+ * **NOTE:** The sheet takes ownership of the mapping, and unmaps it when the
+ * sheet is freed.
+ *
+ * \return The malloc'd sheet generated from the mapped object file.
+ *
+ * \param mapping The mapped object file.
+ * \param size The size of the mapped object file.
+ * \param filePath Where the mapped object file is located.
+ * \param includes A NULL-terminated list of initially included sheets.
+ * Can be NULL.
+ * \param priors A NULL-terminates list of sheets that, if included, will throw
+ * an error. Can be NULL.
+ */
+DECISION_API struct _sheet *d_obj_load_mapped(char *mapping, size_t size,
+                                              const char *filePath,
+                                              struct _sheet **includes,
+                                              struct _sheet **priors);
+
+/**
+ * \fn bool d_obj_find_symbol(const char *obj, size_t size, const char *name,
+ *                            LinkType type, size_t *offset)
+ * \brief Find a function or variable defined in an object file using its
+ * symbol table, without loading the rest of the object file.
+ *
+ * \return If the object file defines the symbol. Object files written before
+ * symbol tables were added never define any symbols.
+ *
+ * \param obj The object string.
+ * \param size The size of the object string.
+ * \param name The name of the symbol.
+ * \param type The type of the symbol, e.g. `LINK_FUNCTION`.
+ * \param offset If the symbol was found, this is overwritten with the index
+ * of the symbol in the text section if it is a function, or in the data
+ * section otherwise. Can be NULL.
+ */
+DECISION_API bool d_obj_find_symbol(const char *obj, size_t size,
+                                    const char *name, LinkType type,
+                                    size_t *offset);
+
 #endif // DOBJ_H
@@ -21,6 +21,7 @@
 #include "dcodegen.h"
 #include "decision.h"
 #include "dlink.h"
+#include "dmalloc.h"
 #include "dsheet.h"
 #include "dvm.h"
 
@@ -299,10 +300,17 @@ void d_optimize_all(Sheet *sheet) {
     VERBOSE(5, "done.\n");
 
     // d_optimize_shrink_fimmediate
-    // NOTE: This should be the last thing to optimise!
+    // NOTE: This should be the last thing to optimise, other than
+    // superinstructions, since they need the smaller immediates!
     VERBOSE(5, "- Checking if we can shrink instruction operands... ");
     d_optimize_shrink_fimmediate(sheet);
     VERBOSE(5, "done.\n");
+
+    // d_optimize_superinstructions
+    // NOTE: This should be the last thing to optimise!
+    VERBOSE(5, "- Checking if we can use superinstructions... ");
+    d_optimize_superinstructions(sheet);
+    VERBOSE(5, "done.\n");
 }
 
 /**
@@ -785,3 +793,119 @@ bool d_optimize_shrink_fimmediate(Sheet *sheet) {
 
     return optimised;
 }
+
+/**
+ * \fn bool d_optimize_superinstructions(Sheet *sheet)
+ * \brief Try and find sequences of instructions that can be replaced with a
+ * superinstruction, so that the VM has less instructions to dispatch.
+ *
+ * **NOTE:** The other optimisations don't know about superinstructions, so
+ * this should be the very last optimisation.
+ *
+ * \return If we were able to optimise.
+ *
+ * \param sheet The sheet containing the bytecode to optimise.
+ */
+bool d_optimize_superinstructions(Sheet *sheet) {
+    bool optimised = false;
+
+    if (sheet->_textSize == 0) {
+        return optimised;
+    }
+
+    // Since a superinstruction is decoded as one instruction, nothing can
+    // jump into the middle of one. So first, we need to know where the
+    // instructions that can be jumped to are.
+    bool *isTarget = d_calloc(sheet->_textSize, sizeof(bool));
+
+    if (sheet->_main < sheet->_textSize) {
+        isTarget[sheet->_main] = true;
+    }
+
+    for (size_t i = 0; i < sheet->_link.size; i++) {
+        LinkMeta meta = sheet->_link.list[i];
+
+        // Functions that are in this sheet.
+        if (meta.type == LINK_FUNCTION && (intptr_t)meta._ptr != -1 &&
+            (size_t)meta._ptr < sheet->_textSize) {
+            isTarget[(size_t)meta._ptr] = true;
+        }
+    }
+
+    for (size_t i = 0; i < sheet->_textSize;) {
+        DIns opcode                 = sheet->_text[i];
+        const unsigned char insSize = d_vm_ins_size(opcode);
+
+        // If we've gone wrong somewhere, error and exit.
+        if (insSize == 0) {
+            printf("Fatal: (internal:d_optimize_superinstructions) Byte %zu of "
+                   "part-optimized bytecode for sheet %s is not a valid opcode",
+                   i, sheet->filePath);
+            exit(1);
+        }
+
+        dint jmpAmt = 0;
+
+        if (opcode == OP_CALLRF || opcode == OP_JRFI || opcode == OP_JRCONFI) {
+            jmpAmt = *(fimmediate_t *)(sheet->_text + i + 1);
+        } else if (opcode == OP_CALLRH || opcode == OP_JRHI ||
+                   opcode == OP_JRCONHI) {
+            jmpAmt = *(himmediate_t *)(sheet->_text + i + 1);
+        } else if (opcode == OP_CALLRB || opcode == OP_JRBI ||
+                   opcode == OP_JRCONBI) {
+            jmpAmt = *(bimmediate_t *)(sheet->_text + i + 1);
+        }
+
+        if (jmpAmt != 0 && (dint)i + jmpAmt >= 0 &&
+            (size_t)((dint)i + jmpAmt) < sheet->_textSize) {
+            isTarget[i + jmpAmt] = true;
+        }
+
+        i += insSize;
+    }
+
+    // Now look for the sequences.
+    for (size_t i = 0; i < sheet->_textSize;) {
+        DIns opcode = sheet->_text[i];
+
+        for (DIns superOpcode = 0; superOpcode < NUM_OPCODES; superOpcode++) {
+            const SuperIns *superIns = d_vm_superins(superOpcode);
+
+            if (superIns == NULL) {
+                continue;
+            }
+
+            // Does the sequence start here, without anything jumping into the
+            // middle of it?
+            bool matches = true;
+            size_t j     = i;
+
+            for (unsigned char k = 0; k < superIns->length; k++) {
+                if (j >= sheet->_textSize ||
+                    (DIns)sheet->_text[j] != superIns->sequence[k] ||
+                    (k > 0 && isTarget[j])) {
+                    matches = false;
+                    break;
+                }
+
+                j += d_vm_ins_size(superIns->sequence[k]);
+            }
+
+            if (matches) {
+                // Only the first opcode is replaced, since the
+                // superinstruction is the same size as the sequence.
+                opcode              = superIns->opcode;
+                *(sheet->_text + i) = opcode;
+
+                optimised = true;
+                break;
+            }
+        }
+
+        i += d_vm_ins_size(opcode);
+    }
+
+    free(isTarget);
+
+    return optimised;
+}
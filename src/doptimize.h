@@ -137,4 +137,18 @@ DECISION_API bool d_optimize_simplify(struct _sheet *sheet);
  */
 DECISION_API bool d_optimize_shrink_fimmediate(struct _sheet *sheet);
 
+/**
+ * \fn bool d_optimize_superinstructions(Sheet *sheet)
+ * \brief Try and find sequences of instructions that can be replaced with a
+ * superinstruction, so that the VM has less instructions to dispatch.
+ *
+ * **NOTE:** The other optimisations don't know about superinstructions, so
+ * this should be the very last optimisation.
+ *
+ * \return If we were able to optimise.
+ *
+ * \param sheet The sheet containing the bytecode to optimise.
+ */
+DECISION_API bool d_optimize_superinstructions(struct _sheet *sheet);
+
 #endif // DOPTIMIZE_H
\ No newline at end of file
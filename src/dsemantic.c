@@ -20,9 +20,11 @@
 
 #include "decision.h"
 #include "derror.h"
+#include "dintern.h"
 #include "dmalloc.h"
 #include "dname.h"
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -45,6 +47,15 @@ typedef struct {
     size_t numArgs;
 } PropertyArgumentList;
 
+/* A struct for holding the functions and subroutines a sheet's properties
+   define, while their sockets are being added. Each scan of a sheet's
+   properties has its own, since including a sheet scans that sheet's
+   properties in the middle of this one's. */
+typedef struct {
+    NodeDefinition *funcs;
+    size_t numFuncs;
+} FunctionList;
+
 /* Macros for checking property arguments. */
 #define PROPERTY_ARGUMENT_NAME_DEFINED(arg) \
     ((arg).type == STX_TOKEN && (arg).data.name != NULL)
@@ -65,6 +76,11 @@ typedef struct {
     if (strcmp(propertyName, #property) == 0) \
         add_property_##property(sheet, lineNum, argList);
 
+/* The same, but for properties that define functions and subroutines. */
+#define IF_FUNCTION_PROPERTY(property)        \
+    if (strcmp(propertyName, #property) == 0) \
+        add_property_##property(sheet, lineNum, argList, funcList);
+
 static void add_property_Variable(Sheet *sheet, size_t lineNum,
                                   PropertyArgumentList argList) {
     bool defaultValue = true;
@@ -326,20 +342,18 @@ static void add_property_Include(Sheet *sheet, size_t lineNum,
 /*
     Functions to help build up NodeDefinition structs for functions and
     subroutines.
-    TODO: Move the storage of temporary definitions to a struct?
 */
 
-static NodeDefinition *funcs = NULL;
-static size_t numFuncs       = 0;
-
-static void add_socket(const char *name, SocketMeta socket, bool isInput) {
+static void add_socket(FunctionList *funcList, const char *name,
+                       SocketMeta socket, bool isInput) {
     size_t index = 0;
     bool found   = false;
 
-    for (size_t i = 0; i < numFuncs; i++) {
-        NodeDefinition def = funcs[i];
+    // The names come from the lexer, so they are interned.
+    for (size_t i = 0; i < funcList->numFuncs; i++) {
+        NodeDefinition def = funcList->funcs[i];
 
-        if (strcmp(name, def.name) == 0) {
+        if (name == def.name) {
             index = i;
             found = true;
             break;
@@ -347,7 +361,7 @@ static void add_socket(const char *name, SocketMeta socket, bool isInput) {
     }
 
     if (found) {
-        NodeDefinition func = funcs[index];
+        NodeDefinition func = funcList->funcs[index];
 
         SocketMeta *sockets     = (SocketMeta *)func.sockets;
         size_t numSockets       = func.numSockets;
@@ -380,81 +394,79 @@ static void add_socket(const char *name, SocketMeta socket, bool isInput) {
         }
 
         // Now save the new properties.
-        *(SocketMeta **)(&(funcs[index].sockets)) = sockets;
-        funcs[index].numSockets                   = numSockets;
-        funcs[index].startOutputIndex             = startOutputIndex;
+        NodeDefinition *def = funcList->funcs + index;
+
+        *(SocketMeta **)(&(def->sockets)) = sockets;
+        def->numSockets                   = numSockets;
+        def->startOutputIndex             = startOutputIndex;
     }
 }
 
-// NOTE: This assumes the name and description are malloc'd!
-static void create_func(const char *name, const char *desc, bool sub) {
-    numFuncs++;
+// NOTE: This assumes the name is interned, and the description is malloc'd!
+static void create_func(FunctionList *funcList, const char *name,
+                        const char *desc, bool sub) {
+    const size_t numFuncs = ++funcList->numFuncs;
     const size_t newAlloc = numFuncs * sizeof(NodeDefinition);
 
-    if (funcs == NULL) {
-        funcs = d_calloc(numFuncs, sizeof(NodeDefinition));
+    if (funcList->funcs == NULL) {
+        funcList->funcs = d_calloc(numFuncs, sizeof(NodeDefinition));
     } else {
-        funcs = d_realloc(funcs, newAlloc);
+        funcList->funcs = d_realloc(funcList->funcs, newAlloc);
     }
 
     NodeDefinition def = {NULL, NULL, NULL, 0, 0, false};
     def.name           = name;
     def.description    = desc;
 
-    funcs[numFuncs - 1] = def;
+    funcList->funcs[numFuncs - 1] = def;
 
     // If it's a subroutine, add execution sockets.
     // TODO: Make these consistent with the ones in dcfunc.c!
     if (sub) {
-        char *beforeSocketName = d_calloc(7, sizeof(char));
-        strcpy(beforeSocketName, "before");
-
         char *beforeSocketDescription = d_calloc(53, sizeof(char));
         strcpy(beforeSocketDescription,
                "The node will activate when this input is activated.");
 
         SocketMeta beforeSocket;
-        beforeSocket.name                      = beforeSocketName;
+        beforeSocket.name                      = d_intern("before");
         beforeSocket.description               = beforeSocketDescription;
         beforeSocket.type                      = TYPE_EXECUTION;
         beforeSocket.defaultValue.integerValue = 0;
 
-        char *afterSocketName = d_calloc(6, sizeof(char));
-        strcpy(afterSocketName, "after");
-
         char *afterSocketDescription = d_calloc(64, sizeof(char));
         strcpy(
             afterSocketDescription,
             "This output will activate once the node has finished executing.");
 
         SocketMeta afterSocket;
-        afterSocket.name                      = afterSocketName;
+        afterSocket.name                      = d_intern("after");
         afterSocket.description               = afterSocketDescription;
         afterSocket.type                      = TYPE_EXECUTION;
         afterSocket.defaultValue.integerValue = 0;
 
-        add_socket(name, beforeSocket, true);
-        add_socket(name, afterSocket, false);
+        add_socket(funcList, name, beforeSocket, true);
+        add_socket(funcList, name, afterSocket, false);
     }
 }
 
-static void add_funcs(Sheet *sheet) {
-    for (size_t i = 0; i < numFuncs; i++) {
-        d_sheet_add_function(sheet, funcs[i]);
+static void add_funcs(Sheet *sheet, FunctionList *funcList) {
+    for (size_t i = 0; i < funcList->numFuncs; i++) {
+        d_sheet_add_function(sheet, funcList->funcs[i]);
     }
 }
 
-static void free_funcs() {
-    if (funcs != NULL) {
-        free(funcs);
+static void free_funcs(FunctionList *funcList) {
+    if (funcList->funcs != NULL) {
+        free(funcList->funcs);
     }
 
-    funcs    = NULL;
-    numFuncs = 0;
+    funcList->funcs    = NULL;
+    funcList->numFuncs = 0;
 }
 
 static void add_property_Function(Sheet *sheet, size_t lineNum,
-                                  PropertyArgumentList argList) {
+                                  PropertyArgumentList argList,
+                                  FunctionList *funcList) {
     if (argList.numArgs > 2) {
         d_error_compiler_push("Function property needs at most 2 arguments",
                               sheet->filePath, lineNum, true);
@@ -471,10 +483,10 @@ static void add_property_Function(Sheet *sheet, size_t lineNum,
             name = nameArg.data.name;
 
             // Does a function with this name already exist?
-            for (size_t i = 0; i < numFuncs; i++) {
-                NodeDefinition func = funcs[i];
+            for (size_t i = 0; i < funcList->numFuncs; i++) {
+                NodeDefinition func = funcList->funcs[i];
 
-                if (strcmp(name, func.name) == 0) {
+                if (name == func.name) {
                     ERROR_COMPILER(sheet->filePath, lineNum, true,
                                    "Function %s is already defined", name);
                     return;
@@ -502,7 +514,7 @@ static void add_property_Function(Sheet *sheet, size_t lineNum,
             }
 
             // Add the function to the list.
-            create_func(name, desc, false);
+            create_func(funcList, name, desc, false);
         } else {
             d_error_compiler_push("Function name argument is not a name",
                                   sheet->filePath, lineNum, true);
@@ -511,7 +523,8 @@ static void add_property_Function(Sheet *sheet, size_t lineNum,
 }
 
 static void add_property_Subroutine(Sheet *sheet, size_t lineNum,
-                                    PropertyArgumentList argList) {
+                                    PropertyArgumentList argList,
+                                    FunctionList *funcList) {
     if (argList.numArgs > 2) {
         d_error_compiler_push("Subroutine property needs at most 2 arguments",
                               sheet->filePath, lineNum, true);
@@ -528,10 +541,10 @@ static void add_property_Subroutine(Sheet *sheet, size_t lineNum,
             name = nameArg.data.name;
 
             // Does a function with this name already exist?
-            for (size_t i = 0; i < numFuncs; i++) {
-                NodeDefinition func = funcs[i];
+            for (size_t i = 0; i < funcList->numFuncs; i++) {
+                NodeDefinition func = funcList->funcs[i];
 
-                if (strcmp(name, func.name) == 0) {
+                if (name == func.name) {
                     ERROR_COMPILER(sheet->filePath, lineNum, true,
                                    "Subroutine %s is already defined", name);
                     return;
@@ -559,7 +572,7 @@ static void add_property_Subroutine(Sheet *sheet, size_t lineNum,
             }
 
             // Add the subroutine to the list.
-            create_func(name, desc, true);
+            create_func(funcList, name, desc, true);
         } else {
             d_error_compiler_push("Subroutine name argument is not a name",
                                   sheet->filePath, lineNum, true);
@@ -570,7 +583,8 @@ static void add_property_Subroutine(Sheet *sheet, size_t lineNum,
 // TODO: Add properties AlternateFunction and AlternateSubroutine.
 
 static void add_property_FunctionInput(Sheet *sheet, size_t lineNum,
-                                       PropertyArgumentList argList) {
+                                       PropertyArgumentList argList,
+                                       FunctionList *funcList) {
     PropertyArgument funcArg;
     funcArg.type      = 0;
     funcArg.data.name = NULL;
@@ -726,17 +740,14 @@ static void add_property_FunctionInput(Sheet *sheet, size_t lineNum,
             socket.type         = socketType;
             socket.defaultValue = defaultValue;
 
-            add_socket(funcName, socket, true);
-        }
-
-        if (funcName != NULL) {
-            free((char *)funcName);
+            add_socket(funcList, funcName, socket, true);
         }
     }
 }
 
 static void add_property_FunctionOutput(Sheet *sheet, size_t lineNum,
-                                        PropertyArgumentList argList) {
+                                        PropertyArgumentList argList,
+                                        FunctionList *funcList) {
     PropertyArgument funcArg;
     funcArg.type      = 0;
     funcArg.data.name = NULL;
@@ -842,11 +853,7 @@ static void add_property_FunctionOutput(Sheet *sheet, size_t lineNum,
             socket.type                      = socketType;
             socket.defaultValue.integerValue = 0;
 
-            add_socket(funcName, socket, false);
-        }
-
-        if (funcName != NULL) {
-            free((char *)funcName);
+            add_socket(funcList, funcName, socket, false);
         }
     }
 }
@@ -854,7 +861,7 @@ static void add_property_FunctionOutput(Sheet *sheet, size_t lineNum,
 /* A helper function for d_semantic_scan_properties */
 static void scan_property(Sheet *sheet, const char *propertyName,
                           SyntaxNode *node, size_t lineNum, Sheet **priors,
-                          bool debugIncluded) {
+                          bool debugIncluded, FunctionList *funcList) {
     // Now we have the property name, we can get the
     // arguments.
     PropertyArgumentList argList = (PropertyArgumentList){NULL, 0};
@@ -918,10 +925,10 @@ static void scan_property(Sheet *sheet, const char *propertyName,
 
     // What is the name of the property?
     IF_PROPERTY(Variable)
-    else IF_PROPERTY(Function)
-    else IF_PROPERTY(Subroutine)
-    else IF_PROPERTY(FunctionInput)
-    else IF_PROPERTY(FunctionOutput)
+    else IF_FUNCTION_PROPERTY(Function)
+    else IF_FUNCTION_PROPERTY(Subroutine)
+    else IF_FUNCTION_PROPERTY(FunctionInput)
+    else IF_FUNCTION_PROPERTY(FunctionOutput)
     // Include needs to know the prior sheets and if we want to debug included
     // sheets!
     else if (strcmp(propertyName, "Include") == 0) {
@@ -955,6 +962,9 @@ void d_semantic_scan_properties(Sheet *sheet, SyntaxNode *root, Sheet **priors,
     SyntaxSearchResult propertySearchResults =
         d_syntax_get_all_nodes_with(root, STX_propertyStatement, false);
 
+    // The functions and subroutines the properties define.
+    FunctionList funcList = {NULL, 0};
+
     // For each of the results,
     for (size_t propertyIndex = 0;
          propertyIndex < propertySearchResults.numOccurances; propertyIndex++) {
@@ -981,11 +991,7 @@ void d_semantic_scan_properties(Sheet *sheet, SyntaxNode *root, Sheet **priors,
                                 propertyName, lineNum);
 
                         scan_property(sheet, propertyName, node, lineNum,
-                                      priors, debugIncluded);
-
-                        // Once we've scanned the property, there is no need to
-                        // store the name of the property anymore!
-                        free((char *)propertyName);
+                                      priors, debugIncluded, &funcList);
                     }
                 }
             }
@@ -993,8 +999,8 @@ void d_semantic_scan_properties(Sheet *sheet, SyntaxNode *root, Sheet **priors,
     }
 
     // Next, if any functions were defined, add them to the sheet.
-    add_funcs(sheet);
-    free_funcs();
+    add_funcs(sheet, &funcList);
+    free_funcs(&funcList);
 
     // Lastly, free the search results.
     d_syntax_free_results(propertySearchResults);
@@ -1046,6 +1052,132 @@ typedef struct _lineSocketPair {
     dint identifier;
 } LineSocketPair;
 
+/**
+ * \struct _lineIndex
+ * \brief A hash map from line identifiers to the sockets that define them.
+ *
+ * The buckets store the index of the first line socket pair with a given
+ * identifier, and `next` chains together the pairs with the same identifier
+ * in the order they were defined.
+ *
+ * \typedef struct _lineIndex LineIndex
+ */
+typedef struct _lineIndex {
+    const LineSocketPair *lines; ///< The line socket pairs that are indexed.
+    size_t *buckets;             ///< The first pair with an identifier, or
+                                 ///< `SIZE_MAX` if the bucket is empty.
+    size_t numBuckets;           ///< The number of buckets, a power of 2.
+    size_t *next;                ///< For each pair, the next pair with the same
+                                 ///< identifier, or `SIZE_MAX`.
+} LineIndex;
+
+/**
+ * \fn static size_t hash_identifier(dint identifier)
+ * \brief Hash a line identifier.
+ *
+ * \return The hash of the identifier.
+ *
+ * \param identifier The line identifier to hash.
+ */
+static size_t hash_identifier(dint identifier) {
+    // Identifiers are usually consecutive, so spread them out with Fibonacci
+    // hashing.
+    return (size_t)(((uint64_t)identifier * UINT64_C(11400714819323198485)) >>
+                    32);
+}
+
+/**
+ * \fn static size_t line_index_bucket(LineIndex *index, dint identifier)
+ * \brief Find the bucket of a line identifier in a line index.
+ *
+ * \return The bucket that contains the identifier, or the empty bucket where
+ * it would go.
+ *
+ * \param index The line index to search.
+ * \param identifier The line identifier to search for.
+ */
+static size_t line_index_bucket(LineIndex *index, dint identifier) {
+    const size_t mask = index->numBuckets - 1;
+    size_t bucket     = hash_identifier(identifier) & mask;
+
+    while (index->buckets[bucket] != SIZE_MAX &&
+           index->lines[index->buckets[bucket]].identifier != identifier) {
+        bucket = (bucket + 1) & mask;
+    }
+
+    return bucket;
+}
+
+/**
+ * \fn static LineIndex line_index_create(const LineSocketPair *lines,
+ *                                        size_t numLines)
+ * \brief Index a list of line socket pairs by their identifiers.
+ *
+ * \return The index of the pairs. Free it with `line_index_free`.
+ *
+ * \param lines The line socket pairs to index. They must outlive the index.
+ * \param numLines The number of line socket pairs.
+ */
+static LineIndex line_index_create(const LineSocketPair *lines,
+                                   size_t numLines) {
+    LineIndex index;
+    index.lines = lines;
+
+    // Keep the map at most half full, so the probes stay short.
+    index.numBuckets = 8;
+    while (index.numBuckets < 2 * numLines) {
+        index.numBuckets *= 2;
+    }
+
+    index.buckets = d_malloc(index.numBuckets * sizeof(size_t));
+    for (size_t i = 0; i < index.numBuckets; i++) {
+        index.buckets[i] = SIZE_MAX;
+    }
+
+    index.next = d_malloc((numLines > 0 ? numLines : 1) * sizeof(size_t));
+
+    // Go through the pairs backwards, so that each chain ends up in the order
+    // the pairs were defined in.
+    for (size_t i = numLines; i > 0; i--) {
+        size_t bucket = line_index_bucket(&index, lines[i - 1].identifier);
+
+        index.next[i - 1]     = index.buckets[bucket];
+        index.buckets[bucket] = i - 1;
+    }
+
+    return index;
+}
+
+/**
+ * \fn static size_t line_index_first(LineIndex *index, dint identifier)
+ * \brief Find the first line socket pair with a given identifier. The rest
+ * can be found by following `index->next`.
+ *
+ * \return The index of the first pair with the identifier, or `SIZE_MAX` if
+ * there are none.
+ *
+ * \param index The line index to search.
+ * \param identifier The line identifier to search for.
+ */
+static size_t line_index_first(LineIndex *index, dint identifier) {
+    return index->buckets[line_index_bucket(index, identifier)];
+}
+
+/**
+ * \fn static void line_index_free(LineIndex *index)
+ * \brief Free a line index.
+ *
+ * \param index The line index to free.
+ */
+static void line_index_free(LineIndex *index) {
+    free(index->buckets);
+    free(index->next);
+
+    index->buckets    = NULL;
+    index->numBuckets = 0;
+    index->next       = NULL;
+}
+
 /* A helper function for d_semantic_scan_nodes */
 static void scan_node(Sheet *sheet, const NodeDefinition *nodeDef,
                       NameDefinition nameDefinition, SyntaxNode *nameNode,
@@ -1248,8 +1380,10 @@ static void scan_node(Sheet *sheet, const NodeDefinition *nodeDef,
                             // If we need to up the capacity of
                             // the list, do so.
                             if (*numUnknownLines + 1 > *unknownLinesCapacity) {
+                                *unknownLinesCapacity =
+                                    2 * (*unknownLinesCapacity) + 1;
                                 *unknownLines = d_realloc(
-                                    *unknownLines, (++(*unknownLinesCapacity)) *
+                                    *unknownLines, (*unknownLinesCapacity) *
                                                        sizeof(LineSocketPair));
                             }
 
@@ -1398,8 +1532,9 @@ static void scan_node(Sheet *sheet, const NodeDefinition *nodeDef,
                     // If we need to up the capacity of the
                     // list, do so.
                     if (*numKnownLines + 1 > *knownLinesCapacity) {
+                        *knownLinesCapacity = 2 * (*knownLinesCapacity) + 1;
                         *knownLines =
-                            d_realloc(*knownLines, (++(*knownLinesCapacity)) *
+                            d_realloc(*knownLines, (*knownLinesCapacity) *
                                                        sizeof(LineSocketPair));
                     }
 
@@ -1422,6 +1557,7 @@ static void scan_node(Sheet *sheet, const NodeDefinition *nodeDef,
     newNode.literalValues    = literals;
     newNode.startOutputIndex = startOutputIndex;
     newNode.nameDefinition   = nameDefinition;
+    newNode.coreFunc         = d_core_find_name(nodeDef->name);
     d_graph_add_node(&(sheet->graph), newNode);
 }
 
@@ -1439,9 +1575,6 @@ void d_semantic_scan_nodes(Sheet *sheet, SyntaxNode *root) {
     SyntaxSearchResult statementSearchResults =
         d_syntax_get_all_nodes_with(root, STX_statement, false);
 
-    // TODO: THE FOLLOWING IS A VERY INEFFICIENT WAY OF CONNECTING SOCKETS.
-    // MAYBE REPLACE WITH ANOTHER DATA STRUCTURE LIKE A DICTIONARY?
-
     // A list of known lines and their "from" sockets.
     // We put lines into this list as we scan output sockets,
     // and then connect them to their respective input socket
@@ -1462,6 +1595,9 @@ void d_semantic_scan_nodes(Sheet *sheet, SyntaxNode *root) {
         3 * statementSearchResults.numOccurances;
     size_t numUnknownLineDefinitions = 0;
 
+    // Every statement is a node, so make room for them all at once.
+    d_graph_reserve(&(sheet->graph), statementSearchResults.numOccurances, 0);
+
     // For each of the results,
     for (size_t statementIndex = 0;
          statementIndex < statementSearchResults.numOccurances;
@@ -1515,15 +1651,6 @@ void d_semantic_scan_nodes(Sheet *sheet, SyntaxNode *root) {
                     ERROR_COMPILER(sheet->filePath, lineNum, true,
                                    "Undefined node %s", nodeName);
                 }
-
-                // Free the node's name from the lexical token, as it will no
-                // longer be needed - it will be in the node's definition.
-                free(nodeInfo->data.stringValue);
-
-                // If there was a name argument, free that too.
-                if (funcName != NULL) {
-                    free((char *)funcName);
-                }
             }
         }
     }
@@ -1583,24 +1710,35 @@ void d_semantic_scan_nodes(Sheet *sheet, SyntaxNode *root) {
     VERBOSE(5, "Connecting %zu defined lines with %zu undefined lines... ",
             numKnownLineDefinitions, numUnknownLineDefinitions)
 
+    // Each undefined line usually connects to one defined line, and each wire
+    // is stored in both directions. The wires are sorted all at once at the
+    // end, rather than inserted in order one by one.
+    d_graph_reserve(&(sheet->graph), 0, 2 * numUnknownLineDefinitions);
+    d_graph_begin_batch(&(sheet->graph));
+
+    // Index the defined lines by their identifiers, so each undefined line
+    // can go straight to the lines it connects to.
+    LineIndex knownLineIndex =
+        line_index_create(knownLineDefinitions, numKnownLineDefinitions);
+
     for (size_t i = 0; i < numUnknownLineDefinitions; i++) {
         bool foundMatch = false;
 
         LineSocketPair unknownLine = unknownLineDefinitions[i];
 
-        for (size_t j = 0; j < numKnownLineDefinitions; j++) {
+        for (size_t j =
+                 line_index_first(&knownLineIndex, unknownLine.identifier);
+             j != SIZE_MAX; j = knownLineIndex.next[j]) {
             LineSocketPair knownLine = knownLineDefinitions[j];
 
             // We found a match!
-            if (knownLine.identifier == unknownLine.identifier) {
-                foundMatch = true;
-
-                // Create a wire and add it to the sheet.
-                Wire wire;
-                wire.socketFrom = knownLine.socket;
-                wire.socketTo   = unknownLine.socket;
-                d_graph_add_wire(&(sheet->graph), wire, sheet->filePath);
-            }
+            foundMatch = true;
+
+            // Create a wire and add it to the sheet.
+            Wire wire;
+            wire.socketFrom = knownLine.socket;
+            wire.socketTo   = unknownLine.socket;
+            d_graph_add_wire(&(sheet->graph), wire, sheet->filePath);
         }
 
         if (!foundMatch) {
@@ -1611,8 +1749,16 @@ void d_semantic_scan_nodes(Sheet *sheet, SyntaxNode *root) {
         }
     }
 
+    line_index_free(&knownLineIndex);
+
+    d_graph_end_batch(&(sheet->graph), sheet->filePath);
+
     VERBOSE(5, "done.\n")
 
+    // The graph won't change from here on, so the passes after this one can
+    // look up the wires of each socket directly.
+    d_graph_build_index(&(sheet->graph));
+
     // Lastly, free the search results and line definitions.
     d_syntax_free_results(statementSearchResults);
     free(knownLineDefinitions);
@@ -1625,10 +1771,54 @@ void d_semantic_scan_nodes(Sheet *sheet, SyntaxNode *root) {
 */
 #define IS_TYPE_REDUCED(t) (t && !(t & (t - 1)))
 
-/* A helper function for d_semantic_reduce_types */
-static void reduce_core_node(Sheet *sheet, const CoreFunction coreFunc,
-                             size_t nodeIndex, size_t numSockets,
-                             bool *nodeReduced) {
+/* What reducing a node did. */
+#define REDUCE_CHANGED  1 // At least one of the node's socket types changed.
+#define REDUCE_REPORTED 2 // An error was reported about the node.
+
+/**
+ * \fn static int set_reduced_type(Sheet *sheet, size_t nodeIndex,
+ *                                 size_t socketIndex, DType type)
+ * \brief Set the reduced type of a node's socket.
+ *
+ * \return `REDUCE_CHANGED` if the type of the socket changed, 0 otherwise.
+ *
+ * \param sheet The sheet containing the node.
+ * \param nodeIndex The index of the node.
+ * \param socketIndex The index of the socket in the node.
+ * \param type The type to set the socket to.
+ */
+static int set_reduced_type(Sheet *sheet, size_t nodeIndex, size_t socketIndex,
+                            DType type) {
+    DType *reducedType =
+        sheet->graph.nodes[nodeIndex].reducedTypes + socketIndex;
+
+    if (*reducedType == type) {
+        return 0;
+    }
+
+    *reducedType = type;
+    return REDUCE_CHANGED;
+}
+
+/**
+ * \fn static int reduce_core_node(Sheet *sheet, const CoreFunction coreFunc,
+ *                                 size_t nodeIndex, size_t numSockets,
+ *                                 bool *reduced)
+ * \brief Reduce the types of a core node's sockets as far as we can with the
+ * types of the sockets it is connected to.
+ *
+ * \return A combination of the `REDUCE_*` flags saying what happened.
+ *
+ * \param sheet The sheet containing the node.
+ * \param coreFunc The core function of the node.
+ * \param nodeIndex The index of the node.
+ * \param numSockets The number of sockets the node has.
+ * \param reduced Set to true if the node can't be reduced any further.
+ */
+static int reduce_core_node(Sheet *sheet, const CoreFunction coreFunc,
+                            size_t nodeIndex, size_t numSockets,
+                            bool *reduced) {
+    int result            = 0;
     bool reducedAllInputs = true;
 
     NodeSocket socket;
@@ -1680,9 +1870,9 @@ static void reduce_core_node(Sheet *sheet, const CoreFunction coreFunc,
                                 if (IS_TYPE_REDUCED(otherMeta.type)) {
                                     // Great! We can set this socket's type to
                                     // be discrete!
-                                    sheet->graph.nodes[nodeIndex]
-                                        .reducedTypes[socketIndex] =
-                                        otherMeta.type;
+                                    result |= set_reduced_type(sheet, nodeIndex,
+                                                               socketIndex,
+                                                               otherMeta.type);
 
                                     if (otherMeta.type == TYPE_FLOAT) {
                                         hasFloatInput = true;
@@ -1702,8 +1892,9 @@ static void reduce_core_node(Sheet *sheet, const CoreFunction coreFunc,
             // it is a divide.)
             if (coreFunc != CORE_DIVIDE) {
                 DType confirmedType = (hasFloatInput) ? TYPE_FLOAT : TYPE_INT;
-                sheet->graph.nodes[outputSocket.nodeIndex]
-                    .reducedTypes[outputSocket.socketIndex] = confirmedType;
+                result |= set_reduced_type(sheet, outputSocket.nodeIndex,
+                                           outputSocket.socketIndex,
+                                           confirmedType);
 
                 // Now we need to check if the type we just set is incompatible
                 // with any of the connections.
@@ -1727,6 +1918,7 @@ static void reduce_core_node(Sheet *sheet, const CoreFunction coreFunc,
                             "in %s, which has type %s",
                             node.definition->name, d_type_name(confirmedType),
                             connNode.definition->name, d_type_name(meta.type));
+                        result |= REDUCE_REPORTED;
                     }
 
                     wireIndex++;
@@ -1736,7 +1928,7 @@ static void reduce_core_node(Sheet *sheet, const CoreFunction coreFunc,
             // If we've gotten all of our inputs reduced, we can say we are
             // fully reduced now.
             if (reducedAllInputs) {
-                nodeReduced[nodeIndex] = true;
+                *reduced = true;
             }
 
             break;
@@ -1781,8 +1973,9 @@ static void reduce_core_node(Sheet *sheet, const CoreFunction coreFunc,
                             if (IS_TYPE_REDUCED(otherMeta.type)) {
                                 // Great! We can set this socket's type to be
                                 // discrete!
-                                sheet->graph.nodes[nodeIndex]
-                                    .reducedTypes[socketIndex] = otherMeta.type;
+                                result |= set_reduced_type(sheet, nodeIndex,
+                                                           socketIndex,
+                                                           otherMeta.type);
 
                                 reducedTo = otherMeta.type;
                             }
@@ -1792,7 +1985,7 @@ static void reduce_core_node(Sheet *sheet, const CoreFunction coreFunc,
             }
 
             if (reducedTo != TYPE_NONE) {
-                nodeReduced[nodeIndex] = true;
+                *reduced = true;
 
                 if (coreFunc == CORE_SET && inputName != NULL) {
                     Node node = sheet->graph.nodes[nodeIndex];
@@ -1809,6 +2002,7 @@ static void reduce_core_node(Sheet *sheet, const CoreFunction coreFunc,
                                        d_type_name(reducedTo),
                                        var->variableMeta.name,
                                        d_type_name(var->variableMeta.type));
+                        result |= REDUCE_REPORTED;
                     }
                 }
             }
@@ -1844,6 +2038,7 @@ static void reduce_core_node(Sheet *sheet, const CoreFunction coreFunc,
                                                   "same type",
                                                   sheet->filePath, node.lineNum,
                                                   true);
+                            result |= REDUCE_REPORTED;
                             allSame = false;
                         }
 
@@ -1864,8 +2059,9 @@ static void reduce_core_node(Sheet *sheet, const CoreFunction coreFunc,
                             if (IS_TYPE_REDUCED(otherMeta.type)) {
                                 // Great! We can set this socket's type to be
                                 // discrete!
-                                sheet->graph.nodes[nodeIndex]
-                                    .reducedTypes[socketIndex] = otherMeta.type;
+                                result |= set_reduced_type(sheet, nodeIndex,
+                                                           socketIndex,
+                                                           otherMeta.type);
 
                                 // But wait... is it the same as the rest of the
                                 // types???
@@ -1876,6 +2072,7 @@ static void reduce_core_node(Sheet *sheet, const CoreFunction coreFunc,
                                         "All inputs in bitwise operators must "
                                         "be of the same type",
                                         sheet->filePath, node.lineNum, true);
+                                    result |= REDUCE_REPORTED;
                                     allSame = false;
                                 }
 
@@ -1886,15 +2083,15 @@ static void reduce_core_node(Sheet *sheet, const CoreFunction coreFunc,
                         }
                     }
                 } else if (finalType != TYPE_NONE) {
-                    sheet->graph.nodes[nodeIndex].reducedTypes[socketIndex] =
-                        finalType;
+                    result |= set_reduced_type(sheet, nodeIndex, socketIndex,
+                                               finalType);
                 }
             }
 
             // If all of them are not the same, we can't keep reducing and hope
             // that they do become the same. It's a lost cause :(
             if (reducedAllInputs || !allSame) {
-                nodeReduced[nodeIndex] = true;
+                *reduced = true;
             }
             break;
 
@@ -1949,9 +2146,9 @@ static void reduce_core_node(Sheet *sheet, const CoreFunction coreFunc,
                                 if (IS_TYPE_REDUCED(otherMeta.type)) {
                                     // Great! We can set this socket's type to
                                     // be discrete!
-                                    sheet->graph.nodes[nodeIndex]
-                                        .reducedTypes[socketIndex] =
-                                        otherMeta.type;
+                                    result |= set_reduced_type(sheet, nodeIndex,
+                                                               socketIndex,
+                                                               otherMeta.type);
 
                                     if ((otherMeta.type & TYPE_NUMBER) != 0) {
                                         hasNumberInput = true;
@@ -1977,6 +2174,7 @@ static void reduce_core_node(Sheet *sheet, const CoreFunction coreFunc,
                 d_error_compiler_push("Comparison operators cannot compare "
                                       "between numbers and strings",
                                       sheet->filePath, node.lineNum, true);
+                result |= REDUCE_REPORTED;
             }
 
             if (hasNumberInput && hasBoolInput) {
@@ -1984,6 +2182,7 @@ static void reduce_core_node(Sheet *sheet, const CoreFunction coreFunc,
                 d_error_compiler_push("Comparison operators cannot compare "
                                       "between numbers and booleans",
                                       sheet->filePath, node.lineNum, true);
+                result |= REDUCE_REPORTED;
             }
 
             if (hasStringInput && hasBoolInput) {
@@ -1991,12 +2190,13 @@ static void reduce_core_node(Sheet *sheet, const CoreFunction coreFunc,
                 d_error_compiler_push("Comparison operators cannot compare "
                                       "between strings and booleans",
                                       sheet->filePath, node.lineNum, true);
+                result |= REDUCE_REPORTED;
             }
 
             // If we've gotten all of our inputs reduced, we can
             // say we are fully reduced now.
             if (reducedAllInputs) {
-                nodeReduced[nodeIndex] = true;
+                *reduced = true;
             }
 
             break;
@@ -2029,6 +2229,7 @@ static void reduce_core_node(Sheet *sheet, const CoreFunction coreFunc,
                                                   "same type",
                                                   sheet->filePath, node.lineNum,
                                                   true);
+                            result |= REDUCE_REPORTED;
                             inputsSameType = false;
                         }
 
@@ -2051,8 +2252,9 @@ static void reduce_core_node(Sheet *sheet, const CoreFunction coreFunc,
 
                                 // Great! We can set this socket's type to be
                                 // discrete!
-                                sheet->graph.nodes[nodeIndex]
-                                    .reducedTypes[socketIndex] = otherMeta.type;
+                                result |= set_reduced_type(sheet, nodeIndex,
+                                                           socketIndex,
+                                                           otherMeta.type);
 
                                 // But wait... is it the same as the rest of the
                                 // types???
@@ -2063,6 +2265,7 @@ static void reduce_core_node(Sheet *sheet, const CoreFunction coreFunc,
                                         "Value inputs in a Ternary operator "
                                         "must be of the same type",
                                         sheet->filePath, node.lineNum, true);
+                                    result |= REDUCE_REPORTED;
                                     inputsSameType = false;
                                 }
                             } else {
@@ -2072,8 +2275,8 @@ static void reduce_core_node(Sheet *sheet, const CoreFunction coreFunc,
                     }
 
                 } else if (inputType != TYPE_NONE) {
-                    sheet->graph.nodes[nodeIndex].reducedTypes[socketIndex] =
-                        inputType;
+                    result |= set_reduced_type(sheet, nodeIndex, socketIndex,
+                                               inputType);
                 }
             }
 
@@ -2081,14 +2284,127 @@ static void reduce_core_node(Sheet *sheet, const CoreFunction coreFunc,
             // fully reduced now, or if the inputs are not the same, we can't
             // make them the same, so we have to stop.
             if (reducedAllInputs || !inputsSameType) {
-                nodeReduced[nodeIndex] = true;
+                *reduced = true;
             }
             break;
 
         default:
-            nodeReduced[nodeIndex] = true;
+            *reduced = true;
+            break;
+    }
+
+    return result;
+}
+
+/**
+ * \fn static int reduce_node(Sheet *sheet, size_t nodeIndex, bool *reduced)
+ * \brief Reduce the types of a node's sockets as far as we can with the types
+ * of the sockets it is connected to.
+ *
+ * \return A combination of the `REDUCE_*` flags saying what happened.
+ *
+ * \param sheet The sheet containing the node.
+ * \param nodeIndex The index of the node.
+ * \param reduced Set to true if the node can't be reduced any further.
+ */
+static int reduce_node(Sheet *sheet, size_t nodeIndex, bool *reduced) {
+    const Node node = sheet->graph.nodes[nodeIndex];
+
+    VERBOSE(5, "Reducing node #%zu (%s)... ", nodeIndex, node.definition->name)
+
+    int result = 0;
+
+    if ((int)node.coreFunc > -1) {
+        size_t numInputs  = d_node_num_inputs(sheet->graph, nodeIndex);
+        size_t numOutputs = d_node_num_outputs(sheet->graph, nodeIndex);
+
+        result = reduce_core_node(sheet, node.coreFunc, nodeIndex,
+                                  numInputs + numOutputs, reduced);
+    } else {
+        // TODO: Reduce functions from other sheets.
+        *reduced = true;
+    }
+
+    if (d_get_verbose_level() >= 5) {
+        if (*reduced)
+            printf("done.\n");
+        else
+            printf("not yet able to reduce.\n");
+    }
+
+    return result;
+}
+
+/**
+ * \fn bool d_semantic_reduce_node(Sheet *sheet, size_t nodeIndex)
+ * \brief Reduce the types of one node's sockets as far as we can with the
+ * types of the sockets it is connected to.
+ *
+ * `d_semantic_reduce_types` does this for every node in a sheet.
+ *
+ * \return If the node can't be reduced any further.
+ *
+ * \param sheet The sheet containing the node.
+ * \param nodeIndex The index of the node to reduce.
+ */
+bool d_semantic_reduce_node(Sheet *sheet, size_t nodeIndex) {
+    bool reduced = false;
+    reduce_node(sheet, nodeIndex, &reduced);
+
+    return reduced;
+}
+
+/**
+ * \fn static void heap_push(size_t *heap, size_t *size, size_t value)
+ * \brief Push a value onto a binary min-heap.
+ *
+ * \param heap The heap, which must have room for the value.
+ * \param size The number of values in the heap, which is incremented.
+ * \param value The value to push.
+ */
+static void heap_push(size_t *heap, size_t *size, size_t value) {
+    size_t i = (*size)++;
+
+    while (i > 0 && heap[(i - 1) / 2] > value) {
+        heap[i] = heap[(i - 1) / 2];
+        i       = (i - 1) / 2;
+    }
+
+    heap[i] = value;
+}
+
+/**
+ * \fn static size_t heap_pop(size_t *heap, size_t *size)
+ * \brief Pop the smallest value off a binary min-heap.
+ *
+ * \return The smallest value in the heap.
+ *
+ * \param heap The heap, which must not be empty.
+ * \param size The number of values in the heap, which is decremented.
+ */
+static size_t heap_pop(size_t *heap, size_t *size) {
+    size_t top  = heap[0];
+    size_t last = heap[--(*size)];
+    size_t i    = 0;
+
+    while (2 * i + 1 < *size) {
+        size_t child = 2 * i + 1;
+
+        if (child + 1 < *size && heap[child + 1] < heap[child]) {
+            child++;
+        }
+
+        if (heap[child] >= last) {
             break;
+        }
+
+        heap[i] = heap[child];
+        i       = child;
     }
+
+    heap[i] = last;
+
+    return top;
 }
 
 /**
@@ -2099,123 +2415,191 @@ static void reduce_core_node(Sheet *sheet, const CoreFunction coreFunc,
  * e.g. If `Multiply` has at least one `Float` input, the output must be a
  * `Float`.
  *
+ * The nodes are reduced in passes, in order of their indexes. After the first
+ * pass, a node is only reduced again once the types of a node it is connected
+ * to have changed, or if it changed something itself.
+ *
  * \param sheet The sheet to reduce the types on.
  */
 void d_semantic_reduce_types(Sheet *sheet) {
+    const size_t numNodes = sheet->graph.numNodes;
+
+    if (numNodes == 0) {
+        return;
+    }
+
+    // The wires of each node are needed to find its neighbours.
+    d_graph_build_index(&(sheet->graph));
+
+    const size_t *socketOffsets = sheet->graph.socketOffsets;
+    const size_t *wireOffsets   = sheet->graph.wireOffsets;
+
     // An array of booleans to say whether we have reduced the node with the
     // same index.
-    bool *nodeReduced = d_calloc(sheet->graph.numNodes, sizeof(bool));
+    bool *nodeReduced = d_calloc(numNodes, sizeof(bool));
+
+    // The nodes to reduce in this pass and the next pass, in order of their
+    // indexes, and which pass each node is waiting for.
+    size_t *thisPass      = d_malloc(numNodes * sizeof(size_t));
+    size_t *nextPass      = d_malloc(numNodes * sizeof(size_t));
+    size_t *queuedForPass = d_calloc(numNodes, sizeof(size_t));
+    size_t thisPassSize   = 0;
+    size_t nextPassSize   = 0;
+
+    // In the first pass, every node gets reduced, so there is no need to use
+    // the heap for it.
+    for (size_t i = 0; i < numNodes; i++) {
+        queuedForPass[i] = 1;
+    }
 
-    bool allReduced = false;
+    size_t firstPassIndex = 0;
 
-    while (!allReduced) {
+    for (size_t pass = 1; pass == 1 || thisPassSize > 0; pass++) {
         VERBOSE(5, "Beginning a pass of reducing nodes...\n");
 
-        bool neededToReduce = false;
+        bool passChanged = false;
 
-        for (size_t nodeIndex = 0; nodeIndex < sheet->graph.numNodes;
-             nodeIndex++) {
-            bool isReduced = nodeReduced[nodeIndex];
+        while ((pass == 1) ? firstPassIndex < numNodes : thisPassSize > 0) {
+            size_t nodeIndex = (pass == 1) ? firstPassIndex++
+                                           : heap_pop(thisPass, &thisPassSize);
 
-            // We haven't reduced this node yet.
-            if (!isReduced) {
-                neededToReduce = true;
-                const char *name =
-                    d_get_node_definition(sheet->graph, nodeIndex)->name;
+            if (nodeReduced[nodeIndex]) {
+                continue;
+            }
 
-                VERBOSE(5, "Reducing node #%zu (%s)... ", nodeIndex, name)
+            int result = reduce_node(sheet, nodeIndex, nodeReduced + nodeIndex);
 
-                size_t numInputs  = d_node_num_inputs(sheet->graph, nodeIndex);
-                size_t numOutputs = d_node_num_outputs(sheet->graph, nodeIndex);
-                size_t numSockets = numInputs + numOutputs;
+            // If the node's sockets changed, the nodes connected to it might
+            // be able to reduce further. The ones after it can still do so in
+            // this pass.
+            if (result & REDUCE_CHANGED) {
+                passChanged = true;
 
-                // Is it a core function?
-                const CoreFunction coreFunc = d_core_find_name(name);
+                for (size_t socket = socketOffsets[nodeIndex];
+                     socket < socketOffsets[nodeIndex + 1]; socket++) {
+                    for (size_t wire = wireOffsets[socket];
+                         wire < wireOffsets[socket + 1]; wire++) {
+                        size_t other =
+                            sheet->graph.wires[wire].socketTo.nodeIndex;
 
-                if ((int)coreFunc > -1) {
-                    reduce_core_node(sheet, coreFunc, nodeIndex, numSockets,
-                                     nodeReduced);
-                } else {
-                    // TODO: Reduce functions from other sheets.
-                    nodeReduced[nodeIndex] = true;
-                }
+                        if (nodeReduced[other] || other == nodeIndex) {
+                            continue;
+                        }
 
-                if (d_get_verbose_level() >= 5) {
-                    if (nodeReduced[nodeIndex])
-                        printf("done.\n");
-                    else
-                        printf("not yet able to reduce.\n");
+                        if (other > nodeIndex) {
+                            if (queuedForPass[other] < pass) {
+                                queuedForPass[other] = pass;
+                                heap_push(thisPass, &thisPassSize, other);
+                            }
+                        } else if (queuedForPass[other] < pass + 1) {
+                            queuedForPass[other] = pass + 1;
+                            heap_push(nextPass, &nextPassSize, other);
+                        }
+                    }
                 }
             }
+
+            // If the node isn't reduced yet, but it did something, it might do
+            // something else on the next pass.
+            if (!nodeReduced[nodeIndex] && result != 0 &&
+                queuedForPass[nodeIndex] < pass + 1) {
+                queuedForPass[nodeIndex] = pass + 1;
+                heap_push(nextPass, &nextPassSize, nodeIndex);
+            }
         }
 
-        if (!neededToReduce) {
-            allReduced = true;
+        // If no types changed in this pass, they won't change in the next one
+        // either.
+        if (!passChanged) {
+            break;
         }
+
+        size_t *swap = thisPass;
+        thisPass     = nextPass;
+        nextPass     = swap;
+        thisPassSize = nextPassSize;
+        nextPassSize = 0;
     }
 
     VERBOSE(5, "Done reducing nodes.\n");
 
     free(nodeReduced);
+    free(thisPass);
+    free(nextPass);
+    free(queuedForPass);
 }
 
+/* The states a node can be in while searching for loops. */
+#define LOOP_UNVISITED 0 // The node hasn't been reached yet.
+#define LOOP_ON_PATH   1 // The node is on the path currently being searched.
+#define LOOP_DONE      2 // Every path from the node has been searched.
+
 /**
- * \fn static void check_loop(Sheet *sheet, size_t start, size_t *pathArray,
- *                            size_t pathLength)
- * \brief A recursive function to check if a sheet has a loop.
+ * \fn static void check_loop(Sheet *sheet, size_t start,
+ *                            const size_t *firstWire, const size_t *endWire,
+ *                            char *state, size_t *path, size_t *nextWire)
+ * \brief Search every path from a node for loops, erroring if a path enters a
+ * node that is already on it.
+ *
+ * This is an iterative depth-first search, so each node and wire is only
+ * searched once, no matter how many paths there are to it.
  *
  * \param sheet In case we error, say where we errored from.
  * \param start The index of the node to start from.
- * \param pathArray The array to write our current path to. Used to see if we
- * visit the same node twice.
- * \param pathLength The length of the current path.
+ * \param firstWire For each node, the index of the first wire coming from one
+ * of its output sockets.
+ * \param endWire For each node, the index after the last wire coming from one
+ * of its output sockets.
+ * \param state For each node, its `LOOP_*` state. This is kept between calls,
+ * so nodes that were searched from a different start are skipped.
+ * \param path The array to write our current path to.
+ * \param nextWire For each node on the path, the index of the next wire
+ * coming from it to search.
  */
-static void check_loop(Sheet *sheet, size_t start, size_t *pathArray,
-                       size_t pathLength) {
-    // Firstly, check if we're already in the path.
-    for (size_t i = 0; i < pathLength - 1; i++) {
-        if (start == pathArray[i]) {
-            VERBOSE(5, "FOUND LOOP\n")
-
-            Node node = sheet->graph.nodes[start];
-
-            ERROR_COMPILER(sheet->filePath, node.lineNum, true,
-                           "Detected loop entering node %s",
-                           node.definition->name);
-            return;
-        }
+static void check_loop(Sheet *sheet, size_t start, const size_t *firstWire,
+                       const size_t *endWire, char *state, size_t *path,
+                       size_t *nextWire) {
+    if (state[start] != LOOP_UNVISITED) {
+        return;
     }
 
-    // Set ourselves into the path array.
-    pathArray[pathLength - 1] = start;
+    size_t pathLength = 0;
 
-    // Now, go through all of our output connections,
-    // and call this function on them.
-    size_t numInputs  = d_node_num_inputs(sheet->graph, start);
-    size_t numOutputs = d_node_num_outputs(sheet->graph, start);
+    state[start]       = LOOP_ON_PATH;
+    nextWire[start]    = firstWire[start];
+    path[pathLength++] = start;
 
-    // Start from the first output socket.
-    for (size_t i = numInputs; i < numInputs + numOutputs; i++) {
-        NodeSocket socket;
-        socket.nodeIndex   = start;
-        socket.socketIndex = i;
+    while (pathLength > 0) {
+        size_t nodeIndex = path[pathLength - 1];
 
-        int wireIndex = d_wire_find_first(sheet->graph, socket);
+        // Have we searched all of the wires coming from this node?
+        if (nextWire[nodeIndex] >= endWire[nodeIndex]) {
+            state[nodeIndex] = LOOP_DONE;
+            pathLength--;
 
-        while (IS_WIRE_FROM(sheet->graph, wireIndex, socket)) {
-            size_t nextNodeIndex =
-                sheet->graph.wires[wireIndex].socketTo.nodeIndex;
-            Node nextNode = sheet->graph.nodes[nextNodeIndex];
+            Node node = sheet->graph.nodes[nodeIndex];
+            VERBOSE(5, "EXIT %s LINE %zu\n", node.definition->name,
+                    node.lineNum)
+            continue;
+        }
 
-            VERBOSE(5, "ENTER %s LINE %zu\n", nextNode.definition->name,
-                    nextNode.lineNum)
+        size_t nextNodeIndex =
+            sheet->graph.wires[nextWire[nodeIndex]++].socketTo.nodeIndex;
+        Node nextNode = sheet->graph.nodes[nextNodeIndex];
 
-            check_loop(sheet, nextNodeIndex, pathArray, pathLength + 1);
+        if (state[nextNodeIndex] == LOOP_ON_PATH) {
+            VERBOSE(5, "FOUND LOOP\n")
 
-            VERBOSE(5, "EXIT %s LINE %zu\n", nextNode.definition->name,
+            ERROR_COMPILER(sheet->filePath, nextNode.lineNum, true,
+                           "Detected loop entering node %s",
+                           nextNode.definition->name);
+        } else if (state[nextNodeIndex] == LOOP_UNVISITED) {
+            VERBOSE(5, "ENTER %s LINE %zu\n", nextNode.definition->name,
                     nextNode.lineNum)
 
-            wireIndex++;
+            state[nextNodeIndex]    = LOOP_ON_PATH;
+            nextWire[nextNodeIndex] = firstWire[nextNodeIndex];
+            path[pathLength++]      = nextNodeIndex;
         }
     }
 }
@@ -2237,17 +2621,44 @@ static void check_loop(Sheet *sheet, size_t start, size_t *pathArray,
 void d_semantic_detect_loops(Sheet *sheet) {
     // We need to find all of the nodes in the sheet that start
     // a path, i.e. nodes with no arguments.
-    // We then try every single possible path from that node.
-    // If we end up visiting a node we've already visited on our
+    // We then search every path from that node.
+    // If we end up visiting a node that is already on our
     // journey, error.
 
     if (sheet->graph.nodes != NULL && sheet->graph.numNodes > 0) {
+        const size_t numNodes = sheet->graph.numNodes;
+
+        // Wires are stored in both directions, and sorted by the socket they
+        // come from, so the wires coming from the output sockets of node i
+        // are in the range [firstWire[i], endWire[i]).
+        d_graph_build_index(&(sheet->graph));
+
+        const size_t *socketOffsets = sheet->graph.socketOffsets;
+        const size_t *wireOffsets   = sheet->graph.wireOffsets;
+
+        // All of the scratch arrays are freed together at the end.
+        DArena *scratch = d_arena_create(
+            numNodes * (4 * sizeof(size_t) + sizeof(char)) + 64);
+
+        size_t *firstWire = d_arena_push(scratch, numNodes * sizeof(size_t));
+        size_t *endWire   = d_arena_push(scratch, numNodes * sizeof(size_t));
+
+        for (size_t i = 0; i < numNodes; i++) {
+            size_t numInputs = d_node_num_inputs(sheet->graph, i);
+
+            firstWire[i] = wireOffsets[socketOffsets[i] + numInputs];
+            endWire[i]   = wireOffsets[socketOffsets[i + 1]];
+        }
+
+        char *state      = d_arena_push_zero(scratch, numNodes, sizeof(char));
+        size_t *nextWire = d_arena_push(scratch, numNodes * sizeof(size_t));
+
         // We can't go on a journey that is bigger than the number
         // of nodes (without looping)
-        size_t *path = d_calloc(sheet->graph.numNodes, sizeof(size_t));
+        size_t *path = d_arena_push(scratch, numNodes * sizeof(size_t));
 
         // Find nodes with no inputs (except name sockets).
-        for (size_t i = 0; i < sheet->graph.numNodes; i++) {
+        for (size_t i = 0; i < numNodes; i++) {
             const NodeDefinition *nodeDef =
                 d_get_node_definition(sheet->graph, i);
             bool hasInputs = false;
@@ -2259,16 +2670,17 @@ void d_semantic_detect_loops(Sheet *sheet) {
                 }
             }
 
-            // If we have no inputs, find all paths from here.
+            // If we have no inputs, search all paths from here.
             if (!hasInputs) {
                 VERBOSE(5, "- Checking paths from node #%zu (%s)...\n", i,
                         nodeDef->name);
 
-                check_loop(sheet, i, path, 1);
+                check_loop(sheet, i, firstWire, endWire, state, path,
+                           nextWire);
             }
         }
 
-        free(path);
+        d_arena_free(scratch);
     }
 }
 
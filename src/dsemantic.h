@@ -84,10 +84,28 @@ DECISION_API void d_semantic_scan_nodes(Sheet *sheet, SyntaxNode *root);
  * e.g. If `Multiply` has at least one `Float` input, the output must be a
  * `Float`.
  *
+ * The nodes are reduced in passes, in order of their indexes. After the first
+ * pass, a node is only reduced again once the types of a node it is connected
+ * to have changed, or if it changed something itself.
+ *
  * \param sheet The sheet to reduce the types on.
  */
 DECISION_API void d_semantic_reduce_types(Sheet *sheet);
 
+/**
+ * \fn bool d_semantic_reduce_node(Sheet *sheet, size_t nodeIndex)
+ * \brief Reduce the types of one node's sockets as far as we can with the
+ * types of the sockets it is connected to.
+ *
+ * `d_semantic_reduce_types` does this for every node in a sheet.
+ *
+ * \return If the node can't be reduced any further.
+ *
+ * \param sheet The sheet containing the node.
+ * \param nodeIndex The index of the node to reduce.
+ */
+DECISION_API bool d_semantic_reduce_node(Sheet *sheet, size_t nodeIndex);
+
 /**
  * \fn void d_semantic_detect_loops(Sheet *sheet)
  * \brief After a sheet has been connected in `d_semantic_scan_nodes`, go
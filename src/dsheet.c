@@ -18,13 +18,17 @@
 
 #include "dsheet.h"
 
+#include "dcontext.h"
 #include "decision.h"
 #include "derror.h"
+#include "dintern.h"
 #include "dmalloc.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <time.h>
 
 /**
  * \def LIST_PUSH(array, arrayType, numCurrentItems, newItem)
@@ -42,30 +46,32 @@
  * \fn void d_sheet_add_variable(Sheet *sheet, const SocketMeta varMeta)
  * \brief Add a variable property to the sheet.
  *
+ * The name of the variable is interned, so the caller keeps ownership of it,
+ * and needs to free it if it was malloc'd. The sheet used to take ownership of
+ * the name as well. The description and default value are owned by the sheet
+ * from now on.
+ *
  * \param sheet The sheet to add the variable onto.
  * \param varMeta The variable metadata to add.
  */
 void d_sheet_add_variable(Sheet *sheet, const SocketMeta varMeta) {
-    // Define the getter node definition.
+    SocketMeta meta = varMeta;
+    meta.name       = d_intern(varMeta.name);
 
-    // Copy the name.
-    size_t nameSize  = strlen(varMeta.name) + 1;
-    char *nameGetter = d_calloc(nameSize, sizeof(char));
-    memcpy(nameGetter, varMeta.name, nameSize);
+    // Define the getter node definition, which shares the variable's name.
 
     // Create a new description for the getter, i.e.
     // "Get the value of the variable <VARIABLE NAME>."
-    size_t descriptionSize  = 32 + strlen(varMeta.name);
+    size_t descriptionSize  = 32 + strlen(meta.name);
     char *descriptionGetter = d_calloc(descriptionSize, sizeof(char));
-    sprintf(descriptionGetter, "Get the value of the variable %s.",
-            varMeta.name);
+    sprintf(descriptionGetter, "Get the value of the variable %s.", meta.name);
 
     // Copy the variable metadata.
     SocketMeta *getterMeta = d_malloc(sizeof(SocketMeta));
-    memcpy(getterMeta, &varMeta, sizeof(SocketMeta));
+    memcpy(getterMeta, &meta, sizeof(SocketMeta));
 
     NodeDefinition getter;
-    getter.name             = nameGetter;
+    getter.name             = meta.name;
     getter.description      = descriptionGetter;
     getter.sockets          = getterMeta;
     getter.numSockets       = 1;
@@ -73,11 +79,12 @@ void d_sheet_add_variable(Sheet *sheet, const SocketMeta varMeta) {
     getter.infiniteInputs   = false;
 
     SheetVariable variable;
-    *(SocketMeta *)&(variable.variableMeta)         = varMeta;
+    *(SocketMeta *)&(variable.variableMeta)         = meta;
     *(NodeDefinition *)&(variable.getterDefinition) = getter;
     variable.sheet                                  = sheet;
 
     LIST_PUSH(sheet->variables, SheetVariable, sheet->numVariables, variable)
+    d_name_invalidate_tables();
 }
 
 /* The names and descriptions of Define and Return name sockets. */
@@ -92,20 +99,30 @@ static const char *returnDescription =
  * \fn void d_sheet_add_function(Sheet *sheet, const NodeDefinition funcDef)
  * \brief Add a function to a sheet.
  *
+ * The names of the function and its sockets are interned, so the caller keeps
+ * ownership of them, and needs to free them if they were malloc'd. The sheet
+ * used to take ownership of the names as well. The description and the
+ * sockets array are owned by the sheet from now on.
+ *
  * \param sheet The sheet to add the function to.
  * \param funcDef The function definition to add.
  */
 void d_sheet_add_function(Sheet *sheet, const NodeDefinition funcDef) {
+    NodeDefinition def = funcDef;
+    def.name           = d_intern(funcDef.name);
+
+    SocketMeta *sockets = (SocketMeta *)def.sockets;
+    for (size_t i = 0; i < def.numSockets; i++) {
+        sockets[i].name = d_intern(sockets[i].name);
+    }
+
     // Before we add the function to the sheet, we need to know what the Define
     // and Return nodes for this function will look like.
 
-    char *nameDefine = d_calloc(7, sizeof(char));
-    strcpy(nameDefine, "Define");
-
     char *descriptionDefine = d_calloc(33, sizeof(char));
     strcpy(descriptionDefine, "Define a function or subroutine.");
 
-    const size_t numInputs        = d_definition_num_inputs(&funcDef);
+    const size_t numInputs        = d_definition_num_inputs(&def);
     const size_t numSocketsDefine = 1 + numInputs;
 
     SocketMeta *defineMeta = d_calloc(numSocketsDefine, sizeof(SocketMeta));
@@ -114,26 +131,23 @@ void d_sheet_add_function(Sheet *sheet, const NodeDefinition funcDef) {
     defineNameSocket.name                     = defineName;
     defineNameSocket.description              = defineDescription;
     defineNameSocket.type                     = TYPE_NAME;
-    defineNameSocket.defaultValue.stringValue = (char *)funcDef.name;
+    defineNameSocket.defaultValue.stringValue = (char *)def.name;
 
     memcpy(defineMeta, &defineNameSocket, sizeof(SocketMeta));
-    memcpy(defineMeta + 1, funcDef.sockets, numInputs * sizeof(SocketMeta));
+    memcpy(defineMeta + 1, def.sockets, numInputs * sizeof(SocketMeta));
 
     NodeDefinition defineDef;
-    defineDef.name             = nameDefine;
+    defineDef.name             = d_intern("Define");
     defineDef.description      = descriptionDefine;
     defineDef.sockets          = defineMeta;
     defineDef.numSockets       = numSocketsDefine;
     defineDef.startOutputIndex = 1;
     defineDef.infiniteInputs   = false;
 
-    char *nameReturn = d_calloc(7, sizeof(char));
-    strcpy(nameReturn, "Return");
-
     char *descriptionReturn = d_calloc(38, sizeof(char));
     strcpy(descriptionReturn, "Return from a function or subroutine.");
 
-    const size_t numOutputs       = d_definition_num_outputs(&funcDef);
+    const size_t numOutputs       = d_definition_num_outputs(&def);
     const size_t numSocketsReturn = 1 + numOutputs;
 
     SocketMeta *returnMeta = d_calloc(numSocketsReturn, sizeof(SocketMeta));
@@ -142,14 +156,14 @@ void d_sheet_add_function(Sheet *sheet, const NodeDefinition funcDef) {
     returnNameSocket.name                     = returnName;
     returnNameSocket.description              = returnDescription;
     returnNameSocket.type                     = TYPE_NAME;
-    returnNameSocket.defaultValue.stringValue = (char *)funcDef.name;
+    returnNameSocket.defaultValue.stringValue = (char *)def.name;
 
     memcpy(returnMeta, &returnNameSocket, sizeof(SocketMeta));
-    memcpy(returnMeta + 1, funcDef.sockets + funcDef.startOutputIndex,
+    memcpy(returnMeta + 1, def.sockets + def.startOutputIndex,
            numOutputs * sizeof(SocketMeta));
 
     NodeDefinition returnDef;
-    returnDef.name             = nameReturn;
+    returnDef.name             = d_intern("Return");
     returnDef.description      = descriptionReturn;
     returnDef.sockets          = returnMeta;
     returnDef.numSockets       = numSocketsReturn;
@@ -157,7 +171,7 @@ void d_sheet_add_function(Sheet *sheet, const NodeDefinition funcDef) {
     returnDef.infiniteInputs   = false;
 
     SheetFunction func;
-    *(NodeDefinition *)&(func.functionDefinition) = funcDef;
+    *(NodeDefinition *)&(func.functionDefinition) = def;
     *(NodeDefinition *)&(func.defineDefinition)   = defineDef;
     *(NodeDefinition *)&(func.returnDefinition)   = returnDef;
     func.defineNodeIndex                          = 0;
@@ -167,6 +181,7 @@ void d_sheet_add_function(Sheet *sheet, const NodeDefinition funcDef) {
     func.sheet                                    = sheet;
 
     LIST_PUSH(sheet->functions, SheetFunction, sheet->numFunctions, func)
+    d_name_invalidate_tables();
 }
 
 /**
@@ -180,6 +195,7 @@ void d_sheet_add_function(Sheet *sheet, const NodeDefinition funcDef) {
  */
 void d_sheet_add_c_function(Sheet *sheet, CFunction cFunction) {
     LIST_PUSH(sheet->cFunctions, CFunction, sheet->numCFunctions, cFunction);
+    d_name_invalidate_tables();
 }
 
 /**
@@ -204,6 +220,279 @@ bool d_is_subroutine(SheetFunction func) {
  */
 void d_sheet_add_include(Sheet *sheet, Sheet *include) {
     LIST_PUSH(sheet->includes, Sheet *, sheet->numIncludes, include);
+    d_name_invalidate_tables();
+}
+
+/*
+=== INCLUDE CACHE =========================================
+*/
+
+/**
+ * \struct _includeCacheEntry
+ * \brief A sheet in the include cache, and what it was loaded from.
+ *
+ * \typedef struct _includeCacheEntry IncludeCacheEntry
+ */
+typedef struct _includeCacheEntry {
+    char *canonicalPath; ///< The absolute path of the file.
+    time_t modifiedTime; ///< When the file was last modified.
+    size_t fileSize;     ///< The size of the file in bytes.
+    bool debug;          ///< Was the sheet compiled in debug mode?
+    Sheet *sheet;        ///< The sheet, which the cache has a reference to.
+} IncludeCacheEntry;
+
+/*
+    The include cache, and its statistics, are kept in the current compile
+    context, since the sheets in it can only be used by one thread at a time.
+*/
+
+/**
+ * \fn static char *canonical_path(const char *filePath, time_t *modifiedTime,
+ *                                 size_t *fileSize)
+ * \brief Get the absolute path of a file, and when it was last modified.
+ *
+ * \return The malloc'd absolute path, or `NULL` if the file doesn't exist.
+ *
+ * \param filePath The path of the file.
+ * \param modifiedTime Set to when the file was last modified.
+ * \param fileSize Set to the size of the file in bytes.
+ */
+static char *canonical_path(const char *filePath, time_t *modifiedTime,
+                            size_t *fileSize) {
+    struct stat info;
+    if (stat(filePath, &info) != 0) {
+        return NULL;
+    }
+
+    *modifiedTime = info.st_mtime;
+    *fileSize     = (size_t)info.st_size;
+
+#if defined(_WIN32)
+    char *path = _fullpath(NULL, filePath, 0);
+#elif defined(__unix__) || defined(__APPLE__)
+    char *path = realpath(filePath, NULL);
+#else
+    char *path = NULL;
+#endif
+
+    // If we can't resolve the path, the path we were given is the best we've
+    // got.
+    if (path == NULL) {
+        const size_t filePathLen = strlen(filePath);
+        path                     = d_calloc(filePathLen + 1, sizeof(char));
+        memcpy(path, filePath, filePathLen + 1);
+    }
+
+    return path;
+}
+
+/**
+ * \fn static void include_cache_remove(DCompileContext *context,
+ *                                      size_t index)
+ * \brief Remove an entry from the include cache, and drop its reference to the
+ * sheet.
+ *
+ * \param context The context the include cache is in.
+ * \param index The index of the entry to remove.
+ */
+static void include_cache_remove(DCompileContext *context, size_t index) {
+    IncludeCacheEntry entry = context->_includeCache[index];
+
+    free(entry.canonicalPath);
+    d_sheet_free(entry.sheet);
+
+    // The order of the entries doesn't matter, so move the last entry into
+    // the gap.
+    context->_includeCache[index] =
+        context->_includeCache[--context->_includeCacheSize];
+
+    if (context->_includeCacheSize == 0) {
+        free(context->_includeCache);
+        context->_includeCache = NULL;
+    }
+}
+
+/**
+ * \fn static bool include_cache_is_fresh(DCompileContext *context,
+ *                                        IncludeCacheEntry entry)
+ * \brief Check that the file of a sheet in the include cache hasn't changed
+ * since it was loaded, and neither have the files of the sheets it includes.
+ *
+ * \return If the sheet can still be reused.
+ *
+ * \param context The context the include cache is in.
+ * \param entry The entry of the sheet in the include cache.
+ */
+static bool include_cache_is_fresh(DCompileContext *context,
+                                   IncludeCacheEntry entry) {
+    struct stat info;
+    if (stat(entry.canonicalPath, &info) != 0 ||
+        info.st_mtime != entry.modifiedTime ||
+        (size_t)info.st_size != entry.fileSize) {
+        return false;
+    }
+
+    for (size_t i = 0; i < entry.sheet->numIncludes; i++) {
+        Sheet *include = entry.sheet->includes[i];
+
+        // Sheets that were given to us directly, rather than from a path,
+        // can't go out of date.
+        if (include->includePath == NULL) {
+            continue;
+        }
+
+        // If an included sheet isn't in the cache anymore, it was either
+        // invalidated, or it went out of date.
+        bool found = false;
+
+        for (size_t j = 0; j < context->_includeCacheSize; j++) {
+            IncludeCacheEntry includeEntry = context->_includeCache[j];
+
+            if (includeEntry.sheet == include) {
+                if (!include_cache_is_fresh(context, includeEntry)) {
+                    return false;
+                }
+
+                found = true;
+                break;
+            }
+        }
+
+        if (!found) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * \fn static Sheet *include_cache_find(DCompileContext *context,
+ *                                      const char *canonicalPath,
+ *                                      const char *includePath, bool debug)
+ * \brief Find a sheet in the include cache that can be reused.
+ *
+ * If the sheet is out of date, it is removed from the cache.
+ *
+ * \return The sheet, or `NULL` if there is no sheet that can be reused.
+ *
+ * \param context The context the include cache is in.
+ * \param canonicalPath The absolute path of the file being included.
+ * \param includePath The argument of the Include property.
+ * \param debug Is the sheet being included in debug mode?
+ */
+static Sheet *include_cache_find(DCompileContext *context,
+                                 const char *canonicalPath,
+                                 const char *includePath, bool debug) {
+    for (size_t i = 0; i < context->_includeCacheSize; i++) {
+        IncludeCacheEntry entry = context->_includeCache[i];
+
+        if (entry.debug != debug ||
+            strcmp(entry.canonicalPath, canonicalPath) != 0) {
+            continue;
+        }
+
+        if (!include_cache_is_fresh(context, entry)) {
+            include_cache_remove(context, i);
+            return NULL;
+        }
+
+        // The include path is saved in object files of the sheets that
+        // include this one, so it needs to be the same.
+        if (entry.sheet->includePath == NULL ||
+            strcmp(entry.sheet->includePath, includePath) != 0) {
+            return NULL;
+        }
+
+        return entry.sheet;
+    }
+
+    return NULL;
+}
+
+/**
+ * \fn void d_include_cache_set_enabled(bool enabled)
+ * \brief Set whether `d_sheet_add_include_from_path` should reuse sheets that
+ * have already been loaded in the current compile context. The cache is
+ * disabled by default.
+ *
+ * A reused sheet is the same sheet, with the same variables, so every sheet
+ * that includes it sees the changes the others make to them, even across
+ * separate runs.
+ *
+ * Disabling the cache doesn't empty it, use `d_include_cache_invalidate` for
+ * that.
+ *
+ * \param enabled Should the include cache be used?
+ */
+void d_include_cache_set_enabled(bool enabled) {
+    d_context_current()->_includeCacheEnabled = enabled;
+}
+
+/**
+ * \fn void d_include_cache_invalidate(const char *filePath)
+ * \brief Remove sheets from the include cache of the current compile context,
+ * so the next time they are included they are loaded again.
+ *
+ * Sheets that still include the removed sheets keep their reference to them.
+ *
+ * \param filePath The path of the file to remove from the cache. If `NULL`,
+ * every sheet is removed.
+ */
+void d_include_cache_invalidate(const char *filePath) {
+    DCompileContext *context = d_context_current();
+
+    if (filePath == NULL) {
+        while (context->_includeCacheSize > 0) {
+            include_cache_remove(context, context->_includeCacheSize - 1);
+        }
+
+        return;
+    }
+
+    time_t modifiedTime;
+    size_t fileSize;
+    char *path = canonical_path(filePath, &modifiedTime, &fileSize);
+
+    // If the file has been deleted, we can't resolve its path anymore, so
+    // go with the path we were given.
+    if (path == NULL) {
+        const size_t filePathLen = strlen(filePath);
+        path                     = d_calloc(filePathLen + 1, sizeof(char));
+        memcpy(path, filePath, filePathLen + 1);
+    }
+
+    size_t i = 0;
+    while (i < context->_includeCacheSize) {
+        IncludeCacheEntry entry = context->_includeCache[i];
+
+        if (strcmp(entry.canonicalPath, path) == 0 ||
+            strcmp(entry.sheet->filePath, filePath) == 0) {
+            include_cache_remove(context, i);
+        } else {
+            i++;
+        }
+    }
+
+    free(path);
+}
+
+/**
+ * \fn IncludeCacheStats d_include_cache_stats()
+ * \brief Get how well the include cache of the current compile context is
+ * doing.
+ *
+ * \return The statistics of the include cache.
+ */
+IncludeCacheStats d_include_cache_stats() {
+    DCompileContext *context = d_context_current();
+
+    IncludeCacheStats stats;
+    stats.hits      = context->_includeCacheHits;
+    stats.misses    = context->_includeCacheMisses;
+    stats.numSheets = context->_includeCacheSize;
+
+    return stats;
 }
 
 /**
@@ -214,6 +503,10 @@ void d_sheet_add_include(Sheet *sheet, Sheet *include) {
  * \brief Add a reference to another sheet to the current sheet, which can be
  * used to get extra functionality.
  *
+ * If the include cache is enabled, and the same file has already been
+ * included with the same include path and debug mode, and it hasn't changed
+ * since, the sheet that was loaded then is reused.
+ *
  * \return A pointer to the sheet that was created from the include path.
  *
  * \param sheet The sheet to add the include to.
@@ -283,6 +576,39 @@ Sheet *d_sheet_add_include_from_path(Sheet *sheet, const char *includePath,
         }
     }
 
+    // Has this file already been loaded by something else?
+    DCompileContext *context = d_context_current();
+
+    time_t modifiedTime = 0;
+    size_t fileSize     = 0;
+    char *canonicalPath = NULL;
+
+    if (context->_includeCacheEnabled) {
+        canonicalPath = canonical_path(finalPath, &modifiedTime, &fileSize);
+
+        if (canonicalPath != NULL) {
+            Sheet *cachedSheet = include_cache_find(
+                context, canonicalPath, includePath, debugInclude);
+
+            if (cachedSheet != NULL) {
+                context->_includeCacheHits++;
+
+                VERBOSE(5, "Reusing sheet %s from the include cache\n",
+                        canonicalPath);
+
+                cachedSheet->_refCount++;
+                d_sheet_add_include(sheet, cachedSheet);
+
+                free(canonicalPath);
+                free(dir);
+
+                return cachedSheet;
+            }
+
+            context->_includeCacheMisses++;
+        }
+    }
+
     CompileOptions opts = DEFAULT_COMPILE_OPTIONS;
     opts.debug          = debugInclude;
 
@@ -321,6 +647,27 @@ Sheet *d_sheet_add_include_from_path(Sheet *sheet, const char *includePath,
 
     includeSheet->includePath = (const char *)cpyIncludePath;
 
+    // Keep the sheet around for anything else that includes it, as long as
+    // it loaded properly.
+    if (canonicalPath != NULL) {
+        if (!includeSheet->hasErrors) {
+            IncludeCacheEntry entry;
+            entry.canonicalPath = canonicalPath;
+            entry.modifiedTime  = modifiedTime;
+            entry.fileSize      = fileSize;
+            entry.debug         = debugInclude;
+            entry.sheet         = includeSheet;
+
+            // The cache has its own reference to the sheet.
+            includeSheet->_refCount++;
+
+            LIST_PUSH(context->_includeCache, IncludeCacheEntry,
+                      context->_includeCacheSize, entry)
+        } else {
+            free(canonicalPath);
+        }
+    }
+
     free(dir);
 
     return includeSheet;
@@ -356,32 +703,69 @@ Sheet *d_sheet_create(const char *filePath) {
     sheet->numFunctions     = 0;
     sheet->cFunctions       = NULL;
     sheet->numCFunctions    = 0;
+    sheet->_names           = d_name_new_table();
     sheet->_main            = 0;
     sheet->_text            = NULL;
     sheet->_textSize        = 0;
     sheet->_data            = NULL;
     sheet->_dataSize        = 0;
+    sheet->_mapping         = NULL;
+    sheet->_mappingSize     = 0;
+    sheet->_callConvention  = VM_CALL_CONVENTION;
+    sheet->_decodedText     = NULL;
+    sheet->_jitCode         = NULL;
+    sheet->_useJit          = false;
+    sheet->_profiles        = NULL;
+    sheet->_numProfiles     = 0;
+    sheet->_useTiers        = false;
     sheet->_insLinkList     = NULL;
     sheet->_insLinkListSize = 0;
     sheet->numStarts        = 0;
     sheet->startNodeIndex   = -1;
     sheet->hasErrors        = false;
     sheet->allowFree        = true;
+    sheet->_refCount        = 1;
     sheet->_isCompiled      = false;
     sheet->_isLinked        = false;
 
+    // The names in the sheet are interned, so they need to stay in the pool
+    // for as long as the sheet does.
+    d_intern_retain();
+
     return sheet;
 }
 
+/**
+ * \fn static bool in_mapping(Sheet *sheet, const char *ptr)
+ * \brief Check if a pointer points into the object file a sheet was mapped
+ * from.
+ *
+ * \return If the pointer is inside the sheet's mapping.
+ *
+ * \param sheet The sheet to query.
+ * \param ptr The pointer to check.
+ */
+static bool in_mapping(Sheet *sheet, const char *ptr) {
+    return sheet->_mapping != NULL && ptr >= sheet->_mapping &&
+           ptr < sheet->_mapping + sheet->_mappingSize;
+}
+
 /**
  * \fn void d_sheet_free(Sheet *sheet)
- * \brief Free malloc'd memory in a sheet.
+ * \brief Drop a reference to a sheet, and free its malloc'd memory if it was
+ * the last reference.
  *
  * **NOTE:** This will also free all included sheets recursively!
  *
  * \param sheet The sheet to free from memory.
  */
 void d_sheet_free(Sheet *sheet) {
+    // If anything else still has a reference to the sheet, leave it be.
+    if (sheet != NULL && sheet->_refCount > 1) {
+        sheet->_refCount--;
+        return;
+    }
+
     if (sheet != NULL) {
         // Dereferenced sheet here so VS stops giving us a warning about this
         // one line.
@@ -400,11 +784,6 @@ void d_sheet_free(Sheet *sheet) {
             for (size_t i = 0; i < sheet->numVariables; i++) {
                 SheetVariable var = sheet->variables[i];
 
-                // Free the variable name.
-                if (var.variableMeta.name != NULL) {
-                    free((char *)var.variableMeta.name);
-                }
-
                 // Free the variable description.
                 if (var.variableMeta.description != NULL) {
                     free((char *)var.variableMeta.description);
@@ -446,6 +825,7 @@ void d_sheet_free(Sheet *sheet) {
                 CFunction cFunc = sheet->cFunctions[i];
 
                 d_definition_free(cFunc.definition, true);
+                d_intern_release();
             }
 
             free(sheet->cFunctions);
@@ -453,12 +833,41 @@ void d_sheet_free(Sheet *sheet) {
             sheet->numCFunctions = 0;
         }
 
-        if (sheet->_text != NULL) {
+        d_name_free_table(&(sheet->_names));
+
+        // The native code needs to be freed before the decoded text it was
+        // compiled from.
+        if (sheet->_jitCode != NULL) {
+            d_jit_free(sheet->_jitCode);
+            sheet->_jitCode = NULL;
+        }
+
+        if (sheet->_profiles != NULL) {
+            for (size_t i = 0; i < sheet->_numProfiles; i++) {
+                if (sheet->_profiles[i].jitCode != NULL) {
+                    d_jit_free(sheet->_profiles[i].jitCode);
+                }
+            }
+
+            free(sheet->_profiles);
+            sheet->_profiles    = NULL;
+            sheet->_numProfiles = 0;
+        }
+
+        if (sheet->_decodedText != NULL) {
+            d_vm_free_decoded_text(sheet->_decodedText);
+            sheet->_decodedText = NULL;
+        }
+
+        // The text and data sections don't need to be freed if they point
+        // into the mapped object file.
+        if (sheet->_text != NULL && !in_mapping(sheet, sheet->_text)) {
             free(sheet->_text);
-            sheet->_text     = NULL;
-            sheet->_textSize = 0;
         }
 
+        sheet->_text     = NULL;
+        sheet->_textSize = 0;
+
         // Before we free the data section, we need to free any string variables
         // that will have been malloc'd. These pointers should only be malloc'd
         // when linking has taken place.
@@ -495,10 +904,17 @@ void d_sheet_free(Sheet *sheet) {
         }
         */
 
-        if (sheet->_data != NULL) {
+        if (sheet->_data != NULL && !in_mapping(sheet, sheet->_data)) {
             free(sheet->_data);
-            sheet->_data     = NULL;
-            sheet->_dataSize = 0;
+        }
+
+        sheet->_data     = NULL;
+        sheet->_dataSize = 0;
+
+        if (sheet->_mapping != NULL) {
+            d_unmap_file(sheet->_mapping, sheet->_mappingSize);
+            sheet->_mapping     = NULL;
+            sheet->_mappingSize = 0;
         }
 
         d_debug_free_info(&(sheet->_debugInfo));
@@ -526,6 +942,8 @@ void d_sheet_free(Sheet *sheet) {
         }
 
         free(sheet);
+
+        d_intern_release();
     }
 }
 
@@ -688,3 +1106,24 @@ void d_sheet_dump(Sheet *sheet) {
 
     printf("\n");
 }
+
+/**
+ * \fn void d_sheet_dump_profiles(Sheet *sheet)
+ * \brief Dump how often each function in a sheet has been run, and if it was
+ * promoted to native code, to `stdout`.
+ *
+ * \param sheet The sheet whose function profiles to dump.
+ */
+void d_sheet_dump_profiles(Sheet *sheet) {
+    printf("# Function profiles of %s: %zu\n", sheet->filePath,
+           sheet->_numProfiles);
+
+    for (size_t i = 0; i < sheet->_numProfiles; i++) {
+        FunctionProfile *profile = sheet->_profiles + i;
+
+        printf("\t%s: %zu calls, %zu backward jumps, %s\n", profile->name,
+               (size_t)profile->profile.calls,
+               (size_t)profile->profile.backEdges,
+               (profile->jitCode != NULL) ? "promoted" : "interpreted");
+    }
+}
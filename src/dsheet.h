@@ -28,6 +28,7 @@
 #include "dcfunc.h"
 #include "ddebug.h"
 #include "dgraph.h"
+#include "djit.h"
 #include "dlink.h"
 #include <stdbool.h>
 
@@ -103,6 +104,30 @@ typedef struct _sheetFunction {
     struct _sheet *sheet; ///< The sheet the function belongs to.
 } SheetFunction;
 
+/**
+ * \struct _functionProfile
+ * \brief How often a function in the decoded text section of a sheet has been
+ * run, for deciding when to compile it to native code.
+ *
+ * \typedef struct _functionProfile FunctionProfile
+ */
+typedef struct _functionProfile {
+    VMProfile profile; ///< The counters the VM increments. This needs to be
+                       ///< the first member, so the profile can be cast back
+                       ///< to a `FunctionProfile`.
+
+    struct _sheet *sheet; ///< The sheet the function belongs to.
+    const char *name;     ///< The name of the function.
+
+    size_t start; ///< The index of the first decoded instruction of the
+                  ///< function.
+    size_t end;   ///< The index after the last decoded instruction of the
+                  ///< function.
+
+    JitCode *jitCode; ///< The native code the function was promoted to, or
+                      ///< `NULL` if it hasn't been promoted.
+} FunctionProfile;
+
 /**
  * \struct _sheet
  * \brief A struct for storing sheet data.
@@ -135,6 +160,9 @@ typedef struct _sheet {
                               ///< sheet.
     size_t numCFunctions;     ///< The number of C functions in this sheet.
 
+    NameTable _names; ///< Every name that can be used in this sheet. See
+                      ///< `d_get_name_definitions`.
+
     size_t _main; ///< Points to the index of the first instruction of Start,
                   ///< *not* the `RET` instruction one before.
 
@@ -143,6 +171,31 @@ typedef struct _sheet {
     char *_data;      ///< The compiled data section.
     size_t _dataSize; ///< The number of bytes the data section has.
 
+    char *_mapping;      ///< The object file the sheet was loaded from, if it
+                         ///< was mapped into memory with `d_map_file`. The
+                         ///< text and data sections may point into it.
+    size_t _mappingSize; ///< The size of the mapped object file in bytes.
+
+    uint8_t _callConvention; ///< The calling convention the text section was
+                             ///< generated with. See `VM_CALL_CONVENTION`.
+
+    DecodedText *_decodedText; ///< The text section, decoded for the VM once
+                               ///< the sheet has been linked.
+    JitCode *_jitCode;         ///< The decoded text section, compiled to
+                               ///< native code once the sheet has been
+                               ///< linked, if `_useJit` is true.
+    bool _useJit;              ///< Should the decoded text section be
+                               ///< compiled to native code? See
+                               ///< `d_jit_compile`.
+
+    FunctionProfile *_profiles; ///< The profiles of the functions in the
+                                ///< decoded text section, if `_useTiers` is
+                                ///< true.
+    size_t _numProfiles;        ///< The number of function profiles.
+    bool _useTiers;             ///< Should functions only be compiled to
+                                ///< native code once they get hot? See
+                                ///< `d_link_sheet`.
+
     InstructionToLink *_insLinkList; ///< A list of which instructions should
                                      ///< link to which items.
     size_t _insLinkListSize;         ///< The number of instructions to link.
@@ -154,11 +207,28 @@ typedef struct _sheet {
 
     bool allowFree; ///< Allow sheets that include this sheet to free it?
 
+    size_t _refCount; ///< How many references there are to this sheet, e.g.
+                      ///< from sheets that include it, or from the include
+                      ///< cache. `d_sheet_free` only frees the sheet once
+                      ///< the last reference is dropped.
+
     bool _isCompiled; ///< Has the sheet been compiled?
     bool _isLinked;   ///< Has the sheet been linked?
 
 } Sheet;
 
+/**
+ * \struct _includeCacheStats
+ * \brief Statistics about the cache of included sheets of a compile context.
+ *
+ * \typedef struct _includeCacheStats IncludeCacheStats
+ */
+typedef struct _includeCacheStats {
+    size_t hits;      ///< How many includes reused an already loaded sheet.
+    size_t misses;    ///< How many includes had to load the sheet.
+    size_t numSheets; ///< How many sheets are in the cache right now.
+} IncludeCacheStats;
+
 /*
 === FUNCTIONS =============================================
 */
@@ -167,6 +237,11 @@ typedef struct _sheet {
  * \fn void d_sheet_add_variable(Sheet *sheet, const SocketMeta varMeta)
  * \brief Add a variable property to the sheet.
  *
+ * The name of the variable is interned, so the caller keeps ownership of it,
+ * and needs to free it if it was malloc'd. The sheet used to take ownership of
+ * the name as well. The description and default value are owned by the sheet
+ * from now on.
+ *
  * \param sheet The sheet to add the variable onto.
  * \param varMeta The variable metadata to add.
  */
@@ -176,6 +251,11 @@ DECISION_API void d_sheet_add_variable(Sheet *sheet, const SocketMeta varMeta);
  * \fn void d_sheet_add_function(Sheet *sheet, const NodeDefinition funcDef)
  * \brief Add a function to a sheet.
  *
+ * The names of the function and its sockets are interned, so the caller keeps
+ * ownership of them, and needs to free them if they were malloc'd. The sheet
+ * used to take ownership of the names as well. The description and the
+ * sockets array are owned by the sheet from now on.
+ *
  * \param sheet The sheet to add the function to.
  * \param funcDef The function definition to add.
  */
@@ -221,6 +301,10 @@ DECISION_API void d_sheet_add_include(Sheet *sheet, Sheet *include);
  * \brief Add a reference to another sheet to the current sheet, which can be
  * used to get extra functionality.
  *
+ * If the include cache is enabled, and the same file has already been
+ * included with the same include path and debug mode, and it hasn't changed
+ * since, the sheet that was loaded then is reused.
+ *
  * \return A pointer to the sheet that was created from the include path.
  *
  * \param sheet The sheet to add the include to.
@@ -248,7 +332,8 @@ DECISION_API Sheet *d_sheet_create(const char *filePath);
 
 /**
  * \fn void d_sheet_free(Sheet *sheet)
- * \brief Free malloc'd memory in a sheet.
+ * \brief Drop a reference to a sheet, and free its malloc'd memory if it was
+ * the last reference.
  *
  * **NOTE:** This will also free all included sheets recursively that have
  * the `allowFree` property set to `true`, which is the default!
@@ -257,6 +342,44 @@ DECISION_API Sheet *d_sheet_create(const char *filePath);
  */
 DECISION_API void d_sheet_free(Sheet *sheet);
 
+/**
+ * \fn void d_include_cache_set_enabled(bool enabled)
+ * \brief Set whether `d_sheet_add_include_from_path` should reuse sheets that
+ * have already been loaded in the current compile context. The cache is
+ * disabled by default.
+ *
+ * A reused sheet is the same sheet, with the same variables, so every sheet
+ * that includes it sees the changes the others make to them, even across
+ * separate runs.
+ *
+ * Disabling the cache doesn't empty it, use `d_include_cache_invalidate` for
+ * that.
+ *
+ * \param enabled Should the include cache be used?
+ */
+DECISION_API void d_include_cache_set_enabled(bool enabled);
+
+/**
+ * \fn void d_include_cache_invalidate(const char *filePath)
+ * \brief Remove sheets from the include cache of the current compile context,
+ * so the next time they are included they are loaded again.
+ *
+ * Sheets that still include the removed sheets keep their reference to them.
+ *
+ * \param filePath The path of the file to remove from the cache. If `NULL`,
+ * every sheet is removed.
+ */
+DECISION_API void d_include_cache_invalidate(const char *filePath);
+
+/**
+ * \fn IncludeCacheStats d_include_cache_stats()
+ * \brief Get how well the include cache of the current compile context is
+ * doing.
+ *
+ * \return The statistics of the include cache.
+ */
+DECISION_API IncludeCacheStats d_include_cache_stats();
+
 /**
  * \fn void d_variables_dump(SheetVariable *variables, size_t numVariables)
  * \brief Dump the details of an array of variables to `stdout`.
@@ -294,4 +417,13 @@ DECISION_API void d_c_functions_dump(CFunction *functions, size_t numFunctions);
  */
 DECISION_API void d_sheet_dump(Sheet *sheet);
 
+/**
+ * \fn void d_sheet_dump_profiles(Sheet *sheet)
+ * \brief Dump how often each function in a sheet has been run, and if it was
+ * promoted to native code, to `stdout`.
+ *
+ * \param sheet The sheet whose function profiles to dump.
+ */
+DECISION_API void d_sheet_dump_profiles(Sheet *sheet);
+
 #endif // DSHEET_H
@@ -232,7 +232,7 @@ SyntaxSearchResult d_syntax_get_all_nodes_with(SyntaxNode *root,
 
             // Resize if the array is too small!
             if (n + 1 > currentSize) {
-                currentSize++;
+                currentSize *= 2;
                 found = d_realloc(found, currentSize * sizeof(SyntaxNode **));
             }
 
@@ -270,6 +270,7 @@ typedef struct {
     size_t numTokens;
     size_t lineNum;
     int tokenIndex;
+    DArena *arena;
 } SyntaxContext;
 
 /*
@@ -312,12 +313,34 @@ static void syntax_error(const char *message, SyntaxContext *context) {
     ERROR_COMPILER((contextPtr)->currentFilePath, (contextPtr)->lineNum, true, \
                    __VA_ARGS__)
 
+/* Create a syntax node in the context's arena, if it has one. */
+static SyntaxNode *create_node(SyntaxContext *context, SyntaxDefinition d,
+                               LexToken *info, size_t line) {
+    if (context->arena == NULL) {
+        return d_syntax_create_node(d, info, line);
+    }
+
+    SyntaxNode *n = d_arena_push(context->arena, sizeof(SyntaxNode));
+
+    n->definition = d;
+    n->info       = info;
+    n->child      = NULL;
+    n->sibling    = NULL;
+    n->onLineNum  = line;
+
+    return n;
+}
+
 /* What if a given definition fails? */
-static void fail_definition(SyntaxResult *out) {
+static void fail_definition(SyntaxContext *context, SyntaxResult *out) {
     out->success = false;
 
     if (out->node != NULL) {
-        d_syntax_free_tree(out->node);
+        // Nodes in an arena are freed along with the arena.
+        if (context->arena == NULL) {
+            d_syntax_free_tree(out->node);
+        }
+
         out->node = NULL;
     }
 }
@@ -341,7 +364,8 @@ static void fail_definition(SyntaxResult *out) {
 /* <lineIdentifier> ::= <Line><IntegerLiteral> */
 static SyntaxResult lineIdentifier(SyntaxContext *context) {
     SyntaxResult out;
-    out.node = d_syntax_create_node(STX_lineIdentifier, NULL, context->lineNum);
+    out.node    = create_node(context, STX_lineIdentifier, NULL,
+                              context->lineNum);
     out.success = true;
 
     VERBOSE(5, "ENTER\tlineIdentifier\tWITH\t%i\n",
@@ -352,8 +376,9 @@ static SyntaxResult lineIdentifier(SyntaxContext *context) {
 
         if (context->currentToken->type == TK_INTEGERLITERAL) {
 
-            SyntaxNode *literal = d_syntax_create_node(
-                STX_TOKEN, context->currentToken, context->lineNum);
+            SyntaxNode *literal = create_node(context, STX_TOKEN,
+                                              context->currentToken,
+                                              context->lineNum);
             d_syntax_add_child(out.node, literal);
 
             nextToken(context);
@@ -362,13 +387,13 @@ static SyntaxResult lineIdentifier(SyntaxContext *context) {
             syntax_error(
                 "Expected integer literal to follow the line symbol (#)",
                 context);
-            fail_definition(&out);
+            fail_definition(context, &out);
         }
     } else {
         syntax_error(
             "Expected line identifier to start with the line symbol (#)",
             context);
-        fail_definition(&out);
+        fail_definition(context, &out);
     }
 
     return out;
@@ -377,8 +402,8 @@ static SyntaxResult lineIdentifier(SyntaxContext *context) {
 /* <listOfLineIdentifier> ::= <lineIdentifier>(<Comma><lineIdentifier>)* */
 static SyntaxResult listOfLineIdentifier(SyntaxContext *context) {
     SyntaxResult out;
-    out.node =
-        d_syntax_create_node(STX_listOfLineIdentifier, NULL, context->lineNum);
+    out.node    = create_node(context, STX_listOfLineIdentifier, NULL,
+                              context->lineNum);
     out.success = true;
 
     VERBOSE(5, "ENTER\tlistOfLineIdentifier\tWITH\t%i\n",
@@ -404,7 +429,7 @@ static SyntaxResult listOfLineIdentifier(SyntaxContext *context) {
                 } else {
                     syntax_error("Expected line identifier to follow comma (,)",
                                  context);
-                    fail_definition(&out);
+                    fail_definition(context, &out);
                     break;
                 }
             }
@@ -413,13 +438,13 @@ static SyntaxResult listOfLineIdentifier(SyntaxContext *context) {
             syntax_error("Expected list of line identifiers to start with a "
                          "line identifier",
                          context);
-            fail_definition(&out);
+            fail_definition(context, &out);
         }
     } else {
         syntax_error("Expected list of line identifiers to start with the line "
                      "symbol (#)",
                      context);
-        fail_definition(&out);
+        fail_definition(context, &out);
     }
 
     return out;
@@ -433,20 +458,20 @@ static bool is_data_type(LexType type) {
 
 static SyntaxResult dataType(SyntaxContext *context) {
     SyntaxResult out;
-    out.node    = d_syntax_create_node(STX_dataType, NULL, context->lineNum);
+    out.node    = create_node(context, STX_dataType, NULL, context->lineNum);
     out.success = true;
 
     VERBOSE(5, "ENTER\tdataType\tWITH\t%i\n", context->currentToken->type);
 
     if (is_data_type(context->currentToken->type)) {
-        SyntaxNode *type = d_syntax_create_node(
-            STX_TOKEN, context->currentToken, context->lineNum);
+        SyntaxNode *type = create_node(context, STX_TOKEN,
+                                       context->currentToken, context->lineNum);
         d_syntax_add_child(out.node, type);
 
         nextToken(context);
     } else {
         syntax_error("Expected a data type keyword", context);
-        fail_definition(&out);
+        fail_definition(context, &out);
     }
 
     return out;
@@ -461,20 +486,21 @@ static bool is_literal(LexType type) {
 
 static SyntaxResult literal(SyntaxContext *context) {
     SyntaxResult out;
-    out.node    = d_syntax_create_node(STX_literal, NULL, context->lineNum);
+    out.node    = create_node(context, STX_literal, NULL, context->lineNum);
     out.success = true;
 
     VERBOSE(5, "ENTER\tliteral\tWITH\t%i\n", context->currentToken->type);
 
     if (is_literal(context->currentToken->type)) {
-        SyntaxNode *literal = d_syntax_create_node(
-            STX_TOKEN, context->currentToken, context->lineNum);
+        SyntaxNode *literal = create_node(context, STX_TOKEN,
+                                          context->currentToken,
+                                          context->lineNum);
         d_syntax_add_child(out.node, literal);
 
         nextToken(context);
     } else {
         syntax_error("Expected a literal", context);
-        fail_definition(&out);
+        fail_definition(context, &out);
     }
 
     return out;
@@ -487,14 +513,14 @@ static bool is_argument(LexType type) {
 
 static SyntaxResult argument(SyntaxContext *context) {
     SyntaxResult out;
-    out.node    = d_syntax_create_node(STX_argument, NULL, context->lineNum);
+    out.node    = create_node(context, STX_argument, NULL, context->lineNum);
     out.success = true;
 
     VERBOSE(5, "ENTER\targument\tWITH\t%i\n", context->currentToken->type);
 
     if (context->currentToken->type == TK_NAME) {
-        SyntaxNode *name = d_syntax_create_node(
-            STX_TOKEN, context->currentToken, context->lineNum);
+        SyntaxNode *name = create_node(context, STX_TOKEN,
+                                       context->currentToken, context->lineNum);
         d_syntax_add_child(out.node, name);
 
         nextToken(context);
@@ -505,7 +531,7 @@ static SyntaxResult argument(SyntaxContext *context) {
             d_syntax_add_child(out.node, lit.node);
         } else {
             syntax_error("Invalid literal argument", context);
-            fail_definition(&out);
+            fail_definition(context, &out);
         }
     } else if (context->currentToken->type == TK_LINE) {
         SyntaxResult line = lineIdentifier(context);
@@ -514,12 +540,12 @@ static SyntaxResult argument(SyntaxContext *context) {
             d_syntax_add_child(out.node, line.node);
         } else {
             syntax_error("Invalid line identifier argument", context);
-            fail_definition(&out);
+            fail_definition(context, &out);
         }
     } else {
         syntax_error("Invalid argument: not a name, literal or line identifier",
                      context);
-        fail_definition(&out);
+        fail_definition(context, &out);
     }
 
     return out;
@@ -532,16 +558,16 @@ static bool is_property_argument(LexType type) {
 
 static SyntaxResult propertyArgument(SyntaxContext *context) {
     SyntaxResult out;
-    out.node =
-        d_syntax_create_node(STX_propertyArgument, NULL, context->lineNum);
+    out.node    = create_node(context, STX_propertyArgument, NULL,
+                              context->lineNum);
     out.success = true;
 
     VERBOSE(5, "ENTER\tpropertyArgument\tWITH\t%i\n",
             context->currentToken->type);
 
     if (context->currentToken->type == TK_NAME) {
-        SyntaxNode *name = d_syntax_create_node(
-            STX_TOKEN, context->currentToken, context->lineNum);
+        SyntaxNode *name = create_node(context, STX_TOKEN,
+                                       context->currentToken, context->lineNum);
         d_syntax_add_child(out.node, name);
 
         nextToken(context);
@@ -552,7 +578,7 @@ static SyntaxResult propertyArgument(SyntaxContext *context) {
             d_syntax_add_child(out.node, lit.node);
         } else {
             syntax_error("Invalid literal property argument", context);
-            fail_definition(&out);
+            fail_definition(context, &out);
         }
     } else if (is_data_type(context->currentToken->type)) {
         SyntaxResult type = dataType(context);
@@ -561,13 +587,13 @@ static SyntaxResult propertyArgument(SyntaxContext *context) {
             d_syntax_add_child(out.node, type.node);
         } else {
             syntax_error("Invalid data type property argument", context);
-            fail_definition(&out);
+            fail_definition(context, &out);
         }
     } else {
         syntax_error("Invalid property argument: not a name, literal or data "
                      "type keyword",
                      context);
-        fail_definition(&out);
+        fail_definition(context, &out);
     }
 
     return out;
@@ -576,8 +602,8 @@ static SyntaxResult propertyArgument(SyntaxContext *context) {
 /* <listOfArguments> ::= <argument>(<Comma><argument>)* */
 static SyntaxResult listOfArguments(SyntaxContext *context) {
     SyntaxResult out;
-    out.node =
-        d_syntax_create_node(STX_listOfArguments, NULL, context->lineNum);
+    out.node    = create_node(context, STX_listOfArguments, NULL,
+                              context->lineNum);
     out.success = true;
 
     VERBOSE(5, "ENTER\tlistOfArguments\tWITH\t%i\n",
@@ -600,14 +626,14 @@ static SyntaxResult listOfArguments(SyntaxContext *context) {
             } else {
                 syntax_error("Expected an argument to follow a comma (,)",
                              context);
-                fail_definition(&out);
+                fail_definition(context, &out);
                 break;
             }
         }
     } else {
         syntax_error("Expected an argument to start a list of arguments",
                      context);
-        fail_definition(&out);
+        fail_definition(context, &out);
     }
 
     return out;
@@ -617,8 +643,8 @@ static SyntaxResult listOfArguments(SyntaxContext *context) {
  * <propertyArgument>(<Comma><propertyArgument>)* */
 static SyntaxResult listOfPropertyArguments(SyntaxContext *context) {
     SyntaxResult out;
-    out.node    = d_syntax_create_node(STX_listOfPropertyArguments, NULL,
-                                    context->lineNum);
+    out.node    = create_node(context, STX_listOfPropertyArguments, NULL,
+                              context->lineNum);
     out.success = true;
 
     VERBOSE(5, "ENTER\tlistOfPropertyArguments\tWITH\t%i\n",
@@ -642,7 +668,7 @@ static SyntaxResult listOfPropertyArguments(SyntaxContext *context) {
                 syntax_error(
                     "Expected a property argument to follow a comma (,)",
                     context);
-                fail_definition(&out);
+                fail_definition(context, &out);
                 break;
             }
         }
@@ -650,7 +676,7 @@ static SyntaxResult listOfPropertyArguments(SyntaxContext *context) {
         syntax_error("Expected a property argument to start a list of property "
                      "arguments",
                      context);
-        fail_definition(&out);
+        fail_definition(context, &out);
     }
 
     return out;
@@ -683,14 +709,14 @@ static bool eos(SyntaxContext *context) {
 
 static SyntaxResult statement(SyntaxContext *context) {
     SyntaxResult out;
-    out.node    = d_syntax_create_node(STX_statement, NULL, context->lineNum);
+    out.node    = create_node(context, STX_statement, NULL, context->lineNum);
     out.success = true;
 
     VERBOSE(5, "ENTER\tstatement\tWITH\t%i\n", context->currentToken->type);
 
     if (context->currentToken->type == TK_NAME) {
-        SyntaxNode *name = d_syntax_create_node(
-            STX_TOKEN, context->currentToken, context->lineNum);
+        SyntaxNode *name = create_node(context, STX_TOKEN,
+                                       context->currentToken, context->lineNum);
         d_syntax_add_child(out.node, name);
 
         nextToken(context);
@@ -705,7 +731,7 @@ static SyntaxResult statement(SyntaxContext *context) {
                     d_syntax_add_child(out.node, argList.node);
                 } else {
                     syntax_error("Invalid list of arguments", context);
-                    fail_definition(&out);
+                    fail_definition(context, &out);
                 }
             }
 
@@ -715,7 +741,7 @@ static SyntaxResult statement(SyntaxContext *context) {
                 syntax_error(
                     "Expected list of arguments to end with a right bracket",
                     context);
-                fail_definition(&out);
+                fail_definition(context, &out);
             }
         }
 
@@ -730,7 +756,7 @@ static SyntaxResult statement(SyntaxContext *context) {
                 syntax_error(
                     "Invalid list of line identifiers after output (~)",
                     context);
-                fail_definition(&out);
+                fail_definition(context, &out);
             }
         }
 
@@ -738,11 +764,11 @@ static SyntaxResult statement(SyntaxContext *context) {
             syntax_error(
                 "Expected end-of-statement (\\n, ;) after the statement",
                 context);
-            fail_definition(&out);
+            fail_definition(context, &out);
         }
     } else {
         syntax_error("Expected statement to start with a name", context);
-        fail_definition(&out);
+        fail_definition(context, &out);
     }
 
     return out;
@@ -753,8 +779,8 @@ static SyntaxResult statement(SyntaxContext *context) {
  */
 static SyntaxResult propertyStatement(SyntaxContext *context) {
     SyntaxResult out;
-    out.node =
-        d_syntax_create_node(STX_propertyStatement, NULL, context->lineNum);
+    out.node    = create_node(context, STX_propertyStatement, NULL,
+                              context->lineNum);
     out.success = true;
 
     VERBOSE(5, "ENTER\tpropertyStatement\tWITH\t%i\n",
@@ -764,8 +790,9 @@ static SyntaxResult propertyStatement(SyntaxContext *context) {
         nextToken(context);
 
         if (context->currentToken->type == TK_NAME) {
-            SyntaxNode *name = d_syntax_create_node(
-                STX_TOKEN, context->currentToken, context->lineNum);
+            SyntaxNode *name = create_node(context, STX_TOKEN,
+                                           context->currentToken,
+                                           context->lineNum);
             d_syntax_add_child(out.node, name);
 
             nextToken(context);
@@ -781,7 +808,7 @@ static SyntaxResult propertyStatement(SyntaxContext *context) {
                     } else {
                         syntax_error("Invalid list of property arguments",
                                      context);
-                        fail_definition(&out);
+                        fail_definition(context, &out);
                     }
                 }
 
@@ -791,7 +818,7 @@ static SyntaxResult propertyStatement(SyntaxContext *context) {
                     syntax_error("Expected list of property arguments to end "
                                  "with a right bracket",
                                  context);
-                    fail_definition(&out);
+                    fail_definition(context, &out);
                 }
             }
 
@@ -802,29 +829,45 @@ static SyntaxResult propertyStatement(SyntaxContext *context) {
                     syntax_error("Expected end-of-statement (\\n, ;) after the "
                                  "property statement",
                                  context);
-                    fail_definition(&out);
+                    fail_definition(context, &out);
                 }
             } else {
                 syntax_error("Expected property statement to end with a right "
                              "squared bracket (])",
                              context);
-                fail_definition(&out);
+                fail_definition(context, &out);
             }
         } else {
             syntax_error("Expected property statement to start with a name",
                          context);
-            fail_definition(&out);
+            fail_definition(context, &out);
         }
     } else {
         syntax_error("Expected property statement to start with a left squared "
                      "bracket ([)",
                      context);
-        fail_definition(&out);
+        fail_definition(context, &out);
     }
 
     return out;
 }
 
+/* Add a statement to the end of the program node in constant time. */
+static void add_statement(SyntaxNode *program, SyntaxNode **lastStatement,
+                          SyntaxNode *statement) {
+    if (statement == NULL) {
+        return;
+    }
+
+    if (*lastStatement == NULL) {
+        d_syntax_add_child(program, statement);
+    } else {
+        (*lastStatement)->sibling = statement;
+    }
+
+    *lastStatement = statement;
+}
+
 /* <program> ::= (NULL|<eos>)(<statement>|<propertyStatement>)* */
 static bool is_statement(LexType type) {
     return (type == TK_NAME || type == TK_LPROPERTY);
@@ -832,7 +875,7 @@ static bool is_statement(LexType type) {
 
 static SyntaxResult program(SyntaxContext *context) {
     SyntaxResult out;
-    out.node    = d_syntax_create_node(STX_program, NULL, context->lineNum);
+    out.node    = create_node(context, STX_program, NULL, context->lineNum);
     out.success = true;
 
     VERBOSE(5, "ENTER\tprogram\tWITH\t%i\n", context->currentToken->type);
@@ -845,26 +888,30 @@ static SyntaxResult program(SyntaxContext *context) {
         return out;
     }
 
+    // Keep track of the last statement, so we don't have to go through all of
+    // the previous statements to add a new one.
+    SyntaxNode *lastStatement = NULL;
+
     while (is_statement(context->currentToken->type)) {
         SyntaxResult s;
         if (context->currentToken->type == TK_NAME) {
             s = statement(context);
 
             if (s.success) {
-                d_syntax_add_child(out.node, s.node);
+                add_statement(out.node, &lastStatement, s.node);
             } else {
                 syntax_error("Invalid statement", context);
-                fail_definition(&out);
+                fail_definition(context, &out);
                 break;
             }
         } else if (context->currentToken->type == TK_LPROPERTY) {
             s = propertyStatement(context);
 
             if (s.success) {
-                d_syntax_add_child(out.node, s.node);
+                add_statement(out.node, &lastStatement, s.node);
             } else {
                 syntax_error("Invalid property statement", context);
-                fail_definition(&out);
+                fail_definition(context, &out);
                 break;
             }
         }
@@ -875,7 +922,7 @@ static SyntaxResult program(SyntaxContext *context) {
         syntax_error("Expected statement to start with a name or a left square "
                      "bracket ([) for a property",
                      context);
-        fail_definition(&out);
+        fail_definition(context, &out);
     }
 
     return out;
@@ -962,16 +1009,21 @@ DECISION_API void d_syntax_free_results(SyntaxSearchResult results) {
 }
 
 /**
- * \fn SyntaxResult d_syntax_parse(LexStream stream, const char *filePath)
+ * \fn SyntaxResult d_syntax_parse(LexStream stream, const char *filePath,
+ *                                 DArena *arena)
  * \brief Parse a lexical stream, and generate a syntax tree.
  *
- * \return The malloc'd root node of the syntax tree, and whether the parsing
- * was successful or not.
+ * \return The root node of the syntax tree, and whether the parsing was
+ * successful or not.
  *
  * \param stream The stream to parse from.
  * \param filePath In case we error, say what the file path was.
+ * \param arena The arena to allocate the nodes of the tree in, so the whole
+ * tree can be freed with `d_arena_free`. If `NULL`, the nodes are malloc'd,
+ * and the tree should be freed with `d_syntax_free_tree`.
  */
-SyntaxResult d_syntax_parse(LexStream stream, const char *filePath) {
+SyntaxResult d_syntax_parse(LexStream stream, const char *filePath,
+                            DArena *arena) {
     // Creating the syntax context structure.
     SyntaxContext context;
     context.lexicalStream   = stream;
@@ -980,6 +1032,7 @@ SyntaxResult d_syntax_parse(LexStream stream, const char *filePath) {
     context.tokenIndex      = -1;
     context.lineNum         = 1;
     context.currentFilePath = filePath;
+    context.arena           = arena;
 
     // Set currentToken to the first token.
     nextToken(&context);
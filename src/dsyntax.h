@@ -40,6 +40,9 @@ struct _lexToken;
 /* Forward declaration of the LexStream struct from dlex.h */
 struct _lexStream;
 
+/* Forward declaration of the DArena struct from dmalloc.h */
+struct _dArena;
+
 /**
  * \enum _syntaxDefinition
  * \brief An enum for each kind of syntax definition.
@@ -231,16 +234,21 @@ DECISION_API void d_syntax_free_tree(SyntaxNode *root);
 DECISION_API void d_syntax_free_results(SyntaxSearchResult results);
 
 /**
- * \fn SyntaxResult d_syntax_parse(LexStream stream, const char *filePath)
+ * \fn SyntaxResult d_syntax_parse(LexStream stream, const char *filePath,
+ *                                 DArena *arena)
  * \brief Parse a lexical stream, and generate a syntax tree.
  *
- * \return The malloc'd root node of the syntax tree, and whether the parsing
- * was successful or not.
+ * \return The root node of the syntax tree, and whether the parsing was
+ * successful or not.
  *
  * \param stream The stream to parse from.
  * \param filePath In case we error, say what the file path was.
+ * \param arena The arena to allocate the nodes of the tree in, so the whole
+ * tree can be freed with `d_arena_free`. If `NULL`, the nodes are malloc'd,
+ * and the tree should be freed with `d_syntax_free_tree`.
  */
 DECISION_API SyntaxResult d_syntax_parse(struct _lexStream stream,
-                                         const char *filePath);
+                                         const char *filePath,
+                                         struct _dArena *arena);
 
 #endif // DSYNTAX_H
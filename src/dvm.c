@@ -19,12 +19,33 @@
 #include "dvm.h"
 
 #include "dcfunc.h"
+#include "dcontext.h"
 #include "dmalloc.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+/*
+    If `DECISION_GUARDED_STACK` is defined (see the `COMPILER_GUARDED_STACK`
+    CMake option), and the platform supports it, the VM's stack is a large
+    reservation of address space, where only the part that is being used is
+    accessible. Pushing past the end of the usable part hits an inaccessible
+    page, and the signal handler either makes more of the stack accessible, or
+    stops the VM with a "stack overflow" runtime error. This means the run
+    loop does not need to check the size of the stack before pushing, and the
+    stack never moves.
+*/
+#if defined(DECISION_GUARDED_STACK) && (defined(__unix__) || defined(__APPLE__))
+#define VM_USE_GUARDED_STACK
+
+#include <pthread.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 /* A constant array of the size of each opcode's instruction in bytes. */
 static const unsigned char VM_INS_SIZE[NUM_OPCODES] = {
     1,                                     // OP_RET
@@ -120,12 +141,208 @@ static const unsigned char VM_INS_SIZE[NUM_OPCODES] = {
     1 + BIMMEDIATE_SIZE,                   // OP_XORBI
     1 + HIMMEDIATE_SIZE,                   // OP_XORHI
     1 + FIMMEDIATE_SIZE,                   // OP_XORFI
+    2 * (1 + BIMMEDIATE_SIZE),             // OP_ADDBI_JRBI
+    1 + 1 + BIMMEDIATE_SIZE,               // OP_CEQ_JRCONBI
+    1 + 1 + BIMMEDIATE_SIZE,               // OP_CLEQ_JRCONBI
+    1 + 1 + BIMMEDIATE_SIZE,               // OP_CLT_JRCONBI
+    1 + 1 + BIMMEDIATE_SIZE,               // OP_CMEQ_JRCONBI
+    1 + 1 + BIMMEDIATE_SIZE,               // OP_CMT_JRCONBI
+    2 * (1 + BIMMEDIATE_SIZE),             // OP_GETBI_ADDBI
+    2 * (1 + BIMMEDIATE_SIZE),             // OP_GETBI_GETBI
+    2 * (1 + BIMMEDIATE_SIZE) + 1,         // OP_GETBI_GETBI_ADD
+    2 * (1 + BIMMEDIATE_SIZE),             // OP_GETBI_SUBBI
+    2 * (1 + BIMMEDIATE_SIZE),             // OP_PUSHB_GETBI
+    2 * (1 + BIMMEDIATE_SIZE),             // OP_PUSHB_SYSCALL
+    1 + BIMMEDIATE_SIZE + 1,               // OP_SYSCALL_POP
+};
+
+/* The list of superinstructions, and the sequences of opcodes they replace.
+   These were picked by counting the most common sequences in the tests with
+   `decision --sequence-stats`, and by looking at what the hot loops of the
+   examples are made of.
+
+   NOTE: Longer sequences should come before shorter ones that they start
+   with, since the optimiser uses the first one that matches. */
+#define NUM_SUPERINS 13
+static const SuperIns VM_SUPERINS[NUM_SUPERINS] = {
+    {OP_GETBI_GETBI_ADD, {OP_GETBI, OP_GETBI, OP_ADD}, 3},
+    {OP_GETBI_GETBI, {OP_GETBI, OP_GETBI}, 2},
+    {OP_GETBI_ADDBI, {OP_GETBI, OP_ADDBI}, 2},
+    {OP_GETBI_SUBBI, {OP_GETBI, OP_SUBBI}, 2},
+    {OP_PUSHB_GETBI, {OP_PUSHB, OP_GETBI}, 2},
+    {OP_PUSHB_SYSCALL, {OP_PUSHB, OP_SYSCALL}, 2},
+    {OP_SYSCALL_POP, {OP_SYSCALL, OP_POP}, 2},
+    {OP_CEQ_JRCONBI, {OP_CEQ, OP_JRCONBI}, 2},
+    {OP_CLEQ_JRCONBI, {OP_CLEQ, OP_JRCONBI}, 2},
+    {OP_CLT_JRCONBI, {OP_CLT, OP_JRCONBI}, 2},
+    {OP_CMEQ_JRCONBI, {OP_CMEQ, OP_JRCONBI}, 2},
+    {OP_CMT_JRCONBI, {OP_CMT, OP_JRCONBI}, 2},
+    {OP_ADDBI_JRBI, {OP_ADDBI, OP_JRBI}, 2},
 };
 
 /*
 === STACK FUNCTIONS =======================================
 */
 
+#ifdef VM_USE_GUARDED_STACK
+
+/**
+ * \def VM_GUARDED_STACK_RESERVE
+ * \brief How many bytes of address space a guarded stack reserves, i.e. the
+ * largest the stack can grow to.
+ */
+#if UINTPTR_MAX > 0xffffffff
+#define VM_GUARDED_STACK_RESERVE ((size_t)1 << 30)
+#else
+#define VM_GUARDED_STACK_RESERVE ((size_t)1 << 26)
+#endif
+
+/* The VM that is currently running on this thread, and where to jump to if
+   its stack overflows. Signals are delivered to the thread that faulted, so
+   each thread only ever sees its own VM. */
+static D_THREAD_LOCAL DVM *guardedVM          = NULL;
+static D_THREAD_LOCAL sigjmp_buf *guardedJump = NULL;
+
+/* The size of a page of memory, and the signal handlers that were set before
+   ours was installed. These are only set once, by whichever thread creates a
+   guarded stack first. */
+static pthread_once_t guardOnce = PTHREAD_ONCE_INIT;
+static size_t guardPageSize     = 0;
+static struct sigaction prevSegvAction;
+static struct sigaction prevBusAction;
+
+/**
+ * \fn static size_t vm_guard_round(size_t numBytes)
+ * \brief Round a number of bytes up to a multiple of the page size.
+ *
+ * \return The rounded number of bytes.
+ *
+ * \param numBytes The number of bytes to round up.
+ */
+static size_t vm_guard_round(size_t numBytes) {
+    return (numBytes + guardPageSize - 1) / guardPageSize * guardPageSize;
+}
+
+/**
+ * \fn static void vm_guard_commit(DVM *vm, duint size)
+ * \brief Make the first `size` elements of a guarded stack accessible, and
+ * make the rest inaccessible.
+ *
+ * **NOTE:** This is called from the signal handler, so it must only use
+ * functions that are safe to call from there.
+ *
+ * \param vm The VM whose stack to set the size of.
+ * \param size The size the stack should be set to. This is capped to the size
+ * of the reservation.
+ */
+static void vm_guard_commit(DVM *vm, duint size) {
+    const duint maxSize = (duint)(VM_GUARDED_STACK_RESERVE / sizeof(dint) - 1);
+    if (size > maxSize) {
+        size = maxSize;
+    }
+
+    // Remember the element below the base pointer.
+    char *start = (char *)(vm->basePtr - 1);
+
+    const size_t oldBytes = vm_guard_round((vm->stackSize + 1) * sizeof(dint));
+    const size_t newBytes = vm_guard_round((size + 1) * sizeof(dint));
+
+    if (newBytes > oldBytes) {
+        mprotect(start + oldBytes, newBytes - oldBytes, PROT_READ | PROT_WRITE);
+    } else if (newBytes < oldBytes) {
+        // Give the memory back to the OS as well.
+        madvise(start + newBytes, oldBytes - newBytes, MADV_DONTNEED);
+        mprotect(start + newBytes, oldBytes - newBytes, PROT_NONE);
+    }
+
+    vm->stackSize = size;
+}
+
+/**
+ * \fn static void vm_guard_handler(int sig, siginfo_t *info, void *context)
+ * \brief The signal handler for when a guarded stack is accessed beyond its
+ * accessible part.
+ *
+ * \param sig The signal number.
+ * \param info Information about the signal, including the faulting address.
+ * \param context The context of the signal.
+ */
+static void vm_guard_handler(int sig, siginfo_t *info, void *context) {
+    DVM *vm    = guardedVM;
+    char *addr = (char *)info->si_addr;
+
+    if (vm != NULL && vm->basePtr != NULL) {
+        char *start = (char *)(vm->basePtr - 1);
+        char *end   = start + VM_GUARDED_STACK_RESERVE;
+
+        // Where the accessible part of the stack ends.
+        char *limit =
+            start + vm_guard_round((vm->stackSize + 1) * sizeof(dint));
+
+        if (addr >= limit && addr < end) {
+            // The stack needs to grow, plus a bit extra. Once we return, the
+            // instruction that faulted is run again.
+            const size_t index = ((dint *)addr - vm->basePtr) + 1;
+            vm_guard_commit(vm, (duint)(index * VM_STACK_SIZE_SCALE_INC));
+            vm->numStackReallocs++;
+            return;
+        } else if (addr >= end && addr < end + guardPageSize &&
+                   guardedJump != NULL) {
+            // We've hit the guard page at the end of the reservation.
+            siglongjmp(*guardedJump, 1);
+        }
+    }
+
+    // This fault has nothing to do with us, so give it to whoever was
+    // handling it before.
+    struct sigaction *prev =
+        (sig == SIGSEGV) ? &prevSegvAction : &prevBusAction;
+
+    if (prev->sa_flags & SA_SIGINFO) {
+        prev->sa_sigaction(sig, info, context);
+    } else if (prev->sa_handler != SIG_DFL && prev->sa_handler != SIG_IGN) {
+        prev->sa_handler(sig);
+    } else {
+        // Returning will run the faulting instruction again, which will then
+        // fault with the default behaviour.
+        sigaction(sig, prev, NULL);
+    }
+}
+
+/**
+ * \fn static void vm_guard_setup()
+ * \brief Find the page size, and install the signal handlers for guarded
+ * stacks.
+ *
+ * **NOTE:** This must only be called once, through `vm_guard_install`.
+ */
+static void vm_guard_setup() {
+    guardPageSize = (size_t)sysconf(_SC_PAGESIZE);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = vm_guard_handler;
+    action.sa_flags     = SA_SIGINFO | SA_NODEFER;
+    sigemptyset(&action.sa_mask);
+
+    sigaction(SIGSEGV, &action, &prevSegvAction);
+    sigaction(SIGBUS, &action, &prevBusAction);
+}
+
+/**
+ * \fn static void vm_guard_install()
+ * \brief Install the signal handlers for guarded stacks, if they haven't been
+ * installed already.
+ *
+ * This is safe to call from several threads at once: only one of them sets
+ * things up, and the rest wait for it to finish.
+ */
+static void vm_guard_install() {
+    pthread_once(&guardOnce, vm_guard_setup);
+}
+
+#endif // VM_USE_GUARDED_STACK
+
 /**
  * \fn static void vm_set_stack_size_to(DVM *vm, duint size)
  * \brief Set the VM's stack size.
@@ -135,12 +352,42 @@ static const unsigned char VM_INS_SIZE[NUM_OPCODES] = {
  * it contain?
  */
 static void vm_set_stack_size_to(DVM *vm, duint size) {
+#ifdef VM_USE_GUARDED_STACK
+    if (vm->basePtr == NULL) {
+        vm_guard_install();
+
+        // Reserve the address space for the whole stack, plus a guard page
+        // at the end which never becomes accessible.
+        void *start =
+            mmap(NULL, VM_GUARDED_STACK_RESERVE + guardPageSize, PROT_NONE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+        if (start == MAP_FAILED) {
+            printf("Fatal: mmap failed to reserve the VM stack\n");
+            exit(1);
+        }
+
+        // Make the first element accessible, so vm_guard_commit knows where
+        // the accessible part of the stack starts.
+        mprotect(start, guardPageSize, PROT_READ | PROT_WRITE);
+
+        vm->basePtr   = (dint *)start + 1;
+        vm->stackSize = 0;
+    } else if (size != vm->stackSize) {
+        vm->numStackReallocs++;
+    }
+
+    vm_guard_commit(vm, size);
+#else
     vm->stackSize = size;
 
-    const size_t newAlloc = size * sizeof(dint);
+    // There is always one extra element allocated below the base pointer, so
+    // that the VM can read the "top" of an empty stack without checking if
+    // the stack is empty first.
+    const size_t newAlloc = (size + 1) * sizeof(dint);
 
     if (vm->basePtr == NULL) {
-        vm->basePtr = d_calloc(size, sizeof(dint));
+        vm->basePtr = (dint *)d_calloc(size + 1, sizeof(dint)) + 1;
     } else {
         // The problem with reallocing the base pointer is that it can move,
         // which would invalidate both the stack pointer and the frame
@@ -148,11 +395,13 @@ static void vm_set_stack_size_to(DVM *vm, duint size) {
         ptrdiff_t stackDiff = vm->stackPtr - vm->basePtr;
         ptrdiff_t frameDiff = vm->framePtr - vm->basePtr;
 
-        vm->basePtr = d_realloc(vm->basePtr, newAlloc);
+        vm->basePtr = (dint *)d_realloc(vm->basePtr - 1, newAlloc) + 1;
+        vm->numStackReallocs++;
 
         vm->stackPtr = vm->basePtr + stackDiff;
         vm->framePtr = vm->basePtr + frameDiff;
     }
+#endif // VM_USE_GUARDED_STACK
 }
 
 /**
@@ -169,25 +418,6 @@ static void vm_increase_stack_size(DVM *vm) {
     }
 }
 
-/**
- * \fn static void vm_decrease_stack_size(DVM *vm)
- * \brief Decrease the size of the stack by `VM_STACK_SIZE_SCALE_DEC`.
- * Note that the size cannot go lower than `VM_STACK_SIZE_MIN`.
- *
- * \param vm The VM of the stack to decrease the size of.
- */
-static void vm_decrease_stack_size(DVM *vm) {
-    duint newSize = (duint)(vm->stackSize * VM_STACK_SIZE_SCALE_DEC);
-
-    if (newSize < VM_STACK_SIZE_MIN) {
-        newSize = VM_STACK_SIZE_MIN;
-    }
-
-    if (newSize < vm->stackSize) {
-        vm_set_stack_size_to(vm, newSize);
-    }
-}
-
 /**
  * \def VM_GET_FRAME_PTR(vm, index)
  * \brief Get a pointer relative to the VM's frame pointer.
@@ -443,11 +673,9 @@ void d_vm_popn(DVM *vm, size_t n) {
             n = maxN;
         }
 
+        // NOTE: The stack is not shrunk here, otherwise pushing and popping
+        // around the same size would realloc the stack over and over.
         vm->stackPtr = vm->stackPtr - n;
-
-        if (maxN - n < (size_t)(vm->stackSize * VM_STACK_SIZE_SCALE_DEC)) {
-            vm_decrease_stack_size(vm);
-        }
     }
 }
 
@@ -704,6 +932,66 @@ unsigned char d_vm_ins_size(DIns opcode) {
     return (const unsigned char)VM_INS_SIZE[opcode];
 }
 
+/**
+ * \fn bool d_vm_ins_changes_flow(DIns opcode)
+ * \brief Given an opcode, could the instruction not carry on to the next
+ * instruction, i.e. is it a jump, a call or a return?
+ *
+ * \return If the instruction could change the flow of execution.
+ *
+ * \param opcode The opcode to query.
+ */
+bool d_vm_ins_changes_flow(DIns opcode) {
+    switch (opcode) {
+        case OP_RET:
+        case OP_RETN:
+        case OP_CALL:
+        case OP_CALLC:
+        case OP_CALLCI:
+        case OP_CALLI:
+        case OP_CALLR:
+        case OP_CALLRB:
+        case OP_CALLRH:
+        case OP_CALLRF:
+        case OP_J:
+        case OP_JCON:
+        case OP_JCONI:
+        case OP_JI:
+        case OP_JR:
+        case OP_JRBI:
+        case OP_JRHI:
+        case OP_JRFI:
+        case OP_JRCON:
+        case OP_JRCONBI:
+        case OP_JRCONHI:
+        case OP_JRCONFI:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+/**
+ * \fn const SuperIns *d_vm_superins(DIns opcode)
+ * \brief Given an opcode, get the sequence of opcodes it replaces if it is a
+ * superinstruction.
+ *
+ * \return The superinstruction, or `NULL` if the opcode is not a
+ * superinstruction.
+ *
+ * \param opcode The opcode to query.
+ */
+const SuperIns *d_vm_superins(DIns opcode) {
+    for (size_t i = 0; i < NUM_SUPERINS; i++) {
+        if (VM_SUPERINS[i].opcode == opcode) {
+            return VM_SUPERINS + i;
+        }
+    }
+
+    return NULL;
+}
+
 /**
  * \fn DVM d_vm_create()
  * \brief Create a Decision VM in its starting state, with malloc'd elements.
@@ -711,8 +999,31 @@ unsigned char d_vm_ins_size(DIns opcode) {
  * \return A Decision VM in its starting state.
  */
 DVM d_vm_create() {
+    return d_vm_create_with_capacity(VM_STACK_SIZE_MIN);
+}
+
+/**
+ * \fn DVM d_vm_create_with_capacity(duint capacity)
+ * \brief Create a Decision VM in its starting state, with a stack that can
+ * hold `capacity` elements before it needs to grow.
+ *
+ * \return A Decision VM in its starting state.
+ *
+ * \param capacity The initial size of the stack. If this is less than
+ * `VM_STACK_SIZE_MIN`, then `VM_STACK_SIZE_MIN` is used instead.
+ */
+DVM d_vm_create_with_capacity(duint capacity) {
     DVM vm;
 
+    if (capacity < VM_STACK_SIZE_MIN) {
+        capacity = VM_STACK_SIZE_MIN;
+    }
+
+    vm.stackSize        = 0;
+    vm.initialStackSize = capacity;
+    vm.numStackReallocs = 0;
+    vm.shrinkOnReset    = true;
+
     // In order to set the VM to its starting state, we just need to set the
     // base stack pointer to NULL, and d_vm_reset will do the rest for us.
     // Setting the pointer to NULL will force d_vm_reset to malloc a new stack.
@@ -730,10 +1041,14 @@ DVM d_vm_create() {
  * \param vm A Decision VM to set to its starting state.
  */
 void d_vm_reset(DVM *vm) {
-    vm->pc      = 0;
-    vm->_inc_pc = 0;
+    vm->pc       = 0;
+    vm->_inc_pc  = 0;
+    vm->_decoded = NULL;
 
-    vm_set_stack_size_to(vm, VM_STACK_SIZE_MIN);
+    if (vm->basePtr == NULL ||
+        (vm->shrinkOnReset && vm->stackSize != vm->initialStackSize)) {
+        vm_set_stack_size_to(vm, vm->initialStackSize);
+    }
 
     dint *ptr    = vm->basePtr - 1;
     vm->stackPtr = ptr;
@@ -752,7 +1067,11 @@ void d_vm_reset(DVM *vm) {
  */
 void d_vm_free(DVM *vm) {
     if (vm->basePtr != NULL) {
-        free(vm->basePtr);
+#ifdef VM_USE_GUARDED_STACK
+        munmap(vm->basePtr - 1, VM_GUARDED_STACK_RESERVE + guardPageSize);
+#else
+        free(vm->basePtr - 1);
+#endif // VM_USE_GUARDED_STACK
         vm->basePtr = NULL;
     }
 }
@@ -773,719 +1092,1828 @@ void d_vm_runtime_error(DVM *vm, const char *error) {
 }
 
 /*
-    NOTE: The following helper macros are used extensively in
-    d_vm_parse_ins_at_pc. Since this function is going to be called a LOT,
-    these helper macros need to be as efficient as possible. This means things
-    like using as few functions as possible, making as less calculations as
-    possible, etc.
+=== INSTRUCTION DECODING ==================================
 */
 
-/**
- * \def GET_IMMEDIATE(tm, offset)
- * \brief A helper macro for getting a generic immediate value.
- */
-#define GET_IMMEDIATE(t, offset) (*((t *)(vm->pc + (offset))))
-
-/**
- * \def GET_BIMMEDIATE(offset)
- * \brief A helper macro for getting a byte immediate.
- */
-#define GET_BIMMEDIATE(offset) GET_IMMEDIATE(bimmediate_t, offset)
-
-/**
- * \def GET_HIMMEDIATE(offset)
- * \brief A helper macro for getting a half immediate.
- */
-#define GET_HIMMEDIATE(offset) GET_IMMEDIATE(himmediate_t, offset)
+/* The addresses of the opcode handlers, if the VM uses computed gotos. This
+   is set the first time that vm_execute is called with a NULL VM. */
+static const void *const *vmHandlers = NULL;
 
-/**
- * \def GET_FIMMEDIATE(offset)
- * \brief A helper macro for getting a full immediate.
- */
-#define GET_FIMMEDIATE(offset) GET_IMMEDIATE(fimmediate_t, offset)
+/* The list of decoded text sections that the VM can use, sorted by the
+   address of their text sections. Sheets can be linked on one thread while
+   others are running, so the list is only used while holding
+   LOCK_DECODED_TEXTS. */
+static DecodedText **decodedTexts = NULL;
+static size_t numDecodedTexts     = 0;
 
-/**
- * \def OP_1_1_I(sym, fun)
- * \brief A helper macro for opcodes with 1 input and 1 output involving
- * integers, and an immediate.
- */
-#define OP_1_1_I(sym, fun)                   \
-    {                                        \
-        dint *top = VM_GET_STACK_PTR(vm, 0); \
-        *top      = *top sym fun(1);         \
-    }
+static void vm_execute(DVM *vm, DecodedIns *ins, const bool step);
 
 /**
- * \def OP_2_1(sym)
- * \brief A helper macro for opcodes with 2 inputs and 1 output involving
- * integers.
+ * \fn static size_t find_text_index(const char *pc)
+ * \brief Find where a location would go in the list of decoded text sections,
+ * while already holding `LOCK_DECODED_TEXTS`.
+ *
+ * \return The index of the first decoded text section whose text starts after
+ * `pc`.
+ *
+ * \param pc The location to find.
  */
-#define OP_2_1(sym)                                                  \
-    {                                                                \
-        dint value = (VM_GET_STACK(vm, 0) sym VM_GET_STACK(vm, -1)); \
-        *VM_GET_STACK_PTR(vm, -1) = value;                           \
-        d_vm_popn(vm, 1);                                            \
-    }
+static size_t find_text_index(const char *pc) {
+    size_t left  = 0;
+    size_t right = numDecodedTexts;
 
-/**
- * \def OP_2_1_F(sym)
- * \brief A helper macro for opcodes with 2 inputs and 1 output involving
- * floats.
- */
-#define OP_2_1_F(sym)                                                   \
-    {                                                                   \
-        dfloat value =                                                  \
-            (VM_GET_STACK_FLOAT(vm, 0) sym VM_GET_STACK_FLOAT(vm, -1)); \
-        *VM_GET_STACK_FLOAT_PTR(vm, -1) = value;                        \
-        d_vm_popn(vm, 1);                                               \
-    }
+    while (left < right) {
+        const size_t middle = left + (right - left) / 2;
 
-/**
- * \def OP_2_1_C(sym)
- * \brief A helper macro for opcodes with 2 inputs and 1 output involving
- * comparisons with floats.
- */
-#define OP_2_1_C(sym)                                                   \
-    {                                                                   \
-        dint value =                                                    \
-            (VM_GET_STACK_FLOAT(vm, 0) sym VM_GET_STACK_FLOAT(vm, -1)); \
-        *VM_GET_STACK_PTR(vm, -1) = value;                              \
-        d_vm_popn(vm, 1);                                               \
+        if (decodedTexts[middle]->text <= pc) {
+            left = middle + 1;
+        } else {
+            right = middle;
+        }
     }
 
-/**
- * \def CALL_GENERIC(sym, newPC, offset)
- * \brief A generic helper macro for call opcodes.
- */
-#define CALL_GENERIC(sym, newPC, offset)                                  \
-    {                                                                     \
-        const uint8_t numArguments = (uint8_t)GET_BIMMEDIATE(offset);     \
-        char *returnAdr = vm->pc + VM_INS_SIZE[(unsigned char)*(vm->pc)]; \
-        vm->pc sym newPC;                                                 \
-        dint *insertPtr     = vm->stackPtr - numArguments + 1;            \
-        ptrdiff_t baseIndex = insertPtr - vm->basePtr;                    \
-        VM_INSERT_LEN(vm, baseIndex, 2, numArguments)                     \
-        insertPtr  = vm->basePtr + baseIndex;                             \
-        *insertPtr = (dint)(vm->framePtr - vm->basePtr);                  \
-        insertPtr++;                                                      \
-        *insertPtr   = (dint)returnAdr;                                   \
-        vm->framePtr = insertPtr;                                         \
-        vm->_inc_pc  = 0;                                                 \
-    }
+    return left;
+}
 
 /**
- * \def CALL_1_0(sym)
- * \brief A helper macro for call opcodes with 1 input and 0 outputs.
+ * \fn static DecodedText *find_decoded_text(const char *pc)
+ * \brief Find the decoded text section that a location is in, while already
+ * holding `LOCK_DECODED_TEXTS`.
  *
- * **NOTE:** Here we just decrement the stack pointer instead of using
- * `d_vm_popn`, since `VM_INSERT_LEN` pushed 2 times, it makes an overall
- * difference of 1 element being pushed on, so the stack should not have to be
- * decreased in size. This is simply an optimisation.
- */
-#define CALL_1_0(sym)                              \
-    {                                              \
-        CALL_GENERIC(sym, VM_GET_STACK(vm, 0), 1); \
-        vm->stackPtr--;                            \
-    }
-
-/**
- * \def CALL_0_0_BI(sym)
- * \brief A helper macro for call opcodes with 0 inputs and 0 outputs,
- * involving a byte immediate.
- */
-#define CALL_0_0_BI(sym) \
-    CALL_GENERIC(sym, GET_BIMMEDIATE(1), 1 + BIMMEDIATE_SIZE)
-
-/**
- * \def CALL_0_0_HI(sym)
- * \brief A helper macro for call opcodes with 0 inputs and 0 outputs,
- * involving a half immediate.
+ * \return The decoded text section, or `NULL` if there isn't one.
+ *
+ * \param pc The location in a text section.
  */
-#define CALL_0_0_HI(sym) \
-    CALL_GENERIC(sym, GET_HIMMEDIATE(1), 1 + HIMMEDIATE_SIZE)
+static DecodedText *find_decoded_text(const char *pc) {
+    const size_t index = find_text_index(pc);
 
-/**
- * \def CALL_0_0_FI(sym)
- * \brief A helper macro for call opcodes with 0 inputs and 0 outputs,
- * involving a full immediate.
- */
-#define CALL_0_0_FI(sym) \
-    CALL_GENERIC(sym, GET_FIMMEDIATE(1), 1 + FIMMEDIATE_SIZE)
+    if (index > 0) {
+        DecodedText *decoded = decodedTexts[index - 1];
 
-/**
- * \def J_0_0_I(sym)
- * \brief A helper macro for jump opcodes with 0 inputs and 0 outputs, and an
- * immediate.
- */
-#define J_0_0_I(sym, fun)  \
-    {                      \
-        vm->pc sym fun(1); \
-        vm->_inc_pc = 0;   \
+        if (pc < decoded->text + decoded->textSize) {
+            return decoded;
+        }
     }
 
+    return NULL;
+}
+
 /**
- * \def J_1_0(sym)
- * \brief A helper macro for jump opcodes with 1 input and 0 outputs.
+ * \fn static DecodedIns *find_decoded_ins(const char *pc)
+ * \brief Find the decoded version of the instruction at a location in a text
+ * section, while already holding `LOCK_DECODED_TEXTS`.
+ *
+ * \return The decoded instruction, or `NULL` if the text section hasn't been
+ * decoded, or `pc` isn't the start of an instruction.
+ *
+ * \param pc The location of the instruction in a text section.
  */
-#define J_1_0(sym)                      \
-    {                                   \
-        vm->pc sym VM_GET_STACK(vm, 0); \
-        d_vm_popn(vm, 1);               \
-        vm->_inc_pc = 0;                \
-    }
+static DecodedIns *find_decoded_ins(const char *pc) {
+    DecodedText *decoded = find_decoded_text(pc);
+    return (decoded != NULL) ? decoded->insAt[pc - decoded->text] : NULL;
+}
 
 /**
- * \def JCON_1_0_I(sym, fun)
- * \brief A helper macro for jump condition opcodes with 1 input and 0 outputs,
- * and an immediate.
+ * \fn static bool in_decoded_text(DecodedText *decoded, DecodedIns *ins)
+ * \brief Check if a decoded instruction belongs to a decoded text section.
+ *
+ * \return If `ins` is one of the instructions of `decoded`.
+ *
+ * \param decoded The decoded text section.
+ * \param ins The decoded instruction.
  */
-#define JCON_1_0_I(sym, fun)       \
-    {                              \
-        if (VM_GET_STACK(vm, 0)) { \
-            vm->pc sym fun(1);     \
-            vm->_inc_pc = 0;       \
-        }                          \
-        d_vm_popn(vm, 1);          \
-    }
+static bool in_decoded_text(DecodedText *decoded, DecodedIns *ins) {
+    return ins >= decoded->ins && ins <= decoded->ins + decoded->numIns;
+}
 
 /**
- * \def JCON_2_0(sym)
- * \brief A helper macro for jump condition opcodes with 2 inputs and 0 outputs.
+ * \def DECODE_IMMEDIATE(t, pc, offset)
+ * \brief A helper macro for reading an immediate from the text section.
  */
-#define JCON_2_0(sym)                        \
-    {                                        \
-        if (VM_GET_STACK(vm, 0)) {           \
-            vm->pc sym VM_GET_STACK(vm, -1); \
-            vm->_inc_pc = 0;                 \
-        }                                    \
-        d_vm_popn(vm, 2);                    \
-    }
+#define DECODE_IMMEDIATE(t, pc, offset) ((dint)(*((t *)((pc) + (offset)))))
 
 /**
- * \fn void d_vm_parse_ins_at_pc(DVM *vm)
- * \brief Given a Decision VM, at it's current position in the program, parse
- * the instruction at that position.
+ * \fn static void vm_decode_opcode(unsigned char opcode, char *pc,
+ *                                  DecodedIns *ins)
+ * \brief Decode an instruction at a location in a text section, as if it had
+ * the given opcode.
  *
- * **NOTE:** This function will be run a lot during the course of execution.
- * If you are looking to optimise Decision, this is a good place to start.
+ * This is used to decode the instructions that make up a superinstruction,
+ * since their immediates are still where they were before they were fused.
  *
- * \param vm The VM to use to parse the instruction.
+ * Note that the target is not resolved, since that requires all of the
+ * instructions to be decoded.
+ *
+ * \param opcode The opcode of the instruction.
+ * \param pc The location of the instruction.
+ * \param ins Where to store the decoded instruction.
  */
-void d_vm_parse_ins_at_pc(DVM *vm) {
-    DIns opcode = *(vm->pc);
+static void vm_decode_opcode(unsigned char opcode, char *pc, DecodedIns *ins) {
+    ins->opcode    = opcode;
+    ins->operand   = 0;
+    ins->target    = NULL;
+    ins->rawTarget = NULL;
+    ins->rawPc     = pc;
+    ins->arity     = 0;
+    ins->operand2  = 0;
+    ins->native    = NULL;
+    ins->profile   = NULL;
+    ins->handler   = (vmHandlers != NULL) ? vmHandlers[opcode] : NULL;
 
-    // Set how many bytes we need to increment.
-    // However, if we're about to perform a jump, we need to set this value to
-    // 0.
-    vm->_inc_pc = VM_INS_SIZE[opcode];
-
-    // Do stuff depending on what the opcode is.
     switch (opcode) {
-        case OP_RET:
-        case OP_RETN:;
-            // If the frame pointer is pointing to a location before the start
-            // of the stack, then halt, as this is the last frame.
-            if (vm->framePtr < vm->basePtr) {
-                vm->halted = true;
-            } else {
-                uint8_t numReturnValues = 0;
-
-                if (opcode == OP_RETN) {
-                    numReturnValues = (uint8_t)GET_BIMMEDIATE(1);
-                }
-
-                // The frame pointer is now pointing at the saved program
-                // counter, i.e. the return address.
-                dint *ptr = vm->framePtr;
-                vm->pc    = (char *)(*ptr);
-
-                // The element before that is the saved frame pointer
-                // difference of the last stack frame.
-                ptr--;
-                vm->framePtr = vm->basePtr + *ptr;
-
-                // Now this position is where the return values should go.
-                const size_t lenRemove =
-                    (vm->stackPtr - ptr) + 1 - numReturnValues;
-
-                VM_REMOVE_LEN(vm, ptr, lenRemove, numReturnValues);
+        // Byte immediates.
+        case OP_ADDBI:
+        case OP_ANDBI:
+        case OP_DIVBI:
+        case OP_GETBI:
+        case OP_JRBI:
+        case OP_JRCONBI:
+        case OP_MODBI:
+        case OP_MULBI:
+        case OP_ORBI:
+        case OP_POPB:
+        case OP_PUSHB:
+        case OP_PUSHNB:
+        case OP_SUBBI:
+        case OP_SYSCALL:
+        case OP_XORBI:
+            ins->operand = DECODE_IMMEDIATE(bimmediate_t, pc, 1);
+            break;
+
+        // Half immediates.
+        case OP_ADDHI:
+        case OP_ANDHI:
+        case OP_DIVHI:
+        case OP_GETHI:
+        case OP_JRHI:
+        case OP_JRCONHI:
+        case OP_MODHI:
+        case OP_MULHI:
+        case OP_ORHI:
+        case OP_POPH:
+        case OP_PUSHH:
+        case OP_PUSHNH:
+        case OP_SUBHI:
+        case OP_XORHI:
+            ins->operand = DECODE_IMMEDIATE(himmediate_t, pc, 1);
+            break;
+
+        // Full immediates.
+        case OP_ADDFI:
+        case OP_ANDFI:
+        case OP_DEREFI:
+        case OP_DEREFBI:
+        case OP_DIVFI:
+        case OP_GETFI:
+        case OP_JCONI:
+        case OP_JI:
+        case OP_JRFI:
+        case OP_JRCONFI:
+        case OP_MODFI:
+        case OP_MULFI:
+        case OP_ORFI:
+        case OP_POPF:
+        case OP_PUSHF:
+        case OP_PUSHNF:
+        case OP_SUBFI:
+        case OP_XORFI:
+            ins->operand = DECODE_IMMEDIATE(fimmediate_t, pc, 1);
+            break;
+
+        // Returns.
+        case OP_RETN:
+            ins->arity = (uint8_t)DECODE_IMMEDIATE(bimmediate_t, pc, 1);
+            break;
+
+        // Calls.
+        case OP_CALL:
+        case OP_CALLC:
+        case OP_CALLR:
+            ins->arity = (uint8_t)DECODE_IMMEDIATE(bimmediate_t, pc, 1);
+            break;
 
-                vm->_inc_pc = 0;
-            }
+        case OP_CALLRB:
+            ins->operand = DECODE_IMMEDIATE(bimmediate_t, pc, 1);
+            ins->arity   = (uint8_t)DECODE_IMMEDIATE(bimmediate_t, pc,
+                                                   1 + BIMMEDIATE_SIZE);
             break;
 
-        case OP_ADD:;
-            OP_2_1(+)
+        case OP_CALLRH:
+            ins->operand = DECODE_IMMEDIATE(himmediate_t, pc, 1);
+            ins->arity   = (uint8_t)DECODE_IMMEDIATE(bimmediate_t, pc,
+                                                   1 + HIMMEDIATE_SIZE);
             break;
 
-        case OP_ADDF:;
-            OP_2_1_F(+)
+        case OP_CALLCI:
+        case OP_CALLI:
+        case OP_CALLRF:
+            ins->operand = DECODE_IMMEDIATE(fimmediate_t, pc, 1);
+            ins->arity   = (uint8_t)DECODE_IMMEDIATE(bimmediate_t, pc,
+                                                   1 + FIMMEDIATE_SIZE);
             break;
 
-        case OP_ADDBI:;
-            OP_1_1_I(+, GET_BIMMEDIATE)
+        // Superinstructions made of two instructions with byte immediates.
+        case OP_ADDBI_JRBI:
+        case OP_GETBI_ADDBI:
+        case OP_GETBI_GETBI:
+        case OP_GETBI_GETBI_ADD:
+        case OP_GETBI_SUBBI:
+        case OP_PUSHB_GETBI:
+        case OP_PUSHB_SYSCALL:
+            ins->operand  = DECODE_IMMEDIATE(bimmediate_t, pc, 1);
+            ins->operand2 = (bimmediate_t)DECODE_IMMEDIATE(
+                bimmediate_t, pc, 1 + BIMMEDIATE_SIZE + 1);
             break;
 
-        case OP_ADDHI:;
-            OP_1_1_I(+, GET_HIMMEDIATE)
+        // Superinstructions that compare, then jump.
+        case OP_CEQ_JRCONBI:
+        case OP_CLEQ_JRCONBI:
+        case OP_CLT_JRCONBI:
+        case OP_CMEQ_JRCONBI:
+        case OP_CMT_JRCONBI:
+            ins->operand = DECODE_IMMEDIATE(bimmediate_t, pc, 2);
             break;
 
-        case OP_ADDFI:;
-            OP_1_1_I(+, GET_FIMMEDIATE)
+        case OP_SYSCALL_POP:
+            ins->operand = DECODE_IMMEDIATE(bimmediate_t, pc, 1);
             break;
 
-        case OP_AND:;
-            OP_2_1(&)
+        default:
             break;
+    }
 
-        case OP_ANDBI:;
-            OP_1_1_I(&, GET_BIMMEDIATE)
+    // Work out where the instruction jumps or calls to, if it is fixed.
+    switch (opcode) {
+        case OP_CALLI:
+        case OP_JCONI:
+        case OP_JI:
+            ins->rawTarget = (char *)ins->operand;
             break;
 
-        case OP_ANDHI:;
-            OP_1_1_I(&, GET_HIMMEDIATE)
+        case OP_CALLRB:
+        case OP_CALLRH:
+        case OP_CALLRF:
+        case OP_JRBI:
+        case OP_JRHI:
+        case OP_JRFI:
+        case OP_JRCONBI:
+        case OP_JRCONHI:
+        case OP_JRCONFI:
+            ins->rawTarget = pc + ins->operand;
             break;
 
-        case OP_ANDFI:;
-            OP_1_1_I(&, GET_FIMMEDIATE)
+        // The jumps of superinstructions are relative to where the jump
+        // instruction would have been.
+        case OP_ADDBI_JRBI:
+            ins->rawTarget = pc + 1 + BIMMEDIATE_SIZE + ins->operand2;
             break;
 
-        case OP_CALL:;
-            CALL_1_0(= (char *))
+        case OP_CEQ_JRCONBI:
+        case OP_CLEQ_JRCONBI:
+        case OP_CLT_JRCONBI:
+        case OP_CMEQ_JRCONBI:
+        case OP_CMT_JRCONBI:
+            ins->rawTarget = pc + 1 + ins->operand;
             break;
 
-        case OP_CALLC:
-        case OP_CALLCI:;
-            CFunction *cFunc;
-            uint8_t numArgs;
+        default:
+            break;
+    }
+}
 
-            if (opcode == OP_CALLC) {
-                cFunc = (CFunction *)VM_GET_STACK(vm, 0);
-                d_vm_popn(vm, 1);
+/**
+ * \fn static void vm_decode_ins(char *pc, DecodedIns *ins)
+ * \brief Decode the instruction at a location in a text section.
+ *
+ * \param pc The location of the instruction.
+ * \param ins Where to store the decoded instruction.
+ */
+static void vm_decode_ins(char *pc, DecodedIns *ins) {
+    vm_decode_opcode((unsigned char)*pc, pc, ins);
+}
 
-                numArgs = (uint8_t)GET_BIMMEDIATE(1);
-            } else {
-                cFunc   = (CFunction *)GET_FIMMEDIATE(1);
-                numArgs = (uint8_t)GET_BIMMEDIATE(1 + FIMMEDIATE_SIZE);
-            }
+/**
+ * \fn static void vm_stop_ins(DecodedIns *ins, char *pc)
+ * \brief Create a decoded instruction that stops the VM at a location in a
+ * text section.
+ *
+ * \param ins Where to store the decoded instruction.
+ * \param pc Where the program counter should be when the VM stops.
+ */
+static void vm_stop_ins(DecodedIns *ins, char *pc) {
+    ins->opcode    = VM_OP_STOP;
+    ins->operand   = 0;
+    ins->target    = NULL;
+    ins->rawTarget = NULL;
+    ins->rawPc     = pc;
+    ins->arity     = 0;
+    ins->operand2  = 0;
+    ins->native    = NULL;
+    ins->profile   = NULL;
+    ins->handler   = (vmHandlers != NULL) ? vmHandlers[VM_OP_STOP] : NULL;
+}
 
-            // Save the current frame pointer.
-            dint *savedFramePtr = vm->framePtr;
+/**
+ * \fn static void vm_add_decoded_text(DecodedText *decoded)
+ * \brief Finish a decoded text section, whose first `numIns` instructions have
+ * been decoded, and add it to the list of decoded text sections that the VM
+ * can use.
+ *
+ * \param decoded The decoded text section to add.
+ */
+static void vm_add_decoded_text(DecodedText *decoded) {
+    // If the VM ever goes past the last instruction, raise an error.
+    DecodedIns *end = decoded->ins + decoded->numIns;
+    vm_stop_ins(end, decoded->text + decoded->textSize);
+    end->opcode  = VM_OP_UNKNOWN;
+    end->handler = (vmHandlers != NULL) ? vmHandlers[VM_OP_UNKNOWN] : NULL;
+
+    // Add the decoded text to the list, so jumps within the text, and future
+    // calls from other text sections, can be resolved.
+    d_lock(LOCK_DECODED_TEXTS);
+
+    const size_t index = find_text_index(decoded->text);
+
+    numDecodedTexts++;
+    decodedTexts = d_realloc(decodedTexts,
+                             numDecodedTexts * sizeof(DecodedText *));
+    memmove(decodedTexts + index + 1, decodedTexts + index,
+            (numDecodedTexts - index - 1) * sizeof(DecodedText *));
+    decodedTexts[index] = decoded;
+
+    for (size_t i = 0; i < decoded->numIns; i++) {
+        DecodedIns *ins = decoded->ins + i;
+
+        if (ins->rawTarget != NULL) {
+            ins->target = find_decoded_ins(ins->rawTarget);
+        }
+    }
 
-            // Set the frame pointer such that it is one below the first
-            // argument.
-            vm->framePtr = vm->stackPtr - numArgs;
+    // Text sections that were decoded before this one may call into it, so
+    // resolve those calls now rather than every time they are made.
+    for (size_t i = 0; i < numDecodedTexts; i++) {
+        DecodedText *other = decodedTexts[i];
 
-            // Call the C function.
-            cFunc->function(vm);
+        if (other == decoded) {
+            continue;
+        }
 
-            // Restore the original frame pointer.
-            vm->framePtr = savedFramePtr;
-            break;
+        for (size_t j = 0; j < other->numIns; j++) {
+            DecodedIns *ins = other->ins + j;
+            char *raw       = ins->rawTarget;
 
-        case OP_CALLI:;
-            CALL_0_0_FI(= (char *))
-            break;
+            if (ins->target == NULL && raw >= decoded->text &&
+                raw < decoded->text + decoded->textSize) {
+                ins->target = decoded->insAt[raw - decoded->text];
+            }
+        }
+    }
 
-        case OP_CALLR:;
-            CALL_1_0(+=)
-            break;
+    d_unlock(LOCK_DECODED_TEXTS);
+}
 
-        case OP_CALLRB:;
-            CALL_0_0_BI(+=)
-            break;
+/**
+ * \fn DecodedText *d_vm_decode_text(char *text, size_t textSize)
+ * \brief Decode a linked text section into a form that the VM can execute
+ * without having to decode the immediates again, with jump and call targets
+ * already resolved.
+ *
+ * The decoded text is remembered, so that `d_vm_run` uses it whenever it is
+ * asked to run code from this text section.
+ *
+ * **NOTE:** Jumps and calls to other text sections are only resolved if those
+ * text sections have already been decoded.
+ *
+ * \return The malloc'd decoded text. Free it with `d_vm_free_decoded_text`.
+ *
+ * \param text The text section to decode.
+ * \param textSize The size of the text section in bytes.
+ */
+DecodedText *d_vm_decode_text(char *text, size_t textSize) {
+    // Make sure we know where the handlers are before decoding anything.
+    if (vmHandlers == NULL) {
+        vm_execute(NULL, NULL, false);
+    }
 
-        case OP_CALLRH:;
-            CALL_0_0_HI(+=)
-            break;
+    // Firstly, count how many instructions there are.
+    size_t numIns = 0;
+    for (size_t i = 0; i < textSize;) {
+        const unsigned char size = d_vm_ins_size((unsigned char)text[i]);
+        i += (size > 0) ? size : 1;
+        numIns++;
+    }
 
-        case OP_CALLRF:;
-            CALL_0_0_FI(+=)
-            break;
+    DecodedText *decoded = d_malloc(sizeof(DecodedText));
+    decoded->text        = text;
+    decoded->textSize    = textSize;
+    decoded->numIns      = numIns;
+    decoded->ins         = d_calloc(numIns + 1, sizeof(DecodedIns));
+    decoded->insAt       = d_calloc((textSize > 0) ? textSize : 1,
+                              sizeof(DecodedIns *));
+
+    // Then decode each instruction.
+    size_t insIndex = 0;
+    for (size_t i = 0; i < textSize;) {
+        DecodedIns *ins = decoded->ins + insIndex;
+        vm_decode_ins(text + i, ins);
+
+        decoded->insAt[i] = ins;
+
+        const unsigned char size = d_vm_ins_size(ins->opcode);
+        i += (size > 0) ? size : 1;
+        insIndex++;
+    }
 
-        case OP_CEQ:;
-            OP_2_1(==)
-            break;
+    vm_add_decoded_text(decoded);
 
-        case OP_CEQF:;
-            OP_2_1_C(==)
-            break;
+    return decoded;
+}
 
-        case OP_CLEQ:;
-            OP_2_1(<=)
-            break;
+/**
+ * \fn DecodedIns *d_vm_find_decoded_ins(const char *pc)
+ * \brief Find the decoded version of the instruction at a location in a text
+ * section.
+ *
+ * \return The decoded instruction, or `NULL` if the text section hasn't been
+ * decoded, or `pc` isn't the start of an instruction.
+ *
+ * \param pc The location of the instruction in a text section.
+ */
+DecodedIns *d_vm_find_decoded_ins(const char *pc) {
+    d_lock_shared(LOCK_DECODED_TEXTS);
+    DecodedIns *ins = find_decoded_ins(pc);
+    d_unlock_shared(LOCK_DECODED_TEXTS);
 
-        case OP_CLEQF:;
-            OP_2_1_C(<=)
-            break;
+    return ins;
+}
 
-        case OP_CLT:;
-            OP_2_1(<)
-            break;
+/**
+ * \fn DecodedText *d_vm_find_decoded_text(const char *pc)
+ * \brief Find the decoded text section that a location is in.
+ *
+ * \return The decoded text section, or `NULL` if the location isn't in a text
+ * section that has been decoded.
+ *
+ * \param pc The location in a text section.
+ */
+DecodedText *d_vm_find_decoded_text(const char *pc) {
+    d_lock_shared(LOCK_DECODED_TEXTS);
+    DecodedText *decoded = find_decoded_text(pc);
+    d_unlock_shared(LOCK_DECODED_TEXTS);
 
-        case OP_CLTF:;
-            OP_2_1_C(<)
-            break;
+    return decoded;
+}
 
-        case OP_CMEQ:;
-            OP_2_1(>=)
-            break;
+/**
+ * \fn static DecodedIns *vm_find_jump_target(DVM *vm, char *pc)
+ * \brief Find the decoded instruction that a jump only known at runtime goes
+ * to.
+ *
+ * Jumps within the text section the VM is running don't need to search for it,
+ * or take the lock on the list of decoded text sections.
+ *
+ * \return The decoded instruction, or `NULL` if it hasn't been decoded.
+ *
+ * \param vm The VM that is jumping.
+ * \param pc The location being jumped to.
+ */
+static DecodedIns *vm_find_jump_target(DVM *vm, char *pc) {
+    DecodedText *decoded = vm->_decoded;
 
-        case OP_CMEQF:;
-            OP_2_1_C(>=)
-            break;
+    if (decoded == NULL || pc < decoded->text ||
+        pc >= decoded->text + decoded->textSize) {
+        decoded = d_vm_find_decoded_text(pc);
 
-        case OP_CMT:;
-            OP_2_1(>)
-            break;
+        if (decoded == NULL) {
+            return NULL;
+        }
 
-        case OP_CMTF:;
-            OP_2_1_C(>)
-            break;
+        vm->_decoded = decoded;
+    }
 
-        case OP_CVTF:;
-            *VM_GET_STACK_FLOAT_PTR(vm, 0) = (dfloat)VM_GET_STACK(vm, 0);
-            break;
+    return decoded->insAt[pc - decoded->text];
+}
 
-        case OP_CVTI:;
-            *VM_GET_STACK_PTR(vm, 0) = (dint)VM_GET_STACK_FLOAT(vm, 0);
-            break;
+/**
+ * \fn void d_vm_set_native(DecodedIns *ins, DecodedIns *(*native)(DVM *vm),
+ *                          uint8_t reserve)
+ * \brief Make a decoded instruction run native code instead, whenever the VM
+ * gets to it.
+ *
+ * The native code is called with the VM's stack pointer and top of the stack
+ * up to date, and it returns the decoded instruction that the VM should carry
+ * on from, with the stack pointer up to date again.
+ *
+ * \param ins The decoded instruction to replace.
+ * \param native The native code that does what `ins` does, and carries on
+ * from there.
+ * \param reserve How many elements the VM should make space for on the stack
+ * before running the native code.
+ */
+void d_vm_set_native(DecodedIns *ins, DecodedIns *(*native)(DVM *vm),
+                     uint8_t reserve) {
+    // Make sure we know where the handlers are.
+    if (vmHandlers == NULL) {
+        vm_execute(NULL, NULL, false);
+    }
 
-        case OP_DEREF:;
-            *VM_GET_STACK_PTR(vm, 0) = *((dint *)VM_GET_STACK(vm, 0));
-            break;
+    ins->opcode  = VM_OP_NATIVE;
+    ins->handler = (vmHandlers != NULL) ? vmHandlers[VM_OP_NATIVE] : NULL;
+    ins->native  = native;
+    ins->arity   = reserve;
+}
 
-        case OP_DEREFI:;
-            d_vm_pushn(vm, 1);
-            *VM_GET_STACK_PTR(vm, 0) = *((dint *)GET_FIMMEDIATE(1));
-            break;
+/**
+ * \fn static bool vm_is_fixed_call(unsigned char opcode)
+ * \brief Is an opcode a call to a Decision function at a fixed location?
+ * These are the only calls that the code generator makes.
+ *
+ * \return If the opcode is a fixed call.
+ *
+ * \param opcode The opcode to check.
+ */
+static bool vm_is_fixed_call(unsigned char opcode) {
+    return opcode == OP_CALLI || opcode == OP_CALLRB || opcode == OP_CALLRH ||
+           opcode == OP_CALLRF;
+}
 
-        case OP_DEREFB:;
-            *VM_GET_STACK_PTR(vm, 0) = *((uint8_t *)VM_GET_STACK(vm, 0));
-            break;
+/**
+ * \fn void d_vm_set_call_convention(DecodedText *decoded, uint8_t convention)
+ * \brief Make the calls in a decoded text section follow the calling
+ * convention it was generated with, if it is older than `VM_CALL_CONVENTION`.
+ *
+ * This needs to be done before the text section is run or compiled to native
+ * code.
+ *
+ * \param decoded The decoded text section.
+ * \param convention The calling convention the text section was generated
+ * with.
+ */
+void d_vm_set_call_convention(DecodedText *decoded, uint8_t convention) {
+    if (decoded == NULL || convention >= VM_CALL_CONVENTION) {
+        return;
+    }
 
-        case OP_DEREFBI:;
-            d_vm_pushn(vm, 1);
-            *VM_GET_STACK_PTR(vm, 0) = *((uint8_t *)GET_FIMMEDIATE(1));
-            break;
+    // In calling convention 0, the caller didn't reserve any space for the
+    // frame, so the arguments need to be moved up to make room for it.
+    for (size_t i = 0; i < decoded->numIns; i++) {
+        DecodedIns *ins = decoded->ins + i;
 
-        case OP_DIV:;
-            if (VM_GET_STACK(vm, -1) == 0) {
-                d_vm_runtime_error(vm, "Division by 0");
-            } else {
-                OP_2_1(/)
-            }
-            break;
+        if (vm_is_fixed_call(ins->opcode)) {
+            ins->opcode = VM_OP_CALL_MOVE;
+            ins->handler =
+                (vmHandlers != NULL) ? vmHandlers[VM_OP_CALL_MOVE] : NULL;
+        }
+    }
+}
 
-        case OP_DIVF:;
-            if (VM_GET_STACK_FLOAT(vm, -1) == 0.0) {
-                d_vm_runtime_error(vm, "Division by 0");
-            } else {
-                OP_2_1_F(/)
-            }
-            break;
+/**
+ * \fn void d_vm_free_decoded_text(DecodedText *decoded)
+ * \brief Free a decoded text section, so that the VM doesn't use it anymore.
+ *
+ * \param decoded The decoded text to free.
+ */
+void d_vm_free_decoded_text(DecodedText *decoded) {
+    if (decoded == NULL) {
+        return;
+    }
 
-        case OP_DIVBI:;
-            if (GET_BIMMEDIATE(1) == 0) {
-                d_vm_runtime_error(vm, "Division by 0");
-            } else {
-                OP_1_1_I(/, GET_BIMMEDIATE)
-            }
-            break;
+    // Remove the decoded text from the list.
+    d_lock(LOCK_DECODED_TEXTS);
 
-        case OP_DIVHI:;
-            if (GET_HIMMEDIATE(1) == 0) {
-                d_vm_runtime_error(vm, "Division by 0");
-            } else {
-                OP_1_1_I(/, GET_HIMMEDIATE)
-            }
+    for (size_t i = 0; i < numDecodedTexts; i++) {
+        if (decodedTexts[i] == decoded) {
+            memmove(decodedTexts + i, decodedTexts + i + 1,
+                    (numDecodedTexts - i - 1) * sizeof(DecodedText *));
+            numDecodedTexts--;
             break;
+        }
+    }
 
-        case OP_DIVFI:;
-            if (GET_FIMMEDIATE(1) == 0) {
-                d_vm_runtime_error(vm, "Division by 0");
-            } else {
-                OP_1_1_I(/, GET_FIMMEDIATE)
+    // Anything that was resolved to this text section needs to be looked up
+    // again, in case it is decoded again somewhere else.
+    for (size_t i = 0; i < numDecodedTexts; i++) {
+        DecodedText *other = decodedTexts[i];
+
+        for (size_t j = 0; j < other->numIns; j++) {
+            DecodedIns *ins = other->ins + j;
+
+            if (ins->target != NULL && in_decoded_text(decoded, ins->target)) {
+                ins->target = NULL;
             }
-            break;
+        }
+    }
 
-        case OP_GET:;
-            *VM_GET_STACK_PTR(vm, 0) = d_vm_get(vm, VM_GET_STACK(vm, 0));
-            break;
+    if (numDecodedTexts == 0 && decodedTexts != NULL) {
+        free(decodedTexts);
+        decodedTexts = NULL;
+    }
 
-        case OP_GETBI:;
-            d_vm_push(vm, d_vm_get(vm, GET_BIMMEDIATE(1)));
-            break;
+    d_unlock(LOCK_DECODED_TEXTS);
 
-        case OP_GETHI:;
-            d_vm_push(vm, d_vm_get(vm, GET_HIMMEDIATE(1)));
-            break;
+    free(decoded->ins);
+    free(decoded->insAt);
+    free(decoded);
+}
 
-        case OP_GETFI:;
-            d_vm_push(vm, d_vm_get(vm, GET_FIMMEDIATE(1)));
-            break;
+/*
+=== INSTRUCTION EXECUTION =================================
+*/
 
-        case OP_INV:;
-            *VM_GET_STACK_PTR(vm, 0) = ~VM_GET_STACK(vm, 0);
-            break;
+/*
+    NOTE: The following helper macros are used extensively in vm_execute.
+    Since this function is going to be called a LOT, these helper macros need
+    to be as efficient as possible. This means things like using as few
+    functions as possible, making as less calculations as possible, etc.
+*/
 
-        case OP_J:;
-            J_1_0(= (char *))
-            break;
+/*
+    The VM executes decoded instructions (see DecodedIns). There are two ways
+    the handlers of the instructions are dispatched:
+
+    * With the "labels as values" extension from GCC and Clang, each handler
+      jumps straight to the handler of the next instruction, using the
+      handler address stored in the decoded instruction.
+    * Otherwise, a `switch` statement on the opcode is used.
+
+    The former is used if `DECISION_COMPUTED_GOTO` is defined (see the
+    `COMPILER_COMPUTED_GOTO` CMake option), and the compiler supports it.
+
+    While executing, the stack pointer and the value at the top of the stack
+    are kept in the local variables `sp` and `tos`, rather than being loaded
+    from and stored to the VM every time. Everything below the top of the stack
+    is always in memory, but the element `sp` points to may be out of date.
+    They are only written back to the VM (see VM_SYNC) when something outside
+    of vm_execute could look at the stack, i.e. when calling C functions, when
+    the stack needs to grow, when there is a runtime error, and when the VM
+    stops.
+*/
+#if defined(DECISION_COMPUTED_GOTO) && defined(__GNUC__)
+#define VM_USE_COMPUTED_GOTO
+#endif
 
-        case OP_JCON:;
-            JCON_2_0(= (char *))
-            break;
+#ifdef VM_USE_COMPUTED_GOTO
 
-        case OP_JCONI:;
-            JCON_1_0_I(= (char *), GET_FIMMEDIATE)
-            break;
+/**
+ * \def VM_CASE(op)
+ * \brief Start the handler for the opcode `op`.
+ */
+#define VM_CASE(op) LABEL_##op:
 
-        case OP_JI:;
-            J_0_0_I(= (char *), GET_FIMMEDIATE)
-            break;
+/**
+ * \def VM_DEFAULT
+ * \brief Start the handler for unknown opcodes.
+ */
+#define VM_DEFAULT LABEL_UNKNOWN:
 
-        case OP_JR:;
-            J_1_0(+=)
-            break;
+/**
+ * \def VM_DISPATCH()
+ * \brief Go to the handler of the instruction `ins`.
+ */
+#define VM_DISPATCH() goto *ins->handler;
 
-        case OP_JRBI:;
-            J_0_0_I(+=, GET_BIMMEDIATE)
-            break;
+#else // VM_USE_COMPUTED_GOTO
 
-        case OP_JRHI:;
-            J_0_0_I(+=, GET_HIMMEDIATE)
-            break;
+#define VM_CASE(op)   case op:
+#define VM_DEFAULT    default:
+#define VM_DISPATCH() continue;
 
-        case OP_JRFI:;
-            J_0_0_I(+=, GET_FIMMEDIATE)
-            break;
+#endif // VM_USE_COMPUTED_GOTO
 
-        case OP_JRCON:;
-            JCON_2_0(+=)
-            break;
+/**
+ * \def VM_NEXT()
+ * \brief End the handler of an instruction by going to the next instruction.
+ */
+#define VM_NEXT()     \
+    {                 \
+        ins++;        \
+        VM_DISPATCH() \
+    }
 
-        case OP_JRCONBI:;
-            JCON_1_0_I(+=, GET_BIMMEDIATE)
-            break;
+/**
+ * \def VM_SYNC_STACK()
+ * \brief Write the cached stack pointer and top of the stack back to the VM.
+ */
+#define VM_SYNC_STACK()       \
+    {                         \
+        *sp          = tos.i; \
+        vm->stackPtr = sp;    \
+    }
 
-        case OP_JRCONHI:;
-            JCON_1_0_I(+=, GET_HIMMEDIATE)
-            break;
+/**
+ * \def VM_LOAD_STACK()
+ * \brief Load the stack pointer and the top of the stack from the VM.
+ */
+#define VM_LOAD_STACK()       \
+    {                         \
+        sp    = vm->stackPtr; \
+        tos.i = *sp;          \
+    }
 
-        case OP_JRCONFI:;
-            JCON_1_0_I(+=, GET_FIMMEDIATE)
-            break;
+/**
+ * \def VM_SYNC()
+ * \brief Write the program counter, the stack pointer and the top of the stack
+ * back to the VM, so that anything outside of the VM knows where we are.
+ */
+#define VM_SYNC()            \
+    {                        \
+        vm->pc = ins->rawPc; \
+        VM_SYNC_STACK()      \
+    }
 
-        case OP_MOD:;
-            OP_2_1(%)
-            break;
+/**
+ * \def VM_HALT()
+ * \brief End the handler of an instruction that has stopped the VM.
+ *
+ * **NOTE:** The program counter should be set before using this.
+ */
+#define VM_HALT()        \
+    {                    \
+        VM_SYNC_STACK()  \
+        vm->_inc_pc = 0; \
+        return;          \
+    }
 
-        case OP_MODBI:;
-            OP_1_1_I(%, GET_BIMMEDIATE)
-            break;
+/**
+ * \def VM_ERROR(...)
+ * \brief End the handler of an instruction with a runtime error.
+ */
+#define VM_ERROR(...)                   \
+    {                                   \
+        VM_SYNC()                       \
+        ERROR_RUNTIME(vm, __VA_ARGS__); \
+        VM_HALT()                       \
+    }
 
-        case OP_MODHI:;
-            OP_1_1_I(%, GET_HIMMEDIATE)
-            break;
+/**
+ * \def VM_RESERVE(n)
+ * \brief Make sure there is space for `n` more elements on the stack.
+ *
+ * **NOTE:** If the stack is guarded, this does nothing, since the stack will
+ * grow by itself when it needs to.
+ */
+#ifdef VM_USE_GUARDED_STACK
+#define VM_RESERVE(n)
+#else
+#define VM_RESERVE(n)                                  \
+    if (sp + (n) >= vm->basePtr + vm->stackSize) {     \
+        vm->stackPtr = sp;                             \
+        vm_set_stack_size_to(                          \
+            vm, (duint)((sp - vm->basePtr + 1 + (n)) * \
+                        VM_STACK_SIZE_SCALE_INC));     \
+        sp = vm->stackPtr;                             \
+    }
+#endif // VM_USE_GUARDED_STACK
 
-        case OP_MODFI:;
-            OP_1_1_I(%, GET_FIMMEDIATE)
-            break;
+/**
+ * \def VM_PUSH(value)
+ * \brief Push an integer onto the stack.
+ */
+#define VM_PUSH(value)               \
+    {                                \
+        const dint _value = (value); \
+        VM_RESERVE(1)                \
+        *sp   = tos.i;               \
+        tos.i = _value;              \
+        sp++;                        \
+    }
 
-        case OP_MUL:;
-            OP_2_1(*)
-            break;
+/**
+ * \def VM_POP(n)
+ * \brief Pop `n` elements from the stack.
+ */
+#define VM_POP(n)    \
+    {                \
+        sp -= (n);   \
+        tos.i = *sp; \
+    }
 
-        case OP_MULF:;
-            OP_2_1_F(*)
-            break;
+/**
+ * \def VM_LOAD(ptr)
+ * \brief Get the value of an element of the stack, which could be the top of
+ * the stack.
+ */
+#define VM_LOAD(ptr) (((ptr) == sp) ? tos.i : *(ptr))
 
-        case OP_MULBI:;
-            OP_1_1_I(*, GET_BIMMEDIATE)
-            break;
+/**
+ * \def VM_GET(index)
+ * \brief The same as `d_vm_get`, but using the cached stack.
+ */
+#define VM_GET(index)                                       \
+    (((index) > 0) ? VM_LOAD(VM_GET_FRAME_PTR(vm, (index))) \
+                   : VM_LOAD(sp + (index)))
 
-        case OP_MULHI:;
-            OP_1_1_I(*, GET_HIMMEDIATE)
-            break;
+/**
+ * \def VM_BELOW(index)
+ * \brief Get an element of the stack below the top of the stack, where
+ * `index` is negative.
+ */
+#define VM_BELOW(index) (*(sp + (index)))
 
-        case OP_MULFI:;
-            OP_1_1_I(*, GET_FIMMEDIATE)
-            break;
+/**
+ * \def VM_BELOW_FLOAT(index)
+ * \brief Get an element of the stack below the top of the stack as a float,
+ * where `index` is negative.
+ */
+#define VM_BELOW_FLOAT(index) (*((dfloat *)(sp + (index))))
 
-        case OP_NOT:;
-            *VM_GET_STACK_PTR(vm, 0) = !VM_GET_STACK(vm, 0);
-            break;
+/**
+ * \def VM_JUMP_RAW(raw)
+ * \brief Jump to a location in a text section that was only known at runtime.
+ */
+#define VM_JUMP_RAW(raw)                                       \
+    {                                                          \
+        char *_raw = (raw);                                    \
+        if (step) {                                            \
+            vm->pc = _raw;                                     \
+            VM_HALT()                                          \
+        }                                                      \
+        DecodedIns *_to = vm_find_jump_target(vm, _raw);       \
+        if (_to == NULL) {                                     \
+            VM_ERROR("Jumped to code that isn't decoded (%p)", \
+                     (void *)_raw)                             \
+        }                                                      \
+        ins = _to;                                             \
+        VM_DISPATCH()                                          \
+    }
 
-        case OP_OR:;
-            OP_2_1(|)
-            break;
+/**
+ * \def VM_COUNT(to, counter)
+ * \brief If the decoded instruction `to` is being profiled, increment one of
+ * the counters of its profile, and promote it if it has just got hot.
+ */
+#define VM_COUNT(to, counter)                            \
+    {                                                    \
+        VMProfile *_profile = (to)->profile;             \
+        if (_profile != NULL) {                          \
+            _profile->counter++;                         \
+            if (_profile->calls + _profile->backEdges == \
+                    _profile->threshold &&               \
+                _profile->promote != NULL) {             \
+                _profile->promote(_profile);             \
+            }                                            \
+        }                                                \
+    }
 
-        case OP_ORBI:;
-            OP_1_1_I(|, GET_BIMMEDIATE)
-            break;
+/**
+ * \def VM_JUMP_TARGET()
+ * \brief Jump to the instruction's fixed target. If the jump goes backwards,
+ * it is counted as a back edge.
+ */
+#define VM_JUMP_TARGET()                \
+    {                                   \
+        if (ins->target == NULL) {      \
+            VM_JUMP_RAW(ins->rawTarget) \
+        }                               \
+        if (ins->target <= ins) {       \
+            VM_COUNT(ins, backEdges)    \
+        }                               \
+        ins = ins->target;              \
+        VM_DISPATCH()                   \
+    }
 
-        case OP_ORHI:;
-            OP_1_1_I(|, GET_HIMMEDIATE)
-            break;
+/**
+ * \def VM_CALL_TARGET()
+ * \brief Jump to the instruction's fixed target, counting it as a call.
+ */
+#define VM_CALL_TARGET()                \
+    {                                   \
+        if (ins->target == NULL) {      \
+            VM_JUMP_RAW(ins->rawTarget) \
+        }                               \
+        VM_COUNT(ins->target, calls)    \
+        ins = ins->target;              \
+        VM_DISPATCH()                   \
+    }
 
-        case OP_ORFI:;
-            OP_1_1_I(|, GET_FIMMEDIATE)
-            break;
+/**
+ * \def OP_1_1_I(sym)
+ * \brief A helper macro for opcodes with 1 input and 1 output involving
+ * integers, and an immediate.
+ */
+#define OP_1_1_I(sym) tos.i = tos.i sym ins->operand;
 
-        case OP_POP:;
-            d_vm_popn(vm, 1);
-            break;
+/**
+ * \def OP_2_1(sym)
+ * \brief A helper macro for opcodes with 2 inputs and 1 output involving
+ * integers.
+ */
+#define OP_2_1(sym)                       \
+    {                                     \
+        tos.i = (tos.i sym VM_BELOW(-1)); \
+        sp--;                             \
+    }
 
-        case OP_POPB:;
-            d_vm_popn(vm, GET_BIMMEDIATE(1));
-            break;
+/**
+ * \def OP_2_1_F(sym)
+ * \brief A helper macro for opcodes with 2 inputs and 1 output involving
+ * floats.
+ */
+#define OP_2_1_F(sym)                           \
+    {                                           \
+        tos.f = (tos.f sym VM_BELOW_FLOAT(-1)); \
+        sp--;                                   \
+    }
 
-        case OP_POPH:;
-            d_vm_popn(vm, GET_HIMMEDIATE(1));
-            break;
+/**
+ * \def OP_2_1_C(sym)
+ * \brief A helper macro for opcodes with 2 inputs and 1 output involving
+ * comparisons with floats.
+ */
+#define OP_2_1_C(sym)                           \
+    {                                           \
+        tos.i = (tos.f sym VM_BELOW_FLOAT(-1)); \
+        sp--;                                   \
+    }
 
-        case OP_POPF:;
-            d_vm_popn(vm, GET_FIMMEDIATE(1));
-            break;
+/**
+ * \def RET_GENERIC(numReturnValues)
+ * \brief A generic helper macro for return opcodes.
+ */
+#define RET_GENERIC(numReturnValues)                                        \
+    {                                                                       \
+        /* If the frame pointer is pointing to a location before the start  \
+           of the stack, then halt, as this is the last frame. */           \
+        if (vm->framePtr < vm->basePtr) {                                   \
+            vm->pc     = ins->rawPc;                                        \
+            vm->halted = true;                                              \
+            VM_HALT()                                                       \
+        }                                                                   \
+                                                                            \
+        const uint8_t _numReturnValues = (numReturnValues);                 \
+        *sp                            = tos.i;                             \
+                                                                            \
+        /* The frame pointer is now pointing at the saved program counter,  \
+           i.e. the return address. */                                      \
+        dint *_ptr      = vm->framePtr;                                     \
+        dint _returnAdr = *_ptr;                                            \
+                                                                            \
+        /* The element before that is the saved frame pointer difference of \
+           the last stack frame. */                                         \
+        _ptr--;                                                             \
+        vm->framePtr = vm->basePtr + *_ptr;                                 \
+                                                                            \
+        /* Now this position is where the return values should go, i.e.     \
+           the first of the two elements the caller reserved. */            \
+        dint *_from = sp - _numReturnValues + 1;                            \
+        for (uint8_t _i = 0; _i < _numReturnValues; _i++) {                 \
+            _ptr[_i] = _from[_i];                                           \
+        }                                                                   \
+        sp    = _ptr + _numReturnValues - 1;                                \
+        tos.i = *sp;                                                        \
+                                                                            \
+        /* When stepping, the return address is in the text section.        \
+           Otherwise, it is the decoded instruction to return to. */        \
+        if (step) {                                                         \
+            vm->pc = (char *)_returnAdr;                                    \
+            VM_HALT()                                                       \
+        }                                                                   \
+        ins = (DecodedIns *)_returnAdr;                                     \
+        VM_DISPATCH()                                                       \
+    }
 
-        case OP_PUSHB:;
-            d_vm_push(vm, GET_BIMMEDIATE(1));
-            break;
+/**
+ * \def CALL_GENERIC(numArguments)
+ * \brief A generic helper macro for call opcodes. This sets up the stack frame
+ * for the call, but does not jump.
+ */
+#define CALL_GENERIC(numArguments)                                         \
+    {                                                                      \
+        /* When stepping, the return address needs to be in the text       \
+           section. Otherwise, it is the next decoded instruction. */      \
+        dint returnAdr = (step) ? (dint)(ins->rawPc +                      \
+                                         VM_INS_SIZE[ins->opcode])         \
+                                : (dint)(ins + 1);                         \
+                                                                           \
+        /* The caller reserved two elements below the arguments, which is  \
+           where the frame pointer and the return address are saved, so    \
+           nothing needs to move. Note that if there are no arguments, the \
+           return address goes in the top of the stack. */                 \
+        *sp              = tos.i;                                          \
+        dint *returnPtr  = sp - (numArguments);                            \
+        *(returnPtr - 1) = (dint)(vm->framePtr - vm->basePtr);             \
+        *returnPtr       = returnAdr;                                      \
+        vm->framePtr     = returnPtr;                                      \
+        tos.i            = *sp;                                            \
+    }
 
-        case OP_PUSHH:;
-            d_vm_push(vm, GET_HIMMEDIATE(1));
-            break;
+/**
+ * \def CALLC_GENERIC(cFunc)
+ * \brief A generic helper macro for calling C functions.
+ */
+#define CALLC_GENERIC(cFunc)                                         \
+    {                                                                \
+        VM_SYNC()                                                    \
+                                                                     \
+        /* Save the current frame pointer. */                        \
+        dint *savedFramePtr = vm->framePtr;                          \
+                                                                     \
+        /* Set the frame pointer such that it is one below the first \
+           argument. */                                              \
+        vm->framePtr = vm->stackPtr - ins->arity;                    \
+                                                                     \
+        /* Call the C function. */                                   \
+        (cFunc)->function(vm);                                       \
+                                                                     \
+        /* Restore the original frame pointer. */                    \
+        vm->framePtr = savedFramePtr;                                \
+                                                                     \
+        /* The C function could have changed the stack. */           \
+        VM_LOAD_STACK()                                              \
+                                                                     \
+        if (vm->halted) {                                            \
+            VM_HALT()                                                \
+        }                                                            \
+        VM_NEXT()                                                    \
+    }
 
-        case OP_PUSHF:;
-            d_vm_push(vm, GET_FIMMEDIATE(1));
-            break;
+/**
+ * \def JCON_2_0(raw)
+ * \brief A helper macro for jump condition opcodes with 2 inputs and 0 outputs.
+ */
+#define JCON_2_0(raw)              \
+    {                              \
+        if (tos.i) {               \
+            char *_jumpTo = (raw); \
+            VM_POP(2)              \
+            VM_JUMP_RAW(_jumpTo)   \
+        }                          \
+        VM_POP(2)                  \
+        VM_NEXT()                  \
+    }
 
-        case OP_PUSHNB:;
-            d_vm_pushn(vm, GET_BIMMEDIATE(1));
-            break;
+/**
+ * \def JCMP_2_0(sym)
+ * \brief A helper macro for superinstructions that compare two integers, and
+ * jump to the instruction's fixed target if the comparison is true.
+ */
+#define JCMP_2_0(sym)                                     \
+    {                                                     \
+        const bool _condition = (tos.i sym VM_BELOW(-1)); \
+        VM_POP(2)                                         \
+        if (_condition) {                                 \
+            VM_JUMP_TARGET()                              \
+        }                                                 \
+        VM_NEXT()                                         \
+    }
 
-        case OP_PUSHNH:;
-            d_vm_pushn(vm, GET_HIMMEDIATE(1));
-            break;
+/**
+ * \def SYSCALL_GENERIC(syscall, result)
+ * \brief A generic helper macro for syscalls. This sets `result` to the
+ * return value of the syscall, but doesn't pop the arguments.
+ */
+#define SYSCALL_GENERIC(syscall, result)                               \
+    {                                                                  \
+        (result) = 0;                                                  \
+        switch (syscall) {                                             \
+            case SYS_PRINT:;                                           \
+                switch (tos.i) {                                       \
+                    case 0: /* Integer */                              \
+                        printf("%" DINT_PRINTF_d, VM_BELOW(-2));       \
+                        break;                                         \
+                    case 1: /* Float */                                \
+                        printf("%g", VM_BELOW_FLOAT(-2));              \
+                        break;                                         \
+                    case 2: /* String */                               \
+                        printf("%s", (char *)VM_BELOW(-2));            \
+                        break;                                         \
+                    case 3: /* Boolean */                              \
+                        printf("%s", VM_BELOW(-2) ? "true" : "false"); \
+                        break;                                         \
+                }                                                      \
+                                                                       \
+                if (VM_BELOW(-1)) {                                    \
+                    printf("\n");                                      \
+                }                                                      \
+                break;                                                 \
+                                                                       \
+            case SYS_STRCMP:;                                          \
+                (result) = strcmp((char *)VM_BELOW(-1),                \
+                                  (char *)VM_BELOW(-2));               \
+                                                                       \
+                switch (tos.i) {                                       \
+                    case 0:                                            \
+                        (result) = ((result) == 0);                    \
+                        break;                                         \
+                    case 1:                                            \
+                        (result) = ((result) <= 0);                    \
+                        break;                                         \
+                    case 2:                                            \
+                        (result) = ((result) < 0);                     \
+                        break;                                         \
+                    case 3:                                            \
+                        (result) = ((result) >= 0);                    \
+                        break;                                         \
+                    case 4:                                            \
+                        (result) = ((result) > 0);                     \
+                        break;                                         \
+                    default:                                           \
+                        (result) = 0;                                  \
+                        break;                                         \
+                }                                                      \
+                break;                                                 \
+                                                                       \
+            case SYS_STRLEN:;                                          \
+                (result) = strlen((char *)VM_BELOW(-2));               \
+                break;                                                 \
+                                                                       \
+            default:                                                   \
+                (result) = VM_BELOW(-2);                               \
+                break;                                                 \
+        }                                                              \
+    }
 
-        case OP_PUSHNF:;
-            d_vm_pushn(vm, GET_FIMMEDIATE(1));
-            break;
+/**
+ * \def DIV_CHECK(isZero, divide)
+ * \brief A helper macro for division opcodes, which need to check for division
+ * by 0 before they divide.
+ */
+#define DIV_CHECK(isZero, divide)     \
+    {                                 \
+        if (isZero) {                 \
+            VM_ERROR("Division by 0") \
+        }                             \
+        divide VM_NEXT()              \
+    }
 
-        case OP_SETADR:;
-            *((dint *)VM_GET_STACK(vm, 0)) = VM_GET_STACK(vm, -1);
-            d_vm_popn(vm, 2);
-            break;
+#ifdef VM_USE_COMPUTED_GOTO
+// Taking the address of a label is an extension to ISO C.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
 
-        case OP_SETADRB:;
-            *((uint8_t *)VM_GET_STACK(vm, 0)) = (uint8_t)VM_GET_STACK(vm, -1);
-            d_vm_popn(vm, 2);
-            break;
+/**
+ * \fn static void vm_execute(DVM *vm, DecodedIns *ins, const bool step)
+ * \brief Execute decoded instructions, starting at `ins`, until the VM is
+ * halted, or until it reaches a `VM_OP_STOP` instruction.
+ *
+ * If `step` is true, return addresses are stored as locations in the text
+ * section rather than as decoded instructions, and the VM stops at any jump
+ * whose target was not known when it was decoded. This is used by
+ * `d_vm_parse_ins_at_pc`.
+ *
+ * If `vm` is `NULL`, then nothing is executed, but the addresses of the
+ * handlers are stored in `vmHandlers`.
+ *
+ * **NOTE:** This function will be run a lot during the course of execution.
+ * If you are looking to optimise Decision, this is a good place to start.
+ *
+ * \param vm The VM to execute the instructions in.
+ * \param ins The first instruction to execute.
+ * \param step Are we stepping through the text section?
+ */
+static void vm_execute(DVM *vm, DecodedIns *ins, const bool step) {
+#ifdef VM_USE_COMPUTED_GOTO
+    static const void *const dispatchTable[256] = {
+        [OP_RET]                      = &&LABEL_OP_RET,
+        [OP_RETN]                     = &&LABEL_OP_RETN,
+        [OP_ADD]                      = &&LABEL_OP_ADD,
+        [OP_ADDF]                     = &&LABEL_OP_ADDF,
+        [OP_ADDBI]                    = &&LABEL_OP_ADDBI,
+        [OP_ADDHI]                    = &&LABEL_OP_ADDHI,
+        [OP_ADDFI]                    = &&LABEL_OP_ADDFI,
+        [OP_AND]                      = &&LABEL_OP_AND,
+        [OP_ANDBI]                    = &&LABEL_OP_ANDBI,
+        [OP_ANDHI]                    = &&LABEL_OP_ANDHI,
+        [OP_ANDFI]                    = &&LABEL_OP_ANDFI,
+        [OP_CALL]                     = &&LABEL_OP_CALL,
+        [OP_CALLC]                    = &&LABEL_OP_CALLC,
+        [OP_CALLCI]                   = &&LABEL_OP_CALLCI,
+        [OP_CALLI]                    = &&LABEL_OP_CALLI,
+        [OP_CALLR]                    = &&LABEL_OP_CALLR,
+        [OP_CALLRB]                   = &&LABEL_OP_CALLRB,
+        [OP_CALLRH]                   = &&LABEL_OP_CALLRH,
+        [OP_CALLRF]                   = &&LABEL_OP_CALLRF,
+        [OP_CEQ]                      = &&LABEL_OP_CEQ,
+        [OP_CEQF]                     = &&LABEL_OP_CEQF,
+        [OP_CLEQ]                     = &&LABEL_OP_CLEQ,
+        [OP_CLEQF]                    = &&LABEL_OP_CLEQF,
+        [OP_CLT]                      = &&LABEL_OP_CLT,
+        [OP_CLTF]                     = &&LABEL_OP_CLTF,
+        [OP_CMEQ]                     = &&LABEL_OP_CMEQ,
+        [OP_CMEQF]                    = &&LABEL_OP_CMEQF,
+        [OP_CMT]                      = &&LABEL_OP_CMT,
+        [OP_CMTF]                     = &&LABEL_OP_CMTF,
+        [OP_CVTF]                     = &&LABEL_OP_CVTF,
+        [OP_CVTI]                     = &&LABEL_OP_CVTI,
+        [OP_DEREF]                    = &&LABEL_OP_DEREF,
+        [OP_DEREFI]                   = &&LABEL_OP_DEREFI,
+        [OP_DEREFB]                   = &&LABEL_OP_DEREFB,
+        [OP_DEREFBI]                  = &&LABEL_OP_DEREFBI,
+        [OP_DIV]                      = &&LABEL_OP_DIV,
+        [OP_DIVF]                     = &&LABEL_OP_DIVF,
+        [OP_DIVBI]                    = &&LABEL_OP_DIVBI,
+        [OP_DIVHI]                    = &&LABEL_OP_DIVHI,
+        [OP_DIVFI]                    = &&LABEL_OP_DIVFI,
+        [OP_GET]                      = &&LABEL_OP_GET,
+        [OP_GETBI]                    = &&LABEL_OP_GETBI,
+        [OP_GETHI]                    = &&LABEL_OP_GETHI,
+        [OP_GETFI]                    = &&LABEL_OP_GETFI,
+        [OP_INV]                      = &&LABEL_OP_INV,
+        [OP_J]                        = &&LABEL_OP_J,
+        [OP_JCON]                     = &&LABEL_OP_JCON,
+        [OP_JCONI]                    = &&LABEL_OP_JCONI,
+        [OP_JI]                       = &&LABEL_OP_JI,
+        [OP_JR]                       = &&LABEL_OP_JR,
+        [OP_JRBI]                     = &&LABEL_OP_JRBI,
+        [OP_JRHI]                     = &&LABEL_OP_JRHI,
+        [OP_JRFI]                     = &&LABEL_OP_JRFI,
+        [OP_JRCON]                    = &&LABEL_OP_JRCON,
+        [OP_JRCONBI]                  = &&LABEL_OP_JRCONBI,
+        [OP_JRCONHI]                  = &&LABEL_OP_JRCONHI,
+        [OP_JRCONFI]                  = &&LABEL_OP_JRCONFI,
+        [OP_MOD]                      = &&LABEL_OP_MOD,
+        [OP_MODBI]                    = &&LABEL_OP_MODBI,
+        [OP_MODHI]                    = &&LABEL_OP_MODHI,
+        [OP_MODFI]                    = &&LABEL_OP_MODFI,
+        [OP_MUL]                      = &&LABEL_OP_MUL,
+        [OP_MULF]                     = &&LABEL_OP_MULF,
+        [OP_MULBI]                    = &&LABEL_OP_MULBI,
+        [OP_MULHI]                    = &&LABEL_OP_MULHI,
+        [OP_MULFI]                    = &&LABEL_OP_MULFI,
+        [OP_NOT]                      = &&LABEL_OP_NOT,
+        [OP_OR]                       = &&LABEL_OP_OR,
+        [OP_ORBI]                     = &&LABEL_OP_ORBI,
+        [OP_ORHI]                     = &&LABEL_OP_ORHI,
+        [OP_ORFI]                     = &&LABEL_OP_ORFI,
+        [OP_POP]                      = &&LABEL_OP_POP,
+        [OP_POPB]                     = &&LABEL_OP_POPB,
+        [OP_POPH]                     = &&LABEL_OP_POPH,
+        [OP_POPF]                     = &&LABEL_OP_POPF,
+        [OP_PUSHB]                    = &&LABEL_OP_PUSHB,
+        [OP_PUSHH]                    = &&LABEL_OP_PUSHH,
+        [OP_PUSHF]                    = &&LABEL_OP_PUSHF,
+        [OP_PUSHNB]                   = &&LABEL_OP_PUSHNB,
+        [OP_PUSHNH]                   = &&LABEL_OP_PUSHNH,
+        [OP_PUSHNF]                   = &&LABEL_OP_PUSHNF,
+        [OP_SETADR]                   = &&LABEL_OP_SETADR,
+        [OP_SETADRB]                  = &&LABEL_OP_SETADRB,
+        [OP_SUB]                      = &&LABEL_OP_SUB,
+        [OP_SUBF]                     = &&LABEL_OP_SUBF,
+        [OP_SUBBI]                    = &&LABEL_OP_SUBBI,
+        [OP_SUBHI]                    = &&LABEL_OP_SUBHI,
+        [OP_SUBFI]                    = &&LABEL_OP_SUBFI,
+        [OP_SYSCALL]                  = &&LABEL_OP_SYSCALL,
+        [OP_XOR]                      = &&LABEL_OP_XOR,
+        [OP_XORBI]                    = &&LABEL_OP_XORBI,
+        [OP_XORHI]                    = &&LABEL_OP_XORHI,
+        [OP_XORFI]                    = &&LABEL_OP_XORFI,
+        [OP_ADDBI_JRBI]               = &&LABEL_OP_ADDBI_JRBI,
+        [OP_CEQ_JRCONBI]              = &&LABEL_OP_CEQ_JRCONBI,
+        [OP_CLEQ_JRCONBI]             = &&LABEL_OP_CLEQ_JRCONBI,
+        [OP_CLT_JRCONBI]              = &&LABEL_OP_CLT_JRCONBI,
+        [OP_CMEQ_JRCONBI]             = &&LABEL_OP_CMEQ_JRCONBI,
+        [OP_CMT_JRCONBI]              = &&LABEL_OP_CMT_JRCONBI,
+        [OP_GETBI_ADDBI]              = &&LABEL_OP_GETBI_ADDBI,
+        [OP_GETBI_GETBI]              = &&LABEL_OP_GETBI_GETBI,
+        [OP_GETBI_GETBI_ADD]          = &&LABEL_OP_GETBI_GETBI_ADD,
+        [OP_GETBI_SUBBI]              = &&LABEL_OP_GETBI_SUBBI,
+        [OP_PUSHB_GETBI]              = &&LABEL_OP_PUSHB_GETBI,
+        [OP_PUSHB_SYSCALL]            = &&LABEL_OP_PUSHB_SYSCALL,
+        [OP_SYSCALL_POP]              = &&LABEL_OP_SYSCALL_POP,
+        [VM_OP_STOP]                  = &&LABEL_VM_OP_STOP,
+        [VM_OP_NATIVE]                = &&LABEL_VM_OP_NATIVE,
+        [VM_OP_CALL_MOVE]             = &&LABEL_VM_OP_CALL_MOVE,
+        [VM_OP_CALL_MOVE + 1 ... 255] = &&LABEL_UNKNOWN,
+    };
+
+    if (vm == NULL) {
+        vmHandlers = dispatchTable;
+        return;
+    }
+#else
+    if (vm == NULL) {
+        return;
+    }
+#endif
+
+    // The cached stack pointer and top of the stack.
+    dint *sp;
+    union {
+        dint i;
+        dfloat f;
+    } tos;
+
+    VM_LOAD_STACK()
+
+#ifdef VM_USE_COMPUTED_GOTO
+    // Go to the handler of the first instruction. From then on, each handler
+    // will go directly to the handler of the next instruction.
+    VM_DISPATCH()
+    {
+#else
+    for (;;) {
+        switch (ins->opcode) {
+#endif
+        VM_CASE(OP_RET)
+        RET_GENERIC(0)
+
+        VM_CASE(OP_RETN)
+        RET_GENERIC(ins->arity)
+
+        VM_CASE(OP_ADD)
+        OP_2_1(+)
+        VM_NEXT()
+
+        VM_CASE(OP_ADDF)
+        OP_2_1_F(+)
+        VM_NEXT()
+
+        VM_CASE(OP_ADDBI)
+        VM_CASE(OP_ADDHI)
+        VM_CASE(OP_ADDFI)
+        OP_1_1_I(+)
+        VM_NEXT()
+
+        VM_CASE(OP_AND)
+        OP_2_1(&)
+        VM_NEXT()
+
+        VM_CASE(OP_ANDBI)
+        VM_CASE(OP_ANDHI)
+        VM_CASE(OP_ANDFI)
+        OP_1_1_I(&)
+        VM_NEXT()
+
+        VM_CASE(OP_CALL) {
+            char *callTo = (char *)tos.i;
+            VM_POP(1)
+            CALL_GENERIC(ins->arity)
+            VM_JUMP_RAW(callTo)
+        }
 
-        case OP_SUB:;
-            OP_2_1(-)
-            break;
+        VM_CASE(OP_CALLC) {
+            CFunction *cFunc = (CFunction *)tos.i;
+            VM_POP(1)
+            CALLC_GENERIC(cFunc)
+        }
 
-        case OP_SUBF:;
-            OP_2_1_F(-)
-            break;
+        VM_CASE(OP_CALLCI) {
+            CFunction *cFunc = (CFunction *)ins->operand;
+            CALLC_GENERIC(cFunc)
+        }
 
-        case OP_SUBBI:;
-            OP_1_1_I(-, GET_BIMMEDIATE)
-            break;
+        VM_CASE(OP_CALLI)
+        VM_CASE(OP_CALLRB)
+        VM_CASE(OP_CALLRH)
+        VM_CASE(OP_CALLRF)
+        CALL_GENERIC(ins->arity)
+        VM_CALL_TARGET()
+
+        VM_CASE(OP_CALLR) {
+            char *callTo = ins->rawPc + tos.i;
+            VM_POP(1)
+            CALL_GENERIC(ins->arity)
+            VM_JUMP_RAW(callTo)
+        }
 
-        case OP_SUBHI:;
-            OP_1_1_I(-, GET_HIMMEDIATE)
-            break;
+        VM_CASE(OP_CEQ)
+        OP_2_1(==)
+        VM_NEXT()
 
-        case OP_SUBFI:;
-            OP_1_1_I(-, GET_FIMMEDIATE)
-            break;
+        VM_CASE(OP_CEQF)
+        OP_2_1_C(==)
+        VM_NEXT()
 
-        case OP_SYSCALL:;
-            dint result;
-            switch (GET_BIMMEDIATE(1)) {
-                case SYS_PRINT:;
-                    switch (VM_GET_STACK(vm, 0)) {
-                        case 0: // Integer
-                            printf("%" DINT_PRINTF_d, VM_GET_STACK(vm, -2));
-                            break;
-                        case 1: // Float
-                            printf("%g", VM_GET_STACK_FLOAT(vm, -2));
-                            break;
-                        case 2: // String
-                            printf("%s", (char *)VM_GET_STACK(vm, -2));
-                            break;
-                        case 3: // Boolean
-                            printf("%s",
-                                   VM_GET_STACK(vm, -2) ? "true" : "false");
-                            break;
-                    }
-
-                    if (VM_GET_STACK(vm, -1)) {
-                        printf("\n");
-                    }
-
-                    *VM_GET_STACK_PTR(vm, -2) = 0;
-                    break;
-
-                case SYS_STRCMP:;
-                    result = strcmp((char *)VM_GET_STACK(vm, -1),
-                                    (char *)VM_GET_STACK(vm, -2));
-
-                    switch (VM_GET_STACK(vm, 0)) {
-                        case 0:
-                            result = (result == 0);
-                            break;
-                        case 1:
-                            result = (result <= 0);
-                            break;
-                        case 2:
-                            result = (result < 0);
-                            break;
-                        case 3:
-                            result = (result >= 0);
-                            break;
-                        case 4:
-                            result = (result > 0);
-                            break;
-                        default:
-                            result = 0;
-                            break;
-                    }
-
-                    *VM_GET_STACK_PTR(vm, -2) = result;
-                    break;
-
-                case SYS_STRLEN:;
-                    result = strlen((char *)VM_GET_STACK(vm, -2));
-                    *VM_GET_STACK_PTR(vm, -2) = result;
-                    break;
+        VM_CASE(OP_CLEQ)
+        OP_2_1(<=)
+        VM_NEXT()
+
+        VM_CASE(OP_CLEQF)
+        OP_2_1_C(<=)
+        VM_NEXT()
+
+        VM_CASE(OP_CLT)
+        OP_2_1(<)
+        VM_NEXT()
+
+        VM_CASE(OP_CLTF)
+        OP_2_1_C(<)
+        VM_NEXT()
+
+        VM_CASE(OP_CMEQ)
+        OP_2_1(>=)
+        VM_NEXT()
+
+        VM_CASE(OP_CMEQF)
+        OP_2_1_C(>=)
+        VM_NEXT()
+
+        VM_CASE(OP_CMT)
+        OP_2_1(>)
+        VM_NEXT()
+
+        VM_CASE(OP_CMTF)
+        OP_2_1_C(>)
+        VM_NEXT()
+
+        VM_CASE(OP_CVTF)
+        tos.f = (dfloat)tos.i;
+        VM_NEXT()
+
+        VM_CASE(OP_CVTI)
+        tos.i = (dint)tos.f;
+        VM_NEXT()
+
+        VM_CASE(OP_DEREF)
+        tos.i = *((dint *)tos.i);
+        VM_NEXT()
+
+        VM_CASE(OP_DEREFI)
+        VM_PUSH(*((dint *)ins->operand))
+        VM_NEXT()
+
+        VM_CASE(OP_DEREFB)
+        tos.i = *((uint8_t *)tos.i);
+        VM_NEXT()
+
+        VM_CASE(OP_DEREFBI)
+        VM_PUSH(*((uint8_t *)ins->operand))
+        VM_NEXT()
+
+        VM_CASE(OP_DIV)
+        DIV_CHECK(VM_BELOW(-1) == 0, OP_2_1(/))
+
+        VM_CASE(OP_DIVF)
+        DIV_CHECK(VM_BELOW_FLOAT(-1) == 0.0, OP_2_1_F(/))
+
+        VM_CASE(OP_DIVBI)
+        VM_CASE(OP_DIVHI)
+        VM_CASE(OP_DIVFI)
+        DIV_CHECK(ins->operand == 0, OP_1_1_I(/))
+
+        VM_CASE(OP_GET)
+        tos.i = VM_GET(tos.i);
+        VM_NEXT()
+
+        VM_CASE(OP_GETBI)
+        VM_CASE(OP_GETHI)
+        VM_CASE(OP_GETFI)
+        VM_PUSH(VM_GET(ins->operand))
+        VM_NEXT()
+
+        VM_CASE(OP_INV)
+        tos.i = ~tos.i;
+        VM_NEXT()
+
+        VM_CASE(OP_J) {
+            char *jumpTo = (char *)tos.i;
+            VM_POP(1)
+            VM_JUMP_RAW(jumpTo)
+        }
+
+        VM_CASE(OP_JCON)
+        JCON_2_0((char *)VM_BELOW(-1))
+
+        VM_CASE(OP_JCONI)
+        VM_CASE(OP_JRCONBI)
+        VM_CASE(OP_JRCONHI)
+        VM_CASE(OP_JRCONFI)
+        if (tos.i) {
+            VM_POP(1)
+            VM_JUMP_TARGET()
+        }
+        VM_POP(1)
+        VM_NEXT()
+
+        VM_CASE(OP_JI)
+        VM_CASE(OP_JRBI)
+        VM_CASE(OP_JRHI)
+        VM_CASE(OP_JRFI)
+        VM_JUMP_TARGET()
+
+        VM_CASE(OP_JR) {
+            char *jumpTo = ins->rawPc + tos.i;
+            VM_POP(1)
+            VM_JUMP_RAW(jumpTo)
+        }
+
+        VM_CASE(OP_JRCON)
+        JCON_2_0(ins->rawPc + VM_BELOW(-1))
+
+        VM_CASE(OP_MOD)
+        OP_2_1(%)
+        VM_NEXT()
+
+        VM_CASE(OP_MODBI)
+        VM_CASE(OP_MODHI)
+        VM_CASE(OP_MODFI)
+        OP_1_1_I(%)
+        VM_NEXT()
+
+        VM_CASE(OP_MUL)
+        OP_2_1(*)
+        VM_NEXT()
+
+        VM_CASE(OP_MULF)
+        OP_2_1_F(*)
+        VM_NEXT()
+
+        VM_CASE(OP_MULBI)
+        VM_CASE(OP_MULHI)
+        VM_CASE(OP_MULFI)
+        OP_1_1_I(*)
+        VM_NEXT()
+
+        VM_CASE(OP_NOT)
+        tos.i = !tos.i;
+        VM_NEXT()
+
+        VM_CASE(OP_OR)
+        OP_2_1(|)
+        VM_NEXT()
+
+        VM_CASE(OP_ORBI)
+        VM_CASE(OP_ORHI)
+        VM_CASE(OP_ORFI)
+        OP_1_1_I(|)
+        VM_NEXT()
+
+        VM_CASE(OP_POP)
+        VM_POP(1)
+        VM_NEXT()
+
+        VM_CASE(OP_POPB)
+        VM_CASE(OP_POPH)
+        VM_CASE(OP_POPF) {
+            // Don't pop more elements than there are in the stack.
+            dint numPop = sp - vm->basePtr + 1;
+            if (ins->operand < numPop) {
+                numPop = ins->operand;
             }
-            d_vm_popn(vm, 2);
-            break;
+            VM_POP(numPop)
+            VM_NEXT()
+        }
 
-        case OP_XOR:;
-            OP_2_1(^)
-            break;
+        VM_CASE(OP_PUSHB)
+        VM_CASE(OP_PUSHH)
+        VM_CASE(OP_PUSHF)
+        VM_PUSH(ins->operand)
+        VM_NEXT()
+
+        VM_CASE(OP_PUSHNB)
+        VM_CASE(OP_PUSHNH)
+        VM_CASE(OP_PUSHNF)
+        if (ins->operand > 0) {
+            VM_RESERVE(ins->operand)
+            *sp = tos.i;
+            memset(sp + 1, 0, ins->operand * sizeof(dint));
+            sp += ins->operand;
+            tos.i = 0;
+        }
+        VM_NEXT()
 
-        case OP_XORBI:;
-            OP_1_1_I(^, GET_BIMMEDIATE)
-            break;
+        VM_CASE(OP_SETADR)
+        *((dint *)tos.i) = VM_BELOW(-1);
+        VM_POP(2)
+        VM_NEXT()
 
-        case OP_XORHI:;
-            OP_1_1_I(^, GET_HIMMEDIATE)
-            break;
+        VM_CASE(OP_SETADRB)
+        *((uint8_t *)tos.i) = (uint8_t)VM_BELOW(-1);
+        VM_POP(2)
+        VM_NEXT()
 
-        case OP_XORFI:;
-            OP_1_1_I(^, GET_FIMMEDIATE)
-            break;
+        VM_CASE(OP_SUB)
+        OP_2_1(-)
+        VM_NEXT()
 
-        default:
-            ERROR_RUNTIME(vm, "unknown opcode %d", opcode);
-            break;
+        VM_CASE(OP_SUBF)
+        OP_2_1_F(-)
+        VM_NEXT()
+
+        VM_CASE(OP_SUBBI)
+        VM_CASE(OP_SUBHI)
+        VM_CASE(OP_SUBFI)
+        OP_1_1_I(-)
+        VM_NEXT()
+
+        VM_CASE(OP_SYSCALL) {
+            dint result;
+            SYSCALL_GENERIC(ins->operand, result)
+            sp -= 2;
+            tos.i = result;
+            VM_NEXT()
+        }
+
+        VM_CASE(OP_XOR)
+        OP_2_1(^)
+        VM_NEXT()
+
+        VM_CASE(OP_XORBI)
+        VM_CASE(OP_XORHI)
+        VM_CASE(OP_XORFI)
+        OP_1_1_I(^)
+        VM_NEXT()
+
+        // Superinstructions.
+        VM_CASE(OP_ADDBI_JRBI)
+        OP_1_1_I(+)
+        VM_JUMP_TARGET()
+
+        VM_CASE(OP_CEQ_JRCONBI)
+        JCMP_2_0(==)
+
+        VM_CASE(OP_CLEQ_JRCONBI)
+        JCMP_2_0(<=)
+
+        VM_CASE(OP_CLT_JRCONBI)
+        JCMP_2_0(<)
+
+        VM_CASE(OP_CMEQ_JRCONBI)
+        JCMP_2_0(>=)
+
+        VM_CASE(OP_CMT_JRCONBI)
+        JCMP_2_0(>)
+
+        VM_CASE(OP_GETBI_ADDBI)
+        VM_PUSH(VM_GET(ins->operand))
+        tos.i += ins->operand2;
+        VM_NEXT()
+
+        VM_CASE(OP_GETBI_GETBI)
+        VM_PUSH(VM_GET(ins->operand))
+        VM_PUSH(VM_GET(ins->operand2))
+        VM_NEXT()
+
+        VM_CASE(OP_GETBI_GETBI_ADD)
+        VM_PUSH(VM_GET(ins->operand))
+        VM_PUSH(VM_GET(ins->operand2))
+        OP_2_1(+)
+        VM_NEXT()
+
+        VM_CASE(OP_GETBI_SUBBI)
+        VM_PUSH(VM_GET(ins->operand))
+        tos.i -= ins->operand2;
+        VM_NEXT()
+
+        VM_CASE(OP_PUSHB_GETBI)
+        VM_PUSH(ins->operand)
+        VM_PUSH(VM_GET(ins->operand2))
+        VM_NEXT()
+
+        VM_CASE(OP_PUSHB_SYSCALL) {
+            dint result;
+            VM_PUSH(ins->operand)
+            SYSCALL_GENERIC(ins->operand2, result)
+            sp -= 2;
+            tos.i = result;
+            VM_NEXT()
+        }
+
+        VM_CASE(OP_SYSCALL_POP) {
+            dint result;
+            SYSCALL_GENERIC(ins->operand, result)
+            (void)result;
+            VM_POP(3)
+            VM_NEXT()
+        }
+
+        VM_CASE(VM_OP_STOP)
+        vm->pc = ins->rawPc;
+        VM_HALT()
+
+        VM_CASE(VM_OP_NATIVE)
+        VM_RESERVE(ins->arity)
+        VM_SYNC_STACK()
+        ins = ins->native(vm);
+        VM_LOAD_STACK()
+        VM_DISPATCH()
+
+        VM_CASE(VM_OP_CALL_MOVE) {
+            // The caller didn't reserve any space for the frame, so move the
+            // arguments up to make room for it.
+            dint returnAdr =
+                (step) ? (dint)(ins->rawPc +
+                                VM_INS_SIZE[(unsigned char)*(ins->rawPc)])
+                       : (dint)(ins + 1);
+
+            VM_RESERVE(2)
+            *sp             = tos.i;
+            dint *insertPtr = sp - ins->arity + 1;
+            memmove(insertPtr + 2, insertPtr, ins->arity * sizeof(dint));
+            sp += 2;
+
+            insertPtr[0] = (dint)(vm->framePtr - vm->basePtr);
+            insertPtr[1] = returnAdr;
+            vm->framePtr = insertPtr + 1;
+            tos.i        = *sp;
+        }
+        VM_CALL_TARGET()
+
+        VM_DEFAULT
+        VM_ERROR("unknown opcode %d", ins->opcode)
+#ifdef VM_USE_COMPUTED_GOTO
+    }
+#else
+        }
+    }
+#endif
+}
+
+#ifdef VM_USE_COMPUTED_GOTO
+#pragma GCC diagnostic pop
+#endif
+
+/**
+ * \fn static void vm_enter(DVM *vm, DecodedIns *ins, const bool step)
+ * \brief Execute decoded instructions using `vm_execute`. If the stack is
+ * guarded, this also catches the stack overflowing, and turns it into a
+ * runtime error.
+ *
+ * \param vm The VM to execute the instructions in.
+ * \param ins The first decoded instruction to execute.
+ * \param step Are we stepping through the text section?
+ */
+static void vm_enter(DVM *vm, DecodedIns *ins, const bool step) {
+#ifdef VM_USE_GUARDED_STACK
+    // Another VM could already be running, e.g. if this VM is being run from
+    // inside a C function, so we need to restore it afterwards.
+    DVM *savedVM          = guardedVM;
+    sigjmp_buf *savedJump = guardedJump;
+
+    sigjmp_buf jump;
+    guardedVM   = vm;
+    guardedJump = &jump;
+
+    // Save the signal mask as well, so it is restored if we jump back here
+    // from the signal handler.
+    if (sigsetjmp(jump, 1) == 0) {
+        vm_execute(vm, ins, step);
+    } else {
+        // The stack overflowed, so whatever was on the stack is lost.
+        vm->stackPtr = vm->basePtr - 1;
+        vm->framePtr = vm->basePtr - 1;
+        ERROR_RUNTIME(vm, "Stack overflow");
+    }
+
+    guardedVM   = savedVM;
+    guardedJump = savedJump;
+#else
+    vm_execute(vm, ins, step);
+#endif // VM_USE_GUARDED_STACK
+}
+
+/**
+ * \fn dint d_vm_syscall(DVM *vm, DSyscall syscall)
+ * \brief Run a syscall in the same way as `OP_SYSCALL`, with its arguments at
+ * the top of the stack, but without popping them.
+ *
+ * This is how native code runs syscalls (see `djit.c`).
+ *
+ * \return The return value of the syscall, or 0 if it doesn't return
+ * anything.
+ *
+ * \param vm The VM whose stack has the arguments on it.
+ * \param syscall The syscall to run.
+ */
+dint d_vm_syscall(DVM *vm, DSyscall syscall) {
+    dint *sp = vm->stackPtr;
+    union {
+        dint i;
+        dfloat f;
+    } tos;
+    tos.i = *sp;
+
+    dint result;
+    SYSCALL_GENERIC(syscall, result)
+    return result;
+}
+
+/**
+ * \fn void d_vm_parse_ins_at_pc(DVM *vm)
+ * \brief Given a Decision VM, at it's current position in the program, parse
+ * the instruction at that position.
+ *
+ * \param vm The VM to use to parse the instruction.
+ */
+void d_vm_parse_ins_at_pc(DVM *vm) {
+    if (vmHandlers == NULL) {
+        vm_execute(NULL, NULL, false);
+    }
+
+    // Decode the instruction at the program counter. We follow it with
+    // instructions that stop the VM wherever it could go next, so only this
+    // instruction is executed.
+    DecodedIns code[3];
+    vm_decode_ins(vm->pc, code);
+
+    // If the call is in a text section with an older calling convention, it
+    // needs to be made in the same way as it would be if it were decoded.
+    if (vm_is_fixed_call(code[0].opcode)) {
+        DecodedIns *decoded = d_vm_find_decoded_ins(vm->pc);
+
+        if (decoded != NULL && decoded->opcode == VM_OP_CALL_MOVE) {
+            code[0].opcode  = VM_OP_CALL_MOVE;
+            code[0].handler = decoded->handler;
+        }
     }
+
+    unsigned char size = d_vm_ins_size(code[0].opcode);
+    vm_stop_ins(code + 1, vm->pc + ((size > 0) ? size : 1));
+    vm_stop_ins(code + 2, code[0].rawTarget);
+    code[0].target = code + 2;
+
+    vm_enter(vm, code, true);
 }
 
 /**
@@ -1520,6 +2948,10 @@ void d_vm_inc_pc(DVM *vm) {
  * \brief Get a virtual machine to start running instructions in a loop, until
  * it is halted.
  *
+ * If `start` is in a text section that has been decoded with
+ * `d_vm_decode_text`, then the decoded instructions are executed. Otherwise,
+ * the instructions are decoded one at a time as they are executed.
+ *
  * \return If it ran without any runtime errors.
  *
  * \param vm The VM to run the bytecode in.
@@ -1529,14 +2961,48 @@ bool d_vm_run(DVM *vm, void *start) {
     vm->pc     = start;
     vm->halted = false;
 
-    while (!vm->halted) {
-        d_vm_parse_ins_at_pc(vm);
-        d_vm_inc_pc(vm);
+    DecodedText *decoded = d_vm_find_decoded_text(start);
+    DecodedIns *ins      = NULL;
+
+    if (decoded != NULL) {
+        ins = decoded->insAt[(char *)start - decoded->text];
+    }
+
+    if (ins != NULL) {
+        vm->_decoded = decoded;
+        vm_enter(vm, ins, false);
+    } else {
+        while (!vm->halted) {
+            d_vm_parse_ins_at_pc(vm);
+            d_vm_inc_pc(vm);
+        }
     }
 
     return !vm->runtimeError;
 }
 
+/**
+ * \fn bool d_vm_run_decoded(DVM *vm, DecodedText *decoded, DecodedIns *ins)
+ * \brief The same as `d_vm_run`, but starting at an instruction that has
+ * already been found with `d_vm_find_decoded_text`, so it doesn't need to be
+ * looked up again. This is quicker when the same code is run many times.
+ *
+ * \return If it ran without any runtime errors.
+ *
+ * \param vm The VM to run the instructions in.
+ * \param decoded The decoded text section the instruction is in.
+ * \param ins The decoded instruction to start at.
+ */
+bool d_vm_run_decoded(DVM *vm, DecodedText *decoded, DecodedIns *ins) {
+    vm->pc       = ins->rawPc;
+    vm->halted   = false;
+    vm->_decoded = decoded;
+
+    vm_enter(vm, ins, false);
+
+    return !vm->runtimeError;
+}
+
 /**
  * \fn void d_vm_dump(DVM *vm)
  * \brief Dump the contents of a Decision VM to stdout for debugging.
@@ -29,6 +29,7 @@
 #include "derror.h"
 #include <stdbool.h>
 
+#include <stddef.h>
 #include <stdint.h>
 
 /*
@@ -135,13 +136,86 @@ typedef enum _dIns {
     OP_XORBI   = 90, ///< push(pop() ^ I(1))
     OP_XORHI   = 91, ///< push(pop() ^ I(|M|/2))
     OP_XORFI   = 92, ///< push(pop() ^ I(|M|))
+
+    // Superinstructions, see SuperIns.
+    OP_ADDBI_JRBI      = 93,  ///< ADDBI I(1); JRBI I(1)
+    OP_CEQ_JRCONBI     = 94,  ///< CEQ; JRCONBI I(1)
+    OP_CLEQ_JRCONBI    = 95,  ///< CLEQ; JRCONBI I(1)
+    OP_CLT_JRCONBI     = 96,  ///< CLT; JRCONBI I(1)
+    OP_CMEQ_JRCONBI    = 97,  ///< CMEQ; JRCONBI I(1)
+    OP_CMT_JRCONBI     = 98,  ///< CMT; JRCONBI I(1)
+    OP_GETBI_ADDBI     = 99,  ///< GETBI I(1); ADDBI I(1)
+    OP_GETBI_GETBI     = 100, ///< GETBI I(1); GETBI I(1)
+    OP_GETBI_GETBI_ADD = 101, ///< GETBI I(1); GETBI I(1); ADD
+    OP_GETBI_SUBBI     = 102, ///< GETBI I(1); SUBBI I(1)
+    OP_PUSHB_GETBI     = 103, ///< PUSHB I(1); GETBI I(1)
+    OP_PUSHB_SYSCALL   = 104, ///< PUSHB I(1); SYSCALL I(1)
+    OP_SYSCALL_POP     = 105, ///< SYSCALL I(1); POP
 } DIns;
 
 /**
  * \def NUM_OPCODES
  * \brief Macro constant representing the number of opcodes.
  */
-#define NUM_OPCODES (OP_XORFI + 1)
+#define NUM_OPCODES (OP_SYSCALL_POP + 1)
+
+/**
+ * \def SUPERINS_MAX_LEN
+ * \brief The length of the longest sequence of opcodes that a
+ * superinstruction can replace.
+ */
+#define SUPERINS_MAX_LEN 3
+
+/**
+ * \struct _superIns
+ * \brief A superinstruction is an opcode that does the same thing as a fixed
+ * sequence of other opcodes, so the VM only needs to dispatch one instruction
+ * instead of several.
+ *
+ * A superinstruction is the same size as the sequence it replaces, since only
+ * the first opcode of the sequence is replaced. The immediates and the rest of
+ * the sequence stay where they were, so nothing that points into the text
+ * section needs to move.
+ *
+ * \typedef struct _superIns SuperIns
+ */
+typedef struct _superIns {
+    DIns opcode;                     ///< The superinstruction's opcode.
+    DIns sequence[SUPERINS_MAX_LEN]; ///< The opcodes it replaces.
+    unsigned char length;            ///< The length of `sequence`.
+} SuperIns;
+
+/**
+ * \def VM_OP_STOP
+ * \brief An internal opcode that only exists in decoded instructions. It stops
+ * the VM from executing any more instructions, and sets the program counter
+ * to the instruction's `rawPc`.
+ */
+#define VM_OP_STOP NUM_OPCODES
+
+/**
+ * \def VM_OP_NATIVE
+ * \brief An internal opcode that only exists in decoded instructions that
+ * have been compiled to native code (see `d_vm_set_native`). It runs the
+ * native code, and carries on from the decoded instruction it returns.
+ */
+#define VM_OP_NATIVE (VM_OP_STOP + 1)
+
+/**
+ * \def VM_OP_CALL_MOVE
+ * \brief An internal opcode that only exists in decoded instructions of text
+ * sections that use calling convention 0 (see `d_vm_set_call_convention`). It
+ * calls the instruction's target like `OP_CALLI`, but first moves the
+ * arguments up the stack to make room for the frame.
+ */
+#define VM_OP_CALL_MOVE (VM_OP_NATIVE + 1)
+
+/**
+ * \def VM_OP_UNKNOWN
+ * \brief An internal opcode that only exists in decoded instructions. It is
+ * used to pad the end of a decoded text section.
+ */
+#define VM_OP_UNKNOWN 255
 
 /**
  * \enum _dSyscall
@@ -173,9 +247,22 @@ typedef enum _dSyscall {
                     ///< * Returns: The length of the string.
 } DSyscall;
 
+/**
+ * \def VM_CALL_CONVENTION
+ * \brief The calling convention that code is generated for, which is recorded
+ * in object files.
+ *
+ * * `0`: Calls push the arguments, and the VM moves them up the stack to make
+ *   room for the saved frame pointer and return address. Object files from
+ *   before the section table was added use this.
+ * * `1`: Calls reserve two elements with `PUSHNB 2` before pushing the
+ *   arguments, and the VM saves the frame there.
+ */
+#define VM_CALL_CONVENTION 1
+
 /**
  * \def VM_STACK_SIZE_MIN
- * \brief The minimum, and starting, size of the VM's stack.
+ * \brief The minimum, and default starting, size of the VM's stack.
  */
 #define VM_STACK_SIZE_MIN 16
 
@@ -185,12 +272,6 @@ typedef enum _dSyscall {
  */
 #define VM_STACK_SIZE_SCALE_INC 1.5
 
-/**
- * \def VM_STACK_SIZE_SCALE_DEC
- * \brief How much should the stack size decrease to save memory?
- */
-#define VM_STACK_SIZE_SCALE_DEC 0.5
-
 /**
  * \enum _DVM
  * \brief The Decision VM structure.
@@ -204,13 +285,26 @@ typedef struct _DVM {
     dint *stackPtr; ///< A pointer to the top of the stack.
     dint *framePtr; ///< A pointer to the start of the stack frame.
 
-    duint stackSize; ///< The current size of the stack.
+    duint stackSize;        ///< The current size of the stack.
+    duint initialStackSize; ///< The size of the stack when the VM is created.
+
+    size_t numStackReallocs; ///< How many times the stack has been
+                             ///< reallocated. Useful for checking that the
+                             ///< initial size of the stack is big enough.
+
+    bool shrinkOnReset; ///< If true, `d_vm_reset` will shrink the stack back
+                        ///< to `initialStackSize`. Otherwise, the stack keeps
+                        ///< its size so it can be reused. Default is `true`.
 
     unsigned char _inc_pc; ///< How many bytes to increment the program counter.
                            ///< This is determined automatically.
 
     bool halted;       ///< The halted flag.
     bool runtimeError; ///< The runtime error flag.
+
+    struct _decodedText *_decoded; ///< The decoded text section the VM is
+                                   ///< running, so jumps within it don't need
+                                   ///< to search for it.
 } DVM;
 
 #define BIMMEDIATE_SIZE   1
@@ -256,6 +350,84 @@ typedef struct _DVM {
 #endif // defined(WIN32)
 #endif // DECISION_32
 
+/**
+ * \struct _vmProfile
+ * \brief Counts how hot a region of decoded instructions, like a function,
+ * is, so that it can be promoted to a faster tier once it gets hot.
+ *
+ * \typedef struct _vmProfile VMProfile
+ */
+typedef struct _vmProfile {
+    duint calls;     ///< How many times the region has been called.
+    duint backEdges; ///< How many backward jumps have been taken in the
+                     ///< region.
+    duint threshold; ///< When `calls + backEdges` reaches this, `promote` is
+                     ///< called.
+
+    void (*promote)(struct _vmProfile *profile); ///< Promote the region to a
+                                                 ///< faster tier. Can be
+                                                 ///< `NULL`.
+    void *data; ///< Data for `promote`.
+} VMProfile;
+
+/**
+ * \struct _decodedIns
+ * \brief A fixed-width, pre-decoded version of an instruction in the text
+ * section, which the VM can execute without decoding the immediates again.
+ *
+ * \typedef struct _decodedIns DecodedIns
+ */
+typedef struct _decodedIns {
+    const void *handler; ///< The address of the opcode's handler in the VM,
+                         ///< if the VM uses computed gotos. `NULL` otherwise.
+
+    dint operand; ///< The immediate of the instruction, sign-extended.
+                  ///< For superinstructions, the first immediate.
+
+    struct _decodedIns *target; ///< If the instruction jumps or calls to a
+                                ///< fixed location, the decoded instruction
+                                ///< at that location. `NULL` if it could not
+                                ///< be resolved.
+
+    char *rawTarget; ///< If the instruction jumps or calls to a fixed
+                     ///< location, the location in the text section.
+
+    char *rawPc; ///< Where the instruction is in the text section.
+
+    unsigned char opcode; ///< The instruction's opcode.
+    uint8_t arity; ///< The number of arguments for calls, or the number of
+                   ///< return values for returns.
+
+    bimmediate_t operand2; ///< For superinstructions, the second immediate,
+                           ///< which is always a byte immediate.
+
+    struct _decodedIns *(*native)(DVM *vm); ///< For `VM_OP_NATIVE`, the native
+                                            ///< code to run. It returns the
+                                            ///< decoded instruction to carry
+                                            ///< on from.
+
+    VMProfile *profile; ///< The profile of the region the instruction is in,
+                        ///< or `NULL` if it isn't being profiled.
+} DecodedIns;
+
+/**
+ * \struct _decodedText
+ * \brief A text section that has been decoded into `DecodedIns`.
+ *
+ * \typedef struct _decodedText DecodedText
+ */
+typedef struct _decodedText {
+    char *text;      ///< The text section that was decoded.
+    size_t textSize; ///< The size of the text section in bytes.
+
+    DecodedIns *ins; ///< The decoded instructions, plus one extra at the end
+                     ///< that raises an error if it is executed.
+    size_t numIns;   ///< The number of decoded instructions.
+
+    DecodedIns **insAt; ///< For each byte in the text section, the decoded
+                        ///< instruction that starts there, or `NULL`.
+} DecodedText;
+
 /*
 === STACK FUNCTIONS =======================================
 */
@@ -530,6 +702,29 @@ DECISION_API size_t d_vm_top(DVM *vm);
  */
 DECISION_API unsigned char d_vm_ins_size(DIns opcode);
 
+/**
+ * \fn bool d_vm_ins_changes_flow(DIns opcode)
+ * \brief Given an opcode, could the instruction not carry on to the next
+ * instruction, i.e. is it a jump, a call or a return?
+ *
+ * \return If the instruction could change the flow of execution.
+ *
+ * \param opcode The opcode to query.
+ */
+DECISION_API bool d_vm_ins_changes_flow(DIns opcode);
+
+/**
+ * \fn const SuperIns *d_vm_superins(DIns opcode)
+ * \brief Given an opcode, get the sequence of opcodes it replaces if it is a
+ * superinstruction.
+ *
+ * \return The superinstruction, or `NULL` if the opcode is not a
+ * superinstruction.
+ *
+ * \param opcode The opcode to query.
+ */
+DECISION_API const SuperIns *d_vm_superins(DIns opcode);
+
 /**
  * \fn DVM d_vm_create()
  * \brief Create a Decision VM in its starting state, with malloc'd elements.
@@ -538,9 +733,25 @@ DECISION_API unsigned char d_vm_ins_size(DIns opcode);
  */
 DECISION_API DVM d_vm_create();
 
+/**
+ * \fn DVM d_vm_create_with_capacity(duint capacity)
+ * \brief Create a Decision VM in its starting state, with a stack that can
+ * hold `capacity` elements before it needs to grow.
+ *
+ * **NOTE:** The stack never shrinks while the VM is running. If
+ * `shrinkOnReset` is true, it shrinks back to `capacity` in `d_vm_reset`.
+ *
+ * \return A Decision VM in its starting state.
+ *
+ * \param capacity The initial size of the stack. If this is less than
+ * `VM_STACK_SIZE_MIN`, then `VM_STACK_SIZE_MIN` is used instead.
+ */
+DECISION_API DVM d_vm_create_with_capacity(duint capacity);
+
 /**
  * \fn void d_vm_reset(DVM *vm)
- * \brief Reset a Decision VM to its starting state.
+ * \brief Reset a Decision VM to its starting state. The stack is only
+ * reallocated if it was freed, or if it has grown and `shrinkOnReset` is true.
  *
  * \param vm A Decision VM to set to its starting state.
  */
@@ -580,6 +791,107 @@ DECISION_API void d_vm_runtime_error(DVM *vm, const char *error);
         d_vm_runtime_error((vm), errMsg); \
     }
 
+/**
+ * \fn DecodedText *d_vm_decode_text(char *text, size_t textSize)
+ * \brief Decode a linked text section into a form that the VM can execute
+ * without having to decode the immediates again, with jump and call targets
+ * already resolved.
+ *
+ * The decoded text is remembered, so that `d_vm_run` uses it whenever it is
+ * asked to run code from this text section.
+ *
+ * Jumps and calls to other text sections are resolved if those text sections
+ * have already been decoded, and jumps and calls from text sections that have
+ * already been decoded into this one are resolved as well.
+ *
+ * \return The malloc'd decoded text. Free it with `d_vm_free_decoded_text`.
+ *
+ * \param text The text section to decode.
+ * \param textSize The size of the text section in bytes.
+ */
+DECISION_API DecodedText *d_vm_decode_text(char *text, size_t textSize);
+
+/**
+ * \fn DecodedIns *d_vm_find_decoded_ins(const char *pc)
+ * \brief Find the decoded version of the instruction at a location in a text
+ * section.
+ *
+ * \return The decoded instruction, or `NULL` if the text section hasn't been
+ * decoded, or `pc` isn't the start of an instruction.
+ *
+ * \param pc The location of the instruction in a text section.
+ */
+DECISION_API DecodedIns *d_vm_find_decoded_ins(const char *pc);
+
+/**
+ * \fn DecodedText *d_vm_find_decoded_text(const char *pc)
+ * \brief Find the decoded text section that a location is in.
+ *
+ * \return The decoded text section, or `NULL` if the location isn't in a text
+ * section that has been decoded.
+ *
+ * \param pc The location in a text section.
+ */
+DECISION_API DecodedText *d_vm_find_decoded_text(const char *pc);
+
+/**
+ * \fn void d_vm_set_native(DecodedIns *ins, DecodedIns *(*native)(DVM *vm),
+ *                          uint8_t reserve)
+ * \brief Make a decoded instruction run native code instead, whenever the VM
+ * gets to it.
+ *
+ * The native code is called with the VM's stack pointer and top of the stack
+ * up to date, and it returns the decoded instruction that the VM should carry
+ * on from, with the stack pointer up to date again.
+ *
+ * \param ins The decoded instruction to replace.
+ * \param native The native code that does what `ins` does, and carries on
+ * from there.
+ * \param reserve How many elements the VM should make space for on the stack
+ * before running the native code.
+ */
+DECISION_API void d_vm_set_native(DecodedIns *ins,
+                                  DecodedIns *(*native)(DVM *vm),
+                                  uint8_t reserve);
+
+/**
+ * \fn void d_vm_set_call_convention(DecodedText *decoded, uint8_t convention)
+ * \brief Make the calls in a decoded text section follow the calling
+ * convention it was generated with, if it is older than `VM_CALL_CONVENTION`.
+ *
+ * This needs to be done before the text section is run or compiled to native
+ * code.
+ *
+ * \param decoded The decoded text section.
+ * \param convention The calling convention the text section was generated
+ * with.
+ */
+DECISION_API void d_vm_set_call_convention(DecodedText *decoded,
+                                           uint8_t convention);
+
+/**
+ * \fn void d_vm_free_decoded_text(DecodedText *decoded)
+ * \brief Free a decoded text section, so that the VM doesn't use it anymore.
+ *
+ * \param decoded The decoded text to free.
+ */
+DECISION_API void d_vm_free_decoded_text(DecodedText *decoded);
+
+/**
+ * \fn dint d_vm_syscall(DVM *vm, DSyscall syscall)
+ * \brief Run a syscall in the same way as `OP_SYSCALL`, with its arguments at
+ * the top of the stack, but without popping them.
+ *
+ * This is how native code runs syscalls (see `djit.c`).
+ *
+ * \return The return value of the syscall, or 0 if it doesn't return
+ * anything.
+ *
+ * \param vm The VM whose stack has the arguments on it.
+ * \param syscall The syscall to run.
+ */
+DECISION_API dint d_vm_syscall(DVM *vm, DSyscall syscall);
+
 /**
  * \fn void d_vm_parse_ins_at_pc(DVM *vm)
  * \brief Given a Decision VM, at it's current position in the program, parse
@@ -618,6 +930,10 @@ DECISION_API void d_vm_inc_pc(DVM *vm);
  * \brief Get a virtual machine to start running instructions in a loop, until
  * it is halted.
  *
+ * If `start` is in a text section that has been decoded with
+ * `d_vm_decode_text`, then the decoded instructions are executed. Otherwise,
+ * the instructions are decoded one at a time as they are executed.
+ *
  * \return If it ran without any runtime errors.
  *
  * \param vm The VM to run the bytecode in.
@@ -625,6 +941,21 @@ DECISION_API void d_vm_inc_pc(DVM *vm);
  */
 DECISION_API bool d_vm_run(DVM *vm, void *start);
 
+/**
+ * \fn bool d_vm_run_decoded(DVM *vm, DecodedText *decoded, DecodedIns *ins)
+ * \brief The same as `d_vm_run`, but starting at an instruction that has
+ * already been found with `d_vm_find_decoded_text`, so it doesn't need to be
+ * looked up again. This is quicker when the same code is run many times.
+ *
+ * \return If it ran without any runtime errors.
+ *
+ * \param vm The VM to run the instructions in.
+ * \param decoded The decoded text section the instruction is in.
+ * \param ins The decoded instruction to start at.
+ */
+DECISION_API bool d_vm_run_decoded(DVM *vm, DecodedText *decoded,
+                                   DecodedIns *ins);
+
 /**
  * \fn void d_vm_dump(DVM *vm)
  * \brief Dump the contents of a Decision VM to stdout for debugging.
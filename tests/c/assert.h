@@ -22,6 +22,16 @@
 #include <stdio.h>
 #include <string.h>
 
+/**
+ * \def CAPTURED_STDOUT_PATH
+ * \brief The file that captured output from STDOUT is written to. CMake sets
+ * this to a file in the build directory, so it never ends up in the source
+ * tree.
+ */
+#ifndef CAPTURED_STDOUT_PATH
+#define CAPTURED_STDOUT_PATH "stdout.txt"
+#endif // CAPTURED_STDOUT_PATH
+
 // Globals used when asserting.
 FILE *fp;
 char *ptr, *str;
@@ -30,10 +40,10 @@ int flag;
 
 /**
  * \def START_CAPTURE_STDOUT
- * \brief Start redirecting output from STDOUT to a file called stdout.txt
+ * \brief Start redirecting output from STDOUT to `CAPTURED_STDOUT_PATH`.
  */
 #define START_CAPTURE_STDOUT() \
-    { freopen("stdout.txt", "w", stdout); }
+    { freopen(CAPTURED_STDOUT_PATH, "w", stdout); }
 
 /**
  * \def STOP_CAPTURE_STDOUT
@@ -44,10 +54,10 @@ int flag;
 
 /**
  * \def OPEN_CAPTURED_STDOUT()
- * \brief Open stdout.txt
+ * \brief Open `CAPTURED_STDOUT_PATH`.
  */
 #define OPEN_CAPTURED_STDOUT() \
-    { fp = fopen("stdout.txt", "r"); }
+    { fp = fopen(CAPTURED_STDOUT_PATH, "r"); }
 
 /**
  * \def ASSERT_CAPTURED_STDOUT(against)
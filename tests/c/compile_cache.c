@@ -0,0 +1,151 @@
+/*
+    Decision
+    Copyright (C) 2019-2020  Benjamin Beddows
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <dcache.h>
+#include <decision.h>
+#include <derror.h>
+#include <dsheet.h>
+
+#include "assert.h"
+
+#include <stdio.h>
+
+// Where the cache is kept for the test.
+#define CACHE_DIR "compile_cache_test"
+
+/**
+ * \fn static void write_file(const char *filePath, const char *contents)
+ * \brief Write a source file.
+ *
+ * \param filePath Where to write the file.
+ * \param contents What to write to the file.
+ */
+static void write_file(const char *filePath, const char *contents) {
+    FILE *file = fopen(filePath, "w");
+    fprintf(file, "%s", contents);
+    fclose(file);
+}
+
+/**
+ * \fn static int run_main(char *expected)
+ * \brief Load and run the main sheet, like a fresh process would.
+ *
+ * \return 0 if the sheet printed what was expected, 1 otherwise.
+ *
+ * \param expected What the sheet should print.
+ */
+static int run_main(char *expected) {
+    // Other processes won't have the included sheets in memory.
+    d_include_cache_invalidate(NULL);
+
+    Sheet *sheet = d_load_source_file("compile_cache_main.dc", NULL);
+    ASSERT_EQUAL(sheet->hasErrors, false)
+
+    START_CAPTURE_STDOUT()
+    d_run_sheet(sheet);
+    STOP_CAPTURE_STDOUT()
+    ASSERT_CAPTURED_STDOUT(expected)
+
+    d_sheet_free(sheet);
+
+    return 0;
+}
+
+int main() {
+    write_file("compile_cache_lib.dc", "[Variable(libValue, Integer, 5)]\n");
+    write_file("compile_cache_main.dc", "[Include(\"compile_cache_lib.dc\")]\n"
+                                        "Start~#1\n"
+                                        "libValue~#2\n"
+                                        "Print(#1, #2)\n");
+
+    // The cache is off until a directory is given.
+    ASSERT_EQUAL(d_compile_cache_get_dir(), NULL)
+
+    d_compile_cache_set_dir(CACHE_DIR);
+    ASSERT_EQUAL(d_compile_cache_clear(NULL), true)
+
+    // The first time, both files are compiled and cached.
+    if (run_main("5\n") != 0) {
+        return 1;
+    }
+
+    CompileCacheStats stats = d_compile_cache_stats();
+    ASSERT_EQUAL(stats.hits, 0)
+    ASSERT_EQUAL(stats.misses, 2)
+    ASSERT_EQUAL(stats.writes, 2)
+
+    // The second time, both come from the cache.
+    if (run_main("5\n") != 0) {
+        return 1;
+    }
+
+    stats = d_compile_cache_stats();
+    ASSERT_EQUAL(stats.hits, 2)
+    ASSERT_EQUAL(stats.misses, 2)
+    ASSERT_EQUAL(stats.writes, 2)
+
+    // Changing the library means both it and the main sheet that includes it
+    // need compiling again.
+    write_file("compile_cache_lib.dc", "[Variable(libValue, Integer, 42)]\n");
+
+    if (run_main("42\n") != 0) {
+        return 1;
+    }
+
+    stats = d_compile_cache_stats();
+    ASSERT_EQUAL(stats.hits, 2)
+    ASSERT_EQUAL(stats.misses, 4)
+    ASSERT_EQUAL(stats.writes, 4)
+
+    if (run_main("42\n") != 0) {
+        return 1;
+    }
+
+    stats = d_compile_cache_stats();
+    ASSERT_EQUAL(stats.hits, 4)
+
+    // Sheets compiled in debug mode are never cached.
+    CompileOptions options = DEFAULT_COMPILE_OPTIONS;
+    options.debug          = true;
+
+    Sheet *sheet = d_load_source_file("compile_cache_main.dc", &options);
+    d_sheet_free(sheet);
+
+    stats = d_compile_cache_stats();
+    ASSERT_EQUAL(stats.hits, 4)
+    ASSERT_EQUAL(stats.misses, 4)
+
+    // After clearing the cache, everything is compiled again.
+    ASSERT_EQUAL(d_compile_cache_clear(NULL), true)
+
+    if (run_main("42\n") != 0) {
+        return 1;
+    }
+
+    stats = d_compile_cache_stats();
+    ASSERT_EQUAL(stats.hits, 4)
+    ASSERT_EQUAL(stats.misses, 6)
+
+    d_compile_cache_clear(NULL);
+    d_compile_cache_set_dir(NULL);
+    d_include_cache_invalidate(NULL);
+
+    ASSERT_EQUAL(d_error_report(), false)
+
+    return 0;
+}
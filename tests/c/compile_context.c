@@ -0,0 +1,262 @@
+/*
+    Decision
+    Copyright (C) 2019-2020  Benjamin Beddows
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <dcontext.h>
+#include <decision.h>
+#include <dmalloc.h>
+#include <dsheet.h>
+#include <dvm.h>
+
+#include "assert.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// How many threads compile at the same time, and how many sheets they compile
+// between them.
+#define NUM_THREADS 4
+#define NUM_JOBS    400
+
+// The job whose sheet has an error in it.
+#define BAD_JOB 13
+
+/**
+ * \struct _worker
+ * \brief The jobs a thread compiles, and how they went.
+ *
+ * \typedef struct _worker Worker
+ */
+typedef struct _worker {
+    size_t firstJob; ///< The first job the thread compiles.
+    size_t numJobs;  ///< How many jobs the thread compiles.
+
+    size_t numCorrect;       ///< How many jobs compiled and ran correctly.
+    IncludeCacheStats stats; ///< The include cache of the thread's context.
+} Worker;
+
+/**
+ * \fn static char *make_job(size_t job)
+ * \brief Make the source code of a sheet with a function that triples its
+ * input with a function from the library, and adds the job number to it.
+ *
+ * The function is defined before the library is included, so including it
+ * can't lose track of the function.
+ *
+ * \return The malloc'd source code.
+ *
+ * \param job The job number.
+ */
+static char *make_job(size_t job) {
+    char *source = d_malloc(512);
+
+    sprintf(source,
+            "[Function(Job)]\n"
+            "[FunctionInput(Job, value, Integer, 0)]\n"
+            "[FunctionOutput(Job, result, Integer)]\n"
+            "[Include(\"context_lib.dc\")]\n"
+            "Define(Job)~#1\n"
+            "%s(#1)~#2\n"
+            "Add(#2, %zu)~#3\n"
+            "Return(Job, #3)\n",
+            (job == BAD_JOB) ? "Quadruple" : "Triple", job);
+
+    return source;
+}
+
+/**
+ * \fn static void *run_worker(void *arg)
+ * \brief Compile and run a range of jobs in a context of their own.
+ *
+ * \return `NULL`.
+ *
+ * \param arg The worker describing the jobs.
+ */
+static void *run_worker(void *arg) {
+    Worker *worker           = arg;
+    DCompileContext *context = d_context_create();
+
+    // Reuse the library between the jobs.
+    DCompileContext *previous = d_context_begin(context);
+    d_include_cache_set_enabled(true);
+    d_context_end(previous);
+
+    CompileOptions options = DEFAULT_COMPILE_OPTIONS;
+    options.context        = context;
+
+    for (size_t i = 0; i < worker->numJobs; i++) {
+        const size_t job = worker->firstJob + i;
+
+        char name[32];
+        sprintf(name, "context_job%zu.dc", job);
+
+        char *source = make_job(job);
+        Sheet *sheet = d_load_string(source, name, &options);
+        free(source);
+
+        if (job == BAD_JOB) {
+            worker->numCorrect += sheet->hasErrors;
+        } else if (!sheet->hasErrors) {
+            DVM vm = d_vm_create();
+            d_vm_push(&vm, 7);
+
+            if (d_run_function(&vm, sheet, "Job") &&
+                d_vm_pop(&vm) == (dint)(21 + job)) {
+                worker->numCorrect++;
+            }
+
+            d_vm_free(&vm);
+        }
+
+        d_sheet_free(sheet);
+    }
+
+    previous      = d_context_begin(context);
+    worker->stats = d_include_cache_stats();
+    d_context_end(previous);
+
+    d_context_free(context);
+
+    return NULL;
+}
+
+/**
+ * \fn static double run_workers(Worker *workers, size_t numThreads)
+ * \brief Split the jobs between some threads, and wait for them to finish.
+ *
+ * \return How many seconds it took.
+ *
+ * \param workers Set to what each thread did.
+ * \param numThreads How many threads to use.
+ */
+static double run_workers(Worker *workers, size_t numThreads) {
+    pthread_t threads[NUM_THREADS];
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (size_t i = 0; i < numThreads; i++) {
+        const size_t firstJob = i * NUM_JOBS / numThreads;
+        const size_t endJob   = (i + 1) * NUM_JOBS / numThreads;
+
+        workers[i].firstJob   = firstJob;
+        workers[i].numJobs    = endJob - firstJob;
+        workers[i].numCorrect = 0;
+
+        pthread_create(threads + i, NULL, run_worker, workers + i);
+    }
+
+    for (size_t i = 0; i < numThreads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return (double)(end.tv_sec - start.tv_sec) +
+           (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+int main() {
+    FILE *lib = fopen("context_lib.dc", "w");
+    fprintf(lib, "[Function(Triple)]\n"
+                 "[FunctionInput(Triple, value, Integer, 0)]\n"
+                 "[FunctionOutput(Triple, result, Integer)]\n"
+                 "Define(Triple)~#1\n"
+                 "Multiply(#1, 3)~#2\n"
+                 "Return(Triple, #2)\n");
+    fclose(lib);
+
+    // Compile every job on one thread, and then on lots of threads at once.
+    Worker workers[NUM_THREADS];
+
+    const double oneThread = run_workers(workers, 1);
+    ASSERT_EQUAL(workers[0].numCorrect, NUM_JOBS)
+
+    const double manyThreads = run_workers(workers, NUM_THREADS);
+
+    printf("Compiled %d sheets in %f seconds on 1 thread, and in %f seconds "
+           "on %d threads.\n",
+           NUM_JOBS, oneThread, manyThreads, NUM_THREADS);
+
+    for (size_t i = 0; i < NUM_THREADS; i++) {
+        Worker worker = workers[i];
+
+        // Each context has its own include cache, so the library is loaded
+        // once by each thread, and reused for the rest of its jobs.
+        ASSERT_EQUAL(worker.numCorrect, worker.numJobs)
+        ASSERT_EQUAL(worker.stats.misses, 1)
+        ASSERT_EQUAL(worker.stats.hits, worker.numJobs - 1)
+        ASSERT_EQUAL(worker.stats.numSheets, 1)
+    }
+
+    // Errors in one context don't leak into another, or into the next
+    // compile in the same context.
+    DCompileContext *context = d_context_create();
+
+    CompileOptions options = DEFAULT_COMPILE_OPTIONS;
+    options.context        = context;
+
+    char *badSource  = make_job(BAD_JOB);
+    char *goodSource = make_job(1);
+
+    START_CAPTURE_STDOUT()
+    Sheet *badSheet = d_load_string(badSource, "bad.dc", &options);
+    STOP_CAPTURE_STDOUT()
+    ASSERT_CAPTURED_STDOUT(
+        "Fatal: (bad.dc:6) Name Quadruple is not defined\n"
+        "Fatal: (bad.dc:6) Undefined node Quadruple\n"
+        "Fatal: (bad.dc:7) Undefined line identifier 2\n")
+
+    Sheet *goodDefault = d_load_string(goodSource, "good.dc", NULL);
+    Sheet *goodContext = d_load_string(goodSource, "good.dc", &options);
+
+    ASSERT_EQUAL(badSheet->hasErrors, true)
+    ASSERT_EQUAL(goodDefault->hasErrors, false)
+    ASSERT_EQUAL(goodContext->hasErrors, false)
+
+    d_sheet_free(badSheet);
+    d_sheet_free(goodDefault);
+    d_sheet_free(goodContext);
+
+    // Each context has its own verbose level.
+    d_set_verbose_level(1);
+
+    START_CAPTURE_STDOUT()
+    Sheet *quietSheet = d_load_string(goodSource, "quiet.dc", &options);
+    STOP_CAPTURE_STDOUT()
+    ASSERT_CAPTURED_STDOUT("")
+
+    char defaultLevel = d_get_verbose_level();
+    ASSERT_EQUAL(defaultLevel, 1)
+    ASSERT_EQUAL(context->verboseLevel, 0)
+
+    d_set_verbose_level(0);
+
+    d_sheet_free(quietSheet);
+    free(badSource);
+    free(goodSource);
+
+    d_context_free(context);
+    d_include_cache_invalidate(NULL);
+
+    remove("context_lib.dc");
+
+    return 0;
+}
@@ -63,6 +63,28 @@ int main() {
     STOP_CAPTURE_STDOUT()
     ASSERT_CAPTURED_STDOUT("Hello, world!\n")
 
+    // d_load_object_file
+    sheet = d_load_object_file("main.dco", NULL);
+    ASSERT_EQUAL(sheet->hasErrors, false)
+
+#if defined(__unix__) || defined(__APPLE__) || defined(_WIN32)
+    // The text section should point into the mapped object file.
+    ASSERT_EQUAL(sheet->_mapping != NULL, true)
+    bool textMapped = sheet->_text >= sheet->_mapping &&
+                      sheet->_text < sheet->_mapping + sheet->_mappingSize;
+    ASSERT_EQUAL(textMapped, true)
+#endif
+
+    // Writing the object file again shouldn't affect the loaded sheet.
+    d_compile_file("main.dc", "main.dco", NULL);
+
+    START_CAPTURE_STDOUT()
+    d_run_sheet(sheet);
+    STOP_CAPTURE_STDOUT()
+    ASSERT_CAPTURED_STDOUT("Hello, world!\n")
+
+    d_sheet_free(sheet);
+
     // d_is_object_file
     short isObj = d_is_object_file("main.dc");
     ASSERT_EQUAL(isObj, 0)
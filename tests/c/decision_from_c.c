@@ -24,6 +24,7 @@
 
 #include "assert.h"
 
+#include <stdbool.h>
 #include <stdio.h>
 
 int test_sheet(Sheet *sheet) {
@@ -57,6 +58,43 @@ int test_sheet(Sheet *sheet) {
     // d_vm_reset
     d_vm_reset(&vm);
 
+    // d_get_function_handle
+    FunctionHandle *handle = d_get_function_handle(sheet, "FactorOf");
+    bool found             = handle != NULL;
+    ASSERT_EQUAL(found, true)
+
+    // d_run_function_handle
+    for (dint divisor = 1; divisor <= 100; divisor++) {
+        d_vm_reset(&vm);
+        d_vm_push(&vm, 360);
+        d_vm_push(&vm, divisor);
+
+        bool success = d_run_function_handle(&vm, handle);
+        ASSERT_EQUAL(success, true)
+
+        answer        = d_vm_pop(&vm);
+        dint expected = (360 % divisor == 0);
+        ASSERT_EQUAL(answer, expected)
+    }
+
+    // d_free_function_handle
+    d_free_function_handle(handle);
+
+    // Handles can't be got for functions that don't exist.
+    char expectedOutput[256];
+    snprintf(expectedOutput, sizeof(expectedOutput),
+             "Fatal: Sheet %s has no function Triple defined",
+             sheet->filePath);
+
+    START_CAPTURE_STDOUT()
+    handle = d_get_function_handle(sheet, "Triple");
+    STOP_CAPTURE_STDOUT()
+    ASSERT_EQUAL(handle, NULL)
+    ASSERT_CAPTURED_STDOUT(expectedOutput)
+
+    // d_vm_reset
+    d_vm_reset(&vm);
+
     // d_vm_push_float
     d_vm_push_float(&vm, 4.75);
 
@@ -69,6 +107,31 @@ int test_sheet(Sheet *sheet) {
 
     d_vm_free(&vm);
 
+    // d_vm_create_with_capacity
+    vm = d_vm_create_with_capacity(1024);
+    ASSERT_EQUAL(vm.stackSize, 1024)
+
+    d_vm_push(&vm, 1377);
+    d_vm_push(&vm, 51);
+    d_run_function(&vm, sheet, "FactorOf");
+    answer = d_vm_pop(&vm);
+    ASSERT_EQUAL(answer, 1)
+
+    // The stack should have been big enough to never need to grow.
+    ASSERT_EQUAL(vm.numStackReallocs, 0)
+
+    // If the stack grows, it should keep its size when reset.
+    vm.shrinkOnReset = false;
+    for (int i = 0; i < 1500; i++) {
+        d_vm_push(&vm, i);
+    }
+    d_vm_popn(&vm, 1500);
+    d_vm_reset(&vm);
+    ASSERT_EQUAL(vm.numStackReallocs, 1)
+    ASSERT_EQUAL(vm.stackSize > 1024, 1)
+
+    d_vm_free(&vm);
+
     return 0;
 }
 
@@ -128,5 +191,76 @@ int main() {
     // d_sheet_free
     d_sheet_free(sheet);
 
+    // d_load_string, compiling to native code if the platform supports it.
+    CompileOptions options = DEFAULT_COMPILE_OPTIONS;
+    options.jit            = true;
+
+    sheet = d_load_string(src, NULL, &options);
+    ASSERT_EQUAL(sheet->_jitCode != NULL, d_jit_available())
+
+    result = test_sheet(sheet);
+    ASSERT_EQUAL(result, 0)
+
+    // d_sheet_free
+    d_sheet_free(sheet);
+
+    // d_load_string, profiling the functions instead.
+    options        = DEFAULT_COMPILE_OPTIONS;
+    options.tiered = true;
+
+    sheet = d_load_string(src, NULL, &options);
+    ASSERT_EQUAL(sheet->_jitCode, NULL)
+    ASSERT_EQUAL(sheet->_numProfiles, 3)
+
+    result = test_sheet(sheet);
+    ASSERT_EQUAL(result, 0)
+
+    // Promote the functions as if they had got hot, and make sure they still
+    // do the same thing.
+    for (size_t i = 0; i < sheet->_numProfiles; i++) {
+        VMProfile *profile = &(sheet->_profiles[i].profile);
+        ASSERT_EQUAL(profile->promote != NULL, d_jit_available())
+
+        if (profile->promote != NULL) {
+            profile->promote(profile);
+        }
+    }
+
+    result = test_sheet(sheet);
+    ASSERT_EQUAL(result, 0)
+
+    // d_sheet_free
+    d_sheet_free(sheet);
+
+    // d_get_function_handle, for a function that is only defined in an
+    // included sheet.
+    file = fopen("square.dc", "w");
+    fprintf(file, "[Function(Square)]\n"
+                  "[FunctionInput(Square, n, Integer, 0)]\n"
+                  "[FunctionOutput(Square, squared, Integer)]\n"
+                  "Define(Square)~#1\n"
+                  "Multiply(#1, #1)~#2\n"
+                  "Return(Square, #2)\n");
+    fclose(file);
+
+    sheet = d_load_string("[Include(\"square.dc\")]\n"
+                          "Start~#1\n"
+                          "Print(#1, 'Hello')\n",
+                          NULL, NULL);
+
+    FunctionHandle *handle = d_get_function_handle(sheet, "Square");
+    bool found             = handle != NULL;
+    ASSERT_EQUAL(found, true)
+
+    DVM vm = d_vm_create();
+    d_vm_push(&vm, 12);
+    d_run_function_handle(&vm, handle);
+    dint squared = d_vm_pop(&vm);
+    ASSERT_EQUAL(squared, 144)
+
+    d_vm_free(&vm);
+    d_free_function_handle(handle);
+    d_sheet_free(sheet);
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,204 @@
+/*
+    Decision
+    Copyright (C) 2019-2020  Benjamin Beddows
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <decision.h>
+#include <derror.h>
+#include <dsheet.h>
+#include <dvm.h>
+
+#include "assert.h"
+
+#include <stdio.h>
+
+/**
+ * \fn static void write_file(const char *filePath, const char *contents)
+ * \brief Write a source file.
+ *
+ * \param filePath Where to write the file.
+ * \param contents What to write to the file.
+ */
+static void write_file(const char *filePath, const char *contents) {
+    FILE *file = fopen(filePath, "w");
+    fprintf(file, "%s", contents);
+    fclose(file);
+}
+
+/**
+ * \fn static dint lib_value(Sheet *sheet)
+ * \brief Get the default value of the variable in the library, from the main
+ * sheet.
+ *
+ * \return The default value of the library variable.
+ *
+ * \param sheet The main sheet.
+ */
+static dint lib_value(Sheet *sheet) {
+    Sheet *lib = sheet->includes[0]->includes[0];
+    return lib->variables[0].variableMeta.defaultValue.integerValue;
+}
+
+/**
+ * \fn static dint bump(Sheet *sheet)
+ * \brief Run the subroutine that increments the library's counter.
+ *
+ * \return The value of the counter after it was incremented, or -1 if the
+ * subroutine couldn't be run.
+ *
+ * \param sheet The sheet that includes the library.
+ */
+static dint bump(Sheet *sheet) {
+    DVM vm      = d_vm_create();
+    dint result = -1;
+
+    if (d_run_function(&vm, sheet, "Bump")) {
+        result = d_vm_pop(&vm);
+    }
+
+    d_vm_free(&vm);
+    return result;
+}
+
+int main() {
+    // A library with a variable, and a sheet that increments it.
+    write_file("state_lib.dc", "[Variable(counter, Integer, 0)]\n");
+    write_file("state_main.dc", "[Include(\"state_lib.dc\")]\n"
+                                "[Subroutine(Bump)]\n"
+                                "[FunctionOutput(Bump, value, Integer)]\n"
+                                "Define(Bump)~#1\n"
+                                "counter~#2\n"
+                                "Add(#2, 1)~#3\n"
+                                "Set(counter, #1, #3)~#4\n"
+                                "counter~#5\n"
+                                "Return(Bump, #4, #5)\n");
+
+    // The cache is disabled by default, so loading the same program twice
+    // gives each one its own variables.
+    Sheet *first  = d_load_source_file("state_main.dc", NULL);
+    Sheet *second = d_load_source_file("state_main.dc", NULL);
+    ASSERT_EQUAL(first->hasErrors, false)
+    ASSERT_EQUAL(second->hasErrors, false)
+    ASSERT_EQUAL(first->includes[0] == second->includes[0], false)
+
+    ASSERT_EQUAL(bump(first), 1)
+    ASSERT_EQUAL(bump(first), 2)
+    ASSERT_EQUAL(bump(second), 1)
+
+    d_sheet_free(first);
+    d_sheet_free(second);
+
+    first = d_load_source_file("state_main.dc", NULL);
+    ASSERT_EQUAL(bump(first), 1)
+    d_sheet_free(first);
+
+    IncludeCacheStats stats = d_include_cache_stats();
+    ASSERT_EQUAL(stats.hits, 0)
+    ASSERT_EQUAL(stats.misses, 0)
+    ASSERT_EQUAL(stats.numSheets, 0)
+
+    d_include_cache_set_enabled(true);
+
+    // A diamond of includes: main includes a and b, which both include lib.
+    write_file("cache_lib.dc", "[Variable(libValue, Integer, 5)]\n");
+    write_file("cache_a.dc", "[Include(\"cache_lib.dc\")]\n"
+                             "[Variable(aValue, Integer, 1)]\n");
+    write_file("cache_b.dc", "[Include(\"cache_lib.dc\")]\n"
+                             "[Variable(bValue, Integer, 2)]\n");
+    write_file("cache_main.dc", "[Include(\"cache_a.dc\")]\n"
+                                "[Include(\"cache_b.dc\")]\n"
+                                "Start~#1\n"
+                                "Print(#1, 'Hello, world!')\n");
+
+    // The library should only be loaded once.
+    Sheet *sheet = d_load_source_file("cache_main.dc", NULL);
+    ASSERT_EQUAL(sheet->hasErrors, false)
+
+    stats = d_include_cache_stats();
+    ASSERT_EQUAL(stats.hits, 1)
+    ASSERT_EQUAL(stats.misses, 3)
+    ASSERT_EQUAL(stats.numSheets, 3)
+
+    ASSERT_EQUAL(sheet->includes[0]->includes[0],
+                 sheet->includes[1]->includes[0])
+    ASSERT_EQUAL(lib_value(sheet), 5)
+
+    // Loading the sheet again reuses everything it includes.
+    Sheet *again = d_load_source_file("cache_main.dc", NULL);
+
+    stats = d_include_cache_stats();
+    ASSERT_EQUAL(stats.hits, 3)
+    ASSERT_EQUAL(stats.misses, 3)
+    ASSERT_EQUAL(sheet->includes[0], again->includes[0])
+    ASSERT_EQUAL(sheet->includes[1], again->includes[1])
+
+    START_CAPTURE_STDOUT()
+    d_run_sheet(again);
+    STOP_CAPTURE_STDOUT()
+    ASSERT_CAPTURED_STDOUT("Hello, world!\n")
+
+    // The cache keeps the includes alive after the sheets are freed.
+    d_sheet_free(sheet);
+    d_sheet_free(again);
+
+    stats = d_include_cache_stats();
+    ASSERT_EQUAL(stats.numSheets, 3)
+
+    // If the library changes, so do the sheets that include it.
+    write_file("cache_lib.dc", "[Variable(libValue, Integer, 75)]\n");
+
+    sheet = d_load_source_file("cache_main.dc", NULL);
+    ASSERT_EQUAL(sheet->hasErrors, false)
+    ASSERT_EQUAL(lib_value(sheet), 75)
+
+    stats = d_include_cache_stats();
+    ASSERT_EQUAL(stats.hits, 4)
+    ASSERT_EQUAL(stats.misses, 6)
+    ASSERT_EQUAL(stats.numSheets, 3)
+
+    // Sheets can be removed from the cache by hand.
+    d_include_cache_invalidate("cache_lib.dc");
+    stats = d_include_cache_stats();
+    ASSERT_EQUAL(stats.numSheets, 2)
+
+    d_include_cache_invalidate(NULL);
+    stats = d_include_cache_stats();
+    ASSERT_EQUAL(stats.numSheets, 0)
+
+    // The sheet still has its own references to its includes.
+    ASSERT_EQUAL(lib_value(sheet), 75)
+    d_sheet_free(sheet);
+
+    // With the cache disabled, nothing is reused or counted.
+    d_include_cache_set_enabled(false);
+
+    sheet = d_load_source_file("cache_main.dc", NULL);
+    ASSERT_EQUAL(sheet->includes[0]->includes[0] ==
+                     sheet->includes[1]->includes[0],
+                 false)
+
+    stats = d_include_cache_stats();
+    ASSERT_EQUAL(stats.hits, 4)
+    ASSERT_EQUAL(stats.misses, 6)
+    ASSERT_EQUAL(stats.numSheets, 0)
+
+    d_sheet_free(sheet);
+    d_include_cache_set_enabled(true);
+
+    ASSERT_EQUAL(d_error_report(), false)
+
+    return 0;
+}
@@ -0,0 +1,248 @@
+/*
+    Decision
+    Copyright (C) 2019-2020  Benjamin Beddows
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <dcontext.h>
+#include <decision.h>
+#include <dintern.h>
+#include <dlex.h>
+#include <dlink.h>
+#include <dmalloc.h>
+#include <dsheet.h>
+
+#include "assert.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// How many libraries the main sheet includes, and how many variables and
+// functions each library has.
+#define NUM_LIBRARIES 20
+#define NUM_VARIABLES 50
+#define NUM_FUNCTIONS 20
+
+/**
+ * \fn static void write_library(size_t index)
+ * \brief Write a library with a lot of variables, and functions that use
+ * them. Every library also includes the same base library.
+ *
+ * \param index The index of the library.
+ */
+static void write_library(size_t index) {
+    char filePath[32];
+    sprintf(filePath, "intern_lib%zu.dc", index);
+
+    FILE *file = fopen(filePath, "w");
+    fprintf(file, "[Include(\"intern_base.dc\")]\n");
+
+    for (size_t i = 0; i < NUM_VARIABLES; i++) {
+        fprintf(file, "[Variable(lib%zu_v%zu, Integer, %zu)]\n", index, i,
+                index * 100 + i);
+    }
+
+    // Each function multiplies its input by one of the variables, and by the
+    // variable in the base library.
+    for (size_t i = 0; i < NUM_FUNCTIONS; i++) {
+        const size_t line = 10 * i;
+
+        fprintf(file, "[Function(lib%zu_f%zu)]\n", index, i);
+        fprintf(file, "[FunctionInput(lib%zu_f%zu, value, Integer, 0)]\n",
+                index, i);
+        fprintf(file, "[FunctionOutput(lib%zu_f%zu, result, Integer)]\n",
+                index, i);
+
+        fprintf(file, "Define(lib%zu_f%zu)~#%zu\n", index, i, line + 1);
+        fprintf(file, "lib%zu_v%zu~#%zu\n", index, i, line + 2);
+        fprintf(file, "scale~#%zu\n", line + 3);
+        fprintf(file, "Multiply(#%zu, #%zu)~#%zu\n", line + 1, line + 2,
+                line + 4);
+        fprintf(file, "Multiply(#%zu, #%zu)~#%zu\n", line + 4, line + 3,
+                line + 5);
+        fprintf(file, "Return(lib%zu_f%zu, #%zu)\n", index, i, line + 5);
+    }
+
+    fclose(file);
+}
+
+/**
+ * \fn static char *make_main()
+ * \brief Make the source code of a sheet that includes all of the libraries,
+ * and prints the result of a function from each of them.
+ *
+ * \return The malloc'd source code.
+ */
+static char *make_main() {
+    char *source = d_malloc(NUM_LIBRARIES * 128 + 64);
+    char *end    = source;
+
+    for (size_t i = 0; i < NUM_LIBRARIES; i++) {
+        end += sprintf(end, "[Include(\"intern_lib%zu.dc\")]\n", i);
+    }
+
+    end += sprintf(end, "Start~#1\n");
+
+    for (size_t i = 0; i < NUM_LIBRARIES; i++) {
+        const size_t line = 10 * (i + 1);
+
+        end += sprintf(end, "lib%zu_f%zu(1)~#%zu\n", i, i % NUM_FUNCTIONS,
+                       line);
+        end += sprintf(end, "Print(#%zu, #%zu)~#%zu\n",
+                       (i == 0) ? 1 : line - 9, line, line + 1);
+    }
+
+    return source;
+}
+
+int main() {
+    // Interning the same string gives the same pointer.
+    const char *hello = d_intern("hello");
+    ASSERT_EQUAL(hello == d_intern("hello"), true)
+    ASSERT_EQUAL(hello == d_intern_n("hello, world!", 5), true)
+    ASSERT_EQUAL(hello == d_intern("hell"), false)
+    ASSERT_EQUAL(d_intern_find("hello") == hello, true)
+    ASSERT_EQUAL(d_intern_find("not interned yet") == NULL, true)
+    ASSERT_EQUAL(d_intern(NULL) == NULL, true)
+
+    // So does lexing the same name in different sources.
+    LexStream first  = d_lex_create_stream("shared~#1\n", "first");
+    LexStream second = d_lex_create_stream("Print(#1, shared)\n", "second");
+
+    const char *firstName  = first.tokenArray[0].data.stringValue;
+    const char *secondName = NULL;
+
+    for (size_t i = 0; i < second.numTokens; i++) {
+        LexToken token = second.tokenArray[i];
+
+        if (token.type == TK_NAME &&
+            strcmp(token.data.stringValue, "shared") == 0) {
+            secondName = token.data.stringValue;
+        }
+    }
+
+    ASSERT_EQUAL(strcmp(firstName, "shared"), 0)
+    ASSERT_EQUAL(firstName == secondName, true)
+
+    d_lex_free_stream(first);
+    d_lex_free_stream(second);
+
+    // Now compile a big project with lots of sheets, where the same names
+    // appear over and over again.
+    FILE *base = fopen("intern_base.dc", "w");
+    fprintf(base, "[Variable(scale, Integer, 2)]\n");
+    fclose(base);
+
+    for (size_t i = 0; i < NUM_LIBRARIES; i++) {
+        write_library(i);
+    }
+
+    const char *source = make_main();
+
+    InternStats before = d_intern_stats();
+    Sheet *sheet       = d_load_string(source, "intern_main.dc", NULL);
+    InternStats after  = d_intern_stats();
+
+    ASSERT_EQUAL(sheet->hasErrors, false)
+
+    const size_t numRequests    = after.numRequests - before.numRequests;
+    const size_t requestedBytes = after.requestedBytes - before.requestedBytes;
+    const size_t numStrings     = after.numStrings - before.numStrings;
+    const size_t numBytes       = after.numBytes - before.numBytes;
+
+    printf("Interned %zu names (%zu bytes) as %zu strings (%zu bytes), "
+           "saving %zu allocations and %zu bytes (%.1f%%).\n",
+           numRequests, requestedBytes, numStrings, numBytes,
+           numRequests - numStrings, requestedBytes - numBytes,
+           100.0 * (double)(requestedBytes - numBytes) /
+               (double)requestedBytes);
+
+    // Every variable and function is named at least twice: once where it is
+    // defined, and once where it is used.
+    ASSERT_EQUAL(numRequests > 2 * numStrings, true)
+    ASSERT_EQUAL(requestedBytes > 2 * numBytes, true)
+
+    // A variable, its getter, and the link to it from another sheet all share
+    // the same name.
+    Sheet *library      = sheet->includes[3];
+    SheetVariable *var  = library->variables + 3;
+    SheetFunction *func = library->functions + 3;
+
+    const char *varName  = var->variableMeta.name;
+    const char *funcName = func->functionDefinition.name;
+    const char *getter   = var->getterDefinition.name;
+
+    LinkMeta *funcLink = d_link_find_meta(&(sheet->_link), LINK_FUNCTION,
+                                          d_intern("lib3_f3"));
+    LinkMeta *varLink =
+        d_link_find_meta(&(library->_link), LINK_VARIABLE, varName);
+
+    ASSERT_EQUAL(varName == d_intern("lib3_v3"), true)
+    ASSERT_EQUAL(getter == varName, true)
+    ASSERT_EQUAL(funcLink != NULL, true)
+    ASSERT_EQUAL(funcLink->name == funcName, true)
+    ASSERT_EQUAL(varLink != NULL, true)
+    ASSERT_EQUAL(varLink->name == varName, true)
+
+    // Every library's function is given 1, and multiplies it by its variable
+    // and by 2.
+    char expected[NUM_LIBRARIES * 16];
+    char *end = expected;
+
+    for (size_t i = 0; i < NUM_LIBRARIES; i++) {
+        end += sprintf(end, "%zu\n", 2 * (i * 100 + i % NUM_FUNCTIONS));
+    }
+
+    START_CAPTURE_STDOUT()
+    d_run_sheet(sheet);
+    STOP_CAPTURE_STDOUT()
+    ASSERT_CAPTURED_STDOUT(expected)
+
+    d_sheet_free(sheet);
+
+    // Once nothing uses the names any more, they are freed.
+    InternStats empty = d_intern_stats();
+    ASSERT_EQUAL(empty.numStrings, 0)
+    ASSERT_EQUAL(empty.numBytes, 0)
+    ASSERT_EQUAL(d_intern_find("lib3_v3") == NULL, true)
+
+    // A compile context keeps the names for as long as it exists, so sheets
+    // compiled with it can share them.
+    DCompileContext *context = d_context_create();
+
+    CompileOptions options = DEFAULT_COMPILE_OPTIONS;
+    options.context        = context;
+
+    sheet = d_load_string(source, "intern_main.dc", &options);
+    ASSERT_EQUAL(sheet->hasErrors, false)
+    d_sheet_free(sheet);
+
+    ASSERT_EQUAL(d_intern_find("lib3_v3") != NULL, true)
+
+    d_context_free(context);
+    ASSERT_EQUAL(d_intern_find("lib3_v3") == NULL, true)
+
+    free((char *)source);
+
+    remove("intern_base.dc");
+    for (size_t i = 0; i < NUM_LIBRARIES; i++) {
+        char filePath[32];
+        sprintf(filePath, "intern_lib%zu.dc", i);
+        remove(filePath);
+    }
+
+    return 0;
+}
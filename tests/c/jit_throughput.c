@@ -0,0 +1,301 @@
+/*
+    Decision
+    Copyright (C) 2019-2020  Benjamin Beddows
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <decision.h>
+#include <derror.h>
+#include <djit.h>
+#include <dsheet.h>
+#include <dvm.h>
+
+#include "assert.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// A loop that reads and writes variables, which are dereferenced and set
+// through their addresses. It counts up in twos.
+static const char *LOOP_SOURCE = "[Variable(i, Integer, 0)]\n"
+                                 "[Variable(total, Integer, 0)]\n"
+                                 "[Subroutine(CountTo)]\n"
+                                 "[FunctionInput(CountTo, n, Integer, 0)]\n"
+                                 "[FunctionOutput(CountTo, count, Integer)]\n"
+                                 "Define(CountTo)~#1, #2\n"
+                                 "Set(i, #1, 0)~#3\n"
+                                 "Set(total, #3, 0)~#4\n"
+                                 "i~#5\n"
+                                 "LessThan(#5, #2)~#6\n"
+                                 "While(#4, #6)~#7, #8\n"
+                                 "total~#9\n"
+                                 "Add(#9, 2)~#10\n"
+                                 "Set(total, #7, #10)~#11\n"
+                                 "Add(#5, 1)~#12\n"
+                                 "Set(i, #11, #12)\n"
+                                 "total~#13\n"
+                                 "Return(CountTo, #8, #13)\n";
+
+// A function that calls itself a lot.
+static const char *FIB_SOURCE = "[Function(Fib)]\n"
+                                "[FunctionInput(Fib, n, Integer, 0)]\n"
+                                "[FunctionOutput(Fib, fib, Integer)]\n"
+                                "Define(Fib)~#1\n"
+                                "LessThan(#1, 2)~#2\n"
+                                "Subtract(#1, 1)~#3\n"
+                                "Subtract(#1, 2)~#4\n"
+                                "Fib(#3)~#5\n"
+                                "Fib(#4)~#6\n"
+                                "Add(#5, #6)~#7\n"
+                                "Ternary(#2, #1, #7)~#8\n"
+                                "Return(Fib, #8)\n";
+
+// A loop that divides a float, which the JIT can't compile, on every
+// iteration.
+static const char *FLOAT_LOOP_SOURCE =
+    "[Variable(i, Integer, 0)]\n"
+    "[Variable(x, Float, 0.0)]\n"
+    "[Subroutine(Halve)]\n"
+    "[FunctionInput(Halve, n, Integer, 0)]\n"
+    "[FunctionOutput(Halve, count, Integer)]\n"
+    "Define(Halve)~#1, #2\n"
+    "Set(i, #1, 0)~#3\n"
+    "Set(x, #3, 1000.0)~#4\n"
+    "i~#5\n"
+    "LessThan(#5, #2)~#6\n"
+    "While(#4, #6)~#7, #8\n"
+    "x~#9\n"
+    "Divide(#9, 2.0)~#10\n"
+    "Set(x, #7, #10)~#11\n"
+    "Add(#5, 1)~#12\n"
+    "Set(i, #11, #12)\n"
+    "i~#13\n"
+    "Return(Halve, #8, #13)\n";
+
+// How many times each workload is timed. The fastest time is the one used.
+#define NUM_RUNS 3
+
+/**
+ * \struct _tierRun
+ * \brief What happened when a function was run a few times in one tier.
+ *
+ * \typedef struct _tierRun TierRun
+ */
+typedef struct _tierRun {
+    dint results[NUM_RUNS]; ///< What the function returned each time.
+    double seconds;         ///< The fastest run in seconds, which is only
+                            ///< printed, since it depends on the machine.
+    size_t numIns;          ///< How many decoded instructions the sheet has.
+    size_t numCompiled;     ///< How many of them were compiled to native
+                            ///< code.
+    bool promoted;          ///< Was the function promoted to native code with
+                            ///< tiered execution?
+} TierRun;
+
+/**
+ * \fn static TierRun run_tier(const char *source, const char *name,
+ *                             CompileOptions *options, dint arg)
+ * \brief Load a sheet, and run one of its functions with one argument
+ * `NUM_RUNS` times, timing each run.
+ *
+ * \return What happened when the function was run.
+ *
+ * \param source The source code of the sheet.
+ * \param name The name of the function to run.
+ * \param options The options to load the sheet with.
+ * \param arg The argument to run the function with.
+ */
+static TierRun run_tier(const char *source, const char *name,
+                        CompileOptions *options, dint arg) {
+    Sheet *sheet           = d_load_string(source, NULL, options);
+    FunctionHandle *handle = d_get_function_handle(sheet, name);
+    DVM vm                 = d_vm_create();
+
+    TierRun run;
+    memset(&run, 0, sizeof(run));
+    run.seconds = -1.0;
+
+    for (int i = 0; i < NUM_RUNS && handle != NULL; i++) {
+        d_vm_reset(&vm);
+        d_vm_push(&vm, arg);
+
+        clock_t start = clock();
+        d_run_function_handle(&vm, handle);
+        clock_t end = clock();
+
+        run.results[i] = d_vm_pop(&vm);
+
+        double seconds = (double)(end - start) / CLOCKS_PER_SEC;
+        if (run.seconds < 0 || seconds < run.seconds) {
+            run.seconds = seconds;
+        }
+    }
+
+    if (sheet->_decodedText != NULL) {
+        run.numIns = sheet->_decodedText->numIns;
+    }
+
+    if (sheet->_jitCode != NULL) {
+        run.numCompiled = sheet->_jitCode->numCompiled;
+    }
+
+    for (size_t i = 0; i < sheet->_numProfiles; i++) {
+        FunctionProfile profile = sheet->_profiles[i];
+
+        if (strcmp(profile.name, name) == 0) {
+            run.promoted = profile.jitCode != NULL;
+        }
+    }
+
+    d_vm_free(&vm);
+    d_free_function_handle(handle);
+    d_sheet_free(sheet);
+
+    return run;
+}
+
+/**
+ * \fn static int compare_tiers(const char *source, const char *name,
+ *                              dint arg, dint expected)
+ * \brief Run a function in the VM, in native code, and with tiered execution,
+ * make sure they all give the same results, that every instruction was
+ * compiled, and that the function was promoted once it got hot. The times are
+ * printed, but not checked.
+ *
+ * \return 0 if both tiers behaved the same, 1 otherwise.
+ *
+ * \param source The source code of the sheet.
+ * \param name The name of the function to run.
+ * \param arg The argument to run the function with.
+ * \param expected What the function should return.
+ */
+static int compare_tiers(const char *source, const char *name, dint arg,
+                         dint expected) {
+    CompileOptions options = DEFAULT_COMPILE_OPTIONS;
+    TierRun vmRun          = run_tier(source, name, &options, arg);
+
+    options.jit    = true;
+    TierRun jitRun = run_tier(source, name, &options, arg);
+
+    options        = DEFAULT_COMPILE_OPTIONS;
+    options.tiered = true;
+
+    TierRun tieredRun = run_tier(source, name, &options, arg);
+
+    printf("%s(%" DINT_PRINTF_d "): %f seconds in the VM, %f seconds in "
+           "native code, %f seconds tiered.\n",
+           name, arg, vmRun.seconds, jitRun.seconds, tieredRun.seconds);
+
+    for (int i = 0; i < NUM_RUNS; i++) {
+        ASSERT_EQUAL(vmRun.results[i], expected)
+        ASSERT_EQUAL(jitRun.results[i], vmRun.results[i])
+        ASSERT_EQUAL(tieredRun.results[i], vmRun.results[i])
+    }
+
+    // The VM doesn't compile anything, and the JIT compiles every
+    // instruction of these workloads. Tiered execution only compiles the
+    // function once it gets hot, which these workloads do.
+    ASSERT_EQUAL(vmRun.numCompiled, 0)
+    ASSERT_EQUAL(vmRun.promoted, false)
+    ASSERT_EQUAL(jitRun.numIns, vmRun.numIns)
+    ASSERT_EQUAL(tieredRun.numCompiled, 0)
+    ASSERT_EQUAL(tieredRun.promoted, d_jit_available())
+
+    if (d_jit_available()) {
+        ASSERT_EQUAL(jitRun.numCompiled, jitRun.numIns)
+    } else {
+        ASSERT_EQUAL(jitRun.numCompiled, 0)
+    }
+
+    return 0;
+}
+
+/**
+ * \fn static int check_promotion(const char *source, const char *name,
+ *                                dint arg, dint expected, bool covered)
+ * \brief Run a function until it gets hot with tiered execution, and make sure
+ * it is only promoted to native code if the JIT covers its hot instructions.
+ *
+ * \return 0 if the function was promoted when it should have been, 1
+ * otherwise.
+ *
+ * \param source The source code of the sheet.
+ * \param name The name of the function to run.
+ * \param arg The argument to run the function with, which should make it hot.
+ * \param expected What the function should return.
+ * \param covered Can the JIT compile the instructions that make it hot?
+ */
+static int check_promotion(const char *source, const char *name, dint arg,
+                           dint expected, bool covered) {
+    CompileOptions options = DEFAULT_COMPILE_OPTIONS;
+    options.tiered         = true;
+
+    Sheet *sheet           = d_load_string(source, NULL, &options);
+    FunctionHandle *handle = d_get_function_handle(sheet, name);
+    bool found             = handle != NULL;
+    ASSERT_EQUAL(found, true)
+
+    DVM vm = d_vm_create();
+    d_vm_push(&vm, arg);
+    d_run_function_handle(&vm, handle);
+    ASSERT_EQUAL(d_vm_pop(&vm), expected)
+
+    FunctionProfile *profile = NULL;
+
+    for (size_t i = 0; i < sheet->_numProfiles; i++) {
+        if (strcmp(sheet->_profiles[i].name, name) == 0) {
+            profile = sheet->_profiles + i;
+        }
+    }
+
+    found = profile != NULL;
+    ASSERT_EQUAL(found, true)
+
+    bool isHot = profile->profile.calls + profile->profile.backEdges >=
+                 profile->profile.threshold;
+    ASSERT_EQUAL(isHot, true)
+
+    bool promoted = profile->jitCode != NULL;
+    ASSERT_EQUAL(promoted, covered && d_jit_available())
+
+    d_vm_free(&vm);
+    d_free_function_handle(handle);
+    d_sheet_free(sheet);
+
+    return 0;
+}
+
+int main() {
+    int result = compare_tiers(LOOP_SOURCE, "CountTo", 3000000, 6000000);
+    ASSERT_EQUAL(result, 0)
+
+    result = compare_tiers(FIB_SOURCE, "Fib", 27, 196418);
+    ASSERT_EQUAL(result, 0)
+
+    result = check_promotion(LOOP_SOURCE, "CountTo", 5000, 10000, true);
+    ASSERT_EQUAL(result, 0)
+
+    result = check_promotion(FIB_SOURCE, "Fib", 20, 6765, true);
+    ASSERT_EQUAL(result, 0)
+
+    result = check_promotion(FLOAT_LOOP_SOURCE, "Halve", 5000, 5000, false);
+    ASSERT_EQUAL(result, 0)
+
+    ASSERT_EQUAL(d_error_report(), false)
+
+    return 0;
+}
@@ -0,0 +1,112 @@
+/*
+    Decision
+    Copyright (C) 2019-2020  Benjamin Beddows
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <derror.h>
+#include <dlex.h>
+#include <dmalloc.h>
+
+#include "assert.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#define HAS_RUSAGE
+#endif
+
+// A line with a bit of everything the lexer has to deal with.
+static const char *LINE =
+    "Add(#12, 3.75, \"a string\", true)~#34 > A comment\n";
+
+// How many times the line is repeated.
+#define NUM_LINES 100000
+
+/**
+ * \fn static size_t lex_and_free(const char *source)
+ * \brief Lex some source code, and free the stream and the strings in it.
+ *
+ * \return The number of tokens in the stream.
+ *
+ * \param source The source code to lex.
+ */
+static size_t lex_and_free(const char *source) {
+    LexStream stream = d_lex_create_stream(source, "source");
+
+    for (size_t i = 0; i < stream.numTokens; i++) {
+        LexToken token = stream.tokenArray[i];
+
+        // Names are interned, so only string literals are malloc'd.
+        if (token.type == TK_STRINGLITERAL) {
+            free(token.data.stringValue);
+        }
+    }
+
+    d_lex_free_stream(stream);
+
+    return stream.numTokens;
+}
+
+int main() {
+    const size_t lineLen = strlen(LINE);
+
+    // Find out how many tokens are in one line.
+    const size_t tokensPerLine = lex_and_free(LINE);
+    ASSERT_EQUAL(tokensPerLine, 15)
+
+    // Now lex a few megabytes of it.
+    char *source = d_malloc(NUM_LINES * lineLen + 1);
+
+    for (size_t i = 0; i < NUM_LINES; i++) {
+        memcpy(source + i * lineLen, LINE, lineLen);
+    }
+
+    source[NUM_LINES * lineLen] = '\0';
+
+    clock_t start    = clock();
+    size_t numTokens = lex_and_free(source);
+    clock_t end      = clock();
+
+    ASSERT_EQUAL(numTokens, NUM_LINES * tokensPerLine)
+
+    double seconds = (double)(end - start) / CLOCKS_PER_SEC;
+    double mb      = (double)(NUM_LINES * lineLen) / (1024.0 * 1024.0);
+
+    printf("Lexed %.2f MB into %zu tokens in %f seconds (%.2f MB/s).\n", mb,
+           numTokens, seconds, (seconds > 0) ? mb / seconds : 0.0);
+
+#ifdef HAS_RUSAGE
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        double peakMb = (double)usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+        double peakMb = (double)usage.ru_maxrss / 1024.0;
+#endif
+        printf("Peak resident set size: %.2f MB.\n", peakMb);
+    }
+#endif
+
+    free(source);
+
+    ASSERT_EQUAL(d_error_report(), false)
+
+    return 0;
+}
@@ -0,0 +1,155 @@
+/*
+    Decision
+    Copyright (C) 2019-2020  Benjamin Beddows
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <derror.h>
+#include <dlex.h>
+#include <dmalloc.h>
+#include <dsemantic.h>
+#include <dsheet.h>
+#include <dsyntax.h>
+
+#include "assert.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * \fn static char *make_chain(size_t numLines, bool undefined)
+ * \brief Make the source code of a sheet that is a chain of Add nodes, where
+ * each node's output goes into the next node, and into a Multiply node.
+ *
+ * \return The malloc'd source code.
+ *
+ * \param numLines How many Add nodes there are in the chain.
+ * \param undefined If true, the last Multiply node uses a line that is never
+ * defined.
+ */
+static char *make_chain(size_t numLines, bool undefined) {
+    // Each pair of lines is at most about 80 characters long.
+    char *source = d_malloc(80 * (numLines + 1));
+    char *end    = source;
+
+    end += sprintf(end, "Add(0, 1)~#1\n");
+
+    for (size_t i = 1; i < numLines; i++) {
+        end += sprintf(end, "Add(#%zu, 1)~#%zu\n", i, i + 1);
+        end += sprintf(end, "Multiply(#%zu, 2)\n", i);
+    }
+
+    if (undefined) {
+        end += sprintf(end, "Multiply(#%zu, 2)\n", 2 * numLines);
+    }
+
+    return source;
+}
+
+/**
+ * \fn static Sheet *scan_source(const char *source, double *seconds)
+ * \brief Parse some source code, and time how long it takes to scan the
+ * nodes of the syntax tree into a sheet.
+ *
+ * \return The sheet the nodes were scanned into.
+ *
+ * \param source The source code to scan.
+ * \param seconds Set to how long `d_semantic_scan_nodes` took.
+ */
+static Sheet *scan_source(const char *source, double *seconds) {
+    Sheet *sheet = d_sheet_create("chain.dc");
+
+    LexStream stream    = d_lex_create_stream(source, "chain.dc");
+    DArena *arena       = d_arena_create(0);
+    SyntaxResult result = d_syntax_parse(stream, "chain.dc", arena);
+
+    clock_t start = clock();
+    d_semantic_scan_nodes(sheet, result.node);
+    clock_t end = clock();
+
+    *seconds = (double)(end - start) / CLOCKS_PER_SEC;
+
+    d_arena_free(arena);
+    d_lex_free_stream(stream);
+
+    return sheet;
+}
+
+int main() {
+    // Check every line is connected, and how long each size takes. If the
+    // lines were matched up one by one, 10 times as many lines would take 100
+    // times as long.
+    for (size_t numLines = 1000; numLines <= 100000; numLines *= 10) {
+        char *source = make_chain(numLines, false);
+
+        double seconds;
+        Sheet *sheet = scan_source(source, &seconds);
+
+        printf("Connected %zu nodes with %zu wires in %f seconds.\n",
+               sheet->graph.numNodes, sheet->graph.numWires, seconds);
+
+        // Each line after the first goes into two nodes, and each wire is
+        // stored in both directions.
+        ASSERT_EQUAL(sheet->graph.numNodes, 2 * numLines - 1)
+        ASSERT_EQUAL(sheet->graph.numWires, 4 * (numLines - 1))
+
+        d_sheet_free(sheet);
+        free(source);
+    }
+
+    ASSERT_EQUAL(d_error_report(), false)
+
+    // Now check a line that isn't defined is still found.
+    char *source = make_chain(100000, true);
+
+    double seconds;
+    START_CAPTURE_STDOUT()
+    Sheet *sheet   = scan_source(source, &seconds);
+    bool hasErrors = d_error_report();
+    STOP_CAPTURE_STDOUT()
+
+    ASSERT_EQUAL(hasErrors, true)
+    ASSERT_CAPTURED_STDOUT("Fatal: (chain.dc:200000) Undefined line "
+                           "identifier 200000\n")
+
+    d_sheet_free(sheet);
+    free(source);
+    d_error_free();
+
+    // Each extra connection to a socket gets its own error.
+    START_CAPTURE_STDOUT()
+    sheet     = scan_source("Start~#1\n"
+                            "Add(1, 2)~#2\n"
+                            "Add(3, 4)~#2\n"
+                            "Add(5, 6)~#2\n"
+                            "Print(#1, #2)\n",
+                            &seconds);
+    hasErrors = d_error_report();
+    STOP_CAPTURE_STDOUT()
+
+    ASSERT_EQUAL(hasErrors, true)
+    ASSERT_CAPTURED_STDOUT(
+        "Fatal: (chain.dc:5) Input non-execution socket (#1) has more than "
+        "one connection (has 2, on lines 2, 3)\n"
+        "Fatal: (chain.dc:5) Input non-execution socket (#1) has more than "
+        "one connection (has 3, on lines 2, 3, 4)\n")
+
+    d_sheet_free(sheet);
+    d_error_free();
+
+    return 0;
+}
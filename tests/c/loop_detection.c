@@ -0,0 +1,169 @@
+/*
+    Decision
+    Copyright (C) 2019-2020  Benjamin Beddows
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <derror.h>
+#include <dgraph.h>
+#include <dmalloc.h>
+#include <dsemantic.h>
+#include <dsheet.h>
+
+#include "assert.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// A node with no inputs, that starts every path.
+static const SocketMeta ROOT_SOCKETS[] = {
+    {"left", "", TYPE_INT, {0}},
+    {"right", "", TYPE_INT, {0}},
+};
+
+static const NodeDefinition ROOT_DEFINITION = {"Root", "", ROOT_SOCKETS, 2, 0,
+                                               false};
+
+// A node with two inputs and two outputs.
+static const SocketMeta CROSS_SOCKETS[] = {
+    {"a", "", TYPE_INT, {0}},
+    {"b", "", TYPE_INT, {0}},
+    {"left", "", TYPE_INT, {0}},
+    {"right", "", TYPE_INT, {0}},
+};
+
+static const NodeDefinition CROSS_DEFINITION = {"Cross", "", CROSS_SOCKETS, 4,
+                                                2, false};
+
+/**
+ * \fn static int compare_wires(const void *a, const void *b)
+ * \brief Compare two wires for `qsort`.
+ *
+ * \return The result of `d_wire_cmp` on the wires.
+ *
+ * \param a The first wire.
+ * \param b The second wire.
+ */
+static int compare_wires(const void *a, const void *b) {
+    return d_wire_cmp(*(const Wire *)a, *(const Wire *)b);
+}
+
+/**
+ * \fn static Sheet *make_ladder(size_t numRungs, bool loop)
+ * \brief Make a sheet whose graph is a ladder of nodes, two nodes wide, where
+ * both nodes of each rung are wired to both nodes of the next rung.
+ *
+ * There are 2^numRungs paths from the root to the last rung, so searching
+ * every path separately never finishes for big ladders.
+ *
+ * \return A sheet containing the graph.
+ *
+ * \param numRungs How many rungs of two nodes the ladder has.
+ * \param loop If true, the last rung is also wired back to the first rung.
+ */
+static Sheet *make_ladder(size_t numRungs, bool loop) {
+    Sheet *sheet = d_sheet_create("ladder.dc");
+
+    const size_t numNodes = 1 + 2 * numRungs;
+
+    // Like in d_graph_add_wire, every wire is stored in both directions.
+    const size_t numWires = 2 * (2 + 4 * (numRungs - 1) + (loop ? 1 : 0));
+
+    sheet->graph.nodes    = d_calloc(numNodes, sizeof(Node));
+    sheet->graph.numNodes = numNodes;
+    sheet->graph.wires    = d_calloc(numWires, sizeof(Wire));
+    sheet->graph.numWires = numWires;
+
+    for (size_t i = 0; i < numNodes; i++) {
+        const NodeDefinition *nodeDef =
+            (i == 0) ? &ROOT_DEFINITION : &CROSS_DEFINITION;
+
+        Node *node             = sheet->graph.nodes + i;
+        node->definition       = nodeDef;
+        node->lineNum          = i + 1;
+        node->startOutputIndex = nodeDef->startOutputIndex;
+    }
+
+    size_t wireIndex = 0;
+
+    for (size_t i = 0; i < numNodes; i++) {
+        size_t numOutputs = d_node_num_outputs(sheet->graph, i);
+        size_t numInputs  = d_node_num_inputs(sheet->graph, i);
+
+        // The nodes of the next rung.
+        size_t left = (i == 0) ? 1 : 2 * ((i + 1) / 2) + 1;
+
+        if (left >= numNodes) {
+            // This is the last rung, wire the right node back to the start.
+            if (loop && i == numNodes - 1) {
+                Wire wire = {{i, numInputs + 1}, {1, 1}};
+                Wire back = {wire.socketTo, wire.socketFrom};
+                sheet->graph.wires[wireIndex++] = wire;
+                sheet->graph.wires[wireIndex++] = back;
+            }
+
+            continue;
+        }
+
+        for (size_t j = 0; j < numOutputs; j++) {
+            Wire wire = {{i, numInputs + j}, {left + j, (i % 2 == 0) ? 1 : 0}};
+            Wire back = {wire.socketTo, wire.socketFrom};
+            sheet->graph.wires[wireIndex++] = wire;
+            sheet->graph.wires[wireIndex++] = back;
+        }
+    }
+
+    // The wires need to be in lexicographical order.
+    qsort(sheet->graph.wires, numWires, sizeof(Wire), compare_wires);
+
+    return sheet;
+}
+
+int main() {
+    // Check there are no false positives, and how long each size takes.
+    for (size_t numRungs = 500; numRungs <= 50000; numRungs *= 10) {
+        Sheet *sheet = make_ladder(numRungs, false);
+
+        clock_t start = clock();
+        d_semantic_detect_loops(sheet);
+        clock_t end = clock();
+
+        printf("Searched %zu nodes and %zu wires for loops in %f seconds.\n",
+               sheet->graph.numNodes, sheet->graph.numWires,
+               (double)(end - start) / CLOCKS_PER_SEC);
+
+        d_sheet_free(sheet);
+    }
+
+    ASSERT_EQUAL(d_error_report(), false)
+
+    // Now check the loop is found, and where it was found.
+    Sheet *sheet = make_ladder(50000, true);
+
+    START_CAPTURE_STDOUT()
+    d_semantic_detect_loops(sheet);
+    bool hasErrors = d_error_report();
+    STOP_CAPTURE_STDOUT()
+
+    ASSERT_EQUAL(hasErrors, true)
+    ASSERT_CAPTURED_STDOUT("Fatal: (ladder.dc:2) Detected loop entering node "
+                           "Cross\n")
+
+    d_sheet_free(sheet);
+    d_error_free();
+
+    return 0;
+}
@@ -0,0 +1,210 @@
+/*
+    Decision
+    Copyright (C) 2019-2020  Benjamin Beddows
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <decision.h>
+#include <derror.h>
+#include <dmalloc.h>
+#include <dname.h>
+#include <dsheet.h>
+
+#include "assert.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// How many libraries the main sheet includes, and how many variables each
+// library has.
+#define NUM_LIBRARIES 10
+#define NUM_VARIABLES 200
+
+/**
+ * \fn static void write_library(size_t index)
+ * \brief Write a library with a lot of variables. Every library also includes
+ * the same base library.
+ *
+ * \param index The index of the library.
+ */
+static void write_library(size_t index) {
+    char filePath[32];
+    sprintf(filePath, "names_lib%zu.dc", index);
+
+    FILE *file = fopen(filePath, "w");
+    fprintf(file, "[Include(\"names_base.dc\")]\n");
+
+    for (size_t i = 0; i < NUM_VARIABLES; i++) {
+        fprintf(file, "[Variable(lib%zu_%zu, Integer, %zu)]\n", index, i,
+                index * NUM_VARIABLES + i);
+    }
+
+    // Two of the libraries define the same variable.
+    if (index < 2) {
+        fprintf(file, "[Variable(shared, Integer, %zu)]\n", index);
+    }
+
+    fclose(file);
+}
+
+/**
+ * \fn static Sheet *load_main(const char *body)
+ * \brief Compile a sheet that includes all of the libraries.
+ *
+ * \return The compiled sheet.
+ *
+ * \param body The source code after the includes.
+ */
+static Sheet *load_main(const char *body) {
+    char *source = d_malloc(NUM_LIBRARIES * 32 + strlen(body) + 1);
+    char *end    = source;
+
+    for (size_t i = 0; i < NUM_LIBRARIES; i++) {
+        end += sprintf(end, "[Include(\"names_lib%zu.dc\")]\n", i);
+    }
+
+    strcpy(end, body);
+
+    Sheet *sheet = d_load_string(source, "names_main.dc", NULL);
+    free(source);
+
+    return sheet;
+}
+
+/**
+ * \fn static size_t count_definitions(Sheet *sheet, const char *name)
+ * \brief Count how many definitions a name has in a sheet.
+ *
+ * \return The number of definitions of the name.
+ *
+ * \param sheet The sheet to look in.
+ * \param name The name to look for.
+ */
+static size_t count_definitions(Sheet *sheet, const char *name) {
+    AllNameDefinitions definitions = d_get_name_definitions(sheet, name);
+    size_t numDefinitions          = definitions.numDefinitions;
+    d_free_name_definitions(&definitions);
+
+    return numDefinitions;
+}
+
+int main() {
+    FILE *base = fopen("names_base.dc", "w");
+    fprintf(base, "[Variable(baseValue, Integer, 7)]\n");
+    fclose(base);
+
+    for (size_t i = 0; i < NUM_LIBRARIES; i++) {
+        write_library(i);
+    }
+
+    // Variables from any of the libraries can be used.
+    Sheet *sheet = load_main("Start~#1\n"
+                             "lib9_199~#2\n"
+                             "Print(#1, #2)~#3\n"
+                             "lib0_0~#4\n"
+                             "Print(#3, #4)\n");
+    ASSERT_EQUAL(sheet->hasErrors, false)
+
+    // Names are found in the sheet they are defined in.
+    AllNameDefinitions definitions = d_get_name_definitions(sheet, "lib5_100");
+    ASSERT_EQUAL(definitions.numDefinitions, 1)
+    ASSERT_EQUAL(definitions.definitions[0].type, NAME_VARIABLE)
+    ASSERT_EQUAL(definitions.definitions[0].sheet, sheet->includes[5])
+    d_free_name_definitions(&definitions);
+
+    // Core functions are found in the sheet they are looked up from.
+    definitions = d_get_name_definitions(sheet, "Add");
+    ASSERT_EQUAL(definitions.numDefinitions, 1)
+    ASSERT_EQUAL(definitions.definitions[0].type, NAME_CORE)
+    ASSERT_EQUAL(definitions.definitions[0].sheet, sheet)
+    d_free_name_definitions(&definitions);
+
+    // The base library is included by every library, so it is found once for
+    // each of them.
+    size_t numBaseDefinitions = count_definitions(sheet, "baseValue");
+    ASSERT_EQUAL(numBaseDefinitions, NUM_LIBRARIES)
+
+    size_t numSharedDefinitions = count_definitions(sheet, "shared");
+    ASSERT_EQUAL(numSharedDefinitions, 2)
+
+    size_t numUndefined = count_definitions(sheet, "undefined");
+    ASSERT_EQUAL(numUndefined, 0)
+
+    // Look up every name a lot of times.
+    char name[32];
+    size_t numFound = 0;
+
+    clock_t start = clock();
+
+    for (size_t repeat = 0; repeat < 10; repeat++) {
+        for (size_t i = 0; i < NUM_LIBRARIES; i++) {
+            for (size_t j = 0; j < NUM_VARIABLES; j++) {
+                sprintf(name, "lib%zu_%zu", i, j);
+                numFound += count_definitions(sheet, name);
+            }
+        }
+    }
+
+    clock_t end = clock();
+
+    printf("Looked up %zu names in %f seconds.\n", numFound,
+           (double)(end - start) / CLOCKS_PER_SEC);
+    ASSERT_EQUAL(numFound, 10 * NUM_LIBRARIES * NUM_VARIABLES)
+
+    START_CAPTURE_STDOUT()
+    d_run_sheet(sheet);
+    STOP_CAPTURE_STDOUT()
+    ASSERT_CAPTURED_STDOUT("1999\n0\n")
+
+    // Names added to an included sheet after the table was built are found.
+    SocketMeta newMeta;
+    newMeta.name                      = "newName";
+    newMeta.description               = NULL;
+    newMeta.type                      = TYPE_INT;
+    newMeta.defaultValue.integerValue = 0;
+
+    d_sheet_add_variable(sheet->includes[3], newMeta);
+
+    size_t numNewDefinitions = count_definitions(sheet, "newName");
+    ASSERT_EQUAL(numNewDefinitions, 1)
+
+    d_sheet_free(sheet);
+
+    // Names that are defined more than once are errors.
+    START_CAPTURE_STDOUT()
+    sheet = load_main("shared~#1\n"
+                      "baseValue~#2\n");
+    STOP_CAPTURE_STDOUT()
+
+    ASSERT_EQUAL(sheet->hasErrors, true)
+    ASSERT_CAPTURED_STDOUT(
+        "Fatal: (names_main.dc:11) Name shared defined multiple times\n"
+        "Fatal: (names_main.dc:11) Undefined node shared\n"
+        "Fatal: (names_main.dc:12) Name baseValue defined multiple times\n"
+        "Fatal: (names_main.dc:12) Undefined node baseValue\n")
+
+    d_sheet_free(sheet);
+
+    remove("names_base.dc");
+    for (size_t i = 0; i < NUM_LIBRARIES; i++) {
+        char filePath[32];
+        sprintf(filePath, "names_lib%zu.dc", i);
+        remove(filePath);
+    }
+
+    return 0;
+}
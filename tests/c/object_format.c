@@ -0,0 +1,220 @@
+/*
+    Decision
+    Copyright (C) 2019-2020  Benjamin Beddows
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <decision.h>
+#include <derror.h>
+#include <dmalloc.h>
+#include <dobj.h>
+#include <dsheet.h>
+#include <dvm.h>
+
+#include "assert.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// A sheet with a variable of each kind, and a function.
+static const char *SOURCE = "[Variable(count, Integer, 3)]\n"
+                            "[Variable(greeting, String, \"Hi\")]\n"
+                            "[Function(Twice, \"Doubles a number.\")]\n"
+                            "[FunctionInput(Twice, n, Integer, 0)]\n"
+                            "[FunctionOutput(Twice, result, Integer)]\n"
+                            "Define(Twice)~#1\n"
+                            "Multiply(#1, 2)~#2\n"
+                            "Return(Twice, #2)\n"
+                            "Start~#10\n"
+                            "count~#9\n"
+                            "Twice(#9)~#11\n"
+                            "Print(#10, #11)~#12\n"
+                            "greeting~#8\n"
+                            "Print(#12, #8)\n";
+
+#ifndef DECISION_32
+// SOURCE compiled by the Decision 0.3.0 release on a 64-bit build, before
+// object files had a section table or recorded their calling convention.
+// Callers in this text don't reserve space for the call frame.
+static const unsigned char LEGACY_OBJECT[] = {
+    0x44, 0x36, 0x34, 0x00, 0x03, 0x00, 0x2e, 0x74, 0x65, 0x78, 0x74, 0x2c,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x29, 0x01, 0x3f, 0x02,
+    0x01, 0x01, 0x00, 0x20, 0xf0, 0x5f, 0x00, 0xce, 0x97, 0x55, 0x00, 0x00,
+    0x10, 0xf0, 0x01, 0x4b, 0x01, 0x4b, 0x00, 0x58, 0x00, 0x47, 0x20, 0xf8,
+    0x5f, 0x00, 0xce, 0x97, 0x55, 0x00, 0x00, 0x4b, 0x01, 0x4b, 0x02, 0x58,
+    0x00, 0x47, 0x00, 0x2e, 0x6d, 0x61, 0x69, 0x6e, 0x08, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x2e, 0x64, 0x61, 0x74, 0x61, 0x13, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x60, 0x00, 0xce, 0x97, 0x55, 0x00, 0x00, 0x48, 0x69, 0x00,
+    0x2e, 0x6c, 0x6d, 0x65, 0x74, 0x61, 0x05, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x01, 0x63, 0x6f, 0x75, 0x6e, 0x74, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x67, 0x72, 0x65, 0x65, 0x74, 0x69,
+    0x6e, 0x67, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03,
+    0x67, 0x72, 0x65, 0x65, 0x74, 0x69, 0x6e, 0x67, 0x00, 0x10, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x69, 0x00, 0x10, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x54, 0x77, 0x69, 0x63, 0x65, 0x00,
+    0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x2e, 0x6c, 0x69, 0x6e,
+    0x6b, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x1b, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x2e, 0x66, 0x75, 0x6e, 0x63, 0x01, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x44, 0x6f, 0x75, 0x62, 0x6c, 0x65, 0x73, 0x20, 0x61, 0x20,
+    0x6e, 0x75, 0x6d, 0x62, 0x65, 0x72, 0x2e, 0x00, 0x02, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x6e, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x72, 0x65, 0x73, 0x75, 0x6c, 0x74, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x2e, 0x76, 0x61, 0x72, 0x02, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x02, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x08};
+#endif // DECISION_32
+
+/**
+ * \fn static char *read_file(const char *filePath, size_t *size)
+ * \brief Read the contents of a binary file.
+ *
+ * \return The malloc'd contents of the file.
+ *
+ * \param filePath The file to read.
+ * \param size Overwritten with the size of the file.
+ */
+static char *read_file(const char *filePath, size_t *size) {
+    FILE *file = fopen(filePath, "rb");
+    fseek(file, 0, SEEK_END);
+    *size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char *contents = d_malloc(*size);
+    fread(contents, 1, *size, file);
+    fclose(file);
+
+    return contents;
+}
+
+/**
+ * \fn static int run_object(const char *filePath)
+ * \brief Load an object file, and check it runs properly.
+ *
+ * \return 0 if the object ran like SOURCE should, 1 otherwise.
+ *
+ * \param filePath The object file to run.
+ */
+static int run_object(const char *filePath) {
+    Sheet *sheet = d_load_object_file(filePath, NULL);
+    ASSERT_EQUAL(sheet->hasErrors, false)
+
+    START_CAPTURE_STDOUT()
+    d_run_sheet(sheet);
+    STOP_CAPTURE_STDOUT()
+    ASSERT_CAPTURED_STDOUT("6\nHi\n")
+
+    d_sheet_free(sheet);
+
+    return 0;
+}
+
+int main() {
+    // Object files are written with a section table.
+    d_compile_string(SOURCE, "object_format.dco", NULL);
+    ASSERT_EQUAL(d_is_object_file("object_format.dco"), 1)
+
+    if (run_object("object_format.dco") != 0) {
+        return 1;
+    }
+
+#if defined(__unix__) || defined(__APPLE__) || defined(_WIN32)
+    // Since the sections are aligned, the data section can be used in place
+    // as well as the text section.
+    Sheet *sheet = d_load_object_file("object_format.dco", NULL);
+    ASSERT_EQUAL(sheet->_mapping != NULL, true)
+
+    bool dataMapped = sheet->_data >= sheet->_mapping &&
+                      sheet->_data < sheet->_mapping + sheet->_mappingSize;
+    ASSERT_EQUAL(dataMapped, true)
+
+    d_sheet_free(sheet);
+#endif
+
+    // Symbols can be found without loading the object.
+    size_t size;
+    char *obj = read_file("object_format.dco", &size);
+
+    size_t offset = 0;
+    ASSERT_EQUAL(d_obj_find_symbol(obj, size, "Twice", LINK_FUNCTION, &offset),
+                 true)
+    ASSERT_EQUAL(d_obj_find_symbol(obj, size, "count", LINK_VARIABLE, NULL),
+                 true)
+    ASSERT_EQUAL(d_obj_find_symbol(obj, size, "greeting",
+                                   LINK_VARIABLE_POINTER, NULL),
+                 true)
+    ASSERT_EQUAL(d_obj_find_symbol(obj, size, "count", LINK_FUNCTION, NULL),
+                 false)
+    ASSERT_EQUAL(d_obj_find_symbol(obj, size, "Thrice", LINK_FUNCTION, NULL),
+                 false)
+
+    sheet = d_obj_load(obj, size, "object_format.dco", NULL, NULL);
+    ASSERT_EQUAL(sheet->hasErrors, false)
+    ASSERT_EQUAL(offset < sheet->_textSize, true)
+    d_sheet_free(sheet);
+
+    // An object file that was cut short shouldn't be loaded.
+    START_CAPTURE_STDOUT()
+    sheet = d_obj_load(obj, size / 2, "object_format.dco", NULL, NULL);
+    STOP_CAPTURE_STDOUT()
+    ASSERT_CAPTURED_STDOUT("object_format.dco cannot be loaded: object file "
+                           "is not a valid object file.\n")
+    ASSERT_EQUAL(sheet->hasErrors, true)
+    d_sheet_free(sheet);
+
+    // Neither should one that uses a calling convention we don't know about.
+    // The convention is stored after the magic, the format and the version.
+    obj[9] = (char)(VM_CALL_CONVENTION + 1);
+
+    START_CAPTURE_STDOUT()
+    sheet = d_obj_load(obj, size, "object_format.dco", NULL, NULL);
+    STOP_CAPTURE_STDOUT()
+    ASSERT_CAPTURED_STDOUT("object_format.dco cannot be loaded: object file "
+                           "uses calling convention 2, which is newer than "
+                           "this version of Decision supports.\n")
+    ASSERT_EQUAL(sheet->hasErrors, true)
+    d_sheet_free(sheet);
+
+    free(obj);
+
+#ifndef DECISION_32
+    // Object files from before the section table was added can still be
+    // loaded, even though their callers use the older calling convention.
+    FILE *file = fopen("object_format_legacy.dco", "wb");
+    fwrite(LEGACY_OBJECT, 1, sizeof(LEGACY_OBJECT), file);
+    fclose(file);
+
+    ASSERT_EQUAL(d_is_object_file("object_format_legacy.dco"), 1)
+
+    if (run_object("object_format_legacy.dco") != 0) {
+        return 1;
+    }
+
+    // They don't have a symbol table, though.
+    ASSERT_EQUAL(d_obj_find_symbol((const char *)LEGACY_OBJECT,
+                                   sizeof(LEGACY_OBJECT), "Twice",
+                                   LINK_FUNCTION, NULL),
+                 false)
+#endif // DECISION_32
+
+    ASSERT_EQUAL(d_error_report(), false)
+
+    return 0;
+}
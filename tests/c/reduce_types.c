@@ -0,0 +1,287 @@
+/*
+    Decision
+    Copyright (C) 2019-2020  Benjamin Beddows
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <derror.h>
+#include <dlex.h>
+#include <dmalloc.h>
+#include <dsemantic.h>
+#include <dsheet.h>
+#include <dsyntax.h>
+
+#include "assert.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The sheets in the tests folder mostly flow from top to bottom, so these
+// sheets make the types flow the other way, which takes more than one pass.
+static const char *BACKWARDS =
+    "Multiply(#4, 2)~#5\n"
+    "Add(#3, 1)~#4\n"
+    "Subtract(#2, 1)~#3\n"
+    "Add(#1, 2.5)~#2\n"
+    "Add(1, 2)~#1\n"
+    "Start~#6\n"
+    "Print(#6, #5)\n";
+
+static const char *BACKWARDS_ERRORS = "Add(#3, 2.5)~#1\n"
+                                      "Mod(#1, 2)~#2\n"
+                                      "Multiply(#2, 3)~#3\n"
+                                      "Subtract(#5, 1)~#4\n"
+                                      "Add(#4, #4)~#5\n";
+
+/**
+ * \fn static char *read_file(const char *filePath, bool newline)
+ * \brief Read the contents of a file into a string.
+ *
+ * \return The malloc'd contents of the file, or `NULL` if it can't be read.
+ *
+ * \param filePath The path of the file to read.
+ * \param newline If true, put a newline at the end, like `d_load_file` does
+ * with source files.
+ */
+static char *read_file(const char *filePath, bool newline) {
+    FILE *file = fopen(filePath, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char *contents = d_calloc((size_t)size + 2, sizeof(char));
+    size_t numRead = fread(contents, 1, (size_t)size, file);
+
+    if (newline) {
+        contents[numRead++] = '\n';
+    }
+
+    contents[numRead] = '\0';
+
+    fclose(file);
+    return contents;
+}
+
+/**
+ * \fn static bool reduce_every_pass(Sheet *sheet)
+ * \brief Reduce the types of a sheet the simple way, by going over every node
+ * that isn't reduced yet, again and again, until they all are.
+ *
+ * \return If all of the nodes were reduced. If not, the simple way would have
+ * kept going forever.
+ *
+ * \param sheet The sheet to reduce the types on.
+ */
+static bool reduce_every_pass(Sheet *sheet) {
+    const size_t numNodes = sheet->graph.numNodes;
+    bool *nodeReduced     = d_calloc(numNodes + 1, sizeof(bool));
+
+    bool allReduced = false;
+
+    for (size_t pass = 0; !allReduced && pass <= 4 * numNodes; pass++) {
+        allReduced = true;
+
+        for (size_t i = 0; i < numNodes; i++) {
+            if (!nodeReduced[i]) {
+                allReduced     = false;
+                nodeReduced[i] = d_semantic_reduce_node(sheet, i);
+            }
+        }
+    }
+
+    free(nodeReduced);
+    return allReduced;
+}
+
+/**
+ * \fn static Sheet *scan_sheet(const char *filePath, const char *source,
+ *                              bool everyPass, char **errors)
+ * \brief Scan a sheet up to and including reducing its types.
+ *
+ * \return The scanned sheet, or `NULL` if its syntax was wrong.
+ *
+ * \param filePath The path of the sheet.
+ * \param source The source code of the sheet.
+ * \param everyPass If true, reduce the types with `reduce_every_pass`.
+ * Otherwise, use `d_semantic_reduce_types`.
+ * \param errors Set to the malloc'd errors that were reported.
+ */
+static Sheet *scan_sheet(const char *filePath, const char *source,
+                         bool everyPass, char **errors) {
+    Sheet *sheet = d_sheet_create(filePath);
+
+    START_CAPTURE_STDOUT()
+
+    LexStream stream    = d_lex_create_stream(source, filePath);
+    DArena *arena       = d_arena_create(0);
+    SyntaxResult result = d_syntax_parse(stream, filePath, arena);
+
+    if (result.success) {
+        d_semantic_scan_properties(sheet, result.node, NULL, false);
+        d_semantic_scan_nodes(sheet, result.node);
+
+        if (everyPass) {
+            if (!reduce_every_pass(sheet)) {
+                printf("Reducing the types never finished.\n");
+            }
+        } else {
+            d_semantic_reduce_types(sheet);
+        }
+    }
+
+    d_error_report();
+    d_error_free();
+
+    d_arena_free(arena);
+    d_lex_free_stream(stream);
+
+    STOP_CAPTURE_STDOUT()
+
+    *errors = read_file(CAPTURED_STDOUT_PATH, false);
+
+    if (!result.success) {
+        d_sheet_free(sheet);
+        free(*errors);
+        return NULL;
+    }
+
+    return sheet;
+}
+
+/**
+ * \fn static bool same_types(Sheet *a, Sheet *b)
+ * \brief Check that the sockets of two sheets were reduced to the same types.
+ *
+ * \return If every socket of every node has the same type in both sheets.
+ *
+ * \param a The first sheet.
+ * \param b The second sheet.
+ */
+static bool same_types(Sheet *a, Sheet *b) {
+    if (a->graph.numNodes != b->graph.numNodes) {
+        return false;
+    }
+
+    for (size_t i = 0; i < a->graph.numNodes; i++) {
+        size_t numSockets =
+            d_node_num_inputs(a->graph, i) + d_node_num_outputs(a->graph, i);
+
+        if (numSockets != d_node_num_inputs(b->graph, i) +
+                              d_node_num_outputs(b->graph, i)) {
+            return false;
+        }
+
+        for (size_t j = 0; j < numSockets; j++) {
+            if (a->graph.nodes[i].reducedTypes[j] !=
+                b->graph.nodes[i].reducedTypes[j]) {
+                fprintf(stderr, "Node %zu (%s) socket %zu: %s != %s\n", i,
+                       a->graph.nodes[i].definition->name, j,
+                       d_type_name(a->graph.nodes[i].reducedTypes[j]),
+                       d_type_name(b->graph.nodes[i].reducedTypes[j]));
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * \fn static int compare_sheet(const char *filePath, const char *source)
+ * \brief Reduce the types of a sheet both ways, and check they match.
+ *
+ * \return 0 if they match, 1 otherwise.
+ *
+ * \param filePath The path of the sheet.
+ * \param source The source code of the sheet.
+ */
+static int compare_sheet(const char *filePath, const char *source) {
+    char *everyPassErrors, *errors;
+    Sheet *everyPass = scan_sheet(filePath, source, true, &everyPassErrors);
+    Sheet *sheet     = scan_sheet(filePath, source, false, &errors);
+
+    // Every sheet in the tests should at least be syntactically correct.
+    if (everyPass == NULL || sheet == NULL) {
+        fprintf(stderr, "%s could not be parsed.\n", filePath);
+        return 1;
+    }
+
+    bool sameTypes  = same_types(everyPass, sheet);
+    bool sameErrors = strcmp(everyPassErrors, errors) == 0;
+
+    if (!sameTypes || !sameErrors) {
+        fprintf(stderr, "%s was reduced differently.\n", filePath);
+    }
+
+    ASSERT_EQUAL(sameTypes, true)
+    ASSERT_EQUAL(sameErrors, true)
+
+    d_sheet_free(everyPass);
+    d_sheet_free(sheet);
+    free(everyPassErrors);
+    free(errors);
+
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    // The first argument is a file listing the sheets to check, one per line.
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s SHEET_LIST\n", argv[0]);
+        return 1;
+    }
+
+    char *list = read_file(argv[1], false);
+    ASSERT_EQUAL(list == NULL, false)
+
+    // Included sheets should be scanned again each time, so both ways of
+    // reducing the types report the same errors.
+    d_include_cache_set_enabled(false);
+
+    ASSERT_EQUAL(compare_sheet("backwards.dc", BACKWARDS), 0)
+    ASSERT_EQUAL(compare_sheet("backwards_errors.dc", BACKWARDS_ERRORS), 0)
+
+    size_t numSheets = 2;
+
+    for (char *filePath = strtok(list, "\n"); filePath != NULL;
+         filePath       = strtok(NULL, "\n")) {
+        char *source = read_file(filePath, true);
+        if (source == NULL) {
+            continue;
+        }
+
+        int result = compare_sheet(filePath, source);
+        free(source);
+
+        ASSERT_EQUAL(result, 0)
+
+        numSheets++;
+    }
+
+    // stdout was closed after capturing the last sheet's errors.
+    fprintf(stderr, "Reduced the types of %zu sheets the same way.\n",
+            numSheets);
+    ASSERT_EQUAL(numSheets > 2, true)
+
+    free(list);
+
+    return 0;
+}
@@ -0,0 +1,175 @@
+/*
+    Decision
+    Copyright (C) 2019-2020  Benjamin Beddows
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <derror.h>
+#include <dlex.h>
+#include <dmalloc.h>
+#include <dsyntax.h>
+
+#include "assert.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// A statement for the parser to chew on.
+static const char *LINE = "Add(#12, 3.75, 1)~#34\n";
+
+// How many times the statement is repeated.
+#define NUM_LINES 100000
+
+/**
+ * \fn static int check_arena()
+ * \brief Check that allocations from an arena are aligned, don't overlap, and
+ * are reused after a reset.
+ *
+ * \return 0 if the checks passed, 1 otherwise.
+ */
+static int check_arena() {
+    // Use a tiny block size so we go through lots of blocks.
+    DArena *arena = d_arena_create(64);
+
+    unsigned char *allocs[100];
+    size_t sizes[100];
+
+    for (size_t i = 0; i < 100; i++) {
+        sizes[i]  = (i * 7) % 40 + 1;
+        allocs[i] = d_arena_push(arena, sizes[i]);
+
+        ASSERT_EQUAL((uintptr_t)allocs[i] % sizeof(void *), 0)
+        memset(allocs[i], (int)i, sizes[i]);
+    }
+
+    // An allocation bigger than the block size gets a block to itself.
+    unsigned char *big = d_arena_push_zero(arena, 1000, 1);
+    for (size_t i = 0; i < 1000; i++) {
+        ASSERT_EQUAL(big[i], 0)
+    }
+
+    // If any of the allocations overlapped, their contents would have been
+    // overwritten.
+    for (size_t i = 0; i < 100; i++) {
+        for (size_t j = 0; j < sizes[i]; j++) {
+            ASSERT_EQUAL(allocs[i][j], (unsigned char)i)
+        }
+    }
+
+    // After a reset, the first block gets used again.
+    d_arena_reset(arena);
+    ASSERT_EQUAL(d_arena_push(arena, sizes[0]), (void *)allocs[0])
+
+    d_arena_free(arena);
+
+    return 0;
+}
+
+/**
+ * \fn static size_t parse_and_free(const char *source, DArena *arena,
+ *                                  double *seconds)
+ * \brief Lex and parse some source code, and then free the syntax tree.
+ *
+ * The stream is lexed each time, as parsing changes the last token.
+ *
+ * \return The number of statements in the tree, or 0 if the parse failed.
+ *
+ * \param source The source code to parse.
+ * \param arena The arena to put the tree in. If `NULL`, the nodes are
+ * malloc'd.
+ * \param seconds Set to how long parsing and freeing the tree took.
+ */
+static size_t parse_and_free(const char *source, DArena *arena,
+                             double *seconds) {
+    LexStream stream = d_lex_create_stream(source, "source");
+
+    clock_t start       = clock();
+    SyntaxResult result = d_syntax_parse(stream, "source", arena);
+    clock_t end         = clock();
+
+    size_t numStatements = 0;
+
+    if (result.success) {
+        SyntaxSearchResult statements =
+            d_syntax_get_all_nodes_with(result.node, STX_statement, false);
+        numStatements = statements.numOccurances;
+        d_syntax_free_results(statements);
+    }
+
+    clock_t freeStart = clock();
+
+    if (arena != NULL) {
+        d_arena_free(arena);
+    } else if (result.node != NULL) {
+        d_syntax_free_tree(result.node);
+    }
+
+    clock_t freeEnd = clock();
+
+    *seconds =
+        (double)((end - start) + (freeEnd - freeStart)) / CLOCKS_PER_SEC;
+
+    for (size_t i = 0; i < stream.numTokens; i++) {
+        LexToken token = stream.tokenArray[i];
+
+        // Names are interned, so only string literals are malloc'd.
+        if (token.type == TK_STRINGLITERAL) {
+            free(token.data.stringValue);
+        }
+    }
+
+    d_lex_free_stream(stream);
+
+    return numStatements;
+}
+
+int main() {
+    if (check_arena() != 0) {
+        return 1;
+    }
+
+    const size_t lineLen = strlen(LINE);
+
+    char *source = d_malloc(NUM_LINES * lineLen + 1);
+
+    for (size_t i = 0; i < NUM_LINES; i++) {
+        memcpy(source + i * lineLen, LINE, lineLen);
+    }
+
+    source[NUM_LINES * lineLen] = '\0';
+
+    double mallocSeconds = 0.0;
+    double arenaSeconds  = 0.0;
+
+    size_t mallocStatements = parse_and_free(source, NULL, &mallocSeconds);
+    size_t arenaStatements =
+        parse_and_free(source, d_arena_create(0), &arenaSeconds);
+
+    ASSERT_EQUAL(mallocStatements, NUM_LINES)
+    ASSERT_EQUAL(arenaStatements, NUM_LINES)
+
+    printf("Parsed and freed %d statements in %f seconds with malloc, and %f "
+           "seconds with an arena.\n",
+           NUM_LINES, mallocSeconds, arenaSeconds);
+
+    free(source);
+
+    ASSERT_EQUAL(d_error_report(), false)
+
+    return 0;
+}
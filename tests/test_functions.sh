@@ -27,12 +27,23 @@ function testdone {
 }
 
 # A function to run a Decision file, and compare it against some output we expect.
+# The file is run in the VM, and then again with as much as possible compiled
+# to native code, and again with only the hot functions compiled to native
+# code.
 # The 1st argument is the source file.
 # The 2nd argument is the output file.
 function testdecision {
 	echo "- Running diff on $EXECUTABLE $1 and $2 ..."
 	diff $DIFF_FLAGS <("$EXECUTABLE" $1) <(cat $2)
 	testdone $?
+
+	echo "- Running diff on $EXECUTABLE --jit $1 and $2 ..."
+	diff $DIFF_FLAGS <("$EXECUTABLE" --jit $1) <(cat $2)
+	testdone $?
+
+	echo "- Running diff on $EXECUTABLE --tiered $1 and $2 ..."
+	diff $DIFF_FLAGS <("$EXECUTABLE" --tiered $1) <(cat $2)
+	testdone $?
 }
 
 # A function to compile a Decision file, run the object file, and compare it